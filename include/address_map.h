@@ -0,0 +1,95 @@
+/*
+    address_map.h
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef SATYR_ADDRESS_MAP_H
+#define SATYR_ADDRESS_MAP_H
+
+/**
+ * @file
+ * @brief Map of address ranges to the modules mapped there.
+ *
+ * The ranges are sorted when the map is searched for the first time, the
+ * lookups are done by binary search. When ranges overlap, the one added
+ * first wins, like in a linear search of the list of modules the map is
+ * built from.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+
+struct sr_address_map;
+
+/**
+ * Creates an empty map.
+ * @returns
+ * It never returns NULL. The returned pointer must be released by
+ * sr_address_map_free().
+ */
+struct sr_address_map *
+sr_address_map_new(void);
+
+/**
+ * Releases the memory held by the map. The modules are not released.
+ * @param map
+ * If map is NULL, no operation is performed.
+ */
+void
+sr_address_map_free(struct sr_address_map *map);
+
+/**
+ * Adds a range of addresses.
+ * @param first
+ * The first address of the range.
+ * @param last
+ * The last address of the range, included in it. Ranges with the last
+ * address lower than the first one are ignored.
+ * @param module
+ * The value returned by sr_address_map_find() for the addresses of the
+ * range.
+ */
+void
+sr_address_map_add(struct sr_address_map *map,
+                   uint64_t first,
+                   uint64_t last,
+                   void *module);
+
+/**
+ * Returns the number of ranges in the map.
+ */
+int
+sr_address_map_size(struct sr_address_map *map);
+
+/**
+ * Finds the module mapped at the address.
+ * @returns
+ * The module of the first added range containing the address, NULL if
+ * there is none.
+ */
+void *
+sr_address_map_find(struct sr_address_map *map,
+                    uint64_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
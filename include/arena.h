@@ -0,0 +1,113 @@
+/*
+    arena.h
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef SATYR_ARENA_H
+#define SATYR_ARENA_H
+
+/**
+ * @file
+ * @brief Memory arena for parsing many stack traces at once.
+ *
+ * The stack traces parsed into an arena are allocated from large blocks
+ * of memory together with their threads, frames and strings, and all
+ * of them are released at once by sr_arena_free(). This avoids the
+ * separate allocation of every part of a stack trace and the walk over
+ * all of them when it is released, which dominate when many stack
+ * traces are loaded only to be inspected.
+ *
+ * The stack traces in an arena can be modified, normalized and
+ * released like any other, for example by sr_stacktrace_free(), which
+ * then releases only the memory they took from the heap afterwards,
+ * such as the names given to frames by the normalization.  The arena
+ * memory is released by sr_arena_free() alone, and the stack traces
+ * must not be used after it.  An arena can be used by a single thread
+ * at a time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "report_type.h"
+
+#include <json.h>
+#include <stddef.h>
+
+struct sr_arena;
+struct sr_stacktrace;
+
+/**
+ * Creates an empty arena.
+ * @returns
+ * It never returns NULL. The returned pointer must be released by
+ * sr_arena_free().
+ */
+struct sr_arena *
+sr_arena_new(void);
+
+/**
+ * Releases the arena with all the stack traces parsed into it.
+ * @param arena
+ * If arena is NULL, no operation is performed.
+ */
+void
+sr_arena_free(struct sr_arena *arena);
+
+/**
+ * Returns the number of bytes allocated from the arena.
+ */
+size_t
+sr_arena_size(struct sr_arena *arena);
+
+/**
+ * Parses the stack trace like sr_stacktrace_parse() into the arena.
+ * The memory used by a stack trace that fails to parse is released
+ * only with the arena.
+ */
+struct sr_stacktrace *
+sr_arena_stacktrace_parse(struct sr_arena *arena,
+                          enum sr_report_type type,
+                          const char *input,
+                          char **error_message);
+
+/**
+ * Deserializes the stack trace like sr_stacktrace_from_json() into the
+ * arena.
+ */
+struct sr_stacktrace *
+sr_arena_stacktrace_from_json(struct sr_arena *arena,
+                              enum sr_report_type type,
+                              json_object *root,
+                              char **error_message);
+
+/**
+ * Deserializes the stack trace like sr_stacktrace_from_json_text() into
+ * the arena.
+ */
+struct sr_stacktrace *
+sr_arena_stacktrace_from_json_text(struct sr_arena *arena,
+                                   enum sr_report_type type,
+                                   const char *input,
+                                   char **error_message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
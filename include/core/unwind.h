@@ -29,17 +29,174 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 struct sr_core_stacktrace;
 struct sr_gdb_stacktrace;
 struct sr_core_stracetrace_unwind_state;
+struct sr_unwind_session;
+struct sr_core_stream;
+
+/**
+ * @brief Options of unwinding of the threads of a coredump.
+ */
+struct sr_core_unwind_options
+{
+    /* Maximal number of threads of the process unwound concurrently.
+     * Every concurrent unwinder opens the coredump on its own. Zero means
+     * the number of available processors. */
+    unsigned nthreads;
+    /* Only the thread that received the signal is unwound. */
+    bool crash_thread_only;
+    /* Maximal number of frames unwound in every thread, the innermost
+     * frames are kept. Zero means no limit. */
+    unsigned max_thread_frames;
+    /* Maximal number of frames unwound in all threads together. Zero
+     * means no limit. */
+    unsigned max_frames;
+    /* Time limit of the unwinding in milliseconds. Zero means no limit. */
+    unsigned timeout_ms;
+    /* When the coredump is read from a stream, the memory segments larger
+     * than this number of bytes are left out unless a register of a
+     * thread points into them, like the stack pointers do. The smaller
+     * segments are all kept, so with the default of 16 MiB, the whole
+     * stacks of the threads and most of the data of the process stay in
+     * memory, not only the pages the unwinder reads. Zero means that all
+     * segments are kept. */
+    uint64_t stream_segment_limit;
+    /* Maximal number of bytes of the notes and the segments kept in
+     * memory when the coredump is read from a stream. Larger coredumps
+     * are rejected. Zero means no limit besides the address space. */
+    uint64_t stream_image_limit;
+};
+
+/**
+ * Sets the options to their defaults, the ones used by
+ * sr_parse_coredump().
+ */
+void
+sr_core_unwind_options_init(struct sr_core_unwind_options *options);
 
 struct sr_core_stacktrace *
 sr_parse_coredump(const char *coredump_filename,
                   const char *executable_filename,
                   char **error_message);
 
+/**
+ * Unwinds the threads of a coredump like sr_parse_coredump() does. The
+ * threads of the result are in the same order whatever the options are.
+ * When the total frame or time limit is reached, the threads being
+ * unwound are cut short and the threads not started yet are left out of
+ * the stacktrace.
+ */
+struct sr_core_stacktrace *
+sr_parse_coredump_with_options(const char *coredump_filename,
+                               const char *executable_filename,
+                               const struct sr_core_unwind_options *options,
+                               char **error_message);
+
+/**
+ * Creates a session for unwinding many coredumps. The session remembers
+ * where the ELF files of the modules were found by their build ids and
+ * the function names at the addresses of the modules, so that cores of
+ * the same binaries are unwound faster. The files that were not found
+ * are not searched for again within the session.
+ * @returns
+ * It never returns NULL. The returned pointer must be released by
+ * sr_unwind_session_free().
+ */
+struct sr_unwind_session *
+sr_unwind_session_new(void);
+
+/**
+ * Releases the session.
+ * @param session
+ * If session is NULL, no operation is performed.
+ */
+void
+sr_unwind_session_free(struct sr_unwind_session *session);
+
+/**
+ * Unwinds the threads of a coredump like sr_parse_coredump_with_options()
+ * does, reusing what the session has learned from the previous cores.
+ * The function can be called from multiple threads with the same session
+ * at the same time.
+ * @param session
+ * If session is NULL, nothing is reused.
+ * @param options
+ * If options is NULL, the defaults are used.
+ */
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump(struct sr_unwind_session *session,
+                                 const char *coredump_filename,
+                                 const char *executable_filename,
+                                 const struct sr_core_unwind_options *options,
+                                 char **error_message);
+
+/**
+ * Creates a stream reading the coredump from the file descriptor, which
+ * may be a pipe. A coredump compressed by zstd is decompressed while it
+ * is read, if satyr is built with libzstd. The parts of a seekable file
+ * that are not needed are skipped without reading them.
+ * @param fd
+ * The descriptor stays open when the stream is released.
+ * @returns
+ * It never returns NULL. The returned pointer must be released by
+ * sr_core_stream_free().
+ */
+struct sr_core_stream *
+sr_core_stream_new_fd(int fd);
+
+/**
+ * Creates a stream of a coredump provided by the callbacks.
+ * @param read
+ * Reads at most size bytes of the coredump to the buffer and returns
+ * their number. Returns 0 at the end of the coredump and -1 with errno
+ * set on failure.
+ * @param skip
+ * Moves forward by size bytes without reading them and returns true.
+ * Returns false if the source cannot do that, the bytes are then read
+ * and thrown away. Can be NULL.
+ * @param data
+ * Passed to the callbacks.
+ */
+struct sr_core_stream *
+sr_core_stream_new(ssize_t (*read)(void *data, void *buffer, size_t size),
+                   bool (*skip)(void *data, uint64_t size),
+                   void *data);
+
+/**
+ * Releases the stream.
+ * @param stream
+ * If stream is NULL, no operation is performed.
+ */
+void
+sr_core_stream_free(struct sr_core_stream *stream);
+
+/**
+ * Unwinds the threads of a coredump read from the stream in a single
+ * pass, without storing it to a file. Only the notes and the memory
+ * segments needed for unwinding are kept in memory, see
+ * sr_core_unwind_options.stream_segment_limit and
+ * sr_core_unwind_options.stream_image_limit. The segments left out
+ * after the last kept one are not read at all. Memory of the segments
+ * left out cannot be read while unwinding, as if it were not dumped.
+ * The coredump must come from a machine of the architecture satyr runs
+ * on.
+ * @param session
+ * If session is NULL, nothing is reused.
+ * @param options
+ * If options is NULL, the defaults are used.
+ */
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump_stream(struct sr_unwind_session *session,
+                                        struct sr_core_stream *stream,
+                                        const char *executable_filename,
+                                        const struct sr_core_unwind_options *options,
+                                        char **error_message);
+
 struct sr_core_stacktrace *
 sr_core_stacktrace_from_gdb(const char *gdb_output,
                             const char *coredump_filename,
@@ -91,6 +91,25 @@ sr_distance(enum sr_distance_type distance_type,
             struct sr_thread *thread1,
             struct sr_thread *thread2);
 
+/**
+ * Computes the distance of two threads if it is within a bound. This is
+ * faster than sr_distance() when only the distances within the bound are
+ * of interest, the computation stops once the bound is known to be
+ * exceeded.
+ * @param max_distance
+ * The bound. The Jaro-Winkler distance is a similarity, it is always
+ * computed exactly.
+ * @returns
+ * The same value as sr_distance() if it is not greater than max_distance.
+ * Otherwise a value greater than max_distance, which is not greater than
+ * the distance.
+ */
+float
+sr_distance_bounded(enum sr_distance_type distance_type,
+                    struct sr_thread *thread1,
+                    struct sr_thread *thread2,
+                    float max_distance);
+
 /**
  * @brief A distance matrix of stack trace threads.
  *
@@ -102,6 +121,23 @@ struct sr_distances
     int m;
     int n;
     float *distances;
+    /* Mapping of the file the distances were loaded from by
+     * sr_distances_load(), NULL if they are allocated on the heap. */
+    void *mapping;
+    size_t mapping_size;
+};
+
+/**
+ * @brief Encodings of the distances in a file.
+ */
+enum sr_distances_encoding
+{
+    /* Single precision floats, the file can be mapped without copying. */
+    SR_DISTANCES_FLOAT32,
+    /* Half precision floats. */
+    SR_DISTANCES_FLOAT16,
+    /* Distances between 0 and 1 quantized to 256 levels. */
+    SR_DISTANCES_UINT8,
 };
 
 /**
@@ -169,7 +205,10 @@ sr_distances_set_distance(struct sr_distances *distances,
                           float d);
 
 /**
- * Creates a distances structure by comparing threads.
+ * Creates a distances structure by comparing threads. Threads with
+ * the same frames with respect to the distance are compared with other
+ * threads only once when it saves enough work, the distances of their
+ * duplicates are copied.
  * @param threads
  * Array of threads. They are not modified by calling this function.
  * @param m
@@ -185,6 +224,70 @@ struct sr_distances *
 sr_threads_compare(struct sr_thread **threads, int m, int n,
                    enum sr_distance_type dist_type);
 
+/**
+ * Creates a distances structure like sr_threads_compare(), but the
+ * distances greater than max_distance are not computed exactly, see
+ * sr_distance_bounded(). Cutting the dendrogram of single or complete
+ * linkage clustering of the distances at a level not greater than
+ * max_distance gives the same clusters as with the exact distances.
+ * @returns
+ * This function never returns NULL.
+ */
+struct sr_distances *
+sr_threads_compare_bounded(struct sr_thread **threads, int m, int n,
+                           enum sr_distance_type dist_type,
+                           float max_distance);
+
+/**
+ * Creates a distances structure by comparing threads in parallel.
+ * The rows of the matrix are distributed among worker threads, which
+ * steal rows from each other when they run out of work.
+ * @param threads
+ * Array of threads. They are not modified by calling this function.
+ * @param m
+ * Compare first m threads from the array with other threads.
+ * @param n
+ * Number of threads in the passed array.
+ * @param dist_type
+ * Type of distance to compute.
+ * @param nthreads
+ * Number of worker threads to use, including the calling thread. If zero,
+ * the number of available processors is used.
+ * @returns
+ * This function never returns NULL. The result is identical to the one
+ * of sr_threads_compare().
+ */
+struct sr_distances *
+sr_threads_compare_parallel(struct sr_thread **threads, int m, int n,
+                            enum sr_distance_type dist_type,
+                            unsigned nthreads);
+
+/**
+ * Extends distances of threads by new threads. Only the distances
+ * involving the new threads are computed.
+ * @param distances
+ * Distances of the first distances->n threads of the array, as returned by
+ * sr_threads_compare(). The structure is not modified by calling this
+ * function.
+ * @param threads
+ * Array of threads, the new threads are at its end. They are not modified
+ * by calling this function.
+ * @param n
+ * Number of threads in the passed array, at least distances->n.
+ * @param dist_type
+ * Type of distance the distances were computed with.
+ * @returns
+ * This function never returns NULL. If the passed distances form a full
+ * matrix, so does the result, otherwise the new threads are only added as
+ * columns. The result is identical to the one of sr_threads_compare() on
+ * the whole array.
+ */
+struct sr_distances *
+sr_threads_compare_extend(struct sr_distances *distances,
+                          struct sr_thread **threads,
+                          int n,
+                          enum sr_distance_type dist_type);
+
 /**
  * @brief A part of a distance matrix to be computed (possibly in different
  * threads/processes and even different machines provided they have the same
@@ -210,6 +313,9 @@ struct sr_distances_part
     float *distances;
     /* Make it possible to create lists of sr_distances_part. */
     struct sr_distances_part *next;
+    /* Number of the distances computed so far, the part is complete when
+     * it reaches len. */
+    size_t done;
 };
 
 /**
@@ -238,7 +344,8 @@ sr_distances_part_create(int m, int n, enum sr_distance_type dist_type,
                          unsigned nparts);
 
 /**
- * Perform the distance computation on the matrix part.
+ * Perform the distance computation on the matrix part. A part loaded by
+ * sr_distances_part_load() is resumed where its computation stopped.
  * @param part
  * Part of the matrix previously returned by sr_distances_part_create.
  * @param threads
@@ -248,6 +355,27 @@ void
 sr_distances_part_compute(struct sr_distances_part *part,
                           struct sr_thread **threads);
 
+/**
+ * Perform the distance computation on the matrix part and save the
+ * progress to a file regularly, so that the computation can be resumed
+ * by sr_distances_part_load() after it is interrupted.
+ * @param threads
+ * Array of threads. If the part is partially computed, the threads must
+ * be the same as before.
+ * @param path
+ * The file the part is saved to, see sr_distances_part_save().
+ * @param interval
+ * Number of distances computed between the checkpoints.
+ * @returns
+ * True on success, false with error_message set otherwise.
+ */
+bool
+sr_distances_part_compute_checkpointed(struct sr_distances_part *part,
+                                       struct sr_thread **threads,
+                                       const char *path,
+                                       size_t interval,
+                                       char **error_message);
+
 /**
  * Merge the matrix part into full distance matrix.
  * @param part
@@ -269,6 +397,104 @@ sr_distances_part_merge(struct sr_distances_part *parts);
 void
 sr_distances_part_free(struct sr_distances_part *part, bool follow_links);
 
+/**
+ * Saves the matrix part, including the distances computed so far, to
+ * a binary file. The format depends on the architecture.
+ * @returns
+ * True on success, false with error_message set otherwise.
+ */
+bool
+sr_distances_part_save(struct sr_distances_part *part,
+                       const char *path,
+                       char **error_message);
+
+/**
+ * Loads a matrix part saved by sr_distances_part_save() or
+ * sr_distances_part_compute_checkpointed().
+ * @returns
+ * The part, or NULL with error_message set if the file cannot be read
+ * or is corrupted. It must be released by sr_distances_part_free().
+ */
+struct sr_distances_part *
+sr_distances_part_load(const char *path,
+                       char **error_message);
+
+/**
+ * Creates a file for distances that are written later by parts, see
+ * sr_distances_file_write_part() and sr_distances_file_finish(). The
+ * file holds a header and the distances encoded in the same layout as in
+ * struct sr_distances. The format depends on the architecture.
+ * @param m
+ * Number of rows, see sr_distances_new().
+ * @param n
+ * Number of columns.
+ * @param dist_type
+ * Type of the distances, it is stored in the file.
+ * @param encoding
+ * How the distances are stored.
+ * @returns
+ * True on success, false with error_message set otherwise.
+ */
+bool
+sr_distances_file_create(const char *path,
+                         int m,
+                         int n,
+                         enum sr_distance_type dist_type,
+                         enum sr_distances_encoding encoding,
+                         char **error_message);
+
+/**
+ * Writes a computed part of the matrix to a file created by
+ * sr_distances_file_create(). The parts can be written in any order.
+ * The checksum of the threads of the first written part is stored in the
+ * file, parts computed from other threads are rejected.
+ * @returns
+ * True on success, false with error_message set otherwise.
+ */
+bool
+sr_distances_file_write_part(const char *path,
+                             struct sr_distances_part *part,
+                             char **error_message);
+
+/**
+ * Computes the checksum of the file after all parts were written and marks
+ * it complete. Incomplete files cannot be loaded.
+ * @returns
+ * True on success, false with error_message set otherwise.
+ */
+bool
+sr_distances_file_finish(const char *path,
+                         char **error_message);
+
+/**
+ * Saves distances to a file.
+ * @returns
+ * True on success, false with error_message set otherwise.
+ */
+bool
+sr_distances_save(struct sr_distances *distances,
+                  const char *path,
+                  enum sr_distance_type dist_type,
+                  enum sr_distances_encoding encoding,
+                  char **error_message);
+
+/**
+ * Loads distances from a file. Distances encoded as SR_DISTANCES_FLOAT32
+ * are mapped into memory privately without being copied, changes are not
+ * written back to the file. Other encodings are decoded on the heap.
+ * sr_distances_cluster_objects_in_place() clusters the distances without
+ * copying them.
+ * @param dist_type
+ * If not NULL, the type of the distances is stored there.
+ * @returns
+ * The distances, or NULL with error_message set if the file cannot be
+ * read or is corrupted. They must be released by sr_distances_free().
+ */
+struct sr_distances *
+sr_distances_load(const char *path,
+                  enum sr_distance_type *dist_type,
+                  char **error_message);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,9 @@ extern "C" {
 #include <stdbool.h>
 #include <inttypes.h>
 
+struct sr_address_map;
+struct sr_location;
+
 enum
 {
     SYMS_OK,
@@ -117,6 +120,18 @@ struct sr_gdb_sharedlib *
 sr_gdb_sharedlib_find_address(struct sr_gdb_sharedlib *first,
                               uint64_t address);
 
+/**
+ * Creates a map of the addresses to the sharedlibs from the list
+ * starting by 'first'. Searching the map by sr_address_map_find() gives
+ * the same results as sr_gdb_sharedlib_find_address() in logarithmic
+ * time.
+ * @returns
+ * It never returns NULL. The returned map must be released by
+ * sr_address_map_free(), the sharedlibs must outlive it.
+ */
+struct sr_address_map *
+sr_gdb_sharedlib_address_map(struct sr_gdb_sharedlib *first);
+
 /**
  * Parses the output of GDB's 'info sharedlib' command.
  * @param input
@@ -127,6 +142,20 @@ sr_gdb_sharedlib_find_address(struct sr_gdb_sharedlib *first,
 struct sr_gdb_sharedlib *
 sr_gdb_sharedlib_parse(const char *input);
 
+/**
+ * If the input starts with the table printed by GDB's 'info
+ * sharedlib' command, parses it and moves the input pointer after the
+ * last library line.  Otherwise the input is not modified.
+ * @param location
+ * The line and column members are increased by the parsed text.
+ * @returns
+ * First element of the list of loaded libraries, NULL if there is no
+ * table or it is empty.
+ */
+struct sr_gdb_sharedlib *
+sr_gdb_sharedlib_parse_table(const char **input,
+                             struct sr_location *location);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,7 @@ extern "C" {
 struct sr_gdb_frame;
 struct sr_location;
 struct sr_gdb_sharedlib;
+struct sr_address_map;
 
 /**
  * @brief A thread of execution of a GDB-produced stack trace.
@@ -264,6 +265,15 @@ void
 sr_gdb_thread_set_libnames(struct sr_gdb_thread *thread,
                            struct sr_gdb_sharedlib *libs);
 
+/**
+ * Set library names in all frames in the thread according to the
+ * map created by sr_gdb_sharedlib_address_map(). The map can be reused
+ * for all threads of the stacktrace.
+ */
+void
+sr_gdb_thread_set_libnames_map(struct sr_gdb_thread *thread,
+                               struct sr_address_map *libs_map);
+
 /**
  * Return copy of the thread optimized for comparison.
  */
@@ -35,8 +35,10 @@ extern "C" {
 #include <inttypes.h>
 #include <json.h>
 #include <stddef.h>
+#include <sys/types.h>
 
 struct sr_location;
+struct sr_koops_stream;
 
 struct sr_koops_stacktrace
 {
@@ -157,6 +159,63 @@ sr_koops_stacktrace_parse(const char **input,
 char **
 sr_koops_stacktrace_parse_modules(const char **input);
 
+/**
+ * Creates a stream extracting kernel oopses from a kernel log read from
+ * the file descriptor, such as the output of dmesg, journalctl -k or
+ * a serial console.
+ * @param fd
+ * The descriptor stays open when the stream is released.
+ * @returns
+ * It never returns NULL. The returned pointer must be released by
+ * sr_koops_stream_free().
+ */
+struct sr_koops_stream *
+sr_koops_stream_new_fd(int fd);
+
+/**
+ * Creates a stream extracting kernel oopses from a kernel log provided
+ * by the callback.
+ * @param read
+ * Reads at most size bytes of the log to the buffer and returns their
+ * number. Returns 0 at the end of the log and -1 with errno set on
+ * failure.
+ * @param data
+ * Passed to the callback.
+ */
+struct sr_koops_stream *
+sr_koops_stream_new(ssize_t (*read)(void *data, void *buffer, size_t size),
+                    void *data);
+
+/**
+ * Releases the stream.
+ * @param stream
+ * If stream is NULL, no operation is performed.
+ */
+void
+sr_koops_stream_free(struct sr_koops_stream *stream);
+
+/**
+ * Reads the log up to the end of the next kernel oops and parses it.
+ * The log is read in blocks of a fixed size and only the text of the
+ * oops is kept, so the memory used does not depend on the size of the
+ * log.
+ *
+ * An oops starts at a line reporting a problem, such as "BUG:",
+ * "WARNING:", "Oops:" or "general protection fault", or after a
+ * "cut here" line. It ends with the "---[ end trace" line, before the
+ * start of the next oops found after its call trace, or at the end of
+ * the log. The prefix journalctl and syslog put before the kernel
+ * messages, ending with "kernel: ", is removed. Lines longer than
+ * 64 KiB and oopses longer than 1 MiB are truncated.
+ * @param error_message
+ * On error, *error_message will contain the description of the error.
+ * @returns
+ * The next oops, or NULL at the end of the log or on error.
+ */
+struct sr_koops_stacktrace *
+sr_koops_stream_next(struct sr_koops_stream *stream,
+                     char **error_message);
+
 /**
  * Returns brief, human-readable explanation of the stacktrace.
  */
@@ -0,0 +1,138 @@
+/*
+    lsh.h
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef SATYR_LSH_H
+#define SATYR_LSH_H
+
+/**
+ * @file
+ * @brief Search for similar threads by locality-sensitive hashing.
+ *
+ * The index stores MinHash signatures of the sets of frames of threads
+ * and finds the threads whose Jaccard distance (see SR_DISTANCE_JACCARD)
+ * to a thread is likely to be within a threshold without comparing it
+ * to all stored threads. The candidates are verified by sr_distance(),
+ * so no false positives are returned. Some similar threads may be
+ * missed, the index is tuned to find at least 95 % of the threads at
+ * the threshold distance and more of the closer ones.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct sr_thread;
+struct sr_lsh_index;
+
+/**
+ * @brief A stored thread found by the index.
+ */
+struct sr_lsh_match
+{
+    /* Index of the stored thread, as returned by sr_lsh_index_add(). */
+    int index;
+    /* Jaccard distance of the threads. */
+    float distance;
+};
+
+/**
+ * @brief A pair of similar stored threads.
+ */
+struct sr_lsh_pair
+{
+    /* Indices of the stored threads, index1 < index2. */
+    int index1;
+    int index2;
+    /* Jaccard distance of the threads. */
+    float distance;
+};
+
+/**
+ * Creates an empty index.
+ * @param max_distance
+ * Maximal Jaccard distance of the threads that should be found,
+ * between 0 and 1.
+ * @returns
+ * It never returns NULL. The returned pointer must be released by
+ * sr_lsh_index_free().
+ */
+struct sr_lsh_index *
+sr_lsh_index_new(float max_distance);
+
+/**
+ * Releases the memory held by the index. The stored threads are not
+ * released.
+ * @param index
+ * If index is NULL, no operation is performed.
+ */
+void
+sr_lsh_index_free(struct sr_lsh_index *index);
+
+/**
+ * Adds a thread to the index.
+ * @param thread
+ * The thread is not copied, it must not be modified or released while
+ * the index exists.
+ * @returns
+ * Index of the stored thread. The threads are numbered from 0 in the
+ * order they are added.
+ */
+int
+sr_lsh_index_add(struct sr_lsh_index *index,
+                 struct sr_thread *thread);
+
+/**
+ * Returns the number of stored threads.
+ */
+int
+sr_lsh_index_size(struct sr_lsh_index *index);
+
+/**
+ * Finds stored threads similar to a thread.
+ * @param thread
+ * The thread to search for. It does not need to be stored in the index.
+ * @param count
+ * Number of the returned matches.
+ * @returns
+ * Array of the stored threads within the maximal distance, ordered by
+ * their index. NULL if there are none. The array must be released by
+ * g_free().
+ */
+struct sr_lsh_match *
+sr_lsh_index_find(struct sr_lsh_index *index,
+                  struct sr_thread *thread,
+                  int *count);
+
+/**
+ * Finds all pairs of stored threads within the maximal distance.
+ * @param count
+ * Number of the returned pairs.
+ * @returns
+ * Array of the pairs ordered by their indices, NULL if there are none.
+ * The array must be released by g_free().
+ */
+struct sr_lsh_pair *
+sr_lsh_index_find_pairs(struct sr_lsh_index *index,
+                        int *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
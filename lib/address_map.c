@@ -0,0 +1,151 @@
+/*
+    address_map.c
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "address_map.h"
+#include <glib.h>
+#include <stdbool.h>
+
+struct address_range
+{
+    uint64_t first;
+    uint64_t last;
+    /* Order in which the range was added. */
+    int order;
+    void *module;
+    /* The highest last address of this and all preceding ranges. */
+    uint64_t max_last;
+};
+
+struct sr_address_map
+{
+    GArray *ranges;
+    bool sorted;
+};
+
+struct sr_address_map *
+sr_address_map_new(void)
+{
+    struct sr_address_map *map = g_malloc0(sizeof(*map));
+
+    map->ranges = g_array_new(FALSE, FALSE, sizeof(struct address_range));
+    map->sorted = true;
+
+    return map;
+}
+
+void
+sr_address_map_free(struct sr_address_map *map)
+{
+    if (!map)
+        return;
+
+    g_array_free(map->ranges, TRUE);
+    g_free(map);
+}
+
+void
+sr_address_map_add(struct sr_address_map *map,
+                   uint64_t first,
+                   uint64_t last,
+                   void *module)
+{
+    if (last < first)
+        return;
+
+    struct address_range range =
+    {
+        .first = first,
+        .last = last,
+        .order = map->ranges->len,
+        .module = module,
+    };
+
+    g_array_append_val(map->ranges, range);
+    map->sorted = false;
+}
+
+int
+sr_address_map_size(struct sr_address_map *map)
+{
+    return map->ranges->len;
+}
+
+static gint
+cmp_ranges(gconstpointer a, gconstpointer b)
+{
+    const struct address_range *x = a, *y = b;
+
+    if (x->first != y->first)
+        return x->first < y->first ? -1 : 1;
+
+    return x->order - y->order;
+}
+
+static void
+address_map_sort(struct sr_address_map *map)
+{
+    struct address_range *ranges = (struct address_range *)map->ranges->data;
+    uint64_t max_last = 0;
+
+    g_array_sort(map->ranges, cmp_ranges);
+
+    for (guint i = 0; i < map->ranges->len; i++)
+    {
+        max_last = MAX(max_last, ranges[i].last);
+        ranges[i].max_last = max_last;
+    }
+
+    map->sorted = true;
+}
+
+void *
+sr_address_map_find(struct sr_address_map *map,
+                    uint64_t address)
+{
+    if (!map->sorted)
+        address_map_sort(map);
+
+    struct address_range *ranges = (struct address_range *)map->ranges->data;
+    guint low = 0, high = map->ranges->len;
+
+    /* Find the ranges starting at or below the address. */
+    while (low < high)
+    {
+        guint middle = low + (high - low) / 2;
+
+        if (ranges[middle].first <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    /* Go back while some preceding range may still contain the address,
+     * which is a single step unless the ranges overlap. */
+    struct address_range *found = NULL;
+
+    for (guint i = low; i > 0 && ranges[i - 1].max_last >= address; i--)
+    {
+        struct address_range *range = &ranges[i - 1];
+
+        if (range->last >= address && (!found || range->order < found->order))
+            found = range;
+    }
+
+    return found ? found->module : NULL;
+}
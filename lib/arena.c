@@ -0,0 +1,240 @@
+/*
+    arena.c
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "arena.h"
+#include "internal_arena.h"
+#include <glib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Blocks are aligned to their size, so that the block containing any
+ * memory of the arena is found by masking its address. */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+/* Larger allocations get blocks of their own. */
+#define ARENA_LARGE_SIZE (ARENA_BLOCK_SIZE / 4)
+#define ARENA_ALIGNMENT (2 * sizeof(void *))
+
+struct sr_arena
+{
+    /* The blocks, the start of each one is the key. */
+    GHashTable *blocks;
+    /* The free part of the current block. */
+    char *next;
+    char *end;
+    size_t size;
+};
+
+static GPrivate current_arena = G_PRIVATE_INIT(NULL);
+
+/* The blocks of all arenas, so that arena_free() leaves memory of any
+ * arena alone, not only of the one in use.  The count is checked
+ * first to avoid taking the lock when there are no arenas. */
+static GMutex all_blocks_lock;
+static GHashTable *all_blocks;
+static gint all_blocks_count;
+
+static void
+forget_block(gpointer block, gpointer value, gpointer user_data)
+{
+    g_hash_table_remove(all_blocks, block);
+    g_atomic_int_add(&all_blocks_count, -1);
+}
+
+struct sr_arena *
+sr_arena_new(void)
+{
+    struct sr_arena *arena = g_malloc0(sizeof(*arena));
+
+    arena->blocks = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                          free, NULL);
+
+    return arena;
+}
+
+void
+sr_arena_free(struct sr_arena *arena)
+{
+    if (!arena)
+        return;
+
+    g_mutex_lock(&all_blocks_lock);
+    g_hash_table_foreach(arena->blocks, forget_block, NULL);
+    g_mutex_unlock(&all_blocks_lock);
+
+    g_hash_table_destroy(arena->blocks);
+    g_free(arena);
+}
+
+size_t
+sr_arena_size(struct sr_arena *arena)
+{
+    return arena->size;
+}
+
+struct sr_arena *
+arena_enter(struct sr_arena *arena)
+{
+    struct sr_arena *previous = g_private_get(&current_arena);
+
+    g_private_set(&current_arena, arena);
+
+    return previous;
+}
+
+static char *
+arena_new_block(struct sr_arena *arena, size_t size)
+{
+    void *block;
+
+    if (posix_memalign(&block, ARENA_BLOCK_SIZE, size) != 0)
+        g_error("Unable to allocate %zu bytes", size);
+
+    g_hash_table_add(arena->blocks, block);
+
+    g_mutex_lock(&all_blocks_lock);
+    if (!all_blocks)
+        all_blocks = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_add(all_blocks, block);
+    g_atomic_int_inc(&all_blocks_count);
+    g_mutex_unlock(&all_blocks_lock);
+
+    return block;
+}
+
+static void *
+arena_alloc_aligned(struct sr_arena *arena, size_t size, size_t alignment)
+{
+    char *mem;
+
+    arena->size += size;
+
+    /* The whole aligned window is taken, so that no heap memory, which
+     * arena_free() must release, shares it with the block. */
+    if (size > ARENA_LARGE_SIZE)
+        return arena_new_block(arena, (size + ARENA_BLOCK_SIZE - 1) &
+                                      ~(size_t)(ARENA_BLOCK_SIZE - 1));
+
+    if (arena->next)
+    {
+        mem = (char *)(((uintptr_t)arena->next + alignment - 1) &
+                       ~(uintptr_t)(alignment - 1));
+
+        if (size <= (size_t)(arena->end - mem))
+        {
+            arena->next = mem + size;
+            return mem;
+        }
+    }
+
+    mem = arena_new_block(arena, ARENA_BLOCK_SIZE);
+    arena->next = mem + size;
+    arena->end = mem + ARENA_BLOCK_SIZE;
+
+    return mem;
+}
+
+void *
+arena_alloc0(size_t size)
+{
+    struct sr_arena *arena = g_private_get(&current_arena);
+
+    if (!arena)
+        return g_malloc0(size);
+
+    return memset(arena_alloc_aligned(arena, size, ARENA_ALIGNMENT), 0, size);
+}
+
+char *
+arena_strndup(const char *str, size_t n)
+{
+    struct sr_arena *arena = g_private_get(&current_arena);
+
+    if (!arena)
+        return g_strndup(str, n);
+
+    if (!str)
+        return NULL;
+
+    char *result = arena_alloc_aligned(arena, n + 1, 1);
+
+    /* Like g_strndup(), the string ends at the first NUL. */
+    strncpy(result, str, n);
+    result[n] = '\0';
+
+    return result;
+}
+
+char *
+arena_strdup(const char *str)
+{
+    if (!str)
+        return NULL;
+
+    return arena_strndup(str, strlen(str));
+}
+
+char *
+arena_string_free(GString *string)
+{
+    if (!g_private_get(&current_arena))
+        return g_string_free(string, FALSE);
+
+    char *result = arena_strndup(string->str, string->len);
+
+    g_string_free(string, TRUE);
+
+    return result;
+}
+
+void
+arena_free(void *mem)
+{
+    if (!mem || g_atomic_int_get(&all_blocks_count) == 0)
+    {
+        g_free(mem);
+        return;
+    }
+
+    void *block = (void *)((uintptr_t)mem & ~(uintptr_t)(ARENA_BLOCK_SIZE - 1));
+    struct sr_arena *arena = g_private_get(&current_arena);
+
+    if (arena && g_hash_table_contains(arena->blocks, block))
+        return;
+
+    g_mutex_lock(&all_blocks_lock);
+    bool in_arena = g_hash_table_contains(all_blocks, block);
+    g_mutex_unlock(&all_blocks_lock);
+
+    if (!in_arena)
+        g_free(mem);
+}
+
+void
+arena_strfreev(char **strv)
+{
+    if (!strv)
+        return;
+
+    for (char **str = strv; *str; str++)
+        arena_free(*str);
+
+    arena_free(strv);
+}
@@ -21,38 +21,77 @@
 #include "elves.h"
 #include "disasm.h"
 #include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+/* Cache files start with this word, the format version and the build id. */
+#define CALLGRAPH_CACHE_HEADER "satyr-callgraph"
+#define CALLGRAPH_CACHE_VERSION 1
+
+struct sr_callgraph_index
+{
+    struct sr_callgraph *first;
+    struct sr_callgraph *last;
+    /* Address -> struct sr_callgraph, the key is the address in the node. */
+    GHashTable *nodes;
+};
+
+/* Disassembles the function and creates its node. */
+static struct sr_callgraph *
+callgraph_node_compute(struct sr_disasm_state *disassembler,
+                       uint64_t address,
+                       uint64_t start_offset,
+                       uint64_t length,
+                       char **error_message)
+{
+    size_t count;
+    struct sr_disasm_instruction *instructions = sr_disasm_decode_function(
+        disassembler,
+        start_offset,
+        length,
+        &count,
+        error_message);
+
+    if (!instructions)
+        return NULL;
+
+    struct sr_callgraph *entry = g_malloc(sizeof(*entry));
+    entry->address = address;
+    entry->callees = sr_disasm_get_decoded_callee_addresses(instructions,
+                                                            count);
+    entry->next = NULL;
+
+    g_free(instructions);
+    return entry;
+}
 
 struct sr_callgraph *
 sr_callgraph_compute(struct sr_disasm_state *disassembler,
-                     struct sr_elf_fde *eh_frame,
+                     struct sr_elf_eh_frame *eh_frame,
                      char **error_message)
 {
-    struct sr_elf_fde *fde_entry = eh_frame;
     struct sr_callgraph *result = NULL, *last = NULL;
-    while (fde_entry)
+    for (size_t i = 0; i < eh_frame->count; i++)
     {
-        struct sr_callgraph *entry = g_malloc(sizeof(*entry));
-        entry->address = fde_entry->start_address;
-        entry->callees = NULL;
-        entry->next = NULL;
-
-        char **instructions = sr_disasm_get_function_instructions(
+        struct sr_elf_fde *fde_entry = &eh_frame->fdes[i];
+        struct sr_callgraph *entry = callgraph_node_compute(
             disassembler,
             fde_entry->start_address,
+            fde_entry->start_address,
             fde_entry->length,
             error_message);
 
-        if (!instructions)
+        if (!entry)
         {
             sr_callgraph_free(result);
-            g_free(entry);
             return NULL;
         }
 
-        entry->callees = sr_disasm_get_callee_addresses(instructions);
-
         if (result)
         {
             last->next = entry;
@@ -60,8 +99,6 @@ sr_callgraph_compute(struct sr_disasm_state *disassembler,
         }
         else
             result = last = entry;
-
-        fde_entry = fde_entry->next;
     }
 
     return result;
@@ -71,77 +108,37 @@ struct sr_callgraph *
 sr_callgraph_extend(struct sr_callgraph *callgraph,
                     uint64_t start_address,
                     struct sr_disasm_state *disassembler,
-                    struct sr_elf_fde *eh_frame,
+                    struct sr_elf_eh_frame *eh_frame,
                     char **error_message)
 {
-    if (sr_callgraph_find(callgraph, start_address))
-        return callgraph;
-
-    struct sr_elf_fde *fde =
-        sr_elf_find_fde_for_start_address(eh_frame,
-                                           start_address);
-
-    if (!fde)
-    {
-        *error_message = g_strdup_printf(
-            "Unable to find FDE for address 0x%"PRIx64,
-            start_address);
-
-        return NULL;
-    }
-
-    struct sr_callgraph *last = sr_callgraph_last(callgraph);
-    struct sr_callgraph *entry = g_malloc(sizeof(*entry));
-    entry->address = fde->exec_base + fde->start_address;
-    entry->callees = NULL;
-    entry->next = NULL;
-
-    char **instructions = sr_disasm_get_function_instructions(
-        disassembler,
-        fde->exec_base + fde->start_address,
-        fde->length,
-        error_message);
-
-    if (!instructions)
-    {
-        g_free(entry);
-        return NULL;
-    }
-
-    entry->callees = sr_disasm_get_callee_addresses(instructions);
-
-    if (callgraph)
-    {
-        last->next = entry;
-        last = entry;
-    }
-    else
-        callgraph = last = entry;
+    struct sr_callgraph_index *index = sr_callgraph_index_new();
 
-    uint64_t *callees = entry->callees;
-    while (*callees != 0)
+    for (struct sr_callgraph *next, *node = callgraph; node; node = next)
     {
-        struct sr_callgraph *result = sr_callgraph_extend(callgraph,
-                                                            *callees,
-                                                            disassembler,
-                                                            eh_frame,
-                                                            error_message);
+        next = node->next;
+        node->next = NULL;
 
-        /* Failure here may mean that the address points to PLT. */
-        if (result)
-            callgraph = result;
-        else if (*error_message)
+        if (!sr_callgraph_index_add(index, node))
         {
-            g_free(*error_message);
-            *error_message = NULL;
+            /* Duplicates stay in the list, the first one is found. */
+            index->last->next = node;
+            index->last = node;
         }
-
-        ++callees;
     }
 
-    return callgraph;
-}
+    bool success = sr_callgraph_index_extend(index,
+                                             start_address,
+                                             disassembler,
+                                             eh_frame,
+                                             error_message);
 
+    /* The list now continues with the new nodes. */
+    callgraph = index->first;
+    index->first = index->last = NULL;
+    sr_callgraph_index_free(index);
+
+    return success ? callgraph : NULL;
+}
 
 void
 sr_callgraph_free(struct sr_callgraph *callgraph)
@@ -182,3 +179,364 @@ sr_callgraph_last(struct sr_callgraph *callgraph)
 
     return last;
 }
+
+struct sr_callgraph_index *
+sr_callgraph_index_new(void)
+{
+    struct sr_callgraph_index *index = g_malloc0(sizeof(*index));
+    index->nodes = g_hash_table_new(g_int64_hash, g_int64_equal);
+    return index;
+}
+
+void
+sr_callgraph_index_free(struct sr_callgraph_index *index)
+{
+    if (!index)
+        return;
+
+    sr_callgraph_free(index->first);
+    g_hash_table_destroy(index->nodes);
+    g_free(index);
+}
+
+struct sr_callgraph *
+sr_callgraph_index_nodes(struct sr_callgraph_index *index)
+{
+    return index->first;
+}
+
+int
+sr_callgraph_index_size(struct sr_callgraph_index *index)
+{
+    return g_hash_table_size(index->nodes);
+}
+
+struct sr_callgraph *
+sr_callgraph_index_find(struct sr_callgraph_index *index,
+                        uint64_t address)
+{
+    return g_hash_table_lookup(index->nodes, &address);
+}
+
+bool
+sr_callgraph_index_add(struct sr_callgraph_index *index,
+                       struct sr_callgraph *node)
+{
+    if (g_hash_table_contains(index->nodes, &node->address))
+        return false;
+
+    node->next = NULL;
+    if (index->last)
+        index->last->next = node;
+    else
+        index->first = node;
+
+    index->last = node;
+    g_hash_table_insert(index->nodes, &node->address, node);
+    return true;
+}
+
+/* Pushes the callees so that they are popped in their order. */
+static void
+push_callees(GArray *pending, struct sr_callgraph *node)
+{
+    size_t count = 0;
+    while (node->callees[count] != 0)
+        ++count;
+
+    while (count > 0)
+        g_array_append_val(pending, node->callees[--count]);
+}
+
+static struct sr_callgraph *
+callgraph_node_for_start_address(uint64_t start_address,
+                                 struct sr_disasm_state *disassembler,
+                                 struct sr_elf_eh_frame *eh_frame,
+                                 char **error_message)
+{
+    struct sr_elf_fde *fde =
+        sr_elf_find_fde_for_start_address(eh_frame,
+                                           start_address);
+
+    if (!fde)
+    {
+        *error_message = g_strdup_printf(
+            "Unable to find FDE for address 0x%"PRIx64,
+            start_address);
+
+        return NULL;
+    }
+
+    return callgraph_node_compute(disassembler,
+                                  fde->exec_base + fde->start_address,
+                                  fde->exec_base + fde->start_address,
+                                  fde->length,
+                                  error_message);
+}
+
+bool
+sr_callgraph_index_extend(struct sr_callgraph_index *index,
+                          uint64_t start_address,
+                          struct sr_disasm_state *disassembler,
+                          struct sr_elf_eh_frame *eh_frame,
+                          char **error_message)
+{
+    if (sr_callgraph_index_find(index, start_address))
+        return true;
+
+    struct sr_callgraph *node =
+        callgraph_node_for_start_address(start_address,
+                                         disassembler,
+                                         eh_frame,
+                                         error_message);
+    if (!node)
+        return false;
+
+    sr_callgraph_index_add(index, node);
+
+    /* The callees are added depth-first, the functions already in the
+     * index, e.g. loaded from a cache, are not disassembled again. */
+    GArray *pending = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+    push_callees(pending, node);
+
+    while (pending->len > 0)
+    {
+        uint64_t address = g_array_index(pending, uint64_t, pending->len - 1);
+        g_array_set_size(pending, pending->len - 1);
+
+        if (sr_callgraph_index_find(index, address))
+            continue;
+
+        /* Failure here may mean that the address points to PLT. */
+        char *callee_error_message = NULL;
+        node = callgraph_node_for_start_address(address,
+                                                disassembler,
+                                                eh_frame,
+                                                &callee_error_message);
+        if (!node)
+        {
+            g_free(callee_error_message);
+            continue;
+        }
+
+        sr_callgraph_index_add(index, node);
+        push_callees(pending, node);
+    }
+
+    g_array_free(pending, TRUE);
+    return true;
+}
+
+char *
+sr_callgraph_cache_path(const char *cache_dir,
+                        const char *build_id)
+{
+    return g_strdup_printf("%s/%s.callgraph", cache_dir, build_id);
+}
+
+bool
+sr_callgraph_index_load(struct sr_callgraph_index *index,
+                        const char *filename,
+                        const char *build_id,
+                        char **error_message)
+{
+    char *contents = sr_file_to_string(filename, error_message);
+    if (!contents)
+        return false;
+
+    const char *local_input = contents;
+    struct sr_callgraph_index *loaded = NULL;
+    char *header = g_strdup_printf("%s %d %s\n",
+                                   CALLGRAPH_CACHE_HEADER,
+                                   CALLGRAPH_CACHE_VERSION,
+                                   build_id);
+
+    bool success = sr_skip_string(&local_input, header);
+    g_free(header);
+
+    if (!success)
+    {
+        *error_message = g_strdup_printf(
+            "Callgraph cache '%s' does not belong to build %s.",
+            filename,
+            build_id);
+
+        g_free(contents);
+        return false;
+    }
+
+    /* Each line holds the function address and the addresses it calls:
+     * 0x401000: 0x401100 0x401200
+     * The nodes are added to the index only if the whole file is valid.
+     */
+    loaded = sr_callgraph_index_new();
+    while (*local_input)
+    {
+        uint64_t address;
+        if (!sr_parse_hexadecimal_0xuint64(&local_input, &address) ||
+            !sr_skip_char(&local_input, ':'))
+        {
+            success = false;
+            break;
+        }
+
+        GArray *callees = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+        uint64_t callee;
+        while (sr_skip_char(&local_input, ' '))
+        {
+            if (!sr_parse_hexadecimal_0xuint64(&local_input, &callee) ||
+                callee == 0)
+            {
+                success = false;
+                break;
+            }
+
+            g_array_append_val(callees, callee);
+        }
+
+        if (!success || !sr_skip_char(&local_input, '\n'))
+        {
+            g_array_free(callees, TRUE);
+            success = false;
+            break;
+        }
+
+        callee = 0;
+        g_array_append_val(callees, callee);
+
+        struct sr_callgraph *node = g_malloc(sizeof(*node));
+        node->address = address;
+        node->callees = (uint64_t *)g_array_free(callees, FALSE);
+        node->next = NULL;
+
+        if (!sr_callgraph_index_add(loaded, node))
+            sr_callgraph_free(node);
+    }
+
+    if (success)
+    {
+        struct sr_callgraph *node = loaded->first;
+        loaded->first = loaded->last = NULL;
+
+        while (node)
+        {
+            struct sr_callgraph *next = node->next;
+            if (!sr_callgraph_index_add(index, node))
+            {
+                node->next = NULL;
+                sr_callgraph_free(node);
+            }
+
+            node = next;
+        }
+    }
+    else
+    {
+        *error_message = g_strdup_printf(
+            "Invalid callgraph cache '%s' at offset %td.",
+            filename,
+            local_input - contents);
+    }
+
+    sr_callgraph_index_free(loaded);
+    g_free(contents);
+    return success;
+}
+
+bool
+sr_callgraph_index_save(struct sr_callgraph_index *index,
+                        const char *filename,
+                        const char *build_id,
+                        char **error_message)
+{
+    GString *contents = g_string_new(NULL);
+    g_string_append_printf(contents, "%s %d %s\n",
+                           CALLGRAPH_CACHE_HEADER,
+                           CALLGRAPH_CACHE_VERSION,
+                           build_id);
+
+    for (struct sr_callgraph *node = index->first; node; node = node->next)
+    {
+        g_string_append_printf(contents, "0x%"PRIx64":", node->address);
+
+        for (uint64_t *callee = node->callees; *callee != 0; ++callee)
+            g_string_append_printf(contents, " 0x%"PRIx64, *callee);
+
+        g_string_append_c(contents, '\n');
+    }
+
+    /* Readers never see a partially written cache, and concurrent
+     * writers each use their own temporary file. */
+    char *tmp_filename = g_strdup_printf("%s.XXXXXX", filename);
+    int fd = g_mkstemp_full(tmp_filename, O_WRONLY | O_LARGEFILE, 0640);
+    if (fd < 0)
+    {
+        *error_message = g_strdup_printf("Unable to create '%s': %s.",
+                                         tmp_filename,
+                                         strerror(errno));
+
+        g_free(tmp_filename);
+        g_string_free(contents, TRUE);
+        return false;
+    }
+
+    close(fd);
+
+    bool success = sr_string_to_file(tmp_filename,
+                                     contents->str,
+                                     error_message);
+
+    if (success && rename(tmp_filename, filename) != 0)
+    {
+        *error_message = g_strdup_printf("Unable to rename '%s' to '%s': %s.",
+                                         tmp_filename,
+                                         filename,
+                                         strerror(errno));
+
+        success = false;
+    }
+
+    if (!success)
+        unlink(tmp_filename);
+
+    g_free(tmp_filename);
+    g_string_free(contents, TRUE);
+    return success;
+}
+
+bool
+sr_callgraph_index_extend_cached(struct sr_callgraph_index *index,
+                                 uint64_t start_address,
+                                 struct sr_disasm_state *disassembler,
+                                 struct sr_elf_eh_frame *eh_frame,
+                                 const char *cache_dir,
+                                 const char *build_id,
+                                 char **error_message)
+{
+    char *path = sr_callgraph_cache_path(cache_dir, build_id);
+    char *cache_error_message = NULL;
+
+    if (sr_callgraph_index_size(index) == 0 &&
+        g_file_test(path, G_FILE_TEST_EXISTS) &&
+        !sr_callgraph_index_load(index, path, build_id, &cache_error_message))
+    {
+        g_free(cache_error_message);
+        cache_error_message = NULL;
+    }
+
+    int size = sr_callgraph_index_size(index);
+    bool success = sr_callgraph_index_extend(index,
+                                             start_address,
+                                             disassembler,
+                                             eh_frame,
+                                             error_message);
+
+    if (success && sr_callgraph_index_size(index) > size &&
+        !sr_callgraph_index_save(index, path, build_id, &cache_error_message))
+    {
+        g_free(cache_error_message);
+    }
+
+    g_free(path);
+    return success;
+}
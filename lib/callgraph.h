@@ -37,9 +37,10 @@ extern "C" {
 #endif
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 struct sr_disasm_state;
-struct sr_elf_fde;
+struct sr_elf_eh_frame;
 
 /**
  * @brief A call graph representing calling relationships between
@@ -71,7 +72,7 @@ struct sr_callgraph
 
 struct sr_callgraph *
 sr_callgraph_compute(struct sr_disasm_state *disassembler,
-                     struct sr_elf_fde *eh_frame,
+                     struct sr_elf_eh_frame *eh_frame,
                      char **error_message);
 
 /// Assumption: when a fde is included in the callgraph, we assume
@@ -80,7 +81,7 @@ struct sr_callgraph *
 sr_callgraph_extend(struct sr_callgraph *callgraph,
                     uint64_t start_address,
                     struct sr_disasm_state *disassembler,
-                    struct sr_elf_fde *eh_frame,
+                    struct sr_elf_eh_frame *eh_frame,
                     char **error_message);
 
 void
@@ -93,6 +94,85 @@ sr_callgraph_find(struct sr_callgraph *callgraph,
 struct sr_callgraph *
 sr_callgraph_last(struct sr_callgraph *callgraph);
 
+/**
+ * @brief Call graph nodes indexed by their addresses.
+ *
+ * The nodes form a list of struct sr_callgraph in the order they were
+ * added, which is returned by sr_callgraph_index_nodes().  The nodes
+ * are looked up in constant time.
+ */
+struct sr_callgraph_index;
+
+struct sr_callgraph_index *
+sr_callgraph_index_new(void);
+
+/// Releases the index together with its nodes.
+void
+sr_callgraph_index_free(struct sr_callgraph_index *index);
+
+struct sr_callgraph *
+sr_callgraph_index_nodes(struct sr_callgraph_index *index);
+
+int
+sr_callgraph_index_size(struct sr_callgraph_index *index);
+
+struct sr_callgraph *
+sr_callgraph_index_find(struct sr_callgraph_index *index,
+                        uint64_t address);
+
+/// Appends the node and takes its ownership.  Returns false and leaves
+/// the node to the caller if a node with the same address is present.
+bool
+sr_callgraph_index_add(struct sr_callgraph_index *index,
+                       struct sr_callgraph *node);
+
+/// Adds the function starting at start_address and all functions it
+/// calls, unless they are already present.  Failures to add the
+/// callees are ignored, they may be PLT entries.
+bool
+sr_callgraph_index_extend(struct sr_callgraph_index *index,
+                          uint64_t start_address,
+                          struct sr_disasm_state *disassembler,
+                          struct sr_elf_eh_frame *eh_frame,
+                          char **error_message);
+
+/// Returns the path of the callgraph cache of the build in cache_dir.
+char *
+sr_callgraph_cache_path(const char *cache_dir,
+                        const char *build_id);
+
+/// Adds the nodes stored in the cache file to the index.  The call
+/// graph of a build never changes, so the cached functions do not need
+/// to be disassembled again.  Fails if the file belongs to another
+/// build.
+bool
+sr_callgraph_index_load(struct sr_callgraph_index *index,
+                        const char *filename,
+                        const char *build_id,
+                        char **error_message);
+
+/// Stores all the nodes of the index in the cache file.  The file is
+/// replaced atomically.
+bool
+sr_callgraph_index_save(struct sr_callgraph_index *index,
+                        const char *filename,
+                        const char *build_id,
+                        char **error_message);
+
+/// Extends the index like sr_callgraph_index_extend() and keeps its
+/// nodes in the cache of the build in cache_dir.  An empty index is
+/// filled from the cache first, and the cache is saved when new nodes
+/// were added.  A missing or invalid cache is rebuilt, and failures to
+/// save it are ignored.
+bool
+sr_callgraph_index_extend_cached(struct sr_callgraph_index *index,
+                                 uint64_t start_address,
+                                 struct sr_disasm_state *disassembler,
+                                 struct sr_elf_eh_frame *eh_frame,
+                                 const char *cache_dir,
+                                 const char *build_id,
+                                 char **error_message);
+
 #ifdef __cplusplus
 }
 #endif
@@ -104,20 +104,339 @@ cluster_reverse(struct cluster *cluster)
     }
 }
 
-struct sr_dendrogram *
-sr_distances_cluster_objects(struct sr_distances *distances)
+/* Candidate for the nearest cluster in a row of the distance matrix. */
+struct neighbour
 {
-    assert(distances->n);
-    int i, j, merges, m = distances->m, n = distances->n;
+    float dist;
+    int j;
+};
+
+/* Binary min-heap of the candidates of a row. Candidates are ordered by
+ * the distance and then by the column, so the top of the heap is the first
+ * cluster in the row with the minimal distance. Candidates of merged
+ * clusters and candidates with outdated distances are removed lazily once
+ * they reach the top, or all at once when they make up a third of a full
+ * heap. */
+struct row_heap
+{
+    int size;
+    int alloced;
+    /* Number of clusters in the row, which have one current candidate
+     * each. */
+    int columns;
+    /* The items are only appended until the heap is needed. */
+    bool ordered;
+    struct neighbour *items;
+};
+
+static bool
+neighbour_less(const struct neighbour *a, const struct neighbour *b)
+{
+    return a->dist < b->dist || (a->dist == b->dist && a->j < b->j);
+}
+
+static void
+row_heap_sift_down(struct row_heap *heap, int k)
+{
+    struct neighbour item = heap->items[k];
+
+    for (;;)
+    {
+        int child = 2 * k + 1;
+        if (child >= heap->size)
+            break;
+
+        if (child + 1 < heap->size &&
+            neighbour_less(&heap->items[child + 1], &heap->items[child]))
+            child++;
+
+        if (!neighbour_less(&heap->items[child], &item))
+            break;
+
+        heap->items[k] = heap->items[child];
+        k = child;
+    }
+
+    heap->items[k] = item;
+}
+
+static void
+row_heap_push(struct row_heap *heap, float dist, int j)
+{
+    if (heap->size >= heap->alloced)
+    {
+        heap->alloced = heap->alloced >= 1 ? heap->alloced * 2 : 1;
+        /* The row is compacted before it grows above this. */
+        if (heap->alloced > heap->columns + heap->columns / 2 + 1)
+            heap->alloced = heap->columns + heap->columns / 2 + 1;
+        heap->items = g_realloc_n(heap->items, heap->alloced,
+                                  sizeof(*heap->items));
+    }
+
+    struct neighbour item = { dist, j };
+    int k = heap->size++;
+
+    if (!heap->ordered)
+    {
+        heap->items[k] = item;
+        return;
+    }
 
-    struct sr_distances *cluster_distances;
-    struct cluster clusters[n];
-    /* to stop gcc 11 from complaining about uninitialized variables */
-    clusters[0].objects = NULL;
+    while (k > 0 && neighbour_less(&item, &heap->items[(k - 1) / 2]))
+    {
+        heap->items[k] = heap->items[(k - 1) / 2];
+        k = (k - 1) / 2;
+    }
 
-    float merge_levels[n];
+    heap->items[k] = item;
+}
 
-    cluster_distances = sr_distances_dup(distances);
+static void
+row_heap_pop(struct row_heap *heap)
+{
+    heap->items[0] = heap->items[--heap->size];
+    if (heap->size > 0)
+        row_heap_sift_down(heap, 0);
+}
+
+/* Clustering state. Every cluster is identified by the smallest index of
+ * the objects it contains; rows of the distance matrix hold the distances
+ * of the clusters to the clusters with greater index. */
+struct clustering
+{
+    int m, n;
+    enum sr_cluster_linkage linkage;
+    struct sr_distances *distances;
+    struct cluster *clusters;
+    /* Candidates for the nearest cluster of every row. */
+    struct row_heap *rows;
+    /* The top of the heap of the row and its distance, nearest[i] is -1 if
+     * it has to be looked up again. */
+    int *nearest;
+    float *nearest_distances;
+};
+
+/* Fills the heap of row i with the current distances of the row and finds
+ * the nearest cluster of the row. The heap is ordered only once the nearest
+ * cluster is lost. */
+static void
+clustering_rebuild_row(struct clustering *clustering, int i)
+{
+    struct row_heap *heap = &clustering->rows[i];
+
+    clustering->nearest[i] = -1;
+    heap->ordered = false;
+    heap->size = 0;
+    if (heap->alloced < clustering->n - i - 1)
+    {
+        heap->alloced = clustering->n - i - 1;
+        heap->items = g_realloc_n(heap->items, heap->alloced,
+                                  sizeof(*heap->items));
+    }
+
+    for (int j = i + 1; j < clustering->n; j++)
+    {
+        if (!clustering->clusters[j].size)
+            continue;
+
+        float dist = sr_distances_get_distance(clustering->distances, i, j);
+
+        heap->items[heap->size].dist = dist;
+        heap->items[heap->size].j = j;
+        heap->size++;
+
+        if (clustering->nearest[i] < 0 || clustering->nearest_distances[i] > dist)
+        {
+            clustering->nearest[i] = j;
+            clustering->nearest_distances[i] = dist;
+        }
+    }
+
+    heap->columns = heap->size;
+}
+
+/* Drops the candidates of merged clusters and the outdated candidates from
+ * the heap of row i, leaving one candidate per cluster of the row. The
+ * nearest cluster of the row stays valid. */
+static void
+clustering_compact_row(struct clustering *clustering, int i)
+{
+    struct row_heap *heap = &clustering->rows[i];
+    int size = 0;
+
+    for (int k = 0; k < heap->size; k++)
+    {
+        struct neighbour *item = &heap->items[k];
+
+        if (clustering->clusters[item->j].size &&
+            item->dist == sr_distances_get_distance(clustering->distances,
+                                                    i, item->j))
+            heap->items[size++] = *item;
+    }
+
+    heap->size = size;
+    heap->ordered = false;
+
+    /* Release the memory of the columns merged since the row was built. */
+    if (heap->alloced > 2 * (heap->columns + heap->columns / 2 + 1))
+    {
+        heap->alloced = heap->columns + heap->columns / 2 + 1;
+        heap->items = g_realloc_n(heap->items, heap->alloced,
+                                  sizeof(*heap->items));
+    }
+}
+
+/* Returns the first cluster in row i with the minimal distance, or -1 if
+ * the row has no other cluster. Outdated candidates are dropped. */
+static int
+clustering_row_nearest(struct clustering *clustering, int i, float *dist)
+{
+    struct row_heap *heap = &clustering->rows[i];
+
+    if (!heap->ordered)
+    {
+        for (int k = heap->size / 2 - 1; k >= 0; k--)
+            row_heap_sift_down(heap, k);
+
+        heap->ordered = true;
+    }
+
+    while (heap->size > 0)
+    {
+        struct neighbour *top = &heap->items[0];
+
+        if (clustering->clusters[top->j].size &&
+            top->dist == sr_distances_get_distance(clustering->distances,
+                                                   i, top->j))
+        {
+            *dist = top->dist;
+            return top->j;
+        }
+
+        row_heap_pop(heap);
+    }
+
+    return -1;
+}
+
+static float
+clustering_linkage(struct clustering *clustering, float dist1, int size1,
+                   float dist2, int size2)
+{
+    switch (clustering->linkage)
+    {
+    case SR_CLUSTER_LINKAGE_SINGLE:
+        return dist1 < dist2 ? dist1 : dist2;
+    case SR_CLUSTER_LINKAGE_COMPLETE:
+        return dist1 > dist2 ? dist1 : dist2;
+    case SR_CLUSTER_LINKAGE_AVERAGE:
+        return (dist1 * size1 + dist2 * size2) / (size1 + size2);
+    default:
+        assert(0 && "invalid linkage");
+        return 0.0;
+    }
+}
+
+/* Updates the distances after cluster c2 of size2 objects has been merged
+ * into cluster c1 of size1 objects and adds the new distances to the heaps
+ * of the rows. */
+static void
+clustering_update(struct clustering *clustering, int c1, int size1, int c2,
+                  int size2)
+{
+    struct cluster *clusters = clustering->clusters;
+    int i;
+
+    for (i = 0; i < clustering->n; i++)
+    {
+        if (!clusters[i].size || i == c1)
+            continue;
+
+        /* Cluster c2 was in the rows before it. */
+        if (i < c2 && i < clustering->m)
+            clustering->rows[i].columns--;
+
+        /* Skip if distance between clusters i and c2 is unknown. */
+        if (!(c2 < clustering->m || i < clustering->m))
+            continue;
+
+        float previous = sr_distances_get_distance(clustering->distances, i, c1);
+        float dist = clustering_linkage(clustering, previous, size1,
+            sr_distances_get_distance(clustering->distances, i, c2), size2);
+
+        sr_distances_set_distance(clustering->distances, i, c1, dist);
+
+        /* Only the rows before c1 contain the updated distance, the row of
+         * c1 is rebuilt below. */
+        if (i > c1)
+        {
+            if (i < clustering->m && clustering->nearest[i] == c2)
+                clustering->nearest[i] = -1;
+
+            continue;
+        }
+
+        /* The outdated candidates are left in the heap until it is full
+         * and they make up a third of it. The candidate of c1 is still
+         * current if the distance has not changed. */
+        struct row_heap *heap = &clustering->rows[i];
+        int nearest = clustering->nearest[i];
+
+        if (dist != previous)
+        {
+            if (heap->size >= heap->alloced &&
+                heap->size >= heap->columns + heap->columns / 2)
+                clustering_compact_row(clustering, i);
+
+            row_heap_push(heap, dist, c1);
+        }
+
+        if (nearest == c1 || nearest == c2)
+            clustering->nearest[i] = -1;
+        else if (nearest >= 0 &&
+                 (dist < clustering->nearest_distances[i] ||
+                  (dist == clustering->nearest_distances[i] && c1 < nearest)))
+        {
+            clustering->nearest[i] = c1;
+            clustering->nearest_distances[i] = dist;
+        }
+    }
+
+    if (c2 < clustering->m)
+    {
+        g_free(clustering->rows[c2].items);
+        clustering->rows[c2].items = NULL;
+        clustering->rows[c2].size = clustering->rows[c2].alloced = 0;
+    }
+
+    /* The distances in the row of the merged cluster have changed. */
+    if (c1 < clustering->m)
+        clustering_rebuild_row(clustering, c1);
+}
+
+/* Clusters the objects, overwriting the distances. The original distances
+ * of the objects are read from objects. */
+static struct sr_dendrogram *
+cluster_objects(struct sr_distances *distances,
+                struct sr_distances *objects,
+                enum sr_cluster_linkage linkage)
+{
+    assert(distances->n);
+    int i, merges, m = distances->m, n = distances->n;
+
+    struct clustering clustering;
+    clustering.m = m;
+    clustering.n = n;
+    clustering.linkage = linkage;
+    clustering.distances = distances;
+    clustering.clusters = g_malloc_n(n, sizeof(*clustering.clusters));
+    clustering.rows = g_malloc0_n(m, sizeof(*clustering.rows));
+    clustering.nearest = g_malloc_n(m, sizeof(*clustering.nearest));
+    clustering.nearest_distances =
+        g_malloc_n(m, sizeof(*clustering.nearest_distances));
+
+    struct cluster *clusters = clustering.clusters;
+    float *merge_levels = g_malloc_n(n, sizeof(*merge_levels));
 
     /* Start with one cluster per each object. */
     for (i = 0; i < n; i++)
@@ -126,88 +445,58 @@ sr_distances_cluster_objects(struct sr_distances *distances)
         cluster_add_index(&clusters[i], i);
     }
 
+    for (i = 0; i < m; i++)
+        clustering_rebuild_row(&clustering, i);
+
     /* Merge clusters n - 1 times so there will be only one cluster left. */
     for (merges = 0; merges + 1 < n; merges++)
     {
-        bool first, reverse1, reverse2;
-        int c1, c2;
-        float dist, min_dist, dists[4];
-
-        /* Quiet compiler. */
-        c1 = c2 = 0;
+        bool reverse1, reverse2;
+        int c1, c2, size1, size2;
+        float min_dist, dists[4];
+
+        /* Find two clusters with minimal distance. Only the nearest
+         * clusters of the rows have to be compared. Ties are resolved the
+         * same way as by a search of the whole matrix, in favour of the
+         * first pair in row-major order. */
+        c1 = c2 = -1;
         min_dist = 0.0;
-
-        /* Find two clusters with minimal distance. */
-        for (i = 0, first = true; i < m; i++)
+        for (i = 0; i < m; i++)
         {
             if (!clusters[i].size)
                 continue;
 
-            for (j = i + 1; j < n; j++)
+            if (clustering.nearest[i] < 0)
             {
-                if (!clusters[j].size)
-                    continue;
-
-                dist = sr_distances_get_distance(cluster_distances, i, j);
-
-                if (first || min_dist > dist)
-                {
-                    min_dist = dist;
-                    c1 = i;
-                    c2 = j;
-                    first = false;
-                }
+                clustering.nearest[i] = clustering_row_nearest(
+                    &clustering, i, &clustering.nearest_distances[i]);
             }
-        }
-
-        assert(!first && c1 < c2);
-
-        /* Update distances of the new cluster to other clusters. */
-        for (i = 0; i < n; i++)
-        {
-            if (!clusters[i].size || i == c1 || i == c2)
-                continue;
 
-            /* Skip if distance between clusters i and c2 is unknown. */
-            if (!(c2 < m || i < m))
-                continue;
-
-            dists[0] = sr_distances_get_distance(cluster_distances, i, c1);
-            dists[1] = sr_distances_get_distance(cluster_distances, i, c2);
-
-            /* The cluster distance algorithm is hardcoded for now. */
-            switch (3)
+            if (clustering.nearest[i] >= 0 &&
+                (c1 < 0 || min_dist > clustering.nearest_distances[i]))
             {
-                case 1:
-                    /* maximum */
-                    dist = dists[0] > dists[1] ? dists[0] : dists[1];
-                    break;
-                case 2:
-                    /* minimum */
-                    dist = dists[0] < dists[1] ? dists[0] : dists[1];
-                    break;
-                case 3:
-                    /* average */
-                    dist = (dists[0] * clusters[c1].size + dists[1] * clusters[c2].size) / (clusters[c1].size + clusters[c2].size);
-                    break;
+                c1 = i;
+                c2 = clustering.nearest[i];
+                min_dist = clustering.nearest_distances[i];
             }
-
-            sr_distances_set_distance(cluster_distances, i, c1, dist);
         }
 
+        assert(c1 >= 0);
+        assert(c1 < c2);
+
         /* With full distance matrix, merge the sequences of the two clusters
          * so outer objects with minimal distance will be next to each other. */
         if (m + 1 == n)
         {
-            dists[0] = sr_distances_get_distance(distances,
+            dists[0] = sr_distances_get_distance(objects,
                     clusters[c1].objects[0], clusters[c2].objects[0]);
-            dists[1] = sr_distances_get_distance(distances,
+            dists[1] = sr_distances_get_distance(objects,
                     clusters[c1].objects[clusters[c1].size - 1],
                     clusters[c2].objects[0]);
-            dists[2] = sr_distances_get_distance(distances,
+            dists[2] = sr_distances_get_distance(objects,
                     clusters[c1].objects[0],
                     clusters[c2].objects[clusters[c2].size - 1]);
-            dists[3] = sr_distances_get_distance(distances,
+            dists[3] = sr_distances_get_distance(objects,
                     clusters[c1].objects[clusters[c1].size - 1],
                     clusters[c2].objects[clusters[c2].size - 1]);
             if (dists[1] <= dists[0] && dists[1] <= dists[2] &&
@@ -246,8 +535,13 @@ sr_distances_cluster_objects(struct sr_distances *distances)
         merge_levels[clusters[c2].objects[0]] = min_dist;
 
         /* Merge the two clusters. */
+        size1 = clusters[c1].size;
+        size2 = clusters[c2].size;
         cluster_merge(&clusters[c1], &clusters[c2]);
         cluster_clean(&clusters[c2]);
+
+        /* Update distances of the new cluster to other clusters. */
+        clustering_update(&clustering, c1, size1, c2, size2);
     }
 
     struct sr_dendrogram *dendrogram = sr_dendrogram_new(n);
@@ -259,11 +553,47 @@ sr_distances_cluster_objects(struct sr_distances *distances)
         dendrogram->merge_levels[i - 1] = merge_levels[clusters[0].objects[i]];
 
     cluster_clean(&clusters[0]);
-    sr_distances_free(cluster_distances);
+    g_free(clusters);
+    g_free(merge_levels);
+    for (i = 0; i < m; i++)
+        g_free(clustering.rows[i].items);
+    g_free(clustering.rows);
+    g_free(clustering.nearest);
+    g_free(clustering.nearest_distances);
+
+    return dendrogram;
+}
+
+struct sr_dendrogram *
+sr_distances_cluster_objects_linkage(struct sr_distances *distances,
+                                     enum sr_cluster_linkage linkage)
+{
+    struct sr_distances *copy = sr_distances_dup(distances);
+    struct sr_dendrogram *dendrogram = cluster_objects(copy, distances,
+                                                       linkage);
+
+    sr_distances_free(copy);
 
     return dendrogram;
 }
 
+struct sr_dendrogram *
+sr_distances_cluster_objects_in_place(struct sr_distances *distances,
+                                      struct sr_distances *objects,
+                                      enum sr_cluster_linkage linkage)
+{
+    assert(objects || distances->m + 1 != distances->n);
+
+    return cluster_objects(distances, objects, linkage);
+}
+
+struct sr_dendrogram *
+sr_distances_cluster_objects(struct sr_distances *distances)
+{
+    return sr_distances_cluster_objects_linkage(distances,
+                                                SR_CLUSTER_LINKAGE_AVERAGE);
+}
+
 struct sr_cluster *
 sr_cluster_new(int size)
 {
@@ -313,3 +643,49 @@ sr_dendrogram_cut(struct sr_dendrogram *dendrogram, float level, int min_size)
 
     return cluster;
 }
+
+struct sr_cluster *
+sr_cluster_assign(struct sr_cluster *clusters, struct sr_distances *distances,
+                  int object, float level, enum sr_cluster_linkage linkage)
+{
+    struct sr_cluster *best = NULL;
+    float best_dist = 0.0;
+
+    for (struct sr_cluster *cluster = clusters; cluster; cluster = cluster->next)
+    {
+        float dist = 0.0;
+
+        for (int i = 0; i < cluster->size; i++)
+        {
+            float d = sr_distances_get_distance(distances, object,
+                                                cluster->objects[i]);
+
+            if (i == 0)
+                dist = d;
+            else if (linkage == SR_CLUSTER_LINKAGE_SINGLE)
+                dist = d < dist ? d : dist;
+            else if (linkage == SR_CLUSTER_LINKAGE_COMPLETE)
+                dist = d > dist ? d : dist;
+            else
+                dist += d;
+        }
+
+        if (linkage == SR_CLUSTER_LINKAGE_AVERAGE && cluster->size)
+            dist /= cluster->size;
+
+        if (cluster->size && dist <= level && (!best || dist < best_dist))
+        {
+            best = cluster;
+            best_dist = dist;
+        }
+    }
+
+    if (best)
+    {
+        best->objects = g_realloc_n(best->objects, best->size + 1,
+                                    sizeof(*best->objects));
+        best->objects[best->size++] = object;
+    }
+
+    return best;
+}
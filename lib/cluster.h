@@ -71,7 +71,21 @@ void
 sr_dendrogram_free(struct sr_dendrogram *dendrogram);
 
 /**
- * Performs hierarchical agglomerative clustering on objects.
+ * @brief Ways of computing the distance between two clusters.
+ */
+enum sr_cluster_linkage
+{
+    /* Distance of the closest objects of the clusters. */
+    SR_CLUSTER_LINKAGE_SINGLE,
+    /* Distance of the most distant objects of the clusters. */
+    SR_CLUSTER_LINKAGE_COMPLETE,
+    /* Average distance of the objects of the clusters. */
+    SR_CLUSTER_LINKAGE_AVERAGE,
+};
+
+/**
+ * Performs hierarchical agglomerative clustering on objects using
+ * the average linkage.
  * @param distances
  * Distances between the objects. The structure is not modified by
  * calling this function.
@@ -79,6 +93,51 @@ sr_dendrogram_free(struct sr_dendrogram *dendrogram);
 struct sr_dendrogram *
 sr_distances_cluster_objects(struct sr_distances *distances);
 
+/**
+ * Performs hierarchical agglomerative clustering on objects. The closest
+ * pair of clusters is merged first; of equally distant pairs, the first one
+ * in the row-major order of the matrix is merged. Every row keeps a heap of
+ * the candidates for its nearest cluster, so the clustering takes
+ * O(n^2 log n) time. A candidate takes 8 bytes and a heap is compacted
+ * once it holds half again as many candidates as there are clusters left in
+ * its row, so the heaps take up to three times the memory of the distances.
+ * @param distances
+ * Distances between the objects. The structure is not modified by
+ * calling this function. The clustering works on a copy of the distances
+ * on the heap, because every merge rewrites a distance in each row of the
+ * matrix, see sr_distances_cluster_objects_in_place() to avoid it.
+ * @param linkage
+ * How the distance between two clusters is computed from the distances
+ * of their objects.
+ */
+struct sr_dendrogram *
+sr_distances_cluster_objects_linkage(struct sr_distances *distances,
+                                     enum sr_cluster_linkage linkage);
+
+/**
+ * Performs the clustering like sr_distances_cluster_objects_linkage(), but
+ * rewrites the distances themselves instead of a copy of them.
+ * @param distances
+ * Distances between the objects. They are overwritten and can only be
+ * released afterwards. Distances mapped from a SR_DISTANCES_FLOAT32 file by
+ * sr_distances_load() are copied only as the pages of the mapping are
+ * written, and the file is not changed.
+ * @param objects
+ * The same distances, which are not modified. A full matrix is ordered by
+ * the distances of the objects at the ends of the clusters, so for m + 1 ==
+ * n they are read from here, e.g. from the same SR_DISTANCES_FLOAT32 file
+ * loaded again, whose mapping shares the page cache. Distances decoded
+ * from other encodings take as much memory as a copy. If the matrix is
+ * not full, it is not used and can be NULL.
+ * @param linkage
+ * How the distance between two clusters is computed from the distances
+ * of their objects.
+ */
+struct sr_dendrogram *
+sr_distances_cluster_objects_in_place(struct sr_distances *distances,
+                                      struct sr_distances *objects,
+                                      enum sr_cluster_linkage linkage);
+
 /**
  * @brief A cluster of objects from a dendrogram.
  */
@@ -128,6 +187,33 @@ sr_dendrogram_cut(struct sr_dendrogram *dendrogram,
                   float level,
                   int min_size);
 
+/**
+ * Assigns an object to the closest of the clusters, e.g. when a new
+ * object arrives after the dendrogram was cut. It takes time linear in the
+ * number of the clustered objects, while clustering the extended distances
+ * again takes O(n^2 log n) time, see sr_distances_cluster_objects_linkage().
+ * @param clusters
+ * List of clusters as returned by sr_dendrogram_cut().
+ * @param distances
+ * Distances between the object and the objects of the clusters, e.g.
+ * extended by sr_threads_compare_extend().
+ * @param object
+ * Index of the object.
+ * @param level
+ * The cutting level of distance the clusters were created with.
+ * @param linkage
+ * How the distance between the object and a cluster is computed.
+ * @returns
+ * The cluster the object was appended to, or NULL if no cluster is
+ * within the level.
+ */
+struct sr_cluster *
+sr_cluster_assign(struct sr_cluster *clusters,
+                  struct sr_distances *distances,
+                  int object,
+                  float level,
+                  enum sr_cluster_linkage linkage);
+
 #ifdef __cplusplus
 }
 #endif
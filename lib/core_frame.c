@@ -24,6 +24,7 @@
 #include "thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <limits.h>
 #include <string.h>
 #include <glib.h>
@@ -36,6 +37,9 @@ core_append_bthash_text(struct sr_core_frame *frame, enum sr_bthash_flags flags,
 static void
 core_append_duphash_text(struct sr_core_frame *frame, enum sr_duphash_flags flags,
                          GString *strbuf);
+static enum frame_distance_key
+core_distance_key(struct sr_core_frame *frame, GString *key,
+                  const char **qualifier);
 
 DEFINE_NEXT_FUNC(core_next, struct sr_frame, struct sr_core_frame)
 DEFINE_SET_NEXT_FUNC(core_set_next, struct sr_frame, struct sr_core_frame)
@@ -47,6 +51,7 @@ struct frame_methods core_frame_methods =
     .set_next = (set_next_frame_fn_t) core_set_next,
     .cmp = (frame_cmp_fn_t) sr_core_frame_cmp,
     .cmp_distance = (frame_cmp_fn_t) sr_core_frame_cmp_distance,
+    .distance_key = (frame_distance_key_fn_t) core_distance_key,
     .frame_append_bthash_text =
         (frame_append_bthash_text_fn_t) core_append_bthash_text,
     .frame_append_duphash_text =
@@ -59,7 +64,7 @@ struct frame_methods core_frame_methods =
 struct sr_core_frame *
 sr_core_frame_new()
 {
-    struct sr_core_frame *frame = g_malloc(sizeof(*frame));
+    struct sr_core_frame *frame = arena_alloc0(sizeof(*frame));
     sr_core_frame_init(frame);
     return frame;
 }
@@ -84,11 +89,11 @@ sr_core_frame_free(struct sr_core_frame *frame)
     if (!frame)
         return;
 
-    g_free(frame->build_id);
-    g_free(frame->function_name);
-    g_free(frame->file_name);
-    g_free(frame->fingerprint);
-    g_free(frame);
+    arena_free(frame->build_id);
+    arena_free(frame->function_name);
+    arena_free(frame->file_name);
+    arena_free(frame->fingerprint);
+    arena_free(frame);
 }
 
 struct sr_core_frame *
@@ -224,6 +229,19 @@ sr_core_frame_cmp_distance(struct sr_core_frame *frame1,
     return build_id_offset;
 }
 
+static enum frame_distance_key
+core_distance_key(struct sr_core_frame *frame, GString *key,
+                  const char **qualifier)
+{
+    /* Frames without a function name are matched by build ID, offset and
+     * fingerprint with fallbacks that are not transitive. */
+    if (!frame->function_name)
+        return FRAME_DISTANCE_KEY_NONE;
+
+    frame_distance_key_append_str(key, frame->function_name);
+    return FRAME_DISTANCE_KEY;
+}
+
 struct sr_core_frame *
 sr_core_frame_append(struct sr_core_frame *dest,
                      struct sr_core_frame *item)
@@ -27,9 +27,11 @@
 #include "normalize.h"
 #include "utils.h"
 #include "unstrip.h"
+#include "address_map.h"
 #include "json.h"
 #include "generic_stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <ctype.h>
 #include <inttypes.h>
 #include <stdint.h>
@@ -70,7 +72,7 @@ struct stacktrace_methods core_stacktrace_methods =
 struct sr_core_stacktrace *
 sr_core_stacktrace_new()
 {
-    struct sr_core_stacktrace *stacktrace = g_malloc(sizeof(*stacktrace));
+    struct sr_core_stacktrace *stacktrace = arena_alloc0(sizeof(*stacktrace));
 
     sr_core_stacktrace_init(stacktrace);
     return stacktrace;
@@ -101,9 +103,9 @@ sr_core_stacktrace_free(struct sr_core_stacktrace *stacktrace)
     }
 
     if (stacktrace->executable)
-        g_free(stacktrace->executable);
+        arena_free(stacktrace->executable);
 
-    g_free(stacktrace);
+    arena_free(stacktrace);
 }
 
 struct sr_core_stacktrace *
@@ -329,6 +331,8 @@ sr_core_stacktrace_create(const char *gdb_stacktrace_text,
         return NULL;
     }
 
+    struct sr_address_map *unstrip_map = sr_unstrip_address_map(unstrip);
+
     // Create the core stacktrace
     struct sr_core_stacktrace *core_stacktrace =
         sr_core_stacktrace_new();
@@ -347,7 +351,7 @@ sr_core_stacktrace_create(const char *gdb_stacktrace_text,
             core_frame->address = gdb_frame->address;
 
             struct sr_unstrip_entry *unstrip_entry =
-                sr_unstrip_find_address(unstrip, gdb_frame->address);
+                sr_address_map_find(unstrip_map, gdb_frame->address);
 
             if (unstrip_entry)
             {
@@ -373,6 +377,7 @@ sr_core_stacktrace_create(const char *gdb_stacktrace_text,
         gdb_thread = gdb_thread->next;
     }
 
+    sr_address_map_free(unstrip_map);
     sr_unstrip_free(unstrip);
     sr_gdb_stacktrace_free(gdb_stacktrace);
     return core_stacktrace;
@@ -0,0 +1,577 @@
+/*
+    core_stream.c
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <elf.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <link.h> /* ElfW */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/procfs.h> /* struct elf_prstatus */
+
+#include "utils.h"
+#include "core/unwind.h"
+#include "internal_unwind.h"
+#include "internal_utils.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Size of the buffer the skipped data are read to if the source cannot
+ * seek. */
+#define SKIP_BUFFER_SIZE (64 * 1024)
+
+/* The kept segments start at page boundaries in the image. */
+#define IMAGE_SEGMENT_ALIGN 4096
+
+/* The coredump image being read, its size is not limited by guint like
+ * the size of GByteArray is. */
+struct core_image
+{
+    char *data;
+    size_t size;
+    size_t alloced;
+    /* The image does not grow over this size. */
+    size_t limit;
+};
+
+enum core_stream_compression
+{
+    CORE_STREAM_UNKNOWN,
+    CORE_STREAM_PLAIN,
+    CORE_STREAM_ZSTD,
+};
+
+struct sr_core_stream
+{
+    ssize_t (*read)(void *data, void *buffer, size_t size);
+    bool (*skip)(void *data, uint64_t size);
+    void *data;
+
+    /* The rest is used by the streams of file descriptors. */
+    int fd;
+    enum core_stream_compression compression;
+    /* The first bytes read to recognize the compression. */
+    unsigned char head[4];
+    size_t head_size;
+    size_t head_pos;
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd;
+    ZSTD_inBuffer zstd_in;
+    void *zstd_in_buffer;
+    size_t zstd_in_buffer_size;
+    /* Whether the last decompressed frame is complete. */
+    bool zstd_frame_end;
+#endif
+};
+
+static ssize_t
+fd_read_raw(struct sr_core_stream *stream, void *buffer, size_t size)
+{
+    if (stream->head_pos < stream->head_size)
+    {
+        size = MIN(size, stream->head_size - stream->head_pos);
+        memcpy(buffer, stream->head + stream->head_pos, size);
+        stream->head_pos += size;
+        return size;
+    }
+
+    ssize_t ret;
+    do
+        ret = read(stream->fd, buffer, size);
+    while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+
+#ifdef HAVE_ZSTD
+static ssize_t
+zstd_read(struct sr_core_stream *stream, void *buffer, size_t size)
+{
+    ZSTD_outBuffer out = { .dst = buffer, .size = size, .pos = 0 };
+
+    while (out.pos == 0)
+    {
+        if (stream->zstd_in.pos == stream->zstd_in.size)
+        {
+            ssize_t ret = fd_read_raw(stream, stream->zstd_in_buffer,
+                                      stream->zstd_in_buffer_size);
+            if (ret < 0)
+                return -1;
+
+            if (ret == 0)
+            {
+                /* A truncated frame is an error, not the end. */
+                if (!stream->zstd_frame_end)
+                {
+                    errno = EBADMSG;
+                    return -1;
+                }
+
+                return 0;
+            }
+
+            stream->zstd_in.size = ret;
+            stream->zstd_in.pos = 0;
+        }
+
+        size_t ret = ZSTD_decompressStream(stream->zstd, &out,
+                                           &stream->zstd_in);
+        if (ZSTD_isError(ret))
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+
+        stream->zstd_frame_end = (ret == 0);
+    }
+
+    return out.pos;
+}
+#endif
+
+/* Recognizes the compression by the magic number at the start. */
+static bool
+fd_detect_compression(struct sr_core_stream *stream)
+{
+    static const unsigned char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+    while (stream->head_size < sizeof(stream->head))
+    {
+        ssize_t ret = read(stream->fd, stream->head + stream->head_size,
+                           sizeof(stream->head) - stream->head_size);
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret < 0)
+            return false;
+
+        if (ret == 0)
+            break;
+
+        stream->head_size += ret;
+    }
+
+    stream->compression = CORE_STREAM_PLAIN;
+
+    if (stream->head_size == sizeof(zstd_magic) &&
+        0 == memcmp(stream->head, zstd_magic, sizeof(zstd_magic)))
+    {
+#ifdef HAVE_ZSTD
+        stream->compression = CORE_STREAM_ZSTD;
+        stream->zstd = ZSTD_createDStream();
+        ZSTD_initDStream(stream->zstd);
+        stream->zstd_in_buffer_size = ZSTD_DStreamInSize();
+        stream->zstd_in_buffer = g_malloc(stream->zstd_in_buffer_size);
+        stream->zstd_in.src = stream->zstd_in_buffer;
+        stream->zstd_in.size = 0;
+        stream->zstd_in.pos = 0;
+        stream->zstd_frame_end = true;
+#else
+        errno = ENOTSUP;
+        return false;
+#endif
+    }
+
+    return true;
+}
+
+static ssize_t
+fd_read(void *data, void *buffer, size_t size)
+{
+    struct sr_core_stream *stream = data;
+
+    if (stream->compression == CORE_STREAM_UNKNOWN &&
+        !fd_detect_compression(stream))
+    {
+        return -1;
+    }
+
+#ifdef HAVE_ZSTD
+    if (stream->compression == CORE_STREAM_ZSTD)
+        return zstd_read(stream, buffer, size);
+#endif
+
+    return fd_read_raw(stream, buffer, size);
+}
+
+static bool
+fd_skip(void *data, uint64_t size)
+{
+    struct sr_core_stream *stream = data;
+
+    /* Compressed data and the bytes read ahead are skipped by reading. */
+    if (stream->compression != CORE_STREAM_PLAIN ||
+        stream->head_pos < stream->head_size ||
+        size > INT64_MAX)
+    {
+        return false;
+    }
+
+    return lseek(stream->fd, (off_t)size, SEEK_CUR) != (off_t)-1;
+}
+
+struct sr_core_stream *
+sr_core_stream_new(ssize_t (*read)(void *data, void *buffer, size_t size),
+                   bool (*skip)(void *data, uint64_t size),
+                   void *data)
+{
+    struct sr_core_stream *stream = g_malloc0(sizeof(*stream));
+
+    stream->read = read;
+    stream->skip = skip;
+    stream->data = data;
+    stream->fd = -1;
+
+    return stream;
+}
+
+struct sr_core_stream *
+sr_core_stream_new_fd(int fd)
+{
+    struct sr_core_stream *stream = sr_core_stream_new(fd_read, fd_skip,
+                                                       NULL);
+    stream->data = stream;
+    stream->fd = fd;
+
+    return stream;
+}
+
+void
+sr_core_stream_free(struct sr_core_stream *stream)
+{
+    if (!stream)
+        return;
+
+#ifdef HAVE_ZSTD
+    if (stream->zstd)
+        ZSTD_freeDStream(stream->zstd);
+
+    g_free(stream->zstd_in_buffer);
+#endif
+    g_free(stream);
+}
+
+static bool
+stream_read_full(struct sr_core_stream *stream, void *buffer, size_t size,
+                 char **error_msg)
+{
+    char *dest = buffer;
+
+    while (size > 0)
+    {
+        ssize_t ret = stream->read(stream->data, dest, size);
+        if (ret < 0)
+        {
+            set_error("Unable to read the coredump: %s", strerror(errno));
+            return false;
+        }
+
+        if (ret == 0)
+        {
+            set_error("The coredump is truncated");
+            return false;
+        }
+
+        dest += ret;
+        size -= ret;
+    }
+
+    return true;
+}
+
+static bool
+stream_skip(struct sr_core_stream *stream, uint64_t size, char **error_msg)
+{
+    if (size == 0 || (stream->skip && stream->skip(stream->data, size)))
+        return true;
+
+    char *buffer = g_malloc(SKIP_BUFFER_SIZE);
+    bool success = true;
+
+    while (success && size > 0)
+    {
+        size_t chunk = MIN(size, SKIP_BUFFER_SIZE);
+
+        success = stream_read_full(stream, buffer, chunk, error_msg);
+        size -= chunk;
+    }
+
+    g_free(buffer);
+    return success;
+}
+
+/* Collects the registers of the threads from the NT_PRSTATUS notes. */
+static void
+collect_registers(const unsigned char *notes, size_t size, GArray *registers)
+{
+    size_t offset = 0;
+
+    while (size - offset >= sizeof(ElfW(Nhdr)))
+    {
+        ElfW(Nhdr) nhdr;
+        memcpy(&nhdr, notes + offset, sizeof(nhdr));
+        offset += sizeof(nhdr);
+
+        size_t name_size = (nhdr.n_namesz + 3) & ~(size_t)3;
+        size_t desc_size = (nhdr.n_descsz + 3) & ~(size_t)3;
+        if (name_size > size - offset ||
+            desc_size > size - offset - name_size)
+        {
+            return;
+        }
+
+        offset += name_size;
+
+        if (nhdr.n_type == NT_PRSTATUS &&
+            nhdr.n_descsz == sizeof(struct elf_prstatus))
+        {
+            struct elf_prstatus prstatus;
+            memcpy(&prstatus, notes + offset, sizeof(prstatus));
+
+            const elf_greg_t *regs = (const elf_greg_t *)&prstatus.pr_reg;
+            for (size_t i = 0; i < sizeof(prstatus.pr_reg) / sizeof(*regs); i++)
+            {
+                uint64_t value = regs[i];
+                if (value != 0)
+                    g_array_append_val(registers, value);
+            }
+        }
+
+        offset += desc_size;
+    }
+}
+
+static int
+cmp_registers(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Whether a register points into the segment, the registers are sorted. */
+static bool
+segment_has_register(const ElfW(Phdr) *phdr, GArray *registers)
+{
+    guint low = 0, high = registers->len;
+
+    while (low < high)
+    {
+        guint middle = low + (high - low) / 2;
+
+        if (g_array_index(registers, uint64_t, middle) < phdr->p_vaddr)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low < registers->len &&
+        g_array_index(registers, uint64_t, low) - phdr->p_vaddr < phdr->p_memsz;
+}
+
+/* Resizes the image, the added bytes are left uninitialized. */
+static void
+core_image_resize(struct core_image *image, size_t size)
+{
+    if (size > image->alloced)
+    {
+        image->alloced = MAX(size, image->alloced <= image->limit / 2
+                                   ? 2 * image->alloced : image->limit);
+        image->data = g_realloc(image->data, image->alloced);
+    }
+
+    image->size = size;
+}
+
+static int
+cmp_segment_offsets(const void *a, const void *b)
+{
+    const ElfW(Phdr) *x = *(const ElfW(Phdr) * const *)a;
+    const ElfW(Phdr) *y = *(const ElfW(Phdr) * const *)b;
+    return (x->p_offset > y->p_offset) - (x->p_offset < y->p_offset);
+}
+
+bool
+read_core_image(struct sr_core_stream *stream, uint64_t segment_limit,
+                uint64_t image_limit, char **image, size_t *image_size,
+                char **error_msg)
+{
+    ElfW(Ehdr) ehdr;
+    if (!stream_read_full(stream, &ehdr, sizeof(ehdr), error_msg))
+        return false;
+
+    if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 || ehdr.e_type != ET_CORE)
+    {
+        set_error("The stream is not a coredump");
+        return false;
+    }
+
+    /* The notes are read by the structures of the running system. */
+    if (ehdr.e_ident[EI_CLASS] != (__ELF_NATIVE_CLASS == 64
+                                   ? ELFCLASS64 : ELFCLASS32) ||
+        ehdr.e_ident[EI_DATA] != (G_BYTE_ORDER == G_LITTLE_ENDIAN
+                                  ? ELFDATA2LSB : ELFDATA2MSB) ||
+        ehdr.e_phentsize != sizeof(ElfW(Phdr)))
+    {
+        set_error("The coredump stream comes from another architecture");
+        return false;
+    }
+
+    /* The real number of segments would be in the section header at the
+     * end of the coredump. */
+    if (ehdr.e_phnum == PN_XNUM || ehdr.e_phoff < sizeof(ehdr))
+    {
+        set_error("Unsupported program headers of the coredump stream");
+        return false;
+    }
+
+    ElfW(Phdr) *phdrs = g_new(ElfW(Phdr), ehdr.e_phnum);
+    ElfW(Phdr) **order = g_new(ElfW(Phdr) *, ehdr.e_phnum);
+    GArray *registers = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+    struct core_image out = { NULL, 0, 0, SIZE_MAX };
+    size_t ncontents = 0, notes_left = 0;
+    uint64_t pos = ehdr.e_phoff + ehdr.e_phnum * sizeof(ElfW(Phdr));
+    bool success = false;
+
+    if (image_limit > 0 && image_limit < SIZE_MAX)
+        out.limit = image_limit;
+
+    if (!stream_skip(stream, ehdr.e_phoff - sizeof(ehdr), error_msg) ||
+        !stream_read_full(stream, phdrs, ehdr.e_phnum * sizeof(ElfW(Phdr)),
+                          error_msg))
+    {
+        goto out;
+    }
+
+    /* The image starts with the headers, the segments follow. */
+    core_image_resize(&out, sizeof(ehdr) + ehdr.e_phnum * sizeof(ElfW(Phdr)));
+
+    for (size_t i = 0; i < ehdr.e_phnum; i++)
+    {
+        if (phdrs[i].p_filesz > 0 &&
+            (phdrs[i].p_type == PT_NOTE || phdrs[i].p_type == PT_LOAD))
+        {
+            if (phdrs[i].p_type == PT_NOTE)
+                notes_left++;
+
+            order[ncontents++] = &phdrs[i];
+        }
+        else
+        {
+            phdrs[i].p_offset = 0;
+            phdrs[i].p_filesz = 0;
+        }
+    }
+
+    /* The stream is read in a single pass. The kernel writes the notes
+     * before the memory, so what the registers point to is known before
+     * the segments are reached. */
+    qsort(order, ncontents, sizeof(*order), cmp_segment_offsets);
+
+    if (notes_left == 0)
+        segment_limit = 0;
+
+    for (size_t i = 0; i < ncontents; i++)
+    {
+        ElfW(Phdr) *phdr = order[i];
+
+        if (phdr->p_type == PT_LOAD && notes_left == 0 && segment_limit > 0 &&
+            phdr->p_filesz > segment_limit &&
+            !segment_has_register(phdr, registers))
+        {
+            /* Not dumped as far as the unwinder is concerned. */
+            phdr->p_offset = 0;
+            phdr->p_filesz = 0;
+            continue;
+        }
+
+        if (phdr->p_offset < pos)
+        {
+            set_error("Overlapping segments in the coredump stream");
+            goto out;
+        }
+
+        size_t end = out.size, offset = end;
+        if (phdr->p_type == PT_LOAD)
+            offset = (end + IMAGE_SEGMENT_ALIGN - 1) & ~(size_t)(IMAGE_SEGMENT_ALIGN - 1);
+
+        if (phdr->p_filesz > SIZE_MAX - offset)
+        {
+            set_error("Segment of %"PRIu64" bytes in the coredump stream "
+                      "does not fit in memory", (uint64_t)phdr->p_filesz);
+            goto out;
+        }
+
+        if (image_limit > 0 && offset + phdr->p_filesz > image_limit)
+        {
+            set_error("The segments kept from the coredump stream take more "
+                      "than %"PRIu64" bytes", image_limit);
+            goto out;
+        }
+
+        if (!stream_skip(stream, phdr->p_offset - pos, error_msg))
+            goto out;
+
+        core_image_resize(&out, offset + phdr->p_filesz);
+        memset(out.data + end, 0, offset - end);
+        if (!stream_read_full(stream, out.data + offset, phdr->p_filesz,
+                              error_msg))
+        {
+            goto out;
+        }
+
+        pos = phdr->p_offset + phdr->p_filesz;
+        phdr->p_offset = offset;
+
+        if (phdr->p_type == PT_NOTE)
+        {
+            collect_registers((unsigned char *)out.data + offset,
+                              phdr->p_filesz, registers);
+
+            if (--notes_left == 0)
+            {
+                qsort(registers->data, registers->len, sizeof(uint64_t),
+                      cmp_registers);
+            }
+        }
+    }
+
+    ehdr.e_phoff = sizeof(ehdr);
+    ehdr.e_shoff = 0;
+    ehdr.e_shnum = 0;
+    ehdr.e_shstrndx = SHN_UNDEF;
+    memcpy(out.data, &ehdr, sizeof(ehdr));
+    memcpy(out.data + sizeof(ehdr), phdrs, ehdr.e_phnum * sizeof(ElfW(Phdr)));
+
+    *image_size = out.size;
+    *image = out.data;
+    out.data = NULL;
+    success = true;
+
+out:
+    g_free(out.data);
+
+    g_array_free(registers, TRUE);
+    g_free(order);
+    g_free(phdrs);
+    return success;
+}
@@ -24,6 +24,7 @@
 #include "generic_thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include "normalize.h"
 #include <string.h>
 
@@ -58,7 +59,7 @@ struct thread_methods core_thread_methods =
 struct sr_core_thread *
 sr_core_thread_new()
 {
-    struct sr_core_thread *thread = g_malloc(sizeof(*thread));
+    struct sr_core_thread *thread = arena_alloc0(sizeof(*thread));
     sr_core_thread_init(thread);
     return thread;
 }
@@ -84,7 +85,7 @@ sr_core_thread_free(struct sr_core_thread *thread)
         sr_core_frame_free(frame);
     }
 
-    g_free(thread);
+    arena_free(thread);
 }
 
 struct sr_core_thread *
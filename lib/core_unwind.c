@@ -24,6 +24,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <sys/procfs.h> /* struct elf_prstatus */
 #include <sys/ptrace.h> /* PTRACE_SEIZE */
 
@@ -42,6 +43,15 @@
 #include "core/thread.h"
 #include "core/stacktrace.h"
 
+void
+sr_core_unwind_options_init(struct sr_core_unwind_options *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->nthreads = 1;
+    options->stream_segment_limit = 16 * 1024 * 1024;
+    options->stream_image_limit = UINT64_C(4) * 1024 * 1024 * 1024;
+}
+
 #if !defined WITH_LIBDWFL && !defined WITH_LIBUNWIND
 
 struct sr_core_stacktrace *
@@ -53,6 +63,37 @@ sr_parse_coredump(const char *coredump_filename,
     return NULL;
 }
 
+struct sr_core_stacktrace *
+sr_parse_coredump_with_options(const char *coredump_filename,
+                               const char *executable_filename,
+                               const struct sr_core_unwind_options *options,
+                               char **error_message)
+{
+    return sr_parse_coredump(coredump_filename, executable_filename,
+                             error_message);
+}
+
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump(struct sr_unwind_session *session,
+                                 const char *coredump_filename,
+                                 const char *executable_filename,
+                                 const struct sr_core_unwind_options *options,
+                                 char **error_message)
+{
+    return sr_parse_coredump(coredump_filename, executable_filename,
+                             error_message);
+}
+
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump_stream(struct sr_unwind_session *session,
+                                        struct sr_core_stream *stream,
+                                        const char *executable_filename,
+                                        const struct sr_core_unwind_options *options,
+                                        char **error_message)
+{
+    return sr_parse_coredump(NULL, executable_filename, error_message);
+}
+
 #endif /* !defined WITH_LIBDWFL && !defined WITH_LIBUNWIND */
 
 #if (!defined WITH_LIBDWFL || !defined PTRACE_SEIZE)
@@ -87,9 +128,90 @@ sr_core_stacktrace_from_core_hook(pid_t thread_id,
 
 #endif /* !defined WITH_LIBDWFL || !defined PTRACE_SEIZE */
 
-/* FIXME: is there another way to pass the executable name to the find_elf
- * callback? */
-const char *executable_file = NULL;
+struct sr_unwind_session
+{
+    GMutex lock;
+    /* Build id -> malloc'd path of the ELF file found for it, "" if none
+     * was found. */
+    GHashTable *elf_files;
+    /* "build id+offset" -> function name, NULL if there is no symbol */
+    GHashTable *functions;
+};
+
+struct sr_unwind_session *
+sr_unwind_session_new(void)
+{
+    struct sr_unwind_session *session = g_malloc0(sizeof(*session));
+
+    g_mutex_init(&session->lock);
+    session->elf_files = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free, free);
+    session->functions = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free, g_free);
+
+    return session;
+}
+
+void
+sr_unwind_session_free(struct sr_unwind_session *session)
+{
+    if (!session)
+        return;
+
+    g_hash_table_destroy(session->elf_files);
+    g_hash_table_destroy(session->functions);
+    g_mutex_clear(&session->lock);
+    g_free(session);
+}
+
+/* Looks up the function name at the offset in the module with the build
+ * id. Returns false if the session does not know it yet. */
+bool
+unwind_session_lookup_function(struct sr_unwind_session *session,
+                               const char *build_id, uint64_t offset,
+                               const char **function_name)
+{
+    char *key = g_strdup_printf("%s+%"PRIx64, build_id, offset);
+    gpointer value;
+
+    g_mutex_lock(&session->lock);
+    bool found = g_hash_table_lookup_extended(session->functions, key, NULL,
+                                              &value);
+    g_mutex_unlock(&session->lock);
+
+    g_free(key);
+
+    if (found)
+        *function_name = value;
+
+    return found;
+}
+
+/* Stores the function name and returns the stored copy, which lives as
+ * long as the session. A name stored by another thread in the meantime
+ * is kept. */
+const char *
+unwind_session_store_function(struct sr_unwind_session *session,
+                              const char *build_id, uint64_t offset,
+                              const char *function_name)
+{
+    char *key = g_strdup_printf("%s+%"PRIx64, build_id, offset);
+    gpointer value;
+
+    g_mutex_lock(&session->lock);
+
+    if (g_hash_table_lookup_extended(session->functions, key, NULL, &value))
+        g_free(key);
+    else
+    {
+        value = g_strdup(function_name);
+        g_hash_table_insert(session->functions, key, value);
+    }
+
+    g_mutex_unlock(&session->lock);
+
+    return value;
+}
 
 void
 _set_error(char **error_msg, const char *fmt, ...)
@@ -119,33 +241,114 @@ core_handle_free(struct core_handle *ch)
             seg = next;
         }
 
+        frame_cache_free(ch->frame_cache);
+
         if (ch->dwfl)
             dwfl_end(ch->dwfl);
         if (ch->eh)
             elf_end(ch->eh);
-        if (ch->fd > 0)
+        if (ch->fd >= 0)
             close(ch->fd);
+        g_free(ch->exe_file);
         g_free(ch);
     }
 }
 
+/* Finds the ELF file of the module by its build id. The files found are
+ * remembered by the session, so that the search is done once for all
+ * cores. The files that are not found are remembered as well. */
+static int
+find_elf_session(struct sr_unwind_session *session,
+                 Dwfl_Module *mod, void **userdata, const char *modname,
+                 Dwarf_Addr base, char **file_name, Elf **elfp)
+{
+    const unsigned char *build_id_bits;
+    GElf_Addr build_id_addr;
+
+    int len = dwfl_module_build_id(mod, &build_id_bits, &build_id_addr);
+    if (len <= 0)
+    {
+        return dwfl_build_id_find_elf(mod, userdata, modname, base,
+                                      file_name, elfp);
+    }
+
+    char *build_id = g_malloc0(2*len + 1);
+    sr_bin2hex(build_id, (const char *)build_id_bits, len);
+
+    gpointer path;
+    char *known_path = NULL;
+
+    g_mutex_lock(&session->lock);
+    bool known = g_hash_table_lookup_extended(session->elf_files, build_id,
+                                              NULL, &path);
+    if (known)
+        known_path = strdup(path);
+    g_mutex_unlock(&session->lock);
+
+    if (known)
+    {
+        g_free(build_id);
+
+        if (*known_path == '\0')
+        {
+            free(known_path);
+            return -1;
+        }
+
+        /* libdwfl checks the build id of the file, a file replaced since
+         * is rejected. */
+        int fd = open(known_path, O_RDONLY);
+        if (fd >= 0)
+        {
+            *elfp = elf_begin(fd, ELF_C_READ_MMAP, NULL);
+            if (*elfp)
+            {
+                *file_name = known_path;
+                return fd;
+            }
+
+            close(fd);
+        }
+
+        free(known_path);
+        return -1;
+    }
+
+    int fd = dwfl_build_id_find_elf(mod, userdata, modname, base,
+                                    file_name, elfp);
+
+    g_mutex_lock(&session->lock);
+    if (!g_hash_table_contains(session->elf_files, build_id))
+    {
+        g_hash_table_insert(session->elf_files, build_id,
+                            strdup(fd >= 0 && *file_name ? *file_name : ""));
+    }
+    else
+        g_free(build_id);
+    g_mutex_unlock(&session->lock);
+
+    return fd;
+}
+
 static int
 find_elf_core (Dwfl_Module *mod, void **userdata, const char *modname,
                Dwarf_Addr base, char **file_name, Elf **elfp)
 {
+    /* The module user data are set by open_coredump(). */
+    struct core_handle *ch = *userdata;
     int ret = -1;
 
-    if (strcmp("[exe]", modname) == 0 || strcmp("[pie]", modname) == 0)
+    if (ch && (strcmp("[exe]", modname) == 0 || strcmp("[pie]", modname) == 0))
     {
-        int fd = open(executable_file, O_RDONLY);
+        int fd = open(ch->exe_file, O_RDONLY);
         if (fd < 0)
             return -1;
 
-        *file_name = realpath(executable_file, NULL);
+        *file_name = realpath(ch->exe_file, NULL);
         *elfp = elf_begin(fd, ELF_C_READ_MMAP, NULL);
         if (*elfp == NULL)
         {
-            warn("Unable to open executable '%s': %s", executable_file,
+            warn("Unable to open executable '%s': %s", ch->exe_file,
                  elf_errmsg(-1));
             close(fd);
             return -1;
@@ -153,6 +356,11 @@ find_elf_core (Dwfl_Module *mod, void **userdata, const char *modname,
 
         ret = fd;
     }
+    else if (ch && ch->session)
+    {
+        ret = find_elf_session(ch->session, mod, userdata, modname, base,
+                               file_name, elfp);
+    }
     else
     {
         ret = dwfl_build_id_find_elf(mod, userdata, modname, base,
@@ -172,15 +380,25 @@ find_debuginfo_none (Dwfl_Module *mod, void **userdata, const char *modname,
     return -1;
 }
 
+struct touch_module_arg
+{
+    struct core_handle *ch;
+    struct exe_mapping_data **tail;
+};
+
 static int
 touch_module(Dwfl_Module *mod, void **userdata, const char *name,
              Dwarf_Addr start_addr, void *arg)
 {
-    struct exe_mapping_data ***tailp = arg;
+    struct touch_module_arg *touch_arg = arg;
+    struct exe_mapping_data ***tailp = &touch_arg->tail;
     const char *filename = NULL;
     GElf_Addr bias;
     Dwarf_Addr base;
 
+    /* Passes the core handle to find_elf_core(). */
+    *userdata = touch_arg->ch;
+
     if (dwfl_module_getelf (mod, &bias) == NULL)
     {
         warn("cannot find ELF for '%s': %s", name, dwfl_errmsg(-1));
@@ -200,33 +418,14 @@ touch_module(Dwfl_Module *mod, void **userdata, const char *name,
     return DWARF_CB_OK;
 }
 
-struct core_handle *
-open_coredump(const char *elf_file, const char *exe_file, char **error_msg)
+/* Reports the modules of the coredump opened in ch->eh. */
+static struct core_handle *
+open_coredump_elf(struct core_handle *ch, const char *elf_file,
+                  const char *exe_file, struct sr_unwind_session *session,
+                  char **error_msg)
 {
-    struct core_handle *ch = g_malloc0(sizeof(*ch));
-    struct exe_mapping_data *head = NULL, **tail = &head;
-
-    /* Initialize libelf, open the file and get its Elf handle. */
-    if (elf_version(EV_CURRENT) == EV_NONE)
-    {
-        set_error_elf("elf_version");
-        goto fail_free;
-    }
-
-    /* Open input file, and parse it. */
-    ch->fd = open(elf_file, O_RDONLY);
-    if (ch->fd < 0)
-    {
-        set_error("Unable to open '%s': %s", elf_file, strerror(errno));
-        goto fail_free;
-    }
-
-    ch->eh = elf_begin(ch->fd, ELF_C_READ_MMAP, NULL);
-    if (ch->eh == NULL)
-    {
-        set_error_elf("elf_begin");
-        goto fail_close;
-    }
+    struct exe_mapping_data *head = NULL;
+    struct touch_module_arg touch_arg = { .ch = ch, .tail = &head };
 
     /* Check that we are working with a coredump. */
     GElf_Ehdr ehdr;
@@ -236,7 +435,8 @@ open_coredump(const char *elf_file, const char *exe_file, char **error_msg)
         goto fail_elf;
     }
 
-    executable_file = exe_file;
+    ch->exe_file = g_strdup(exe_file);
+    ch->session = session;
     ch->cb.find_elf = find_elf_core;
     ch->cb.find_debuginfo = find_debuginfo_none;
     ch->cb.section_address = dwfl_offline_section_address;
@@ -259,7 +459,7 @@ open_coredump(const char *elf_file, const char *exe_file, char **error_msg)
     }
 
     /* needed so that module filenames are available during unwinding */
-    ptrdiff_t ret = dwfl_getmodules(ch->dwfl, touch_module, &tail, 0);
+    ptrdiff_t ret = dwfl_getmodules(ch->dwfl, touch_module, &touch_arg, 0);
     if (ret == -1)
     {
         set_error_dwfl("dwfl_getmodules");
@@ -274,12 +474,52 @@ open_coredump(const char *elf_file, const char *exe_file, char **error_msg)
         goto fail_dwfl;
     }
 
+    ch->frame_cache = frame_cache_new(session);
+
     return ch;
 
 fail_dwfl:
     dwfl_end(ch->dwfl);
 fail_elf:
     elf_end(ch->eh);
+    if (ch->fd >= 0)
+        close(ch->fd);
+    g_free(ch->exe_file);
+    g_free(ch);
+
+    return NULL;
+}
+
+struct core_handle *
+open_coredump(const char *elf_file, const char *exe_file,
+              struct sr_unwind_session *session, char **error_msg)
+{
+    struct core_handle *ch = g_malloc0(sizeof(*ch));
+
+    /* Initialize libelf, open the file and get its Elf handle. */
+    if (elf_version(EV_CURRENT) == EV_NONE)
+    {
+        set_error_elf("elf_version");
+        goto fail_free;
+    }
+
+    /* Open input file, and parse it. */
+    ch->fd = open(elf_file, O_RDONLY);
+    if (ch->fd < 0)
+    {
+        set_error("Unable to open '%s': %s", elf_file, strerror(errno));
+        goto fail_free;
+    }
+
+    ch->eh = elf_begin(ch->fd, ELF_C_READ_MMAP, NULL);
+    if (ch->eh == NULL)
+    {
+        set_error_elf("elf_begin");
+        goto fail_close;
+    }
+
+    return open_coredump_elf(ch, elf_file, exe_file, session, error_msg);
+
 fail_close:
     close(ch->fd);
 fail_free:
@@ -288,8 +528,144 @@ fail_free:
     return NULL;
 }
 
+struct core_handle *
+open_coredump_image(const char *name, char *image, size_t image_size,
+                    const char *exe_file, struct sr_unwind_session *session,
+                    char **error_msg)
+{
+    const char *elf_file = name;
+    struct core_handle *ch = g_malloc0(sizeof(*ch));
+    ch->fd = -1;
+
+    if (elf_version(EV_CURRENT) == EV_NONE)
+    {
+        set_error_elf("elf_version");
+        g_free(ch);
+        return NULL;
+    }
+
+    ch->eh = elf_memory(image, image_size);
+    if (ch->eh == NULL)
+    {
+        set_error_elf("elf_memory");
+        g_free(ch);
+        return NULL;
+    }
+
+    return open_coredump_elf(ch, elf_file, exe_file, session, error_msg);
+}
+
+struct resolved_module
+{
+    /* NULL if the module has no build id. */
+    char *build_id;
+    /* NULL if the module information is not available. */
+    char *file_name;
+    Dwarf_Addr start;
+};
+
+struct resolved_address
+{
+    /* The key of the cache. */
+    Dwarf_Addr address;
+    /* NULL if the address is not in any module. */
+    struct resolved_module *module;
+    /* Owned by the cache of functions, NULL if there is no symbol. */
+    const char *function_name;
+};
+
+static void
+resolved_module_free(struct resolved_module *module)
+{
+    g_free(module->build_id);
+    g_free(module->file_name);
+    g_free(module);
+}
+
+struct frame_cache *
+frame_cache_new(struct sr_unwind_session *session)
+{
+    struct frame_cache *cache = g_malloc0(sizeof(*cache));
+
+    cache->session = session;
+    cache->modules = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                           (GDestroyNotify)resolved_module_free);
+    cache->addresses = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                             g_free);
+    cache->functions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                             g_free);
+
+    return cache;
+}
+
+void
+frame_cache_free(struct frame_cache *cache)
+{
+    if (!cache)
+        return;
+
+    g_hash_table_destroy(cache->addresses);
+    g_hash_table_destroy(cache->modules);
+    g_hash_table_destroy(cache->functions);
+    g_free(cache);
+}
+
+static struct resolved_module *
+resolve_module(struct frame_cache *cache, Dwfl_Module *mod)
+{
+    struct resolved_module *module = g_hash_table_lookup(cache->modules, mod);
+    if (module)
+        return module;
+
+    module = g_malloc0(sizeof(*module));
+
+    int ret;
+    const unsigned char *build_id_bits;
+    const char *filename;
+    GElf_Addr bias, bid_addr;
+
+    /* Initialize the module's main Elf for dwfl_module_build_id and dwfl_module_info */
+    /* No need to deallocate the variable 'bias' and the return value.*/
+    if (NULL == dwfl_module_getelf(mod, &bias))
+        warn("The module's main Elf was not found");
+
+    ret = dwfl_module_build_id(mod, &build_id_bits, &bid_addr);
+    if (ret > 0)
+    {
+        module->build_id = g_malloc0(2*ret + 1);
+        sr_bin2hex(module->build_id, (const char *)build_id_bits, ret);
+    }
+
+    const char *modname = dwfl_module_info(mod, NULL, &module->start, NULL,
+                                           NULL, NULL, &filename, NULL);
+
+    if (modname)
+        module->file_name = g_strdup(filename ? filename : modname);
+
+    g_hash_table_insert(cache->modules, mod, module);
+
+    return module;
+}
+
+static const char *
+resolve_function(struct frame_cache *cache, const char *funcname)
+{
+    char *function_name = g_hash_table_lookup(cache->functions, funcname);
+    if (function_name)
+        return function_name;
+
+    function_name = sr_demangle_symbol(funcname);
+    if (!function_name)
+        function_name = g_strdup(funcname);
+
+    g_hash_table_insert(cache->functions, g_strdup(funcname), function_name);
+
+    return function_name;
+}
+
 struct sr_core_frame *
-resolve_frame(Dwfl *dwfl, Dwarf_Addr ip, bool minus_one)
+resolve_frame(Dwfl *dwfl, struct frame_cache *cache, Dwarf_Addr ip,
+              bool minus_one)
 {
     struct sr_core_frame *frame = sr_core_frame_new();
     frame->address = frame->build_id_offset = (uint64_t)ip;
@@ -297,49 +673,72 @@ resolve_frame(Dwfl *dwfl, Dwarf_Addr ip, bool minus_one)
     /* see dwfl_frame_state_pc for meaning of this parameter */
     Dwarf_Addr ip_adjusted = ip - (minus_one ? 1 : 0);
 
-    Dwfl_Module *mod = dwfl_addrmodule(dwfl, ip_adjusted);
-    if (mod)
+    struct resolved_address *resolved = g_hash_table_lookup(cache->addresses,
+                                                            &ip_adjusted);
+    if (!resolved)
     {
-        int ret;
-        const unsigned char *build_id_bits;
-        const char *filename, *funcname;
-        GElf_Addr bias, bid_addr;
-        Dwarf_Addr start;
-
-        /* Initialize the module's main Elf for dwfl_module_build_id and dwfl_module_info */
-        /* No need to deallocate the variable 'bias' and the return value.*/
-        if (NULL == dwfl_module_getelf(mod, &bias))
-            warn("The module's main Elf was not found");
-
-        ret = dwfl_module_build_id(mod, &build_id_bits, &bid_addr);
-        if (ret > 0)
+        resolved = g_malloc0(sizeof(*resolved));
+        resolved->address = ip_adjusted;
+
+        Dwfl_Module *mod = dwfl_addrmodule(dwfl, ip_adjusted);
+        if (mod)
         {
-            frame->build_id = g_malloc0(2*ret + 1);
-            sr_bin2hex(frame->build_id, (const char *)build_id_bits, ret);
+            struct resolved_module *module = resolve_module(cache, mod);
+            resolved->module = module;
+
+            /* The functions of a module are the same in all cores. */
+            bool shared = cache->session && module->build_id
+                && module->file_name;
+            uint64_t offset = ip_adjusted - module->start;
+
+            if (!shared
+                || !unwind_session_lookup_function(cache->session,
+                                                   module->build_id, offset,
+                                                   &resolved->function_name))
+            {
+                const char *funcname = dwfl_module_addrname(mod,
+                                                            (GElf_Addr)ip_adjusted);
+                if (funcname)
+                    resolved->function_name = resolve_function(cache, funcname);
+
+                if (shared)
+                {
+                    resolved->function_name =
+                        unwind_session_store_function(cache->session,
+                                                      module->build_id, offset,
+                                                      resolved->function_name);
+                }
+            }
         }
 
-        const char *modname = dwfl_module_info(mod, NULL, &start, NULL, NULL, NULL,
-                                               &filename, NULL);
+        g_hash_table_insert(cache->addresses, &resolved->address, resolved);
+    }
 
-        if (modname)
-        {
-            frame->build_id_offset = ip - start;
-            frame->file_name = filename ? g_strdup(filename) : g_strdup(modname);
-        }
+    struct resolved_module *module = resolved->module;
+    if (module)
+    {
+        frame->build_id = g_strdup(module->build_id);
 
-        funcname = dwfl_module_addrname(mod, (GElf_Addr)ip_adjusted);
-        if (funcname)
+        if (module->file_name)
         {
-            char *demangled = sr_demangle_symbol(funcname);
-            frame->function_name = (demangled ? demangled : g_strdup(funcname));
+            frame->build_id_offset = ip - module->start;
+            frame->file_name = g_strdup(module->file_name);
         }
     }
 
+    frame->function_name = g_strdup(resolved->function_name);
+
     return frame;
 }
 
 short
 get_signal_number(Elf *e, const char *elf_file)
+{
+    return get_crash_thread(e, elf_file, NULL);
+}
+
+short
+get_crash_thread(Elf *e, const char *elf_file, pid_t *tid)
 {
     const char NOTE_CORE[] = "CORE";
 
@@ -413,7 +812,12 @@ get_signal_number(Elf *e, const char *elf_file)
             struct elf_prstatus *prstatus = (struct elf_prstatus*)desc_data->d_buf;
             short signal = prstatus->pr_cursig;
             if (signal)
+            {
+                if (tid)
+                    *tid = prstatus->pr_pid;
+
                 return signal;
+            }
         }
     }
 
@@ -429,7 +833,8 @@ sr_core_stacktrace_from_gdb(const char *gdb_output, const char *core_file,
     /* Initialize error_msg to 'no error'. */
     *error_msg = NULL;
 
-    struct core_handle *ch = open_coredump(core_file, exe_file, error_msg);
+    struct core_handle *ch = open_coredump(core_file, exe_file, NULL,
+                                           error_msg);
     if (*error_msg)
         return NULL;
 
@@ -476,7 +881,7 @@ sr_core_stacktrace_from_gdb(const char *gdb_output, const char *core_file,
                 continue;
 
             struct sr_core_frame *core_frame = resolve_frame(ch->dwfl,
-                    gdb_frame->address, false);
+                    ch->frame_cache, gdb_frame->address, false);
 
             core_thread->frames = sr_core_frame_append(core_thread->frames,
                     core_frame);
@@ -34,17 +34,24 @@
 #include <sys/ptrace.h>
 #include <sys/wait.h>
 
-struct frame_callback_arg
+/* Limits of the unwinding of a coredump, shared by all its threads. */
+struct unwind_budget
 {
-    struct sr_core_frame **frames_tail;
-    char *error_msg;
-    unsigned nframes;
+    unsigned max_thread_frames;
+    /* Monotonic time when the unwinding stops, zero if there is no limit. */
+    gint64 deadline;
+    bool limit_frames;
+    gint frames_left;
 };
 
-struct thread_callback_arg
+struct frame_callback_arg
 {
-    struct sr_core_thread **threads_tail;
+    /* NULL if there is no limit. */
+    struct unwind_budget *budget;
+    struct frame_cache *frame_cache;
+    struct sr_core_frame **frames_tail;
     char *error_msg;
+    unsigned nframes;
 };
 
 struct sr_core_stracetrace_unwind_state {
@@ -54,6 +61,29 @@ struct sr_core_stracetrace_unwind_state {
 
 static const int CB_STOP_UNWIND = DWARF_CB_ABORT+1;
 
+static bool
+unwind_budget_exhausted(struct unwind_budget *budget)
+{
+    if (budget->deadline && g_get_monotonic_time() >= budget->deadline)
+        return true;
+
+    return budget->limit_frames && g_atomic_int_get(&budget->frames_left) <= 0;
+}
+
+/* Returns false if the thread may not have another frame. */
+static bool
+unwind_budget_take_frame(struct unwind_budget *budget, unsigned nframes)
+{
+    if (budget->max_thread_frames && nframes >= budget->max_thread_frames)
+        return false;
+
+    if (budget->deadline && g_get_monotonic_time() >= budget->deadline)
+        return false;
+
+    return !budget->limit_frames
+        || g_atomic_int_add(&budget->frames_left, -1) > 0;
+}
+
 static int
 frame_callback(Dwfl_Frame *frame, void *data)
 {
@@ -69,7 +99,8 @@ frame_callback(Dwfl_Frame *frame, void *data)
     }
 
     Dwfl *dwfl = dwfl_thread_dwfl(dwfl_frame_thread(frame));
-    struct sr_core_frame *result = resolve_frame(dwfl, pc, minus_one);
+    struct sr_core_frame *result = resolve_frame(dwfl, frame_arg->frame_cache,
+                                                 pc, minus_one);
 
     /* Do not unwind below __libc_start_main. */
     if (0 == g_strcmp0(result->function_name, "__libc_start_main"))
@@ -78,6 +109,14 @@ frame_callback(Dwfl_Frame *frame, void *data)
         return CB_STOP_UNWIND;
     }
 
+    /* The innermost frames are kept when the budget runs out. */
+    if (frame_arg->budget
+        && !unwind_budget_take_frame(frame_arg->budget, frame_arg->nframes))
+    {
+        sr_core_frame_free(result);
+        return CB_STOP_UNWIND;
+    }
+
     *frame_arg->frames_tail = result;
     frame_arg->frames_tail = &result->next;
     frame_arg->nframes++;
@@ -98,22 +137,22 @@ truncate_long_thread(struct sr_core_thread *thread, struct frame_callback_arg *f
     }
 }
 
-static int
-unwind_thread(Dwfl_Thread *thread, void *data)
+static struct sr_core_thread *
+unwind_thread(Dwfl_Thread *thread, struct frame_cache *frame_cache,
+              struct unwind_budget *budget, char **error_msg)
 {
-    struct thread_callback_arg *thread_arg = data;
-    char **error_msg = &thread_arg->error_msg;
-
     struct sr_core_thread *result = sr_core_thread_new();
     if (!result)
     {
         set_error("Failed to initialize thread memory");
-        return DWARF_CB_ABORT;
+        return NULL;
     }
     result->id = (int64_t)dwfl_thread_tid(thread);
 
     struct frame_callback_arg frame_arg =
     {
+        .budget = budget,
+        .frame_cache = frame_cache,
         .frames_tail = &(result->frames),
         .error_msg = NULL,
         .nframes = 0
@@ -144,78 +183,523 @@ unwind_thread(Dwfl_Thread *thread, void *data)
 
     truncate_long_thread(result, &frame_arg);
 
-    *thread_arg->threads_tail = result;
-    thread_arg->threads_tail = &result->next;
-
-    return DWARF_CB_OK;
+    return result;
 
 abort:
     sr_core_thread_free(result);
-    return DWARF_CB_ABORT;
+    return NULL;
 }
 
-struct sr_core_stacktrace *
-sr_parse_coredump(const char *core_file,
-                  const char *exe_file,
-                  char **error_msg)
+/* A thread of the process to be unwound by one of the workers. */
+struct unwind_job
 {
-    struct sr_core_stacktrace *stacktrace = NULL;
+    pid_t tid;
+    /* Set by the worker that unwinds the thread. */
+    gint claimed;
+    /* The thread is left out of the stacktrace. */
+    bool skipped;
+    struct sr_core_thread *result;
+    char *error_msg;
+};
 
-    /* Initialize error_msg to 'no error'. */
+/* Every worker has its own libdwfl session, libdwfl handles must not be
+ * shared between threads. All workers walk the threads of the core in the
+ * same order and unwind the ones nobody has claimed yet. */
+struct unwind_worker
+{
+    struct core_handle *ch;
+    struct unwind_budget *budget;
+    struct unwind_job *jobs;
+    unsigned njobs;
+    /* Position of the next thread in the walk. */
+    unsigned next;
+};
+
+static int
+collect_thread(Dwfl_Thread *thread, void *data)
+{
+    GArray *jobs = data;
+    struct unwind_job job = { .tid = dwfl_thread_tid(thread) };
+
+    g_array_append_val(jobs, job);
+
+    return DWARF_CB_OK;
+}
+
+static int
+unwind_claimed_thread(Dwfl_Thread *thread, void *data)
+{
+    struct unwind_worker *worker = data;
+
+    if (worker->next >= worker->njobs)
+        return DWARF_CB_ABORT;
+
+    struct unwind_job *job = &worker->jobs[worker->next++];
+
+    if (!g_atomic_int_compare_and_exchange(&job->claimed, 0, 1))
+        return DWARF_CB_OK;
+
+    if (dwfl_thread_tid(thread) != job->tid)
+    {
+        job->error_msg = g_strdup_printf("Thread id %d found instead of %d",
+                                         (int)dwfl_thread_tid(thread),
+                                         (int)job->tid);
+        return DWARF_CB_OK;
+    }
+
+    /* Threads not started within the budget are left out. */
+    if (unwind_budget_exhausted(worker->budget))
+    {
+        job->skipped = true;
+        return DWARF_CB_OK;
+    }
+
+    job->result = unwind_thread(thread, worker->ch->frame_cache,
+                                worker->budget, &job->error_msg);
+
+    return DWARF_CB_OK;
+}
+
+static gpointer
+unwind_worker_run(gpointer data)
+{
+    struct unwind_worker *worker = data;
+    char *error_msg = NULL;
+
+    int ret = dwfl_getthreads(worker->ch->dwfl, unwind_claimed_thread, worker);
+    if (ret == -1)
+        error_msg = g_strdup_printf("dwfl_getthreads failed: %s",
+                                    dwfl_errmsg(-1));
+
+    /* The threads this worker did not reach are left to the others, those
+     * that nobody reached fail. */
     if (error_msg)
-        *error_msg = NULL;
+    {
+        for (unsigned i = worker->next; i < worker->njobs; i++)
+        {
+            if (g_atomic_int_compare_and_exchange(&worker->jobs[i].claimed,
+                                                  0, 1))
+            {
+                worker->jobs[i].error_msg = g_strdup(error_msg);
+            }
+        }
+
+        g_free(error_msg);
+    }
+
+    return NULL;
+}
+
+/* The coredump file or the image of a coredump read from a stream. */
+struct core_source
+{
+    const char *file;
+    /* NULL if the coredump is read from the file. */
+    char *image;
+    size_t image_size;
+};
+
+/* Opens the coredump for unwinding, including the process state. */
+static struct core_handle *
+open_coredump_attached(const struct core_source *core, const char *exe_file,
+                       struct sr_unwind_session *session, char **error_msg)
+{
+    struct core_handle *ch;
+
+    if (core->image)
+    {
+        ch = open_coredump_image(core->file, core->image, core->image_size,
+                                 exe_file, session, error_msg);
+    }
+    else
+        ch = open_coredump(core->file, exe_file, session, error_msg);
 
-    struct core_handle *ch = open_coredump(core_file, exe_file, error_msg);
     if (!ch)
-        goto fail;
+        return NULL;
 
     if (dwfl_core_file_attach(ch->dwfl, ch->eh) < 0)
     {
         set_error_dwfl("dwfl_core_file_attach");
-        goto fail;
+        core_handle_free(ch);
+        return NULL;
     }
 
-    stacktrace = sr_core_stacktrace_new();
-    if (!stacktrace)
+    return ch;
+}
+
+struct sr_core_stacktrace *
+sr_parse_coredump(const char *core_file,
+                  const char *exe_file,
+                  char **error_msg)
+{
+    struct sr_core_unwind_options options;
+
+    sr_core_unwind_options_init(&options);
+
+    return sr_parse_coredump_with_options(core_file, exe_file, &options,
+                                          error_msg);
+}
+
+struct sr_core_stacktrace *
+sr_parse_coredump_with_options(const char *core_file,
+                               const char *exe_file,
+                               const struct sr_core_unwind_options *options,
+                               char **error_msg)
+{
+    return sr_unwind_session_parse_coredump(NULL, core_file, exe_file,
+                                            options, error_msg);
+}
+
+/* The threads of a coredump unwound one after another in a single walk,
+ * the way of a single libdwfl session. */
+struct sequential_unwind
+{
+    struct unwind_budget *budget;
+    struct frame_cache *frame_cache;
+    /* Zero if the first thread is taken as the crash thread. */
+    pid_t crash_tid;
+    bool crash_thread_only;
+    struct sr_core_thread **threads_tail;
+    struct sr_core_thread *crash_thread;
+    char *error_msg;
+};
+
+static int
+unwind_next_thread(Dwfl_Thread *thread, void *data)
+{
+    struct sequential_unwind *arg = data;
+    pid_t tid = dwfl_thread_tid(thread);
+
+    if (arg->crash_tid == 0)
+        arg->crash_tid = tid;
+
+    if (arg->crash_thread_only && tid != arg->crash_tid)
+        return DWARF_CB_OK;
+
+    /* Threads not started within the budget are left out. */
+    if (unwind_budget_exhausted(arg->budget))
+        return CB_STOP_UNWIND;
+
+    struct sr_core_thread *result = unwind_thread(thread, arg->frame_cache,
+                                                  arg->budget, &arg->error_msg);
+    if (!result)
     {
-        set_error("Failed to initialize stacktrace memory");
-        goto fail;
+        if (!arg->error_msg)
+        {
+            arg->error_msg = g_strdup_printf("Failed to unwind thread id %d",
+                                             (int)tid);
+        }
+
+        return DWARF_CB_ABORT;
     }
 
-    struct thread_callback_arg thread_arg =
+    *arg->threads_tail = result;
+    arg->threads_tail = &result->next;
+
+    if (tid == arg->crash_tid)
+    {
+        arg->crash_thread = result;
+
+        if (arg->crash_thread_only)
+            return CB_STOP_UNWIND;
+    }
+
+    return DWARF_CB_OK;
+}
+
+static struct sr_core_stacktrace *
+unwind_threads_sequentially(struct core_handle *ch,
+                            struct unwind_budget *budget,
+                            pid_t crash_tid,
+                            bool crash_thread_only,
+                            char **error_msg)
+{
+    struct sr_core_stacktrace *stacktrace = sr_core_stacktrace_new();
+    struct sequential_unwind arg =
     {
-        .threads_tail = &(stacktrace->threads),
-        .error_msg = NULL
+        .budget = budget,
+        .frame_cache = ch->frame_cache,
+        .crash_tid = crash_tid,
+        .crash_thread_only = crash_thread_only,
+        .threads_tail = &stacktrace->threads,
     };
 
-    int ret = dwfl_getthreads(ch->dwfl, unwind_thread, &thread_arg);
-    if (ret != 0)
+    int ret = dwfl_getthreads(ch->dwfl, unwind_next_thread, &arg);
+    if (ret != 0 && ret != CB_STOP_UNWIND)
     {
         if (ret == -1)
             set_error_dwfl("dwfl_getthreads");
         else if (ret == DWARF_CB_ABORT)
-        {
-            set_error("%s", thread_arg.error_msg);
-            g_free(thread_arg.error_msg);
-        }
+            set_error("%s", arg.error_msg);
         else
             set_error("Unknown error in dwfl_getthreads");
 
+        g_free(arg.error_msg);
         sr_core_stacktrace_free(stacktrace);
-        stacktrace = NULL;
+        return NULL;
+    }
+
+    stacktrace->crash_thread = arg.crash_thread;
+    return stacktrace;
+}
+
+static struct sr_core_stacktrace *
+unwind_threads_concurrently(struct core_handle *ch,
+                            const struct core_source *core,
+                            const char *exe_file,
+                            struct sr_unwind_session *session,
+                            struct unwind_budget *budget,
+                            pid_t crash_tid,
+                            bool crash_thread_only,
+                            unsigned nthreads,
+                            char **error_msg)
+{
+    struct sr_core_stacktrace *stacktrace = NULL;
+    char *thread_error = NULL;
+    GArray *jobs = g_array_new(FALSE, TRUE, sizeof(struct unwind_job));
+
+    if (dwfl_getthreads(ch->dwfl, collect_thread, jobs) != 0)
+    {
+        set_error_dwfl("dwfl_getthreads");
         goto fail;
     }
 
-    stacktrace->executable = g_strdup(exe_file);
-    stacktrace->signal = get_signal_number(ch->eh, core_file);
-    /* FIXME: is this the best we can do? */
-    stacktrace->crash_thread = stacktrace->threads;
+    unsigned njobs = jobs->len;
+
+    /* Without a thread that received a signal, the first thread is taken
+     * as the crash thread. */
+    if (crash_tid == 0 && jobs->len > 0)
+        crash_tid = g_array_index(jobs, struct unwind_job, 0).tid;
+
+    if (crash_thread_only)
+    {
+        njobs = 0;
+
+        for (guint i = 0; i < jobs->len; i++)
+        {
+            struct unwind_job *job = &g_array_index(jobs, struct unwind_job, i);
+
+            if (job->tid == crash_tid)
+            {
+                njobs++;
+                continue;
+            }
+
+            job->claimed = 1;
+            job->skipped = true;
+        }
+    }
+
+    unsigned nworkers = MAX(1, MIN(nthreads, njobs));
+    struct unwind_worker *workers = g_new0(struct unwind_worker, nworkers);
+
+    /* The calling thread opens the sessions and works as the first
+     * worker. */
+    workers[0].ch = ch;
+    for (unsigned k = 1; k < nworkers; k++)
+    {
+        char *worker_error = NULL;
+
+        workers[k].ch = open_coredump_attached(core, exe_file, session,
+                                               &worker_error);
+        if (!workers[k].ch)
+        {
+            warn("Unwinding with %u threads only: %s", k, worker_error);
+            g_free(worker_error);
+            nworkers = k;
+            break;
+        }
+    }
+
+    for (unsigned k = 0; k < nworkers; k++)
+    {
+        workers[k].budget = budget;
+        workers[k].jobs = (struct unwind_job *)jobs->data;
+        workers[k].njobs = jobs->len;
+    }
+
+    GThread **threads = g_new(GThread *, nworkers);
+    for (unsigned k = 1; k < nworkers; k++)
+        threads[k] = g_thread_new("sr-unwind", unwind_worker_run, &workers[k]);
+
+    unwind_worker_run(&workers[0]);
+
+    for (unsigned k = 1; k < nworkers; k++)
+    {
+        g_thread_join(threads[k]);
+        core_handle_free(workers[k].ch);
+    }
+
+    g_free(threads);
+    g_free(workers);
+
+    /* Link the threads in the order of the core, the first error wins. */
+    stacktrace = sr_core_stacktrace_new();
+    struct sr_core_thread **threads_tail = &stacktrace->threads;
+
+    for (guint i = 0; i < jobs->len; i++)
+    {
+        struct unwind_job *job = &g_array_index(jobs, struct unwind_job, i);
+
+        if (!job->result && !job->skipped && !thread_error)
+        {
+            thread_error = job->error_msg ? job->error_msg
+                : g_strdup_printf("Failed to unwind thread id %d",
+                                  (int)job->tid);
+            job->error_msg = NULL;
+        }
+
+        g_free(job->error_msg);
+
+        if (job->result)
+        {
+            if (job->tid == crash_tid)
+                stacktrace->crash_thread = job->result;
+
+            *threads_tail = job->result;
+            threads_tail = &job->result->next;
+        }
+    }
+
+    if (thread_error)
+    {
+        if (error_msg)
+            *error_msg = thread_error;
+        else
+            g_free(thread_error);
+
+        sr_core_stacktrace_free(stacktrace);
+        stacktrace = NULL;
+    }
 
 fail:
+    g_array_free(jobs, TRUE);
+    return stacktrace;
+}
+
+static struct sr_core_stacktrace *
+parse_coredump(struct sr_unwind_session *session,
+               const struct core_source *core,
+               const char *exe_file,
+               const struct sr_core_unwind_options *options,
+               char **error_msg)
+{
+    struct sr_core_stacktrace *stacktrace;
+
+    struct unwind_budget budget =
+    {
+        .max_thread_frames = options->max_thread_frames,
+        .limit_frames = options->max_frames > 0,
+        .frames_left = MIN(options->max_frames, G_MAXINT),
+    };
+
+    if (options->timeout_ms > 0)
+    {
+        budget.deadline = g_get_monotonic_time()
+            + (gint64)options->timeout_ms * G_TIME_SPAN_MILLISECOND;
+    }
+
+    struct core_handle *ch = open_coredump_attached(core, exe_file,
+                                                    session, error_msg);
+    if (!ch)
+        return NULL;
+
+    pid_t crash_tid = 0;
+    short signal = get_crash_thread(ch->eh, core->file, &crash_tid);
+
+    unsigned nthreads = options->nthreads;
+    if (nthreads == 0)
+        nthreads = g_get_num_processors();
+
+    /* A single unwinder walks the threads once, without the jobs the
+     * concurrent workers share. */
+    if (nthreads == 1)
+    {
+        stacktrace = unwind_threads_sequentially(ch, &budget, crash_tid,
+                                                 options->crash_thread_only,
+                                                 error_msg);
+    }
+    else
+    {
+        stacktrace = unwind_threads_concurrently(ch, core, exe_file, session,
+                                                 &budget, crash_tid,
+                                                 options->crash_thread_only,
+                                                 nthreads, error_msg);
+    }
+
+    if (stacktrace)
+    {
+        stacktrace->executable = g_strdup(exe_file);
+        stacktrace->signal = signal;
+        stacktrace->only_crash_thread = options->crash_thread_only;
+
+        /* The crash thread may have been left out by the budget. */
+        if (!stacktrace->crash_thread)
+            stacktrace->crash_thread = stacktrace->threads;
+    }
+
     core_handle_free(ch);
     return stacktrace;
 }
 
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump(struct sr_unwind_session *session,
+                                 const char *core_file,
+                                 const char *exe_file,
+                                 const struct sr_core_unwind_options *options,
+                                 char **error_msg)
+{
+    struct sr_core_unwind_options default_options;
+    struct core_source core = { .file = core_file };
+
+    /* Initialize error_msg to 'no error'. */
+    if (error_msg)
+        *error_msg = NULL;
+
+    if (!options)
+    {
+        sr_core_unwind_options_init(&default_options);
+        options = &default_options;
+    }
+
+    return parse_coredump(session, &core, exe_file, options, error_msg);
+}
+
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump_stream(struct sr_unwind_session *session,
+                                        struct sr_core_stream *stream,
+                                        const char *exe_file,
+                                        const struct sr_core_unwind_options *options,
+                                        char **error_msg)
+{
+    struct sr_core_unwind_options default_options;
+    struct core_source core = { .file = "coredump stream" };
+
+    /* Initialize error_msg to 'no error'. */
+    if (error_msg)
+        *error_msg = NULL;
+
+    if (!options)
+    {
+        sr_core_unwind_options_init(&default_options);
+        options = &default_options;
+    }
+
+    /* All the unwinders share the image, libelf only reads it. */
+    if (!read_core_image(stream, options->stream_segment_limit,
+                         options->stream_image_limit,
+                         &core.image, &core.image_size, error_msg))
+    {
+        return NULL;
+    }
+
+    struct sr_core_stacktrace *stacktrace =
+        parse_coredump(session, &core, exe_file, options, error_msg);
+
+    g_free(core.image);
+    return stacktrace;
+}
+
 /* If PTRACE_SEIZE is not defined (kernel < 3.4), stub function from
  * core_unwind.c is used. */
 #ifdef PTRACE_SEIZE
@@ -336,12 +820,14 @@ sr_core_stacktrace_from_core_hook_generate(pid_t tid,
 
     struct frame_callback_arg frame_arg =
     {
+        .frame_cache = frame_cache_new(NULL),
         .frames_tail = &(stacktrace->threads->frames),
         .error_msg = NULL,
         .nframes = 0
     };
 
     int ret = dwfl_getthread_frames(state->dwfl, tid, frame_callback, &frame_arg);
+    frame_cache_free(frame_arg.frame_cache);
     if (ret != 0 && ret != CB_STOP_UNWIND)
     {
         if (ret == -1)
@@ -33,6 +33,7 @@ static struct sr_core_thread *
 unwind_thread(struct UCD_info *ui,
               unw_addr_space_t as,
               Dwfl *dwfl,
+              struct frame_cache *frame_cache,
               int thread_no,
               char **error_msg)
 {
@@ -62,7 +63,8 @@ unwind_thread(struct UCD_info *ui,
         if (ip == 0)
             break;
 
-        struct sr_core_frame *entry = resolve_frame(dwfl, ip, false);
+        struct sr_core_frame *entry = resolve_frame(dwfl, frame_cache, ip,
+                                                    false);
 
         if (!entry->function_name)
         {
@@ -137,7 +139,7 @@ sr_parse_coredump(const char *core_file,
     if (error_msg)
         *error_msg = NULL;
 
-    struct core_handle *ch = open_coredump(core_file, exe_file, error_msg);
+    struct core_handle *ch = open_coredump(core_file, exe_file, NULL, error_msg);
     if (*error_msg)
         return NULL;
 
@@ -178,7 +180,9 @@ sr_parse_coredump(const char *core_file,
     int tnum, nthreads = _UCD_get_num_threads(ui);
     for (tnum = 0; tnum < nthreads; ++tnum)
     {
-        struct sr_core_thread *trace = unwind_thread(ui, as, ch->dwfl, tnum, error_msg);
+        struct sr_core_thread *trace = unwind_thread(ui, as, ch->dwfl,
+                                                     ch->frame_cache, tnum,
+                                                     error_msg);
         if (trace)
         {
             stacktrace->threads = sr_core_thread_append(stacktrace->threads, trace);
@@ -205,4 +209,38 @@ fail_destroy_handle:
     return stacktrace;
 }
 
+/* The options are ignored, the threads are always unwound fully one after
+ * another. libunwind coredump accessors do not support concurrent use. */
+struct sr_core_stacktrace *
+sr_parse_coredump_with_options(const char *core_file,
+                               const char *exe_file,
+                               const struct sr_core_unwind_options *options,
+                               char **error_msg)
+{
+    return sr_parse_coredump(core_file, exe_file, error_msg);
+}
+
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump(struct sr_unwind_session *session,
+                                 const char *core_file,
+                                 const char *exe_file,
+                                 const struct sr_core_unwind_options *options,
+                                 char **error_msg)
+{
+    return sr_parse_coredump(core_file, exe_file, error_msg);
+}
+
+/* libunwind opens the coredump file by its name. */
+struct sr_core_stacktrace *
+sr_unwind_session_parse_coredump_stream(struct sr_unwind_session *session,
+                                        struct sr_core_stream *stream,
+                                        const char *exe_file,
+                                        const struct sr_core_unwind_options *options,
+                                        char **error_msg)
+{
+    *error_msg = g_strdup_printf("Unwinding coredump streams is not supported "
+                                 "with libunwind");
+    return NULL;
+}
+
 #endif /* WITH_LIBUNWIND */
@@ -60,6 +60,17 @@ sr_disasm_get_function_instructions(struct sr_disasm_state *state,
     return NULL;
 }
 
+struct sr_disasm_instruction *
+sr_disasm_decode_function(struct sr_disasm_state *state,
+                          uint64_t start_offset,
+                          uint64_t size,
+                          size_t *count,
+                          char **error_message)
+{
+    *error_message = g_strdup_printf("satyr compiled without libopcodes");
+    return NULL;
+}
+
 void
 sr_disasm_instructions_free(char **instructions)
 {
@@ -137,6 +148,39 @@ sr_disasm_instruction_parse_single_address_operand(char *instruction,
     return true;
 }
 
+uint64_t *
+sr_disasm_get_decoded_callee_addresses(const struct sr_disasm_instruction *instructions,
+                                       size_t count)
+{
+    uint64_t *result = g_new(uint64_t, count + 1);
+    size_t result_offset = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (instructions[i].type != SR_DISASM_CALL ||
+            !instructions[i].has_target)
+        {
+            continue;
+        }
+
+        uint64_t address = instructions[i].target;
+
+        /* Check if address is already stored in the list. */
+        size_t result_loop = 0;
+        for (; result_loop < result_offset; ++result_loop)
+        {
+            if (result[result_loop] == address)
+                break;
+        }
+
+        if (result_loop == result_offset)
+            result[result_offset++] = address;
+    }
+
+    result[result_offset] = 0;
+    return result;
+}
+
 uint64_t *
 sr_disasm_get_callee_addresses(char **instructions)
 {
@@ -160,7 +204,7 @@ sr_disasm_get_callee_addresses(char **instructions)
     }
 
     /* Create the output array and fill it */
-    uint64_t *result = g_malloc(result_size * sizeof(*result) + 1);
+    uint64_t *result = g_new(uint64_t, result_size + 1);
     size_t result_offset = 0;
     instruction_offset = 0;
     while (instructions[instruction_offset])
@@ -31,9 +31,42 @@ extern "C" {
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 struct sr_disasm_state;
 
+/**
+ * @brief Kind of a decoded instruction, as far as control flow is
+ * concerned.
+ */
+enum sr_disasm_instruction_type
+{
+    SR_DISASM_OTHER = 0,
+    SR_DISASM_CALL,
+    SR_DISASM_JUMP,
+    SR_DISASM_CONDITIONAL_JUMP,
+    SR_DISASM_RETURN,
+};
+
+/**
+ * @brief A decoded instruction.
+ *
+ * Unlike the textual form, it can be inspected without parsing the
+ * mnemonic and the operands.
+ */
+struct sr_disasm_instruction
+{
+    /** Address of the instruction. */
+    uint64_t address;
+
+    enum sr_disasm_instruction_type type;
+
+    /** Whether the instruction transfers control to a target given
+     * directly by an address operand. */
+    bool has_target;
+    uint64_t target;
+};
+
 struct sr_disasm_state *
 sr_disasm_init(const char *file_name,
                char **error_message);
@@ -54,6 +87,22 @@ sr_disasm_get_function_instructions(struct sr_disasm_state *state,
 void
 sr_disasm_instructions_free(char **instructions);
 
+/**
+ * Decodes the function starting at 'start_offset' and taking 'size'
+ * bytes without formatting the instructions as text.
+ * @param count
+ *   Is set to the number of the decoded instructions.
+ * @returns
+ *   Array of the decoded instructions to be released by g_free(), NULL
+ *   on failure.
+ */
+struct sr_disasm_instruction *
+sr_disasm_decode_function(struct sr_disasm_state *state,
+                          uint64_t start_offset,
+                          uint64_t size,
+                          size_t *count,
+                          char **error_message);
+
 bool
 sr_disasm_instruction_is_one_of(char *instruction,
                                 const char **mnemonics);
@@ -72,6 +121,14 @@ sr_disasm_instruction_parse_single_address_operand(char *instruction,
 uint64_t *
 sr_disasm_get_callee_addresses(char **instructions);
 
+/* Returns the targets of the direct calls among the decoded
+ * instructions, without duplicates.  The list is terminated by address
+ * 0.
+ */
+uint64_t *
+sr_disasm_get_decoded_callee_addresses(const struct sr_disasm_instruction *instructions,
+                                       size_t count);
+
 char *
 sr_disasm_instructions_to_text(char **instructions);
 
@@ -22,22 +22,31 @@
 #include "frame.h"
 #include "normalize.h"
 #include "utils.h"
+#include "gdb/frame.h"
 #include "gdb/thread.h"
 #include "internal_utils.h"
+#include "thread_symbols.h"
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #define SHA1_DIGEST_LEN 20
 
-float
-distance_jaro_winkler(struct sr_thread *thread1,
-                      struct sr_thread *thread2)
+/* All distances lie between 0 and 1, a bound of 1 never cuts anything. */
+#define DISTANCE_UNBOUNDED 1.0f
+
+static float
+distance_jaro_winkler(const struct thread_symbols *thread1,
+                      const struct thread_symbols *thread2)
 {
     assert(thread1->type == thread2->type);
 
-    int frame1_count = sr_thread_frame_count(thread1);
-    int frame2_count = sr_thread_frame_count(thread2);
+    int frame1_count = thread1->frame_count;
+    int frame2_count = thread2->frame_count;
 
     if (frame1_count == 0 && frame2_count == 0)
         return 1.0;
@@ -50,32 +59,30 @@ distance_jaro_winkler(struct sr_thread *thread1,
     bool still_prefix = true;
     float trans_count = 0, match_count = 0;
 
-    struct sr_frame *curr_frame = sr_thread_frames(thread1);
-    for (int i = 1; curr_frame; ++i)
+    for (int i = 1; i <= frame1_count; ++i)
     {
         bool match = false;
-        struct sr_frame *curr_frame2 = sr_thread_frames(thread2);
-        for (int j = 1; !match && curr_frame2; ++j)
+        for (int j = 1; !match && j <= frame2_count; ++j)
         {
+            bool equal = thread_symbols_frames_equal(thread1, i - 1,
+                                                     thread2, j - 1);
+
             /* Whether the prefix continues to be the same for both
              * threads or not.
              */
-            if (i == j && 0 != sr_frame_cmp_distance(curr_frame, curr_frame2))
+            if (i == j && !equal)
                 still_prefix = false;
 
             /* Getting a match only if not too far away from each
              * other and if functions aren't both unpaired unknown
              * functions.
              */
-            if (abs(i - j) <= max_frame_count / 2 - 1 &&
-                0 == sr_frame_cmp_distance(curr_frame, curr_frame2))
+            if (abs(i - j) <= max_frame_count / 2 - 1 && equal)
             {
                 match = true;
                 if (i != j)
                     ++trans_count;  // transposition in place
             }
-
-            curr_frame2 = sr_frame_next(curr_frame2);
         }
 
         if (still_prefix)
@@ -83,8 +90,6 @@ distance_jaro_winkler(struct sr_thread *thread1,
 
         if (match)
             ++match_count;
-
-        curr_frame = sr_frame_next(curr_frame);
     }
 
     trans_count /= 2;
@@ -108,63 +113,80 @@ distance_jaro_winkler(struct sr_thread *thread1,
     return dist;
 }
 
+/* Whether the frame is equal to any of the frames [begin, end) of the
+ * haystack. */
 static bool
-distance_jaccard_frames_contain(struct sr_frame *haystack,
-                                struct sr_frame *needle)
+distance_jaccard_frames_contain(const struct thread_symbols *haystack,
+                                int begin,
+                                int end,
+                                const struct thread_symbols *needle,
+                                int index)
 {
-    while (haystack)
+    for (int i = begin; i < end; i++)
     {
         // Checking if functions are the same but not both "??".
-        if (!sr_frame_cmp_distance(haystack, needle))
+        if (thread_symbols_frames_equal(haystack, i, needle, index))
             return true;
-
-        haystack = sr_frame_next(haystack);
     }
 
     return false;
 }
 
-float
-distance_jaccard(struct sr_thread *thread1,
-                 struct sr_thread *thread2)
+static float
+distance_jaccard(const struct thread_symbols *thread1,
+                 const struct thread_symbols *thread2,
+                 float max_distance)
 {
     assert(thread1->type == thread2->type);
 
     int intersection_size = 0, set1_size = 0, set2_size = 0;
+    bool bounded = (max_distance < DISTANCE_UNBOUNDED);
 
-    for (struct sr_frame *curr_frame = sr_thread_frames(thread1);
-         curr_frame;
-         curr_frame = sr_frame_next(curr_frame))
+    for (int i = 0; i < thread2->frame_count; i++)
     {
-        if (distance_jaccard_frames_contain(
-                sr_frame_next(curr_frame),
-                curr_frame))
+        if (distance_jaccard_frames_contain(thread2, i + 1,
+                                            thread2->frame_count,
+                                            thread2, i))
         {
             continue; // not last, skip
         }
 
-        ++set1_size;
+        ++set2_size;
+    }
 
-        if (distance_jaccard_frames_contain(
-                sr_thread_frames(thread2),
-                curr_frame))
+    for (int i = 0; i < thread1->frame_count; i++)
+    {
+        /* The intersection can grow at most by the remaining frames and
+         * the union contains the frames of the first set missing from the
+         * second one, which gives a lower bound of the distance. The
+         * frames equality is not transitive, so the intersection is not
+         * bounded by the size of the second set. */
+        if (bounded && set2_size > 0)
         {
-            ++intersection_size;
+            int max_intersection = intersection_size +
+                                   thread1->frame_count - i;
+            int min_union = set2_size + set1_size - intersection_size;
+
+            float bound = 1.0 - max_intersection / (float)min_union;
+            if (bound > max_distance)
+                return bound;
         }
-    }
 
-    for (struct sr_frame *curr_frame = sr_thread_frames(thread2);
-         curr_frame;
-         curr_frame = sr_frame_next(curr_frame))
-    {
-        if (distance_jaccard_frames_contain(
-                sr_frame_next(curr_frame),
-                curr_frame))
+        if (distance_jaccard_frames_contain(thread1, i + 1,
+                                            thread1->frame_count,
+                                            thread1, i))
         {
             continue; // not last, skip
         }
 
-        ++set2_size;
+        ++set1_size;
+
+        if (distance_jaccard_frames_contain(thread2, 0,
+                                            thread2->frame_count,
+                                            thread1, i))
+        {
+            ++intersection_size;
+        }
     }
 
     int union_size = set1_size + set2_size - intersection_size;
@@ -178,15 +200,227 @@ distance_jaccard(struct sr_thread *thread1,
     return j_distance;
 }
 
-float
-distance_levenshtein(struct sr_thread *thread1,
-                     struct sr_thread *thread2,
-                     bool transposition)
+/* Match masks of the pattern in the bit-parallel Levenshtein distance,
+ * an open addressing table from symbol ID to the bit masks of the pattern
+ * positions holding the symbol. */
+struct pattern_masks
+{
+    /* Number of slots, a power of two. */
+    unsigned size;
+    /* Symbol ID + 1 for every slot, 0 for empty slots. */
+    uint32_t *keys;
+    /* Number of 64-bit words per symbol. */
+    int words;
+    /* Masks for every slot, words entries each. */
+    uint64_t *masks;
+};
+
+static unsigned
+pattern_masks_slot(const struct pattern_masks *masks, uint32_t id)
+{
+    unsigned slot = (id * UINT32_C(2654435761)) & (masks->size - 1);
+
+    while (masks->keys[slot] != 0 && masks->keys[slot] != id + 1)
+        slot = (slot + 1) & (masks->size - 1);
+
+    return slot;
+}
+
+static void
+pattern_masks_fill(struct pattern_masks *masks, const uint32_t *pattern,
+                   int length)
+{
+    memset(masks->keys, 0, masks->size * sizeof(*masks->keys));
+
+    for (int i = 0; i < length; i++)
+    {
+        unsigned slot = pattern_masks_slot(masks, pattern[i]);
+        uint64_t *mask = &masks->masks[slot * masks->words];
+
+        if (masks->keys[slot] == 0)
+        {
+            masks->keys[slot] = pattern[i] + 1;
+            memset(mask, 0, masks->words * sizeof(*mask));
+        }
+
+        mask[i / 64] |= UINT64_C(1) << (i % 64);
+    }
+}
+
+/* Returns the masks of the symbol, NULL if it is not in the pattern. */
+static const uint64_t *
+pattern_masks_get(const struct pattern_masks *masks, uint32_t id)
+{
+    unsigned slot = pattern_masks_slot(masks, id);
+
+    if (masks->keys[slot] == 0)
+        return NULL;
+
+    return &masks->masks[slot * masks->words];
+}
+
+/* One step of the Myers/Hyyro bit-vector algorithm on a 64-row block of
+ * the dynamic programming matrix. The vertical deltas of the column are
+ * kept in pv (+1) and mv (-1), hin is the horizontal delta entering the
+ * top row of the block. Returns the horizontal delta leaving the row
+ * selected by the last mask. */
+static int
+levenshtein_advance_block(uint64_t *pv, uint64_t *mv, uint64_t eq, int hin,
+                          uint64_t last)
+{
+    uint64_t xv = eq | *mv;
+
+    if (hin < 0)
+        eq |= 1;
+
+    uint64_t xh = (((eq & *pv) + *pv) ^ *pv) | eq;
+    uint64_t ph = *mv | ~(xh | *pv);
+    uint64_t mh = *pv & xh;
+
+    int hout = 0;
+    if (ph & last)
+        hout = 1;
+    else if (mh & last)
+        hout = -1;
+
+    ph <<= 1;
+    mh <<= 1;
+
+    if (hin < 0)
+        mh |= 1;
+    else if (hin > 0)
+        ph |= 1;
+
+    *pv = mh | ~(xv | ph);
+    *mv = ph & xv;
+
+    return hout;
+}
+
+/* Edit distance of two interned threads computed in O(ceil(m/64) * n)
+ * word operations, where the shorter thread of length m is used as the
+ * pattern. The score of the last row changes by at most one per column,
+ * so the computation stops with a value greater than max_edits once the
+ * distance cannot get within max_edits. */
+static int
+levenshtein_bitparallel(const uint32_t *pattern, int pattern_length,
+                        const uint32_t *text, int text_length, int max_edits)
+{
+    if (pattern_length == 0)
+        return text_length;
+
+    int words = (pattern_length + 63) / 64;
+    uint64_t last = UINT64_C(1) << ((pattern_length - 1) % 64);
+    int score = pattern_length;
+
+    struct pattern_masks masks;
+    masks.words = words;
+    masks.size = 1;
+    while (masks.size < 2 * (unsigned)pattern_length)
+        masks.size *= 2;
+
+    if (words == 1)
+    {
+        /* The common case of short threads, no allocation needed. */
+        uint32_t keys[128];
+        uint64_t mask_storage[128];
+
+        masks.keys = keys;
+        masks.masks = mask_storage;
+        pattern_masks_fill(&masks, pattern, pattern_length);
+
+        uint64_t pv = ~UINT64_C(0), mv = 0;
+        for (int j = 0; j < text_length; j++)
+        {
+            const uint64_t *eq = pattern_masks_get(&masks, text[j]);
+            score += levenshtein_advance_block(&pv, &mv, eq ? *eq : 0, 1,
+                                               last);
+
+            if (score - (text_length - j - 1) > max_edits)
+                return score - (text_length - j - 1);
+        }
+
+        return score;
+    }
+
+    masks.keys = g_malloc_n(masks.size, sizeof(*masks.keys));
+    masks.masks = g_malloc_n(masks.size * words, sizeof(*masks.masks));
+    pattern_masks_fill(&masks, pattern, pattern_length);
+
+    uint64_t *pv = g_malloc_n(words, sizeof(*pv));
+    uint64_t *mv = g_malloc0_n(words, sizeof(*mv));
+    for (int k = 0; k < words; k++)
+        pv[k] = ~UINT64_C(0);
+
+    for (int j = 0; j < text_length; j++)
+    {
+        const uint64_t *eq = pattern_masks_get(&masks, text[j]);
+
+        /* The first row of the matrix grows by one in every column. */
+        int h = 1;
+        for (int k = 0; k < words - 1; k++)
+        {
+            h = levenshtein_advance_block(&pv[k], &mv[k], eq ? eq[k] : 0, h,
+                                          UINT64_C(1) << 63);
+        }
+
+        score += levenshtein_advance_block(&pv[words - 1], &mv[words - 1],
+                                           eq ? eq[words - 1] : 0, h, last);
+
+        if (score - (text_length - j - 1) > max_edits)
+        {
+            score -= text_length - j - 1;
+            break;
+        }
+    }
+
+    g_free(pv);
+    g_free(mv);
+    g_free(masks.keys);
+    g_free(masks.masks);
+
+    return score;
+}
+
+/* The largest number of edits of threads with max_frame_count frames at
+ * most whose normalized distance is within max_distance. */
+static int
+levenshtein_max_edits(float max_distance, int max_frame_count)
+{
+    if (max_distance >= DISTANCE_UNBOUNDED)
+        return max_frame_count;
+
+    if (max_distance < 0.0f)
+        return -1;
+
+    /* Compare the same quotients as the ones returned. */
+    int max_edits = max_distance * max_frame_count;
+    while (max_edits < max_frame_count &&
+           (float)(max_edits + 1) / max_frame_count <= max_distance)
+        ++max_edits;
+
+    while (max_edits >= 0 &&
+           (float)max_edits / max_frame_count > max_distance)
+        --max_edits;
+
+    return max_edits;
+}
+
+/* When the distance exceeds max_distance, a value greater than max_distance
+ * is returned, but the distance is not computed exactly. Only the diagonals
+ * of the matrix within max_edits of the main one and of the final cell are
+ * computed (Ukkonen's cut-off), the cells outside of the band have an
+ * infinite distance. */
+static float
+distance_levenshtein(const struct thread_symbols *thread1,
+                     const struct thread_symbols *thread2,
+                     bool transposition,
+                     float max_distance)
 {
     assert(thread1->type == thread2->type);
 
-    int frame_count1 = sr_thread_frame_count(thread1);
-    int frame_count2 = sr_thread_frame_count(thread2);
+    int frame_count1 = thread1->frame_count;
+    int frame_count2 = thread2->frame_count;
 
     int max_frame_count = frame_count2;
     if (max_frame_count < frame_count1)
@@ -196,6 +430,34 @@ distance_levenshtein(struct sr_thread *thread1,
     if (max_frame_count == 0)
         return 0.0;
 
+    int max_edits = levenshtein_max_edits(max_distance, max_frame_count);
+    float exceeded = (float)(max_edits + 1) / max_frame_count;
+
+    /* At least the difference of the lengths has to be inserted. */
+    if (abs(frame_count1 - frame_count2) > max_edits)
+        return exceeded;
+
+    /* The bit-parallel algorithm computes whole columns, but it is still
+     * faster than the band. */
+    if (!transposition && thread1->ids && thread2->ids)
+    {
+        int result;
+
+        if (frame_count1 <= frame_count2)
+            result = levenshtein_bitparallel(thread1->ids, frame_count1,
+                                             thread2->ids, frame_count2,
+                                             max_edits);
+        else
+            result = levenshtein_bitparallel(thread2->ids, frame_count2,
+                                             thread1->ids, frame_count1,
+                                             max_edits);
+
+        if (result > max_edits)
+            return exceeded;
+
+        return (float)result / max_frame_count;
+    }
+
     int m = frame_count1 + 1;
     int n = frame_count2 + 1;
 
@@ -205,6 +467,12 @@ distance_levenshtein(struct sr_thread *thread1,
     int *dist = g_malloc_n(sizeof(int), m + n + 1);
     int *dist1 = g_malloc_n(sizeof(int), m + n + 1);
 
+    /* Diagonal l = m + j - i holds the cells (i, j), the band of the
+     * diagonals that can be part of a path within max_edits. */
+    int infinity = m + n;
+    int diagonal_min = MAX(-max_edits, frame_count2 - frame_count1 - max_edits);
+    int diagonal_max = MIN(max_edits, frame_count2 - frame_count1 + max_edits);
+
     // first row and column having distance equal to their position
     for (int i = m; i > 0; --i)
         dist[m - i] = i;
@@ -212,14 +480,22 @@ distance_levenshtein(struct sr_thread *thread1,
     for (int i = 0; i <= n; ++i)
         dist[m + i] = i;
 
-    struct sr_frame *curr_frame2 = sr_thread_frames(thread2);
-    struct sr_frame *prev_frame = NULL;
-    struct sr_frame *prev_frame2 = NULL;
+    for (int l = 0; l <= m + n; ++l)
+    {
+        if (l - m < diagonal_min || l - m > diagonal_max)
+            dist[l] = infinity;
+    }
 
-    for (int j = 1; curr_frame2; ++j)
+    int previous_min = 0;
+    for (int j = 1; j <= frame_count2; ++j)
     {
-        struct sr_frame *curr_frame = sr_thread_frames(thread1);
-        for (int i = 1; curr_frame; ++i)
+        /* The cell (0, j) has not been overwritten yet. */
+        int column_min = dist[m + j];
+
+        int i_begin = MAX(1, j - diagonal_max);
+        int i_end = MIN(frame_count1, j - diagonal_min);
+
+        for (int i = i_begin; i <= i_end; ++i)
         {
             int l = m + j - i;
 
@@ -231,7 +507,7 @@ distance_levenshtein(struct sr_thread *thread1,
             /*similar characters have distance equal to the previous
               one diagonally, "??" functions aren't taken as
               similar */
-            if (0 == sr_frame_cmp_distance(curr_frame, curr_frame2))
+            if (thread_symbols_frames_equal(thread1, i - 1, thread2, j - 1))
                 cost = 0;
             else
             {
@@ -250,31 +526,42 @@ distance_levenshtein(struct sr_thread *thread1,
               taking into account that "??" functions are not similar*/
             if (transposition &&
                 (i >= 2 && j >= 2 && dist[l] > dist2 + cost &&
-                 0 == sr_frame_cmp_distance(curr_frame, prev_frame2) &&
-                 0 == sr_frame_cmp_distance(prev_frame, curr_frame2)))
+                 thread_symbols_frames_equal(thread1, i - 1, thread2, j - 2) &&
+                 thread_symbols_frames_equal(thread1, i - 2, thread2, j - 1)))
             {
                 dist[l] = dist2 + cost;
             }
 
-            prev_frame = curr_frame;
-            curr_frame = sr_frame_next(curr_frame);
+            if (column_min > dist[l])
+                column_min = dist[l];
         }
 
-        prev_frame2 = curr_frame2;
-        curr_frame2 = sr_frame_next(curr_frame2);
+        /* The cells depend on the two previous columns at most. */
+        if (column_min > max_edits && previous_min > max_edits)
+        {
+            g_free(dist);
+            g_free(dist1);
+            return exceeded;
+        }
+
+        previous_min = column_min;
     }
 
     int result = dist[n];
     g_free(dist);
     g_free(dist1);
 
+    if (result > max_edits)
+        return exceeded;
+
     return (float)result / max_frame_count;
 }
 
-float
-sr_distance(enum sr_distance_type distance_type,
-            struct sr_thread *thread1,
-            struct sr_thread *thread2)
+static float
+distance_symbols(enum sr_distance_type distance_type,
+                 const struct thread_symbols *thread1,
+                 const struct thread_symbols *thread2,
+                 float max_distance)
 {
     /* Different thread types are always unequal. */
     if (thread1->type != thread2->type)
@@ -285,29 +572,59 @@ sr_distance(enum sr_distance_type distance_type,
     case SR_DISTANCE_JARO_WINKLER:
         return distance_jaro_winkler(thread1, thread2);
     case SR_DISTANCE_JACCARD:
-        return distance_jaccard(thread1, thread2);
+        return distance_jaccard(thread1, thread2, max_distance);
     case SR_DISTANCE_LEVENSHTEIN:
-        return distance_levenshtein(thread1, thread2, false);
+        return distance_levenshtein(thread1, thread2, false, max_distance);
     case SR_DISTANCE_DAMERAU_LEVENSHTEIN:
-        return distance_levenshtein(thread1, thread2, true);
+        return distance_levenshtein(thread1, thread2, true, max_distance);
     default:
         return 1.0f;
     }
 }
 
-static int
+float
+sr_distance(enum sr_distance_type distance_type,
+            struct sr_thread *thread1,
+            struct sr_thread *thread2)
+{
+    return sr_distance_bounded(distance_type, thread1, thread2,
+                               DISTANCE_UNBOUNDED);
+}
+
+float
+sr_distance_bounded(enum sr_distance_type distance_type,
+                    struct sr_thread *thread1,
+                    struct sr_thread *thread2,
+                    float max_distance)
+{
+    /* Different thread types are always unequal. */
+    if (thread1->type != thread2->type)
+        return 1.0f;
+
+    struct sr_thread *threads[] = { thread1, thread2 };
+    struct thread_symbols *symbols = thread_symbols_new(threads, 2);
+
+    float dist = distance_symbols(distance_type, &symbols[0], &symbols[1],
+                                  max_distance);
+
+    thread_symbols_free(symbols, 2);
+
+    return dist;
+}
+
+static size_t
 get_distance_position_mn(int m, int n, int i, int j)
 {
     /* The array holds only matrix entries (i, j) where i < j,
      * locate the position in the array. */
     assert(i < j && i >= 0 && i < m && j < n);
 
-    int h = n, l = n - i;
+    size_t h = n, l = n - i;
 
     return ((h * h - h) - (l * l - l)) / 2 + j - 1;
 }
 
-static int
+static size_t
 get_distance_position(const struct sr_distances *distances, int i, int j)
 {
     return get_distance_position_mn(distances->m, distances->n, i, j);
@@ -326,6 +643,8 @@ sr_distances_new(int m, int n)
 
     distances->m = m;
     distances->n = n;
+    distances->mapping = NULL;
+    distances->mapping_size = 0;
     distances->distances = g_malloc_n(
                                get_distance_position(distances, m - 1, n - 1) + 1,
                                sizeof(*distances->distances)
@@ -353,7 +672,11 @@ sr_distances_free(struct sr_distances *distances)
     if (!distances)
         return;
 
-    g_free(distances->distances);
+    if (distances->mapping)
+        munmap(distances->mapping, distances->mapping_size);
+    else
+        g_free(distances->distances);
+
     g_free(distances);
 }
 
@@ -390,161 +713,645 @@ sr_distances_set_distance(struct sr_distances *distances,
     distances->distances[get_distance_position(distances, i, j)] = d;
 }
 
+/* Interned threads prepared for pairwise comparison. */
+struct compare_ctx
+{
+    struct sr_thread **threads;
+    struct thread_symbols *symbols;
+    /* GDB threads containing "??" functions. */
+    bool *unknown_functions;
+    /* GDB threads with low quality frames, see
+     * sr_gdb_thread_quality_counts(). */
+    bool *incomplete;
+    int n;
+    /* Distances above the bound need not be computed exactly, see
+     * sr_distance_bounded(). */
+    float max_distance;
+};
+
+static void
+compare_ctx_init(struct compare_ctx *ctx, struct sr_thread **threads, int n)
+{
+    ctx->threads = threads;
+    ctx->n = n;
+    ctx->max_distance = DISTANCE_UNBOUNDED;
+    ctx->symbols = thread_symbols_new(threads, n);
+    ctx->unknown_functions = g_new0(bool, n);
+    ctx->incomplete = g_new0(bool, n);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (threads[i]->type != SR_REPORT_GDB)
+            continue;
+
+        struct sr_gdb_thread *thread = (struct sr_gdb_thread*)threads[i];
+        int ok = 0, all = 0;
+
+        sr_gdb_thread_quality_counts(thread, &ok, &all);
+        ctx->incomplete[i] = (ok != all);
+
+        for (struct sr_gdb_frame *frame = thread->frames;
+             frame;
+             frame = frame->next)
+        {
+            if (0 == g_strcmp0(frame->function_name, "??"))
+            {
+                ctx->unknown_functions[i] = true;
+                break;
+            }
+        }
+    }
+}
+
+static void
+compare_ctx_destroy(struct compare_ctx *ctx)
+{
+    thread_symbols_free(ctx->symbols, ctx->n);
+    g_free(ctx->unknown_functions);
+    g_free(ctx->incomplete);
+}
+
 static float
-normalize_and_compare(struct sr_thread *t1, struct sr_thread *t2,
+normalize_and_compare(struct compare_ctx *ctx, int i, int j,
                       enum sr_distance_type dist_type)
 {
-    float dist;
-
     /* XXX: GDB crashes have a special normalization step for
      * clustering. If there's something similar for other types, we can
-     * generalize it -- meanwhile there's a separate case for GDB here
+     * generalize it -- meanwhile there's a separate case for GDB here.
+     *
+     * The normalization only renames "??" functions present in both threads,
+     * other pairs are compared using the interned symbols directly.
      */
-    if (t1->type == SR_REPORT_GDB)
+    if ((ctx->incomplete[i] || ctx->incomplete[j]) &&
+        ctx->unknown_functions[i] && ctx->unknown_functions[j])
     {
-        struct sr_gdb_thread *copy1 = (struct sr_gdb_thread*)t1,
-                             *copy2 = (struct sr_gdb_thread*)t2;
-        int ok = 0, all = 0;
+        struct sr_gdb_thread *copy1, *copy2;
+        float dist;
 
-        sr_gdb_thread_quality_counts(copy1, &ok, &all);
-        sr_gdb_thread_quality_counts(copy2, &ok, &all);
+        copy1 = sr_gdb_thread_dup((struct sr_gdb_thread*)ctx->threads[i], false);
+        copy2 = sr_gdb_thread_dup((struct sr_gdb_thread*)ctx->threads[j], false);
+        sr_normalize_gdb_paired_unknown_function_names(copy1, copy2);
 
-        if (ok != all)
-        {
-            /* There are some unknown function names, try to pair them, but
-             * the threads need to be copied first. */
-            copy1 = sr_gdb_thread_dup(copy1, false);
-            copy2 = sr_gdb_thread_dup(copy2, false);
-            sr_normalize_gdb_paired_unknown_function_names(copy1, copy2);
-        }
+        dist = sr_distance_bounded(dist_type, (struct sr_thread*)copy1,
+                                   (struct sr_thread*)copy2,
+                                   ctx->max_distance);
 
-        dist = sr_distance(dist_type, (struct sr_thread*)copy1,
-                           (struct sr_thread*)copy2);
+        sr_gdb_thread_free(copy1);
+        sr_gdb_thread_free(copy2);
 
-        if (ok != all)
-        {
-            sr_gdb_thread_free(copy1);
-            sr_gdb_thread_free(copy2);
-        }
+        return dist;
     }
-    else
-        dist = sr_distance(dist_type, t1, t2);
 
-    return dist;
+    return distance_symbols(dist_type, &ctx->symbols[i], &ctx->symbols[j],
+                            ctx->max_distance);
 }
 
-struct sr_distances *
-sr_threads_compare(struct sr_thread **threads,
-                   int m,
-                   int n,
-                   enum sr_distance_type dist_type)
+static void
+check_thread_types(struct sr_thread **threads, int n)
 {
-    struct sr_distances *distances;
-    int i, j;
-
-    distances = sr_distances_new(m, n);
-
-    if (n <= 0)
-        return distances;
-
     /* Check that all threads are of the same type */
     enum sr_report_type type, prev_type = threads[0]->type;
-    for (i = 0; i < n; i++)
+    for (int i = 0; i < n; i++)
     {
         type = threads[i]->type;
         assert(prev_type == type);
         prev_type = type;
     }
+}
 
-    for (i = 0; i < m; i++)
+static void
+compare_row(struct compare_ctx *ctx, struct sr_distances *distances, int i,
+            enum sr_distance_type dist_type)
+{
+    for (int j = i + 1; j < distances->n; j++)
     {
-        for (j = i + 1; j < n; j++)
-        {
-
-            distances->distances[get_distance_position(distances, i, j)]
-                = normalize_and_compare(threads[i], threads[j], dist_type);
-        }
+        distances->distances[get_distance_position(distances, i, j)]
+            = normalize_and_compare(ctx, i, j, dist_type);
     }
-
-    return distances;
 }
 
-struct sr_distances_part *
-sr_distances_part_new(int m, int n, enum sr_distance_type dist_type,
-                      int m_begin, int n_begin, size_t len)
+/* Rows of the matrix that are yet to be computed by a worker. Other workers
+ * steal from the end of the range when they run out of their own rows. */
+struct compare_worker
 {
-    struct sr_distances_part *part = g_malloc0(sizeof(*part));
+    GMutex lock;
+    int begin;
+    int end;
+    struct compare_pool *pool;
+};
 
-    part->m = m;
-    part->n = n;
-    part->m_begin = m_begin;
-    part->n_begin = n_begin;
-    part->len = len;
-    part->dist_type = dist_type;
+struct compare_pool
+{
+    struct compare_ctx *ctx;
+    struct sr_distances *distances;
+    enum sr_distance_type dist_type;
+    struct compare_worker *workers;
+    unsigned nworkers;
+};
+
+/* Returns the row splitting [begin, end), end - begin >= 2, into two
+ * non-empty parts of about the same amount of work. Row i holds n - i - 1
+ * distances, so the rows at the end of the range are the cheap ones. */
+static int
+split_rows(int n, int begin, int end)
+{
+    int64_t total = 0, upper = 0;
 
-    return part;
+    for (int i = begin; i < end; i++)
+        total += n - i - 1;
+
+    int split = end;
+    while (split > begin + 1 && 2 * (upper + n - split) <= total)
+    {
+        --split;
+        upper += n - split - 1;
+    }
+
+    return split;
 }
 
-/*
- * int main(int argc, char *argv[])
- * {
- *     int m = atoi(argv[1]), n = atoi(argv[2]);
- * 
- *     printf("j\\i ");
- *     for (int i = 0; i < m; i++) printf("%3d", i);
- *     printf("\n");
- * 
- *     for (int j = 0; j < n; j++) {
- *         printf("%2d: ", j);
- *         for (int i = 0; i < m; i++) {
- *             if (i < j) printf("%3d", get_distance_position_mn(m, n, i, j));
- *             else printf("  .");
- *         }
- *         printf("\n");
- *     }
- * }
- *
- * $ ./a.out 3 8
- * m = 3, n = 8
- * j\i   0  1  2
- *  0:   .  .  .
- *  1:   0  .  .
- *  2:   1  8  .
- *  3:   2  9 15
- *  4:   3 10 16
- *  5:   4 11 17
- *  6:   5 12 18
- *  7:   6 13 19
- */
-struct sr_distances_part *
-sr_distances_part_create(int m, int n, enum sr_distance_type dist_type,
-                         unsigned nparts)
+static bool
+compare_worker_take_row(struct compare_worker *worker, int *row)
 {
-    struct sr_distances_part *res = NULL;
-    struct sr_distances_part **tail = &res;
+    struct compare_pool *pool = worker->pool;
+    bool found = false;
 
-    if (m >= n)
-        m = n - 1;
+    g_mutex_lock(&worker->lock);
+    if (worker->begin < worker->end)
+    {
+        *row = worker->begin++;
+        found = true;
+    }
+    g_mutex_unlock(&worker->lock);
 
-    assert(m > 0 && n > 1 && m < n);
+    if (found)
+        return true;
 
-    int triangle_twice = m * (m-1);
-    assert(triangle_twice % 2 == 0);
+    unsigned index = worker - pool->workers;
+    for (unsigned k = 1; k < pool->nworkers && !found; k++)
+    {
+        struct compare_worker *victim =
+            &pool->workers[(index + k) % pool->nworkers];
+        int begin = 0, end = 0;
 
-    int nelems = triangle_twice / 2 + (m*(n-m));
+        g_mutex_lock(&victim->lock);
+        if (victim->begin < victim->end)
+        {
+            end = victim->end;
+            if (end - victim->begin == 1)
+                begin = victim->begin;
+            else
+                begin = split_rows(pool->distances->n, victim->begin, end);
 
-    int nelems_per_part = nelems / nparts;
-    /* First $leftover parts will be (nelems_per_part+1) long */
-    int leftover = nelems % nparts;
-    if (leftover)
-        nelems_per_part++;
+            victim->end = begin;
+            found = true;
+        }
+        g_mutex_unlock(&victim->lock);
+
+        if (found)
+        {
+            g_mutex_lock(&worker->lock);
+            worker->begin = begin + 1;
+            worker->end = end;
+            g_mutex_unlock(&worker->lock);
+
+            *row = begin;
+        }
+    }
+
+    return found;
+}
+
+static gpointer
+compare_worker_run(gpointer data)
+{
+    struct compare_worker *worker = data;
+    struct compare_pool *pool = worker->pool;
+    int row;
+
+    while (compare_worker_take_row(worker, &row))
+        compare_row(pool->ctx, pool->distances, row, pool->dist_type);
+
+    return NULL;
+}
+
+/* Computes all rows of the distances using nthreads threads. */
+static void
+compare_matrix(struct compare_ctx *ctx, struct sr_distances *distances,
+               enum sr_distance_type dist_type, unsigned nthreads)
+{
+    if (nthreads <= 1)
+    {
+        for (int i = 0; i < distances->m; i++)
+            compare_row(ctx, distances, i, dist_type);
+
+        return;
+    }
+
+    int n = distances->n;
+
+    struct compare_pool pool;
+    pool.ctx = ctx;
+    pool.distances = distances;
+    pool.dist_type = dist_type;
+    pool.nworkers = MIN(nthreads, (unsigned)distances->m);
+    pool.workers = g_new(struct compare_worker, pool.nworkers);
+
+    /* Split the rows so that every worker starts with the same amount of
+     * work, stealing takes care of the rest. */
+    int begin = 0;
+    for (unsigned k = 0; k < pool.nworkers; k++)
+    {
+        struct compare_worker *worker = &pool.workers[k];
+        int end = begin;
+
+        if (k + 1 == pool.nworkers)
+            end = distances->m;
+        else
+        {
+            int64_t total = 0, part = 0;
+            for (int i = begin; i < distances->m; i++)
+                total += n - i - 1;
+
+            while (end < distances->m &&
+                   part * (pool.nworkers - k) < total)
+            {
+                part += n - end - 1;
+                ++end;
+            }
+        }
+
+        g_mutex_init(&worker->lock);
+        worker->begin = begin;
+        worker->end = end;
+        worker->pool = &pool;
+        begin = end;
+    }
+
+    /* The calling thread works as the first worker. */
+    GThread **workers = g_new(GThread *, pool.nworkers);
+    for (unsigned k = 1; k < pool.nworkers; k++)
+        workers[k] = g_thread_new("sr-compare", compare_worker_run,
+                                  &pool.workers[k]);
+
+    compare_worker_run(&pool.workers[0]);
+
+    for (unsigned k = 1; k < pool.nworkers; k++)
+        g_thread_join(workers[k]);
+
+    for (unsigned k = 0; k < pool.nworkers; k++)
+        g_mutex_clear(&pool.workers[k].lock);
+
+    g_free(workers);
+    g_free(pool.workers);
+}
+
+static guint
+symbols_hash(gconstpointer key)
+{
+    const struct thread_symbols *symbols = key;
+    guint hash = symbols->frame_count;
+
+    for (int i = 0; i < symbols->frame_count; i++)
+        hash = hash * 31 + symbols->ids[i];
+
+    return hash;
+}
+
+static gboolean
+symbols_equal(gconstpointer a, gconstpointer b)
+{
+    const struct thread_symbols *symbols1 = a, *symbols2 = b;
+
+    return symbols1->frame_count == symbols2->frame_count &&
+           0 == memcmp(symbols1->ids, symbols2->ids,
+                       symbols1->frame_count * sizeof(*symbols1->ids));
+}
+
+/* Threads with the same interned symbols are duplicates, the distances of
+ * a duplicate to the interned threads are the same as the distances of the
+ * first thread of its kind. When there are enough duplicates, the distances
+ * are computed only between the unique threads and then copied to the
+ * duplicates. Threads that could not be interned compare the frames by
+ * more than the symbols, their distances to duplicates are computed
+ * directly. Returns false if it would not save enough work and nothing was
+ * computed. */
+static bool
+compare_unique(struct compare_ctx *ctx, struct sr_distances *distances,
+               enum sr_distance_type dist_type, unsigned nthreads)
+{
+    int m = distances->m, n = distances->n;
+    /* Index of the unique thread for every thread. */
+    int *unique = g_new(int, n);
+    /* The first two threads of every kind, the second is -1 if the thread
+     * has no duplicates. */
+    int *first = g_new(int, n), *second = g_new(int, n);
+    int unique_count = 0, inexact_count = 0;
+
+    GHashTable *kinds = g_hash_table_new(symbols_hash, symbols_equal);
+
+    for (int i = 0; i < n; i++)
+    {
+        gpointer kind;
+
+        if (ctx->symbols[i].ids &&
+            g_hash_table_lookup_extended(kinds, &ctx->symbols[i], NULL, &kind))
+        {
+            unique[i] = GPOINTER_TO_INT(kind);
+            if (second[unique[i]] < 0)
+                second[unique[i]] = i;
+
+            continue;
+        }
+
+        if (ctx->symbols[i].ids)
+        {
+            g_hash_table_insert(kinds, &ctx->symbols[i],
+                                GINT_TO_POINTER(unique_count));
+        }
+
+        if (!ctx->symbols[i].ids)
+            ++inexact_count;
+
+        unique[i] = unique_count;
+        first[unique_count] = i;
+        second[unique_count] = -1;
+        ++unique_count;
+    }
+
+    g_hash_table_destroy(kinds);
+
+    /* Jaro-Winkler distance is not symmetric, both orders of the unique
+     * threads have to be compared then. */
+    bool symmetric = (dist_type != SR_DISTANCE_JARO_WINKLER);
+    int64_t unique_work = (int64_t)unique_count * (unique_count - 1) / 2;
+    int64_t work = (int64_t)m * (2 * n - m - 1) / 2;
+
+    if (!symmetric)
+        unique_work *= 2;
+
+    unique_work += (int64_t)inexact_count * (n - unique_count);
+
+    if (2 * unique_work > work)
+    {
+        g_free(unique);
+        g_free(first);
+        g_free(second);
+        return false;
+    }
+
+    /* Distances between the unique threads, in both orders if needed. */
+    struct sr_distances *forward = NULL, *backward = NULL;
+    if (unique_count > 1)
+    {
+        struct sr_thread **threads = g_new(struct sr_thread *, unique_count);
+        struct compare_ctx unique_ctx;
+
+        for (int k = 0; k < unique_count; k++)
+            threads[k] = ctx->threads[first[k]];
+
+        forward = sr_distances_new(unique_count - 1, unique_count);
+        compare_ctx_init(&unique_ctx, threads, unique_count);
+        unique_ctx.max_distance = ctx->max_distance;
+        compare_matrix(&unique_ctx, forward, dist_type, nthreads);
+        compare_ctx_destroy(&unique_ctx);
+
+        if (!symmetric)
+        {
+            for (int k = 0; k < unique_count; k++)
+                threads[k] = ctx->threads[first[unique_count - k - 1]];
+
+            backward = sr_distances_new(unique_count - 1, unique_count);
+            compare_ctx_init(&unique_ctx, threads, unique_count);
+            unique_ctx.max_distance = ctx->max_distance;
+            compare_matrix(&unique_ctx, backward, dist_type, nthreads);
+            compare_ctx_destroy(&unique_ctx);
+        }
+
+        g_free(threads);
+    }
+
+    /* Distances between the duplicates of the same thread. */
+    float *self = g_new(float, unique_count);
+    for (int k = 0; k < unique_count; k++)
+    {
+        if (second[k] >= 0)
+            self[k] = normalize_and_compare(ctx, first[k], second[k],
+                                            dist_type);
+    }
+
+    for (int i = 0; i < m; i++)
+    {
+        for (int j = i + 1; j < n; j++)
+        {
+            int a = unique[i], b = unique[j];
+            float dist;
+
+            if ((!ctx->symbols[i].ids || !ctx->symbols[j].ids) &&
+                (first[a] != i || first[b] != j))
+            {
+                dist = normalize_and_compare(ctx, i, j, dist_type);
+            }
+            else if (a == b)
+                dist = self[a];
+            else if (a < b)
+                dist = forward->distances[get_distance_position(forward, a, b)];
+            else if (symmetric)
+                dist = forward->distances[get_distance_position(forward, b, a)];
+            else
+            {
+                dist = backward->distances[get_distance_position(
+                    backward, unique_count - a - 1, unique_count - b - 1)];
+            }
+
+            distances->distances[get_distance_position(distances, i, j)] = dist;
+        }
+    }
+
+    sr_distances_free(forward);
+    sr_distances_free(backward);
+    g_free(self);
+    g_free(unique);
+    g_free(first);
+    g_free(second);
+
+    return true;
+}
+
+static struct sr_distances *
+compare_threads(struct sr_thread **threads, int m, int n,
+                enum sr_distance_type dist_type, float max_distance,
+                unsigned nthreads)
+{
+    struct sr_distances *distances;
+
+    distances = sr_distances_new(m, n);
+
+    if (n <= 0)
+        return distances;
+
+    check_thread_types(threads, n);
+
+    struct compare_ctx ctx;
+    compare_ctx_init(&ctx, threads, n);
+    ctx.max_distance = max_distance;
+
+    if (!compare_unique(&ctx, distances, dist_type, nthreads))
+        compare_matrix(&ctx, distances, dist_type, nthreads);
+
+    compare_ctx_destroy(&ctx);
+
+    return distances;
+}
+
+struct sr_distances *
+sr_threads_compare(struct sr_thread **threads,
+                   int m,
+                   int n,
+                   enum sr_distance_type dist_type)
+{
+    return compare_threads(threads, m, n, dist_type, DISTANCE_UNBOUNDED, 1);
+}
+
+struct sr_distances *
+sr_threads_compare_bounded(struct sr_thread **threads,
+                           int m,
+                           int n,
+                           enum sr_distance_type dist_type,
+                           float max_distance)
+{
+    return compare_threads(threads, m, n, dist_type, max_distance, 1);
+}
+
+struct sr_distances *
+sr_threads_compare_parallel(struct sr_thread **threads,
+                            int m,
+                            int n,
+                            enum sr_distance_type dist_type,
+                            unsigned nthreads)
+{
+    if (nthreads == 0)
+        nthreads = g_get_num_processors();
+
+    return compare_threads(threads, m, n, dist_type, DISTANCE_UNBOUNDED,
+                           nthreads);
+}
+
+struct sr_distances *
+sr_threads_compare_extend(struct sr_distances *distances,
+                          struct sr_thread **threads,
+                          int n,
+                          enum sr_distance_type dist_type)
+{
+    int old_m = distances->m, old_n = distances->n;
+
+    assert(n >= old_n);
+
+    /* A full matrix stays full, otherwise only the columns are added. */
+    int m = (old_m + 1 == old_n) ? n - 1 : old_m;
+    struct sr_distances *extended = sr_distances_new(m, n);
+
+    check_thread_types(threads, n);
+
+    struct compare_ctx ctx;
+    compare_ctx_init(&ctx, threads, n);
+
+    for (int i = 0; i < extended->m; i++)
+    {
+        for (int j = i + 1; j < n; j++)
+        {
+            float dist;
+
+            if (i < old_m && j < old_n)
+                dist = distances->distances[get_distance_position(distances, i, j)];
+            else
+                dist = normalize_and_compare(&ctx, i, j, dist_type);
+
+            extended->distances[get_distance_position(extended, i, j)] = dist;
+        }
+    }
+
+    compare_ctx_destroy(&ctx);
+
+    return extended;
+}
+
+struct sr_distances_part *
+sr_distances_part_new(int m, int n, enum sr_distance_type dist_type,
+                      int m_begin, int n_begin, size_t len)
+{
+    struct sr_distances_part *part = g_malloc0(sizeof(*part));
+
+    part->m = m;
+    part->n = n;
+    part->m_begin = m_begin;
+    part->n_begin = n_begin;
+    part->len = len;
+    part->dist_type = dist_type;
+
+    return part;
+}
+
+/*
+ * int main(int argc, char *argv[])
+ * {
+ *     int m = atoi(argv[1]), n = atoi(argv[2]);
+ * 
+ *     printf("j\\i ");
+ *     for (int i = 0; i < m; i++) printf("%3d", i);
+ *     printf("\n");
+ * 
+ *     for (int j = 0; j < n; j++) {
+ *         printf("%2d: ", j);
+ *         for (int i = 0; i < m; i++) {
+ *             if (i < j) printf("%3d", get_distance_position_mn(m, n, i, j));
+ *             else printf("  .");
+ *         }
+ *         printf("\n");
+ *     }
+ * }
+ *
+ * $ ./a.out 3 8
+ * m = 3, n = 8
+ * j\i   0  1  2
+ *  0:   .  .  .
+ *  1:   0  .  .
+ *  2:   1  8  .
+ *  3:   2  9 15
+ *  4:   3 10 16
+ *  5:   4 11 17
+ *  6:   5 12 18
+ *  7:   6 13 19
+ */
+struct sr_distances_part *
+sr_distances_part_create(int m, int n, enum sr_distance_type dist_type,
+                         unsigned nparts)
+{
+    struct sr_distances_part *res = NULL;
+    struct sr_distances_part **tail = &res;
+
+    if (m >= n)
+        m = n - 1;
+
+    assert(m > 0 && n > 1 && m < n);
+
+    size_t triangle_twice = (size_t)m * (m-1);
+    assert(triangle_twice % 2 == 0);
+
+    size_t nelems = triangle_twice / 2 + ((size_t)m*(n-m));
+
+    size_t nelems_per_part = nelems / nparts;
+    /* First $leftover parts will be (nelems_per_part+1) long */
+    int leftover = nelems % nparts;
+    if (leftover)
+        nelems_per_part++;
 
     /* There probably is a formula for this. This code just walks every element
      * of the matrix instead ... */
     int m_begin = 0;
     int n_begin = 1;
     /* How many items we've enountered that will go into the next part. */
-    int counter = 0;
+    size_t counter = 0;
     for (int i = 0; i < m; i++)
     {
         for (int j = i+1; j < n; j++)
@@ -603,25 +1410,46 @@ thread_list_checksum(struct sr_thread **threads, size_t n)
     return u.truncated;
 }
 
-void
-sr_distances_part_compute(struct sr_distances_part *part,
-                          struct sr_thread **threads)
+/* Finds the coordinates of the element of the part at the position. If it
+ * lies outside of the matrix, i is at least m. */
+static void
+part_position(struct sr_distances_part *part, size_t position, int *i, int *j)
 {
-    assert(part);
+    *i = part->m_begin;
+    *j = part->n_begin;
 
-    int i,j;
-    size_t dist_idx;
-    part->distances = g_malloc_n(sizeof(float), part->len);
+    while (position > 0 && *i < part->m)
+    {
+        size_t row_rest = part->n - *j;
 
-    for (dist_idx = 0, i = part->m_begin, j = part->n_begin;
-         dist_idx < part->len;
-         dist_idx++)
+        if (position < row_rest)
+        {
+            *j += position;
+            return;
+        }
+
+        position -= row_rest;
+        ++*i;
+        *j = *i + 1;
+    }
+}
+
+/* Computes the distances of the part up to the position end. */
+static void
+part_compute_until(struct sr_distances_part *part, struct compare_ctx *ctx,
+                   size_t end)
+{
+    int i, j;
+
+    part_position(part, part->done, &i, &j);
+
+    for (; part->done < end; part->done++)
     {
         assert(j > i);
         assert(i < part->m && j < part->n);
 
-        part->distances[dist_idx]
-            = normalize_and_compare(threads[i], threads[j], part->dist_type);
+        part->distances[part->done]
+            = normalize_and_compare(ctx, i, j, part->dist_type);
 
         j++;
         if (j >= part->n)
@@ -630,6 +1458,26 @@ sr_distances_part_compute(struct sr_distances_part *part,
             j = i+1;
         }
     }
+}
+
+void
+sr_distances_part_compute(struct sr_distances_part *part,
+                          struct sr_thread **threads)
+{
+    assert(part);
+
+    if (!part->distances)
+    {
+        part->distances = g_malloc_n(sizeof(float), part->len);
+        part->done = 0;
+    }
+
+    struct compare_ctx ctx;
+    compare_ctx_init(&ctx, threads, part->n);
+
+    part_compute_until(part, &ctx, part->len);
+
+    compare_ctx_destroy(&ctx);
 
     part->checksum = thread_list_checksum(threads, part->n);
 }
@@ -648,6 +1496,7 @@ sr_distances_part_merge(struct sr_distances_part *parts)
     {
         if (it->m != parts->m || it->n != parts->n
             || it->distances == NULL
+            || it->done != it->len
             || it->checksum != parts->checksum)
         {
             goto error;
@@ -698,3 +1547,793 @@ sr_distances_part_free(struct sr_distances_part *part, bool follow_links)
     if (follow_links)
         sr_distances_part_free(next, true);
 }
+
+/* Header of a distances file, the encoded distances follow it. */
+struct distances_file_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t encoding;
+    uint32_t dist_type;
+    int32_t m;
+    int32_t n;
+    /* Checksum of the encoded distances, valid if complete. */
+    uint32_t checksum;
+    /* Number of the encoded distances. */
+    uint64_t count;
+    uint32_t complete;
+    /* Checksum of the threads the written parts were computed from, valid
+     * if threads_checksum_set. Older files have both zeroed. */
+    uint32_t threads_checksum;
+    uint32_t threads_checksum_set;
+    char reserved[12];
+};
+
+#define DISTANCES_FILE_MAGIC "SRDISTS"
+#define DISTANCES_FILE_VERSION 1
+
+static size_t
+distances_encoding_size(enum sr_distances_encoding encoding)
+{
+    switch (encoding)
+    {
+    case SR_DISTANCES_FLOAT32:
+        return sizeof(float);
+    case SR_DISTANCES_FLOAT16:
+        return sizeof(uint16_t);
+    case SR_DISTANCES_UINT8:
+        return sizeof(uint8_t);
+    default:
+        return 0;
+    }
+}
+
+/* Converts to IEEE 754 half precision, rounding to nearest even. */
+static uint16_t
+float_to_half(float value)
+{
+    union { float f; uint32_t u; } bits = { value };
+    uint32_t sign = (bits.u >> 16) & 0x8000;
+    uint32_t exponent = (bits.u >> 23) & 0xff;
+    uint32_t mantissa = bits.u & 0x7fffff;
+
+    /* Infinity and NaN. */
+    if (exponent == 0xff)
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+    int half_exponent = (int)exponent - 127 + 15;
+
+    /* Overflow to infinity. */
+    if (half_exponent >= 0x1f)
+        return sign | 0x7c00;
+
+    /* Subnormal or zero. */
+    if (half_exponent <= 0)
+    {
+        if (half_exponent < -10)
+            return sign;
+
+        mantissa |= 0x800000;
+        int shift = 14 - half_exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            ++half;
+
+        return sign | half;
+    }
+
+    uint32_t half = (half_exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+
+    /* A carry into the exponent is the correct result too. */
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+
+    return sign | half;
+}
+
+static float
+half_to_float(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    union { uint32_t u; float f; } bits;
+
+    if (exponent == 0x1f)
+        bits.u = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits.u = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    else if (mantissa == 0)
+        bits.u = sign;
+    else
+    {
+        /* Normalize the subnormal number. */
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+
+        bits.u = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    return bits.f;
+}
+
+static void
+distances_encode(enum sr_distances_encoding encoding, void *data,
+                 size_t position, float value)
+{
+    switch (encoding)
+    {
+    case SR_DISTANCES_FLOAT32:
+        ((float *)data)[position] = value;
+        break;
+    case SR_DISTANCES_FLOAT16:
+        ((uint16_t *)data)[position] = float_to_half(value);
+        break;
+    case SR_DISTANCES_UINT8:
+        if (!(value > 0.0f))
+            value = 0.0f;
+        else if (value > 1.0f)
+            value = 1.0f;
+
+        ((uint8_t *)data)[position] = (uint8_t)(value * 255.0f + 0.5f);
+        break;
+    }
+}
+
+static float
+distances_decode(enum sr_distances_encoding encoding, const void *data,
+                 size_t position)
+{
+    switch (encoding)
+    {
+    case SR_DISTANCES_FLOAT32:
+        return ((const float *)data)[position];
+    case SR_DISTANCES_FLOAT16:
+        return half_to_float(((const uint16_t *)data)[position]);
+    case SR_DISTANCES_UINT8:
+        return ((const uint8_t *)data)[position] / 255.0f;
+    default:
+        return 0.0f;
+    }
+}
+
+static uint32_t
+distances_file_checksum(const void *data, size_t size)
+{
+    g_autoptr(GChecksum) checksum = g_checksum_new(G_CHECKSUM_SHA1);
+    union
+    {
+        unsigned char hashbuf[SHA1_DIGEST_LEN];
+        uint32_t truncated;
+    } u;
+
+    /* GChecksum takes the length as gssize. */
+    const unsigned char *bytes = data;
+    while (size > 0)
+    {
+        size_t chunk = MIN(size, (size_t)1 << 30);
+        g_checksum_update(checksum, bytes, chunk);
+        bytes += chunk;
+        size -= chunk;
+    }
+
+    gsize digest_len = SHA1_DIGEST_LEN;
+    g_checksum_get_digest(checksum, u.hashbuf, &digest_len);
+    assert(digest_len == SHA1_DIGEST_LEN);
+
+    return u.truncated;
+}
+
+/* A mapped distances file. */
+struct distances_file
+{
+    void *mapping;
+    size_t size;
+    struct distances_file_header *header;
+    void *data;
+};
+
+/* Maps the file and checks that its header is consistent with its size. */
+static bool
+distances_file_map(struct distances_file *file, const char *path,
+                   bool writable, char **error_message)
+{
+    int fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_LARGEFILE);
+    if (fd < 0)
+    {
+        *error_message = g_strdup_printf("Unable to open '%s': %s.",
+                                         path, strerror(errno));
+        return false;
+    }
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size == (off_t)-1)
+    {
+        *error_message = g_strdup_printf("Unable to seek in '%s': %s.",
+                                         path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    if (size < (off_t)sizeof(struct distances_file_header))
+    {
+        *error_message = g_strdup_printf("File '%s' is too short.", path);
+        close(fd);
+        return false;
+    }
+
+    /* Readers get a private copy-on-write mapping, so that the distances
+     * can be modified in memory without touching the file. */
+    file->size = size;
+    file->mapping = mmap(NULL, file->size, PROT_READ | PROT_WRITE,
+                         writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (file->mapping == MAP_FAILED)
+    {
+        *error_message = g_strdup_printf("Unable to map '%s': %s.",
+                                         path, strerror(errno));
+        return false;
+    }
+
+    file->header = file->mapping;
+    file->data = (char *)file->mapping + sizeof(struct distances_file_header);
+
+    struct distances_file_header *header = file->header;
+    size_t element_size = distances_encoding_size(header->encoding);
+
+    if (0 != memcmp(header->magic, DISTANCES_FILE_MAGIC,
+                    sizeof(DISTANCES_FILE_MAGIC))
+        || header->version != DISTANCES_FILE_VERSION
+        || element_size == 0
+        || header->m <= 0 || header->n <= header->m
+        || header->count != get_distance_position_mn(header->m, header->n,
+                                                     header->m - 1,
+                                                     header->n - 1) + 1
+        || header->count * element_size !=
+           file->size - sizeof(struct distances_file_header))
+    {
+        *error_message = g_strdup_printf("File '%s' is not a valid distances "
+                                         "file.", path);
+        munmap(file->mapping, file->size);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+sr_distances_file_create(const char *path,
+                         int m,
+                         int n,
+                         enum sr_distance_type dist_type,
+                         enum sr_distances_encoding encoding,
+                         char **error_message)
+{
+    if (m >= n)
+        m = n - 1;
+
+    assert(m > 0 && n > 1 && m < n);
+
+    struct distances_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISTANCES_FILE_MAGIC, sizeof(DISTANCES_FILE_MAGIC));
+    header.version = DISTANCES_FILE_VERSION;
+    header.encoding = encoding;
+    header.dist_type = dist_type;
+    header.m = m;
+    header.n = n;
+    header.count = get_distance_position_mn(m, n, m - 1, n - 1) + 1;
+
+    int fd = open(path, O_WRONLY | O_LARGEFILE | O_TRUNC | O_CREAT, 0640);
+    if (fd < 0)
+    {
+        *error_message = g_strdup_printf("Unable to open '%s': %s.",
+                                         path, strerror(errno));
+        return false;
+    }
+
+    /* The distances are zero until the parts are written. */
+    off_t size = sizeof(header) +
+                 header.count * distances_encoding_size(encoding);
+
+    if (sizeof(header) != write(fd, &header, sizeof(header))
+        || 0 != ftruncate(fd, size))
+    {
+        *error_message = g_strdup_printf("Unable to write to '%s': %s.",
+                                         path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    if (0 != close(fd))
+    {
+        *error_message = g_strdup_printf("Unable to close '%s': %s.",
+                                         path, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool
+sr_distances_file_write_part(const char *path,
+                             struct sr_distances_part *part,
+                             char **error_message)
+{
+    struct distances_file file;
+
+    if (!part->distances || part->done != part->len)
+    {
+        *error_message = g_strdup("The part has not been computed.");
+        return false;
+    }
+
+    if (!distances_file_map(&file, path, true, error_message))
+        return false;
+
+    if (file.header->m != part->m || file.header->n != part->n
+        || file.header->dist_type != part->dist_type
+        || (file.header->threads_checksum_set
+            && file.header->threads_checksum != part->checksum))
+    {
+        *error_message = g_strdup_printf("The part does not belong to "
+                                         "the distances in '%s'.", path);
+        munmap(file.mapping, file.size);
+        return false;
+    }
+
+    size_t dist_idx;
+    int i, j;
+
+    for (dist_idx = 0, i = part->m_begin, j = part->n_begin;
+         dist_idx < part->len;
+         dist_idx++)
+    {
+        distances_encode(file.header->encoding, file.data,
+                         get_distance_position_mn(part->m, part->n, i, j),
+                         part->distances[dist_idx]);
+
+        j++;
+        if (j >= part->n)
+        {
+            i++;
+            j = i+1;
+        }
+    }
+
+    /* Writing a part invalidates the checksum. */
+    file.header->complete = 0;
+    file.header->threads_checksum = part->checksum;
+    file.header->threads_checksum_set = 1;
+
+    munmap(file.mapping, file.size);
+    return true;
+}
+
+bool
+sr_distances_file_finish(const char *path,
+                         char **error_message)
+{
+    struct distances_file file;
+
+    if (!distances_file_map(&file, path, true, error_message))
+        return false;
+
+    file.header->checksum = distances_file_checksum(
+        file.data, file.size - sizeof(struct distances_file_header));
+    file.header->complete = 1;
+
+    if (0 != msync(file.mapping, file.size, MS_SYNC))
+    {
+        *error_message = g_strdup_printf("Unable to write to '%s': %s.",
+                                         path, strerror(errno));
+        munmap(file.mapping, file.size);
+        return false;
+    }
+
+    munmap(file.mapping, file.size);
+    return true;
+}
+
+bool
+sr_distances_save(struct sr_distances *distances,
+                  const char *path,
+                  enum sr_distance_type dist_type,
+                  enum sr_distances_encoding encoding,
+                  char **error_message)
+{
+    struct distances_file file;
+
+    if (!sr_distances_file_create(path, distances->m, distances->n,
+                                  dist_type, encoding, error_message)
+        || !distances_file_map(&file, path, true, error_message))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < distances->m; i++)
+    {
+        for (int j = i + 1; j < distances->n; j++)
+        {
+            size_t position = get_distance_position(distances, i, j);
+            distances_encode(encoding, file.data, position,
+                             distances->distances[position]);
+        }
+    }
+
+    munmap(file.mapping, file.size);
+
+    return sr_distances_file_finish(path, error_message);
+}
+
+struct sr_distances *
+sr_distances_load(const char *path,
+                  enum sr_distance_type *dist_type,
+                  char **error_message)
+{
+    struct distances_file file;
+
+    if (!distances_file_map(&file, path, false, error_message))
+        return NULL;
+
+    struct distances_file_header *header = file.header;
+
+    if (!header->complete
+        || header->checksum != distances_file_checksum(
+               file.data, file.size - sizeof(struct distances_file_header)))
+    {
+        *error_message = g_strdup_printf("File '%s' is incomplete or "
+                                         "corrupted.", path);
+        munmap(file.mapping, file.size);
+        return NULL;
+    }
+
+    if (dist_type)
+        *dist_type = header->dist_type;
+
+    struct sr_distances *distances;
+
+    if (header->encoding == SR_DISTANCES_FLOAT32)
+    {
+        distances = g_malloc(sizeof(*distances));
+        distances->m = header->m;
+        distances->n = header->n;
+        distances->distances = file.data;
+        distances->mapping = file.mapping;
+        distances->mapping_size = file.size;
+
+        return distances;
+    }
+
+    distances = sr_distances_new(header->m, header->n);
+
+    for (int i = 0; i < distances->m; i++)
+    {
+        for (int j = i + 1; j < distances->n; j++)
+        {
+            size_t position = get_distance_position(distances, i, j);
+            distances->distances[position] =
+                distances_decode(header->encoding, file.data, position);
+        }
+    }
+
+    munmap(file.mapping, file.size);
+
+    return distances;
+}
+
+/* Header of a distances part file, the distances computed so far follow
+ * it and the file is long enough for all distances of the part. */
+struct distances_part_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t dist_type;
+    int32_t m;
+    int32_t n;
+    int32_t m_begin;
+    int32_t n_begin;
+    uint32_t checksum;
+    uint32_t reserved1;
+    uint64_t len;
+    /* Number of the valid distances. */
+    uint64_t done;
+    char reserved2[8];
+};
+
+#define DISTANCES_PART_MAGIC "SRDPART"
+#define DISTANCES_PART_VERSION 1
+
+static void
+distances_part_header_init(struct distances_part_header *header,
+                           struct sr_distances_part *part)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, DISTANCES_PART_MAGIC, sizeof(DISTANCES_PART_MAGIC));
+    header->version = DISTANCES_PART_VERSION;
+    header->dist_type = part->dist_type;
+    header->m = part->m;
+    header->n = part->n;
+    header->m_begin = part->m_begin;
+    header->n_begin = part->n_begin;
+    header->checksum = part->checksum;
+    header->len = part->len;
+    header->done = part->done;
+}
+
+static bool
+write_all(int fd, const void *data, size_t size, off_t offset)
+{
+    const char *bytes = data;
+
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, bytes, size, offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+
+    return true;
+}
+
+static bool
+read_all(int fd, void *data, size_t size, off_t offset)
+{
+    char *bytes = data;
+
+    while (size > 0)
+    {
+        ssize_t got = pread(fd, bytes, size, offset);
+        if (got < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        /* Unexpected end of the file. */
+        if (got == 0)
+        {
+            errno = EIO;
+            return false;
+        }
+
+        bytes += got;
+        size -= got;
+        offset += got;
+    }
+
+    return true;
+}
+
+bool
+sr_distances_part_save(struct sr_distances_part *part,
+                       const char *path,
+                       char **error_message)
+{
+    struct distances_part_header header;
+    size_t done = part->distances ? part->done : 0;
+
+    distances_part_header_init(&header, part);
+    header.done = done;
+
+    /* The file is replaced only when it is written completely, so that
+     * a crash does not destroy the progress saved before. */
+    char *tmp_path = g_strdup_printf("%s.tmp", path);
+    int fd = open(tmp_path, O_WRONLY | O_LARGEFILE | O_TRUNC | O_CREAT, 0640);
+    if (fd < 0)
+    {
+        *error_message = g_strdup_printf("Unable to open '%s': %s.",
+                                         tmp_path, strerror(errno));
+        g_free(tmp_path);
+        return false;
+    }
+
+    off_t size = sizeof(header) + part->len * sizeof(float);
+
+    if (!write_all(fd, &header, sizeof(header), 0)
+        || !write_all(fd, part->distances, done * sizeof(float),
+                      sizeof(header))
+        || 0 != ftruncate(fd, size)
+        || 0 != fsync(fd))
+    {
+        *error_message = g_strdup_printf("Unable to write to '%s': %s.",
+                                         tmp_path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        g_free(tmp_path);
+        return false;
+    }
+
+    if (0 != close(fd) || 0 != rename(tmp_path, path))
+    {
+        *error_message = g_strdup_printf("Unable to write to '%s': %s.",
+                                         path, strerror(errno));
+        unlink(tmp_path);
+        g_free(tmp_path);
+        return false;
+    }
+
+    g_free(tmp_path);
+    return true;
+}
+
+struct sr_distances_part *
+sr_distances_part_load(const char *path,
+                       char **error_message)
+{
+    struct distances_part_header header;
+
+    int fd = open(path, O_RDONLY | O_LARGEFILE);
+    if (fd < 0)
+    {
+        *error_message = g_strdup_printf("Unable to open '%s': %s.",
+                                         path, strerror(errno));
+        return NULL;
+    }
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size == (off_t)-1)
+    {
+        *error_message = g_strdup_printf("Unable to seek in '%s': %s.",
+                                         path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    if (size < (off_t)sizeof(header)
+        || !read_all(fd, &header, sizeof(header), 0)
+        || 0 != memcmp(header.magic, DISTANCES_PART_MAGIC,
+                       sizeof(DISTANCES_PART_MAGIC))
+        || header.version != DISTANCES_PART_VERSION
+        || header.m <= 0 || header.n <= header.m
+        || header.m_begin < 0 || header.m_begin >= header.m
+        || header.n_begin <= header.m_begin || header.n_begin >= header.n
+        || header.len == 0 || header.done > header.len
+        || (uint64_t)(size - sizeof(header)) / sizeof(float) != header.len)
+    {
+        *error_message = g_strdup_printf("File '%s' is not a valid distances "
+                                         "part file.", path);
+        close(fd);
+        return NULL;
+    }
+
+    struct sr_distances_part *part =
+        sr_distances_part_new(header.m, header.n, header.dist_type,
+                              header.m_begin, header.n_begin, header.len);
+    part->checksum = header.checksum;
+
+    /* The part must not reach beyond the matrix. */
+    int i, j;
+    part_position(part, part->len - 1, &i, &j);
+    if (i >= part->m)
+    {
+        *error_message = g_strdup_printf("File '%s' is not a valid distances "
+                                         "part file.", path);
+        sr_distances_part_free(part, false);
+        close(fd);
+        return NULL;
+    }
+
+    part->distances = g_malloc_n(sizeof(float), part->len);
+    part->done = header.done;
+
+    if (!read_all(fd, part->distances, part->done * sizeof(float),
+                  sizeof(header)))
+    {
+        *error_message = g_strdup_printf("Unable to read from '%s': %s.",
+                                         path, strerror(errno));
+        sr_distances_part_free(part, false);
+        close(fd);
+        return NULL;
+    }
+
+    close(fd);
+    return part;
+}
+
+/* Writes the distances computed since the position begin to the part file
+ * and then updates the progress in its header. */
+static bool
+distances_part_checkpoint(int fd, struct sr_distances_part *part,
+                          size_t begin)
+{
+    struct distances_part_header header;
+
+    distances_part_header_init(&header, part);
+
+    return write_all(fd, part->distances + begin,
+                     (part->done - begin) * sizeof(float),
+                     sizeof(header) + begin * sizeof(float))
+        && 0 == fdatasync(fd)
+        && write_all(fd, &header, sizeof(header), 0)
+        && 0 == fdatasync(fd);
+}
+
+bool
+sr_distances_part_compute_checkpointed(struct sr_distances_part *part,
+                                       struct sr_thread **threads,
+                                       const char *path,
+                                       size_t interval,
+                                       char **error_message)
+{
+    assert(part && interval > 0);
+
+    uint32_t checksum = thread_list_checksum(threads, part->n);
+
+    if (!part->distances)
+    {
+        part->distances = g_malloc_n(sizeof(float), part->len);
+        part->done = 0;
+    }
+    else if (part->done > 0 && part->checksum != checksum)
+    {
+        *error_message = g_strdup("The threads differ from the threads "
+                                  "the part was computed from.");
+        return false;
+    }
+
+    part->checksum = checksum;
+
+    if (!sr_distances_part_save(part, path, error_message))
+        return false;
+
+    int fd = open(path, O_WRONLY | O_LARGEFILE);
+    if (fd < 0)
+    {
+        *error_message = g_strdup_printf("Unable to open '%s': %s.",
+                                         path, strerror(errno));
+        return false;
+    }
+
+    struct compare_ctx ctx;
+    compare_ctx_init(&ctx, threads, part->n);
+
+    bool success = true;
+    while (part->done < part->len)
+    {
+        size_t begin = part->done;
+        size_t end = part->len - begin > interval ? begin + interval
+                                                  : part->len;
+
+        part_compute_until(part, &ctx, end);
+
+        if (!distances_part_checkpoint(fd, part, begin))
+        {
+            *error_message = g_strdup_printf("Unable to write to '%s': %s.",
+                                             path, strerror(errno));
+            success = false;
+            break;
+        }
+    }
+
+    compare_ctx_destroy(&ctx);
+
+    if (0 != close(fd) && success)
+    {
+        *error_message = g_strdup_printf("Unable to close '%s': %s.",
+                                         path, strerror(errno));
+        success = false;
+    }
+
+    return success;
+}
@@ -32,6 +32,7 @@
 #include <fcntl.h>
 #include <gelf.h>
 #include <libelf.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <inttypes.h>
@@ -115,7 +116,7 @@ find_elf_section_by_name(Elf *elf,
 }
 #endif /* WITH_ELFUTILS */
 
-struct sr_elf_plt_entry *
+struct sr_elf_plt *
 sr_elf_get_procedure_linkage_table(const char *filename,
                                    char **error_message)
 {
@@ -271,7 +272,10 @@ sr_elf_get_procedure_linkage_table(const char *filename,
      *   3463e01036:   68 01 00 00 00          pushq  $0x1
      *   3463e0103b:   e9 d0 ff ff ff          jmpq   3463e01010 <_init+0x18>
      */
-    struct sr_elf_plt_entry *result = NULL, *last = NULL;
+    GArray *entries = g_array_new(FALSE, FALSE, sizeof(struct sr_elf_plt_entry));
+    GString *names = g_string_new(NULL);
+    /* Offsets of the names, the arena moves as it grows. */
+    GArray *name_offsets = g_array_new(FALSE, FALSE, sizeof(gsize));
     for (unsigned plt_offset = 16; plt_offset < plt_data->d_size; plt_offset += 16)
     {
         uint32_t *plt_index = (uint32_t*)(plt_data->d_buf + plt_offset + 7);
@@ -283,7 +287,9 @@ sr_elf_get_procedure_linkage_table(const char *filename,
                                          filename,
                                          elf_errmsg(-1));
 
-            sr_elf_procedure_linkage_table_free(result);
+            g_array_free(entries, TRUE);
+            g_array_free(name_offsets, TRUE);
+            g_string_free(names, TRUE);
             elf_end(elf);
             close(fd);
             return NULL;
@@ -296,28 +302,43 @@ sr_elf_get_procedure_linkage_table(const char *filename,
                                          filename,
                                          elf_errmsg(-1));
 
-            sr_elf_procedure_linkage_table_free(result);
+            g_array_free(entries, TRUE);
+            g_array_free(name_offsets, TRUE);
+            g_string_free(names, TRUE);
             elf_end(elf);
             close(fd);
             return NULL;
         }
 
-        struct sr_elf_plt_entry *entry = g_malloc(sizeof(*entry));
-        entry->symbol_name = g_strdup(elf_strptr(elf, stringtable,
-                                                  symb.st_name));
-
-        entry->address = (uint64_t)(plt_base + plt_offset);
-        entry->next = NULL;
+        const char *symbol_name = elf_strptr(elf, stringtable, symb.st_name);
+        if (!symbol_name)
+            symbol_name = "";
 
-        if (result)
+        struct sr_elf_plt_entry entry =
         {
-            last->next = entry;
-            last = entry;
-        }
-        else
-            result = last = entry;
+            .address = (uint64_t)(plt_base + plt_offset),
+        };
+
+        g_array_append_val(entries, entry);
+        g_array_append_val(name_offsets, names->len);
+        g_string_append_len(names, symbol_name, strlen(symbol_name) + 1);
+    }
+
+    /* The slots are read by increasing address, so the entries are
+     * sorted. */
+    struct sr_elf_plt *result = g_malloc0(sizeof(*result));
+    result->count = entries->len;
+    result->entries = (struct sr_elf_plt_entry *)g_array_free(entries, FALSE);
+    result->names = g_string_free(names, FALSE);
+
+    for (size_t i = 0; i < result->count; i++)
+    {
+        result->entries[i].symbol_name =
+            result->names + g_array_index(name_offsets, gsize, i);
     }
 
+    g_array_free(name_offsets, TRUE);
+
     elf_end(elf);
     close(fd);
     return result;
@@ -328,32 +349,36 @@ sr_elf_get_procedure_linkage_table(const char *filename,
 }
 
 void
-sr_elf_procedure_linkage_table_free(struct sr_elf_plt_entry *entries)
+sr_elf_procedure_linkage_table_free(struct sr_elf_plt *plt)
 {
-    while (entries)
-    {
-        struct sr_elf_plt_entry *entry = entries;
-        entries = entry->next;
-        g_free(entry->symbol_name);
-        g_free(entry);
-    }
+    if (!plt)
+        return;
+
+    g_free(plt->entries);
+    g_free(plt->names);
+    g_free(plt);
 }
 
 struct sr_elf_plt_entry *
-sr_elf_plt_find_for_address(struct sr_elf_plt_entry *plt,
+sr_elf_plt_find_for_address(struct sr_elf_plt *plt,
                             uint64_t address)
 {
-    struct sr_elf_plt_entry *entry = plt;
-    while (entry)
+    size_t low = 0, high = plt->count;
+
+    while (low < high)
     {
-        if (entry->address == address)
-            return entry;
+        size_t middle = low + (high - low) / 2;
 
-        entry = entry->next;
+        if (plt->entries[middle].address < address)
+            low = middle + 1;
+        else
+            high = middle;
     }
 
-    return NULL;
+    if (low < plt->count && plt->entries[low].address == address)
+        return &plt->entries[low];
 
+    return NULL;
 }
 
 
@@ -384,21 +409,8 @@ struct cie
     Dwarf_Off cie_offset;
     int ptr_len;
     bool pcrel;
-
-    struct cie *next;
 };
 
-static void
-cie_free(struct cie *entries)
-{
-    while (entries)
-    {
-        struct cie *entry = entries;
-        entries = entry->next;
-        g_free(entry);
-    }
-}
-
 
 static struct cie *
 read_cie(Dwarf_CFI_Entry *cfi,
@@ -494,9 +506,283 @@ fde_read_address(const uint8_t *p, unsigned len)
 
     return (len == 4 ? (uint64_t)u.n4 : u.n8);
 }
+
+/* State of the reading of the .eh_frame section. */
+struct eh_frame_reader
+{
+    const char *filename;
+    unsigned char *e_ident;
+    Elf_Data *data;
+    GElf_Shdr *shdr;
+    uint64_t exec_base;
+    /* CIE offset -> struct cie, read when the first FDE refers to it. */
+    GHashTable *cies;
+    /* The read struct sr_elf_fde entries. */
+    GArray *fdes;
+};
+
+static struct cie *
+find_cie(struct eh_frame_reader *reader,
+         Dwarf_Off cie_offset,
+         char **error_message)
+{
+    struct cie *cie = g_hash_table_lookup(reader->cies, &cie_offset);
+    if (cie)
+        return cie;
+
+    Dwarf_CFI_Entry cfi;
+    Dwarf_Off cfi_offset_next;
+    if (0 != dwarf_next_cfi(reader->e_ident,
+                            reader->data,
+                            1,
+                            cie_offset,
+                            &cfi_offset_next,
+                            &cfi) ||
+        !dwarf_cfi_cie_p(&cfi))
+    {
+        *error_message = g_strdup_printf("CIE not found at %jx in %s",
+                                         (uintmax_t)cie_offset,
+                                         reader->filename);
+        return NULL;
+    }
+
+    char *cie_error_message;
+    cie = read_cie(&cfi, cie_offset, reader->e_ident, &cie_error_message);
+    if (!cie)
+    {
+        *error_message = g_strdup_printf("CIE reading failed for %s: %s",
+                                         reader->filename,
+                                         cie_error_message);
+
+        g_free(cie_error_message);
+        return NULL;
+    }
+
+    g_hash_table_insert(reader->cies, &cie->cie_offset, cie);
+    return cie;
+}
+
+/* Reads the FDE at the offset of .eh_frame and appends it to the read
+ * FDEs. */
+static bool
+read_fde(struct eh_frame_reader *reader,
+         Dwarf_CFI_Entry *cfi,
+         Dwarf_Off cfi_offset,
+         char **error_message)
+{
+    /* In .eh_frame, CIE_pointer is relative, but libdw converts it
+     * to absolute offset. */
+    struct cie *cie = find_cie(reader, cfi->fde.CIE_pointer, error_message);
+    if (!cie)
+        return false;
+
+    /* Read the two numbers we need and if they are PC-relative,
+     * compute the offset from VMA base
+     */
+
+    uint64_t initial_location = fde_read_address(cfi->fde.start,
+                                                 cie->ptr_len);
+
+    uint64_t address_range = fde_read_address(cfi->fde.start + cie->ptr_len,
+                                              cie->ptr_len);
+
+    if (cie->pcrel)
+    {
+        /* We need to determine how long is the 'length' (and
+         * consequently CIE id) field of this FDE -- it can be
+         * either 4 or 12 bytes long. */
+        uint64_t length = fde_read_address(reader->data->d_buf + cfi_offset, 4);
+        uint64_t skip = (length == 0xffffffffUL ? 12 : 4);
+        uint64_t mask = (cie->ptr_len == 4 ? 0xffffffffUL : 0xffffffffffffffffUL);
+        initial_location += reader->shdr->sh_offset + cfi_offset + 2 * skip;
+        initial_location &= mask;
+    }
+    else
+    {
+        /* Assuming that not pcrel means absolute address
+         * (what if the file is a library?).  Convert to
+         * text-section-start-relative.
+         */
+        initial_location -= reader->exec_base;
+    }
+
+    struct sr_elf_fde fde =
+    {
+        .exec_base = reader->exec_base,
+        .start_address = initial_location,
+        .length = address_range,
+    };
+
+    g_array_append_val(reader->fdes, fde);
+    return true;
+}
+
+/* Reads all FDEs of .eh_frame in the order they are stored.
+ *
+ * Some info on .eh_frame can be found at
+ * http://www.airs.com/blog/archives/460 and in DWARF
+ * documentation for .debug_frame. The initial_location and
+ * address_range decoding is 'inspired' by elfutils source.
+ */
+static bool
+read_eh_frame(struct eh_frame_reader *reader,
+              char **error_message)
+{
+    Dwarf_Off cfi_offset_next = 0;
+    while (true)
+    {
+        Dwarf_CFI_Entry cfi;
+        Dwarf_Off cfi_offset = cfi_offset_next;
+        int ret = dwarf_next_cfi(reader->e_ident,
+                                 reader->data,
+                                 1,
+                                 cfi_offset,
+                                 &cfi_offset_next,
+                                 &cfi);
+
+        if (ret > 0)
+        {
+            /* We're at the end. */
+            return true;
+        }
+
+        if (ret < 0)
+        {
+            /* Error. If cfi_offset_next was updated, we may skip the
+             * erroneous cfi. */
+            if (cfi_offset_next > cfi_offset)
+                continue;
+
+            *error_message = g_strdup_printf("dwarf_next_cfi failed for %s: %s",
+                                             reader->filename,
+                                             dwarf_errmsg(-1));
+            return false;
+        }
+
+        /* CIEs are read when an FDE refers to them. */
+        if (dwarf_cfi_cie_p(&cfi))
+            continue;
+
+        if (!read_fde(reader, &cfi, cfi_offset, error_message))
+            return false;
+    }
+}
+
+/* Reads the FDEs listed in the binary search table of .eh_frame_hdr,
+ * see http://www.airs.com/blog/archives/462. Only the table encoding
+ * produced by the linkers is supported. Returns false without setting
+ * the error message if the table cannot be used.
+ */
+static bool
+read_eh_frame_hdr(struct eh_frame_reader *reader,
+                  Elf_Data *hdr_data,
+                  GElf_Shdr *hdr_shdr,
+                  char **error_message)
+{
+    const uint8_t *hdr = hdr_data->d_buf;
+    if (hdr_data->d_size < 4 || hdr[0] != 1)
+        return false;
+
+    uint8_t eh_frame_ptr_enc = hdr[1], fde_count_enc = hdr[2],
+            table_enc = hdr[3];
+
+    if (fde_count_enc != DW_EH_PE_udata4 ||
+        table_enc != (DW_EH_PE_datarel | DW_EH_PE_sdata4))
+    {
+        return false;
+    }
+
+    unsigned eh_frame_ptr_len = encoded_size(eh_frame_ptr_enc, reader->e_ident);
+    if (eh_frame_ptr_len == 0 || hdr_data->d_size < 4 + eh_frame_ptr_len + 4)
+        return false;
+
+    size_t offset = 4 + eh_frame_ptr_len;
+    uint64_t fde_count = fde_read_address(hdr + offset, 4);
+    offset += 4;
+
+    if (fde_count > (hdr_data->d_size - offset) / 8)
+        return false;
+
+    for (uint64_t i = 0; i < fde_count; i++, offset += 8)
+    {
+        /* The FDE address is relative to the start of .eh_frame_hdr. */
+        int32_t fde_pointer = (int32_t)fde_read_address(hdr + offset + 4, 4);
+        uint64_t fde_address = hdr_shdr->sh_addr + (int64_t)fde_pointer;
+        Dwarf_Off cfi_offset = fde_address - reader->shdr->sh_addr;
+
+        if (fde_address < reader->shdr->sh_addr ||
+            cfi_offset >= reader->data->d_size)
+        {
+            *error_message = g_strdup_printf("FDE %jx of .eh_frame_hdr outside of .eh_frame in %s",
+                                             (uintmax_t)fde_address,
+                                             reader->filename);
+            return false;
+        }
+
+        Dwarf_CFI_Entry cfi;
+        Dwarf_Off cfi_offset_next;
+        if (0 != dwarf_next_cfi(reader->e_ident,
+                                reader->data,
+                                1,
+                                cfi_offset,
+                                &cfi_offset_next,
+                                &cfi) ||
+            dwarf_cfi_cie_p(&cfi))
+        {
+            *error_message = g_strdup_printf("FDE not found at %jx in %s",
+                                             (uintmax_t)cfi_offset,
+                                             reader->filename);
+            return false;
+        }
+
+        if (!read_fde(reader, &cfi, cfi_offset, error_message))
+            return false;
+    }
+
+    return true;
+}
+
+static int
+fde_cmp(const void *a, const void *b)
+{
+    const struct sr_elf_fde *x = a, *y = b;
+
+    if (x->start_address != y->start_address)
+        return x->start_address < y->start_address ? -1 : 1;
+
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+/* Sorts the FDEs unless they already are and prepares the lookups. */
+static void
+eh_frame_index(struct sr_elf_eh_frame *eh_frame, bool sorted)
+{
+    for (size_t i = 1; sorted && i < eh_frame->count; i++)
+    {
+        if (eh_frame->fdes[i - 1].start_address > eh_frame->fdes[i].start_address)
+            sorted = false;
+    }
+
+    if (!sorted)
+    {
+        qsort(eh_frame->fdes, eh_frame->count, sizeof(struct sr_elf_fde),
+              fde_cmp);
+    }
+
+    eh_frame->max_end = g_new(uint64_t, eh_frame->count);
+
+    uint64_t max_end = 0;
+    for (size_t i = 0; i < eh_frame->count; i++)
+    {
+        struct sr_elf_fde *fde = &eh_frame->fdes[i];
+
+        max_end = MAX(max_end, fde->start_address + fde->length);
+        eh_frame->max_end[i] = max_end;
+    }
+}
 #endif /* WITH_ELFUTILS */
 
-struct sr_elf_fde *
+struct sr_elf_eh_frame *
 sr_elf_get_eh_frame(const char *filename,
                     char **error_message)
 {
@@ -601,175 +887,61 @@ sr_elf_get_eh_frame(const char *filename,
         return NULL;
     }
 
-    /* We now have a handle to .eh_frame data. We'll use
-     * dwarf_next_cfi to iterate through all FDEs looking for those
-     * matching the addresses we have.
-     *
-     * Some info on .eh_frame can be found at
-     * http://www.airs.com/blog/archives/460 and in DWARF
-     * documentation for .debug_frame. The initial_location and
-     * address_range decoding is 'inspired' by elfutils source.
-     *
-     * @todo If this linear scan is too slow, we can do binary search
-     * on .eh_frame_hdr -- see http://www.airs.com/blog/archives/462
-     */
-
-    struct sr_elf_fde *result = NULL, *last = NULL;
-    struct cie *cie_list = NULL, *cie_list_last = NULL;
-
-    Dwarf_Off cfi_offset_next = 0;
-    while (true)
+    struct eh_frame_reader reader =
     {
-        Dwarf_CFI_Entry cfi;
-        Dwarf_Off cfi_offset = cfi_offset_next;
-        int ret = dwarf_next_cfi(e_ident,
-                                 section_data,
-                                 1,
-                                 cfi_offset,
-                                 &cfi_offset_next,
-                                 &cfi);
-
-        if (ret > 0)
-        {
-            /* We're at the end. */
-            break;
-        }
+        .filename = filename,
+        .e_ident = e_ident,
+        .data = section_data,
+        .shdr = &shdr,
+        .exec_base = exec_base,
+        .cies = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                      NULL, g_free),
+        .fdes = g_array_new(FALSE, FALSE, sizeof(struct sr_elf_fde)),
+    };
+
+    /* The binary search table of .eh_frame_hdr lists the FDEs ordered by
+     * their start, use it if there is one. Otherwise, all the entries of
+     * .eh_frame are read and sorted. */
+    Elf_Data *hdr_data;
+    GElf_Shdr hdr_shdr;
+    char *hdr_error_message = NULL;
+    struct sr_elf_eh_frame *result = NULL;
+    bool read = false;
+
+    if (find_elf_section_by_name(elf,
+                                 ".eh_frame_hdr",
+                                 &hdr_data,
+                                 &hdr_shdr,
+                                 &hdr_error_message))
+    {
+        read = read_eh_frame_hdr(&reader, hdr_data, &hdr_shdr,
+                                 &hdr_error_message);
 
-        if (ret < 0)
+        /* The table is usable but broken, no need to try again. */
+        if (hdr_error_message)
         {
-            /* Error. If cfi_offset_next was updated, we may skip the
-             * erroneous cfi. */
-            if (cfi_offset_next > cfi_offset)
-                continue;
-
-            *error_message = g_strdup_printf("dwarf_next_cfi failed for %s: %s",
-                                         filename,
-                                         dwarf_errmsg(-1));
-
-            cie_free(cie_list);
-            sr_elf_eh_frame_free(result);
-            elf_end(elf);
-            close(fd);
-            return NULL;
+            *error_message = hdr_error_message;
+            goto fail;
         }
+    }
 
-        if (dwarf_cfi_cie_p(&cfi))
-        {
-            /* Current CFI is a CIE. We store its offset and FDE encoding
-             * attributes to be used when reading FDEs.
-             */
-
-            /* Default FDE encoding (i.e. no R in augmentation string) is
-             * DW_EH_PE_absptr.
-             */
-            char *cie_error_message;
-            struct cie *cie = read_cie(&cfi,
-                                       cfi_offset,
-                                       e_ident,
-                                       &cie_error_message);
-            if (!cie)
-            {
-                *error_message = g_strdup_printf("CIE reading failed for %s: %s",
-                                             filename,
-                                             cie_error_message);
-
-                g_free(cie_error_message);
-                cie_free(cie_list);
-                sr_elf_eh_frame_free(result);
-                elf_end(elf);
-                close(fd);
-                return NULL;
-            }
-
-            /* Append the newly parsed CIE to our list of CIEs. */
-            if (cie_list)
-            {
-                cie_list_last->next = cie;
-                cie_list_last = cie;
-            }
-            else
-                cie_list = cie_list_last = cie;
-        }
-        else
-        {
-            /* Current CFI is an FDE.
-             */
-            struct cie *cie = cie_list;
-
-            /* Find the CIE data that we should have saved earlier. */
-            while (cie)
-            {
-                /* In .eh_frame, CIE_pointer is relative, but libdw converts it
-                 * to absolute offset. */
-                if (cfi.fde.CIE_pointer == cie->cie_offset)
-                    break; /* Found. */
-
-                cie = cie->next;
-            }
-
-            if (!cie)
-            {
-                *error_message = g_strdup_printf("CIE not found for FDE %jx in %s",
-                                             (uintmax_t)cfi_offset,
-                                             filename);
-
-                cie_free(cie_list);
-                sr_elf_eh_frame_free(result);
-                elf_end(elf);
-                close(fd);
-                return NULL;
-            }
-
-            /* Read the two numbers we need and if they are PC-relative,
-             * compute the offset from VMA base
-             */
-
-            uint64_t initial_location = fde_read_address(cfi.fde.start,
-                                                         cie->ptr_len);
+    g_free(hdr_error_message);
 
-            uint64_t address_range = fde_read_address(cfi.fde.start + cie->ptr_len,
-                                                      cie->ptr_len);
+    if (!read && !read_eh_frame(&reader, error_message))
+        goto fail;
 
-            if (cie->pcrel)
-            {
-                /* We need to determine how long is the 'length' (and
-                 * consequently CIE id) field of this FDE -- it can be
-                 * either 4 or 12 bytes long. */
-                uint64_t length = fde_read_address(section_data->d_buf + cfi_offset, 4);
-                uint64_t skip = (length == 0xffffffffUL ? 12 : 4);
-                uint64_t mask = (cie->ptr_len == 4 ? 0xffffffffUL : 0xffffffffffffffffUL);
-                initial_location += shdr.sh_offset + cfi_offset + 2 * skip;
-                initial_location &= mask;
-            }
-            else
-            {
-                /* Assuming that not pcrel means absolute address
-                 * (what if the file is a library?).  Convert to
-                 * text-section-start-relative.
-                 */
-                initial_location -= exec_base;
-            }
+    result = g_malloc0(sizeof(*result));
+    result->exec_base = exec_base;
+    result->count = reader.fdes->len;
+    result->fdes = (struct sr_elf_fde *)g_array_free(reader.fdes, FALSE);
+    reader.fdes = NULL;
 
-            struct sr_elf_fde *fde = g_malloc(sizeof(*fde));
-            fde->exec_base = exec_base;
-            fde->start_address = initial_location;
-            fde->length = address_range;
-            fde->next = NULL;
+    eh_frame_index(result, read);
 
-            /* Append the newly parsed Frame Description Entry to our
-             * list of FDEs.
-             */
-            if (result)
-            {
-                last->next = fde;
-                last = fde;
-            }
-            else
-                result = last = fde;
-        }
-    }
-
-    cie_free(cie_list);
+fail:
+    if (reader.fdes)
+        g_array_free(reader.fdes, TRUE);
+    g_hash_table_destroy(reader.cies);
     elf_end(elf);
     close(fd);
     return result;
@@ -780,112 +952,119 @@ sr_elf_get_eh_frame(const char *filename,
 }
 
 void
-sr_elf_eh_frame_free(struct sr_elf_fde *entries)
+sr_elf_eh_frame_free(struct sr_elf_eh_frame *eh_frame)
 {
-    while (entries)
-    {
-        struct sr_elf_fde *entry = entries;
-        entries = entry->next;
-        g_free(entry);
-    }
+    if (!eh_frame)
+        return;
+
+    g_free(eh_frame->fdes);
+    g_free(eh_frame->max_end);
+    g_free(eh_frame);
 }
 
 struct sr_elf_fde *
-sr_elf_find_fde_for_offset(struct sr_elf_fde *eh_frame,
+sr_elf_find_fde_for_offset(struct sr_elf_eh_frame *eh_frame,
                            uint64_t build_id_offset)
 {
-    struct sr_elf_fde *fde = eh_frame;
-    while (fde)
+    size_t low = 0, high = eh_frame->count;
+
+    /* Find the FDEs starting at or below the offset. */
+    while (low < high)
     {
-        if (build_id_offset >= fde->start_address &&
-            build_id_offset < fde->start_address + fde->length)
-        {
-            return fde;
-        }
+        size_t middle = low + (high - low) / 2;
+
+        if (eh_frame->fdes[middle].start_address <= build_id_offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
 
-        fde = fde->next;
+    /* The closest one contains the offset unless the FDEs are nested. */
+    for (size_t i = low; i > 0 && eh_frame->max_end[i - 1] > build_id_offset; i--)
+    {
+        struct sr_elf_fde *fde = &eh_frame->fdes[i - 1];
+
+        if (build_id_offset < fde->start_address + fde->length)
+            return fde;
     }
 
     return NULL;
 }
 
 struct sr_elf_fde *
-sr_elf_find_fde_for_address(struct sr_elf_fde *eh_frame,
+sr_elf_find_fde_for_address(struct sr_elf_eh_frame *eh_frame,
                             uint64_t address)
 {
-    struct sr_elf_fde *fde = eh_frame;
-    while (fde)
-    {
-        if (address >= fde->start_address + fde->exec_base &&
-            address < fde->start_address + fde->exec_base + fde->length)
-        {
-            return fde;
-        }
-
-        fde = fde->next;
-    }
+    if (address < eh_frame->exec_base)
+        return NULL;
 
-    return NULL;
+    return sr_elf_find_fde_for_offset(eh_frame, address - eh_frame->exec_base);
 }
 
 struct sr_elf_fde *
-sr_elf_find_fde_for_start_address(struct sr_elf_fde *eh_frame,
+sr_elf_find_fde_for_start_address(struct sr_elf_eh_frame *eh_frame,
                                   uint64_t start_address)
 {
-    struct sr_elf_fde *fde = eh_frame;
-    while (fde)
+    if (start_address < eh_frame->exec_base)
+        return NULL;
+
+    uint64_t start = start_address - eh_frame->exec_base;
+    size_t low = 0, high = eh_frame->count;
+
+    while (low < high)
     {
-        if (start_address == fde->start_address + fde->exec_base)
-            return fde;
+        size_t middle = low + (high - low) / 2;
 
-        fde = fde->next;
+        if (eh_frame->fdes[middle].start_address < start)
+            low = middle + 1;
+        else
+            high = middle;
     }
 
+    if (low < eh_frame->count && eh_frame->fdes[low].start_address == start)
+        return &eh_frame->fdes[low];
+
     return NULL;
 }
 
 char *
-sr_elf_fde_to_json(struct sr_elf_fde *fde,
-                   bool recursive)
+sr_elf_fde_to_json(struct sr_elf_fde *fde)
 {
     GString *strbuf = g_string_new(NULL);
 
-    if (recursive)
-    {
-        struct sr_elf_fde *loop = fde;
-        while (loop)
-        {
-            if (loop == fde)
-                g_string_append(strbuf, "[ ");
-            else
-                g_string_append(strbuf, ", ");
-
-            char *fde_json = sr_elf_fde_to_json(loop, false);
-            char *indented_fde_json = sr_indent_except_first_line(fde_json, 2);
-            g_string_append(strbuf, indented_fde_json);
-            g_free(indented_fde_json);
-            g_free(fde_json);
-            loop = loop->next;
-            if (loop)
-                g_string_append(strbuf, "\n");
-        }
+    /* Start address. */
+    g_string_append_printf(strbuf,
+                          "{   \"start_address\": %"PRIu64"\n",
+                          fde->start_address);
 
-        g_string_append(strbuf, " ]");
-    }
-    else
-    {
-        /* Start address. */
-        g_string_append_printf(strbuf,
-                              "{   \"start_address\": %"PRIu64"\n",
-                              fde->start_address);
+    /* Length. */
+    g_string_append_printf(strbuf,
+                          ",   \"length\": %"PRIu64"\n",
+                          fde->length);
 
-        /* Length. */
-        g_string_append_printf(strbuf,
-                              ",   \"length\": %"PRIu64"\n",
-                              fde->length);
+    g_string_append(strbuf, "}");
 
-        g_string_append(strbuf, "}");
+    return g_string_free(strbuf, FALSE);
+}
+
+char *
+sr_elf_eh_frame_to_json(struct sr_elf_eh_frame *eh_frame)
+{
+    GString *strbuf = g_string_new("[ ");
+
+    for (size_t i = 0; i < eh_frame->count; i++)
+    {
+        if (i > 0)
+            g_string_append(strbuf, "\n, ");
+
+        char *fde_json = sr_elf_fde_to_json(&eh_frame->fdes[i]);
+        char *indented_fde_json = sr_indent_except_first_line(fde_json, 2);
+        g_string_append(strbuf, indented_fde_json);
+        g_free(indented_fde_json);
+        g_free(fde_json);
     }
 
+    g_string_append(strbuf, " ]");
+
     return g_string_free(strbuf, FALSE);
 }
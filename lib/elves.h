@@ -34,6 +34,7 @@ extern "C" {
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @brief A single item of the Procedure Linkage Table present in ELF
@@ -43,10 +44,22 @@ struct sr_elf_plt_entry
 {
     /** Address of the entry. */
     uint64_t address;
-    /** Symbol name corresponding to the address. */
-    char *symbol_name;
+    /** Symbol name corresponding to the address, stored in the names
+     * of the table. */
+    const char *symbol_name;
+};
+
+/**
+ * @brief Procedure Linkage Table entries sorted by their addresses.
+ */
+struct sr_elf_plt
+{
+    /** Array of count entries. */
+    struct sr_elf_plt_entry *entries;
+    size_t count;
 
-    struct sr_elf_plt_entry *next;
+    /** The symbol names of all the entries, each terminated by '\0'. */
+    char *names;
 };
 
 /**
@@ -69,8 +82,23 @@ struct sr_elf_fde
 
     /** Length of the function in bytes. */
     uint64_t length;
+};
+
+/**
+ * @brief Frame Description Entries of the .eh_frame section, sorted by
+ * their start addresses.
+ */
+struct sr_elf_eh_frame
+{
+    /** Array of count entries. */
+    struct sr_elf_fde *fdes;
+    size_t count;
 
-    struct sr_elf_fde *next;
+    /** Exec base of all the entries. */
+    uint64_t exec_base;
+
+    /** The highest end of an entry of fdes[0] to fdes[i]. */
+    uint64_t *max_end;
 };
 
 /**
@@ -81,17 +109,20 @@ struct sr_elf_fde
  *   pointer.  If function succeeds, the pointer is not touched by the
  *   function.
  * @returns
- *   Linked list of PLT entries on success. NULL otherwise.
+ *   PLT entries sorted by address on success. NULL otherwise.
  */
-struct sr_elf_plt_entry *
+struct sr_elf_plt *
 sr_elf_get_procedure_linkage_table(const char *filename,
                                    char **error_message);
 
 void
-sr_elf_procedure_linkage_table_free(struct sr_elf_plt_entry *entries);
+sr_elf_procedure_linkage_table_free(struct sr_elf_plt *plt);
 
+/**
+ * Finds the entry at the address by binary search.
+ */
 struct sr_elf_plt_entry *
-sr_elf_plt_find_for_address(struct sr_elf_plt_entry *plt,
+sr_elf_plt_find_for_address(struct sr_elf_plt *plt,
                             uint64_t address);
 
 /**
@@ -102,31 +133,39 @@ sr_elf_plt_find_for_address(struct sr_elf_plt_entry *plt,
  *   pointer.  If function succeeds, the pointer is not touched by the
  *   function.
  * @returns
- *   Returns a linked list of function ranges (function offset and
- *   size) on success. Otherwise NULL.
+ *   Returns the function ranges (function offset and size) sorted by
+ *   the offset on success. Otherwise NULL.  The binary search table of
+ *   .eh_frame_hdr is used when present, so that the entries do not need
+ *   to be sorted.
  */
-struct sr_elf_fde *
+struct sr_elf_eh_frame *
 sr_elf_get_eh_frame(const char *filename,
                     char **error_message);
 
 void
-sr_elf_eh_frame_free(struct sr_elf_fde *entries);
+sr_elf_eh_frame_free(struct sr_elf_eh_frame *eh_frame);
 
+/**
+ * Finds the FDE containing the offset by binary search.  When the
+ * entries overlap, the one starting closest to the offset is returned.
+ */
 struct sr_elf_fde *
-sr_elf_find_fde_for_offset(struct sr_elf_fde *eh_frame,
+sr_elf_find_fde_for_offset(struct sr_elf_eh_frame *eh_frame,
                            uint64_t build_id_offset);
 
 struct sr_elf_fde *
-sr_elf_find_fde_for_address(struct sr_elf_fde *eh_frame,
+sr_elf_find_fde_for_address(struct sr_elf_eh_frame *eh_frame,
                             uint64_t address);
 
 struct sr_elf_fde *
-sr_elf_find_fde_for_start_address(struct sr_elf_fde *eh_frame,
+sr_elf_find_fde_for_start_address(struct sr_elf_eh_frame *eh_frame,
                                   uint64_t start_address);
 
 char *
-sr_elf_fde_to_json(struct sr_elf_fde *fde,
-                   bool recursive);
+sr_elf_fde_to_json(struct sr_elf_fde *fde);
+
+char *
+sr_elf_eh_frame_to_json(struct sr_elf_eh_frame *eh_frame);
 
 #ifdef __cplusplus
 }
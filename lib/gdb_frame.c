@@ -18,12 +18,15 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 #include "gdb/frame.h"
+#include "gdb/sharedlib.h"
+#include "gdb_parser.h"
 #include "utils.h"
 #include "location.h"
 #include "generic_frame.h"
 #include "thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,6 +41,9 @@ gdb_append_bthash_text(struct sr_gdb_frame *frame, enum sr_bthash_flags flags,
 static void
 gdb_append_duphash_text(struct sr_gdb_frame *frame, enum sr_duphash_flags flags,
                         GString *strbuf);
+static enum frame_distance_key
+gdb_distance_key(struct sr_gdb_frame *frame, GString *key,
+                 const char **qualifier);
 
 DEFINE_NEXT_FUNC(gdb_next, struct sr_frame, struct sr_gdb_frame)
 DEFINE_SET_NEXT_FUNC(gdb_set_next, struct sr_frame, struct sr_gdb_frame)
@@ -55,6 +61,7 @@ struct frame_methods gdb_frame_methods =
     .set_next = (set_next_frame_fn_t) gdb_set_next,
     .cmp = (frame_cmp_fn_t) frame_cmp_without_number,
     .cmp_distance = (frame_cmp_fn_t) sr_gdb_frame_cmp_distance,
+    .distance_key = (frame_distance_key_fn_t) gdb_distance_key,
     .frame_append_bthash_text =
         (frame_append_bthash_text_fn_t) gdb_append_bthash_text,
     .frame_append_duphash_text =
@@ -67,7 +74,7 @@ struct frame_methods gdb_frame_methods =
 struct sr_gdb_frame *
 sr_gdb_frame_new()
 {
-    struct sr_gdb_frame *frame = g_malloc(sizeof(*frame));
+    struct sr_gdb_frame *frame = arena_alloc0(sizeof(*frame));
     sr_gdb_frame_init(frame);
     return frame;
 }
@@ -93,11 +100,12 @@ sr_gdb_frame_free(struct sr_gdb_frame *frame)
     if (!frame)
         return;
 
-    g_free(frame->function_name);
-    g_free(frame->function_type);
-    g_free(frame->source_file);
-    g_free(frame->library_name);
-    g_free(frame);
+    arena_free(frame->function_name);
+    arena_free(frame->function_type);
+    arena_free(frame->source_file);
+    arena_free(frame->library_name);
+
+    arena_free(frame);
 }
 
 struct sr_gdb_frame *
@@ -247,6 +255,21 @@ sr_gdb_frame_cmp_distance(struct sr_gdb_frame *frame1,
     return 0;
 }
 
+static enum frame_distance_key
+gdb_distance_key(struct sr_gdb_frame *frame, GString *key,
+                 const char **qualifier)
+{
+    /* Unknown functions are never considered equal. */
+    if (g_strcmp0(frame->function_name, "??") == 0)
+        return FRAME_DISTANCE_KEY_UNIQUE;
+
+    frame_distance_key_append_str(key, frame->function_name);
+
+    /* Library names are compared only if both of them are known. */
+    *qualifier = frame->library_name;
+    return FRAME_DISTANCE_KEY;
+}
+
 struct sr_gdb_frame *
 sr_gdb_frame_append(struct sr_gdb_frame *dest,
                     struct sr_gdb_frame *item)
@@ -289,53 +312,52 @@ sr_gdb_frame_append_to_str(struct sr_gdb_frame *frame,
         g_string_append(str, " <signal handler called>");
 }
 
-/**
- * Find string a or b in input, whichever comes first.
- * @param location
- * Location structure, which is updated during the search.
- * @returns
- * Return pointer to input to first a or b string.
- * If neither a nor b string is found, return the \0 character at the
- * end of input.
- */
-static const char *
-findfirstabnul(const char *input,
-               const char *a,
-               const char *b,
-               struct sr_location *location)
+const char *
+gdb_parser_skip_lines(struct gdb_parser *parser,
+                      const char *input,
+                      const char *thread_keyword,
+                      struct sr_location *location)
 {
-    size_t alen = strlen(a);
-    size_t blen = strlen(b);
-    const char *p = input;
-    while (*p)
+    const char *line = input;
+    while (true)
     {
-        if (strncmp(p, a, alen) == 0)
-            return p;
-        if (strncmp(p, b, blen) == 0)
-            return p;
-        sr_location_eat_char(location, *p);
-        ++p;
+        const char *newline = strchr(line, '\n');
+        if (!newline)
+        {
+            location->column += strlen(line);
+            return line + strlen(line);
+        }
+
+        location->column += newline - line;
+        sr_location_eat_char(location, *newline);
+        line = newline + 1;
+
+        if (parser->find_libs)
+        {
+            const char *table = line;
+            parser->libs = sr_gdb_sharedlib_parse_table(&line, location);
+            if (line != table)
+                parser->find_libs = false;
+        }
+
+        if (*line == '#' || 0 == strncmp(line, thread_keyword, strlen(thread_keyword)))
+            return line;
     }
-    return p;
 }
 
 struct sr_gdb_frame *
-sr_gdb_frame_parse(const char **input,
-                   struct sr_location *location)
+gdb_parser_parse_frame(struct gdb_parser *parser,
+                       const char **input,
+                       struct sr_location *location)
 {
     const char *local_input = *input;
-    struct sr_gdb_frame *header = sr_gdb_frame_parse_header(input, location);
+    struct sr_gdb_frame *header = sr_gdb_frame_parse_header(&local_input,
+                                                            location);
     if (!header)
         return NULL;
 
     /* Skip the variables section for now. */
-    local_input = findfirstabnul(local_input, "\n#", "\nThread", location);
-    if (*local_input != '\0')
-    {
-        /* skip the newline */
-        sr_location_eat_char(location, *local_input);
-        ++local_input;
-    }
+    local_input = gdb_parser_skip_lines(parser, local_input, "Thread", location);
 
     warn("frame #%u %s\n",
          header->number,
@@ -345,6 +367,14 @@ sr_gdb_frame_parse(const char **input,
     return header;
 }
 
+struct sr_gdb_frame *
+sr_gdb_frame_parse(const char **input,
+                   struct sr_location *location)
+{
+    struct gdb_parser parser = { .find_libs = false };
+    return gdb_parser_parse_frame(&parser, input, location);
+}
+
 int
 sr_gdb_frame_parse_frame_start(const char **input, uint32_t *number)
 {
@@ -416,16 +446,21 @@ sr_gdb_frame_parseadd_operator(const char **input,
 
 #define FUNCTION_NAME_CHARS SR_alnum "@.:=!*+-[]~&/%^|,_"
 
-int
-sr_gdb_frame_parse_function_name_chunk(const char **input,
-                                       bool space_allowed,
-                                       char **target)
+/* The parseadd_function_name_* functions append the parsed part of
+ * function name directly to the target buffer, so a name is built in
+ * a single buffer regardless of how many chunks it consists of.  When
+ * they fail, the target is left as it was.
+ */
+static int
+parseadd_function_name_chunk(const char **input,
+                             bool space_allowed,
+                             GString *target)
 {
     const char *local_input = *input;
-    GString *buf = g_string_new(NULL);
+    size_t target_len = target->len;
     while (*local_input)
     {
-        if (0 < sr_gdb_frame_parseadd_operator(&local_input, buf))
+        if (0 < sr_gdb_frame_parseadd_operator(&local_input, target))
         {
             /* Space is allowed after operator even when it
                is not normally allowed. */
@@ -438,55 +473,50 @@ sr_gdb_frame_parse_function_name_chunk(const char **input,
                     local_input -= 2;
                 }
                 else
-                    g_string_append_c(buf, ' ');
+                    g_string_append_c(target, ' ');
             }
         }
 
-        if (strchr(FUNCTION_NAME_CHARS, *local_input) == NULL)
+        /* Append the run of plain name characters at once, up to the
+         * next possible operator. */
+        const char *run = local_input;
+        while (*local_input && strchr(FUNCTION_NAME_CHARS, *local_input))
         {
-            if (!space_allowed || strchr(" ", *local_input) == NULL)
+            ++local_input;
+            if (0 == strncmp(local_input, "operator", strlen("operator")))
                 break;
         }
 
-        g_string_append_c(buf, *local_input);
+        if (local_input != run)
+        {
+            g_string_append_len(target, run, local_input - run);
+            continue;
+        }
+
+        if (!space_allowed || *local_input != ' ')
+            break;
+
+        g_string_append_c(target, *local_input);
         ++local_input;
     }
 
-    if (buf->len == 0)
-    {
-        g_string_free(buf, TRUE);
+    if (target->len == target_len)
         return 0;
-    }
 
-    *target = g_string_free(buf, FALSE);
     int total_char_count = local_input - *input;
     *input = local_input;
     return total_char_count;
 }
 
-/* Parses output of 'c_type_print_template_args()' at gdb/c_typeprint.c
- *
- * There are no rules for the format of "[with ...]" and the gdb unit-test
- * "cp-support.exp" simply uses "\[with .*\]" regular expression to validate
- * the format of this section.
- *
- * The function checks if the current input starts with " [with " and if so, it
- * reads all characters until it finds the closing ] or the end of the input.
- * The latter case leads to an error.
- *
- * The [] must be balanced; otherwise the function reads the entire input (and
- * reports an error) or does not read all template arguments (should cause an
- * error in the other parsing functions).
- */
-int sr_gdb_frame_parse_function_name_template_args(const char **input,
-                                                   char **target)
+static int
+parseadd_function_name_template_args(const char **input,
+                                     GString *target)
 {
     const char *local_input = *input;
     if (0 == sr_skip_string(&local_input, " [with "))
         return 0;
 
-    GString *buf = g_string_new(NULL);
-    g_string_append(buf, " [with ");
+    const char *args = local_input;
     int depth = 1;
     while (*local_input)
     {
@@ -495,106 +525,191 @@ int sr_gdb_frame_parse_function_name_template_args(const char **input,
         else if (']' == *local_input && --depth == 0)
             break;
 
-        g_string_append_c(buf, *local_input);
         ++local_input;
     }
 
     if (!sr_skip_char(&local_input, ']'))
-    {
-        g_string_free(buf, TRUE);
         return 0;
-    }
 
-    g_string_append_c(buf, ']');
+    g_string_append(target, " [with ");
+    g_string_append_len(target, args, local_input - args);
 
-    *target = g_string_free(buf, FALSE);
     int total_char_count = local_input - *input;
     *input = local_input;
     return total_char_count;
 }
 
-int
-sr_gdb_frame_parse_function_name_braces(const char **input, char **target)
+static int
+parseadd_function_name_template(const char **input,
+                                GString *target);
+
+static int
+parseadd_function_name_braces(const char **input,
+                              GString *target)
 {
     const char *local_input = *input;
     if (!sr_skip_char(&local_input, '('))
         return 0;
 
-    GString *buf = g_string_new(NULL);
-    g_string_append_c(buf, '(');
-    while (true)
+    size_t target_len = target->len;
+    g_string_append_c(target, '(');
+    while (0 < parseadd_function_name_chunk(&local_input, true, target) ||
+           0 < parseadd_function_name_braces(&local_input, target) ||
+           0 < parseadd_function_name_template(&local_input, target))
     {
-        char *namechunk = NULL;
-        if (0 < sr_gdb_frame_parse_function_name_chunk(&local_input, true, &namechunk) ||
-            0 < sr_gdb_frame_parse_function_name_braces(&local_input, &namechunk) ||
-            0 < sr_gdb_frame_parse_function_name_template(&local_input, &namechunk))
-        {
-            g_string_append(buf, namechunk);
-            g_free(namechunk);
-        }
-        else
-            break;
+        continue;
     }
 
     if (!sr_skip_char(&local_input, ')'))
     {
-        g_string_free(buf, TRUE);
+        g_string_truncate(target, target_len);
         return 0;
     }
 
-    g_string_append_c(buf, ')');
-    *target = g_string_free(buf, FALSE);
+    g_string_append_c(target, ')');
     int total_char_count = local_input - *input;
     *input = local_input;
     return total_char_count;
 }
 
-int
-sr_gdb_frame_parse_function_name_template(const char **input, char **target)
+static int
+parseadd_function_name_template(const char **input,
+                                GString *target)
 {
     const char *local_input = *input;
     if (!sr_skip_char(&local_input, '<'))
         return 0;
 
-    GString *buf = g_string_new(NULL);
-    g_string_append_c(buf, '<');
-    while (true)
+    size_t target_len = target->len;
+    g_string_append_c(target, '<');
+    /* The template args usually follows a symbol name (potentially with
+     * braces). However we try to parse the template args first as
+     * "parseadd_function_name_chunk()" accepts almost the same
+     * format, but the difference is that the template args must have
+     * prefix ' [with ', so the parse template args function can return
+     * faster if the local_input does not meet the requirements (the name
+     * chunk parse function parses entire input until it finds an abandoned
+     * character).
+     */
+    while (0 < parseadd_function_name_template_args(&local_input, target) ||
+           0 < parseadd_function_name_chunk(&local_input, true, target) ||
+           0 < parseadd_function_name_braces(&local_input, target) ||
+           0 < parseadd_function_name_template(&local_input, target))
     {
-        char *namechunk = NULL;
-        /* The template args usually follows a symbol name (potentially with
-         * braces). However we try to parse the template args first as
-         * "sr_gdb_frame_parse_function_name_chunk()" accepts almost the same
-         * format, but the difference is that the template args must have
-         * prefix ' [with ', so the parse template args function can return
-         * faster if the local_input does not meet the requirements (the name
-         * chunk parse function parses entire input until it finds an abandoned
-         * character).
-         */
-        if (0 < sr_gdb_frame_parse_function_name_template_args(&local_input, &namechunk) ||
-            0 < sr_gdb_frame_parse_function_name_chunk(&local_input, true, &namechunk) ||
-            0 < sr_gdb_frame_parse_function_name_braces(&local_input, &namechunk) ||
-            0 < sr_gdb_frame_parse_function_name_template(&local_input, &namechunk))
-        {
-            g_string_append(buf, namechunk);
-            g_free(namechunk);
-        }
-        else
-            break;
+        continue;
     }
 
     if (!sr_skip_char(&local_input, '>'))
     {
-        g_string_free(buf, TRUE);
+        g_string_truncate(target, target_len);
         return 0;
     }
 
-    g_string_append_c(buf, '>');
-    *target = g_string_free(buf, FALSE);
+    g_string_append_c(target, '>');
     int total_char_count = local_input - *input;
     *input = local_input;
     return total_char_count;
 }
 
+/* Wraps one of the parseadd_function_name_* functions for the public
+ * interface returning the parsed chunk as a newly allocated string.
+ */
+static int
+parse_function_name_part(const char **input,
+                         int (*parseadd)(const char **, GString *),
+                         char **target)
+{
+    GString *buf = g_string_new(NULL);
+    int chars = parseadd(input, buf);
+    if (0 == chars)
+    {
+        g_string_free(buf, TRUE);
+        return 0;
+    }
+
+    *target = arena_string_free(buf);
+    return chars;
+}
+
+int
+sr_gdb_frame_parse_function_name_chunk(const char **input,
+                                       bool space_allowed,
+                                       char **target)
+{
+    GString *buf = g_string_new(NULL);
+    int chars = parseadd_function_name_chunk(input, space_allowed, buf);
+    if (0 == chars)
+    {
+        g_string_free(buf, TRUE);
+        return 0;
+    }
+
+    *target = arena_string_free(buf);
+    return chars;
+}
+
+/* Parses output of 'c_type_print_template_args()' at gdb/c_typeprint.c
+ *
+ * There are no rules for the format of "[with ...]" and the gdb unit-test
+ * "cp-support.exp" simply uses "\[with .*\]" regular expression to validate
+ * the format of this section.
+ *
+ * The function checks if the current input starts with " [with " and if so, it
+ * reads all characters until it finds the closing ] or the end of the input.
+ * The latter case leads to an error.
+ *
+ * The [] must be balanced; otherwise the function reads the entire input (and
+ * reports an error) or does not read all template arguments (should cause an
+ * error in the other parsing functions).
+ */
+int sr_gdb_frame_parse_function_name_template_args(const char **input,
+                                                   char **target)
+{
+    return parse_function_name_part(input,
+                                    parseadd_function_name_template_args,
+                                    target);
+}
+
+int
+sr_gdb_frame_parse_function_name_braces(const char **input, char **target)
+{
+    return parse_function_name_part(input,
+                                    parseadd_function_name_braces,
+                                    target);
+}
+
+int
+sr_gdb_frame_parse_function_name_template(const char **input, char **target)
+{
+    return parse_function_name_part(input,
+                                    parseadd_function_name_template,
+                                    target);
+}
+
+/* Appends the function name parts, braces, templates... following the
+ * first part of a function name or type. */
+static void
+parseadd_function_name_rest(const char **input,
+                            GString *target,
+                            struct sr_location *location)
+{
+    while (true)
+    {
+        int chars = parseadd_function_name_chunk(input, false, target);
+
+        if (0 == chars)
+            chars = parseadd_function_name_braces(input, target);
+
+        if (0 == chars)
+            chars = parseadd_function_name_template(input, target);
+
+        if (0 == chars)
+            break;
+
+        location->column += chars;
+    }
+}
+
 bool
 sr_gdb_frame_parse_function_name(const char **input,
                                  char **function_name,
@@ -603,8 +718,9 @@ sr_gdb_frame_parse_function_name(const char **input,
 {
     /* Handle unknown function name, represended by double question
        mark. */
-    if (sr_parse_string(input, "??", function_name))
+    if (0 < sr_skip_string(input, "??"))
     {
+        *function_name = arena_strndup("??", 2);
         *function_type = NULL;
         location->column += 2;
         return true;
@@ -622,7 +738,6 @@ sr_gdb_frame_parse_function_name(const char **input,
        '(' to start "(anonymous namespace)::" or something
      */
     char first;
-    char *namechunk;
     if (sr_parse_char_limited(&local_input, "~*._" SR_alnum, &first))
     {
         /* If it's a start of 'o'perator, put the 'o' back! */
@@ -636,14 +751,9 @@ sr_gdb_frame_parse_function_name(const char **input,
     }
     else
     {
-        int chars = sr_gdb_frame_parse_function_name_braces(&local_input,
-                                                            &namechunk);
+        int chars = parseadd_function_name_braces(&local_input, buf0);
         if (0 < chars)
-        {
-            g_string_append(buf0, namechunk);
-            g_free(namechunk);
             location->column += chars;
-        }
         else
         {
             location->message = "Expected function name.";
@@ -653,32 +763,7 @@ sr_gdb_frame_parse_function_name(const char **input,
     }
 
     /* The rest consists of function name, braces, templates...*/
-    while (true)
-    {
-        char *namechunk = NULL;
-        int chars = sr_gdb_frame_parse_function_name_chunk(&local_input,
-                                                           false,
-                                                           &namechunk);
-
-        if (0 == chars)
-        {
-            chars = sr_gdb_frame_parse_function_name_braces(&local_input,
-                                                            &namechunk);
-        }
-
-        if (0 == chars)
-        {
-            chars = sr_gdb_frame_parse_function_name_template(&local_input,
-                                                              &namechunk);
-        }
-
-        if (0 == chars)
-            break;
-
-        g_string_append(buf0, namechunk);
-        g_free(namechunk);
-        location->column += chars;
-    }
+    parseadd_function_name_rest(&local_input, buf0, location);
 
     /* Function name MUST be ended by empty space. */
     char space;
@@ -712,43 +797,16 @@ sr_gdb_frame_parse_function_name(const char **input,
     /* Maybe the first series was just a type of the function, and now
        the real function follows. Now, we know it must not start with
        '(', nor with '<'. */
-    chars = sr_gdb_frame_parse_function_name_chunk(&local_input,
-                                                   false,
-                                                   &namechunk);
+    buf1 = g_string_new(NULL);
+    chars = parseadd_function_name_chunk(&local_input, false, buf1);
     if (0 < chars)
     {
         /* Eat the space separator first. */
         sr_location_eat_char(location, space);
-
-        buf1 = g_string_new(NULL);
-        g_string_append(buf1, namechunk);
-        g_free(namechunk);
         location->column += chars;
 
         /* The rest consists of a function name parts, braces, templates...*/
-        while (true)
-        {
-            char *namechunk = NULL;
-            chars = sr_gdb_frame_parse_function_name_chunk(&local_input,
-                                                           false,
-                                                           &namechunk);
-            if (0 == chars)
-            {
-                chars = sr_gdb_frame_parse_function_name_braces(&local_input,
-                                                                &namechunk);
-            }
-            if (0 == chars)
-            {
-                chars = sr_gdb_frame_parse_function_name_template(&local_input,
-                                                                  &namechunk);
-            }
-            if (0 == chars)
-                break;
-
-            g_string_append(buf1, namechunk);
-            g_free(namechunk);
-            location->column += chars;
-        }
+        parseadd_function_name_rest(&local_input, buf1, location);
 
         /* Function name MUST be ended by empty space. */
         if (!sr_parse_char_limited(&local_input, SR_space, &space))
@@ -759,6 +817,11 @@ sr_gdb_frame_parse_function_name(const char **input,
             return false;
         }
     }
+    else
+    {
+        g_string_free(buf1, TRUE);
+        buf1 = NULL;
+    }
 
     /* Again, some C++ function names might contain suffix " const" */
     chars = sr_skip_string(&local_input, "const");
@@ -775,7 +838,8 @@ sr_gdb_frame_parse_function_name(const char **input,
         {
             /* Function name MUST be ended by empty space. */
             g_string_free(buf0, TRUE);
-            g_string_free(buf1, TRUE);
+            if (buf1)
+                g_string_free(buf1, TRUE);
             location->message = "Space or newline expected after function name.";
             return false;
         }
@@ -786,12 +850,12 @@ sr_gdb_frame_parse_function_name(const char **input,
 
     if (buf1)
     {
-        *function_name = g_string_free(buf1, FALSE);
-        *function_type = g_string_free(buf0, FALSE);
+        *function_name = arena_string_free(buf1);
+        *function_type = arena_string_free(buf0);
     }
     else
     {
-        *function_name = g_string_free(buf0, FALSE);
+        *function_name = arena_string_free(buf0);
         *function_type = NULL;
     }
 
@@ -896,8 +960,8 @@ sr_gdb_frame_parse_function_call(const char **input,
                                         &line,
                                         &column))
     {
-        g_free(name);
-        g_free(type);
+        arena_free(name);
+        arena_free(type);
         location->message = "Expected a space or newline after the function name.";
         return false;
     }
@@ -906,8 +970,8 @@ sr_gdb_frame_parse_function_call(const char **input,
 
     if (!sr_gdb_frame_skip_function_args(&local_input, location))
     {
-        g_free(name);
-        g_free(type);
+        arena_free(name);
+        arena_free(type);
         /* The location message is set by the function returning
          * false, no need to update it here. */
         return false;
@@ -1043,25 +1107,26 @@ sr_gdb_frame_parse_file_location(const char **input,
         return false;
     }
 
-    char *file_name;
-    chars = sr_parse_char_span(&local_input, SR_alnum "_/\\+.-", &file_name);
+    const char *file_start = local_input;
+    chars = sr_skip_char_span(&local_input, SR_alnum "_/\\+.-");
     location->column += chars;
     if (0 == chars)
     {
         location->message = "Expected a file name.";
         return false;
     }
-    
+
     /* If the parsed file_name contains "/lib" and then ".so." or ends with ".so",
      * it is most certainly a shared object, not a source file, so disregard it.
      * See RHBZ#1239318 */
-    char *tmp = NULL;
-    if((tmp = strstr(file_name, "/lib")) != NULL
-       && (strstr(tmp, ".so.") != NULL
-           || strcmp(tmp + strlen(tmp) - 3, ".so") == 0)) {
-        g_free(file_name);
-        file_name = NULL;
-    }
+    const char *tmp = g_strstr_len(file_start, chars, "/lib");
+    bool shared_object = tmp
+        && (g_strstr_len(tmp, local_input - tmp, ".so.") != NULL
+            || strncmp(local_input - 3, ".so", 3) == 0);
+
+    char *file_name = NULL;
+    if (!shared_object)
+        file_name = arena_strndup(file_start, chars);
 
     if (sr_skip_char(&local_input, ':'))
     {
@@ -1070,7 +1135,7 @@ sr_gdb_frame_parse_file_location(const char **input,
         location->column += digits;
         if (0 == digits)
         {
-            g_free(file_name);
+            arena_free(file_name);
             location->message = "Expected a line number.";
             return false;
         }
@@ -0,0 +1,80 @@
+/*
+    gdb_parser.h
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef SATYR_GDB_PARSER_H
+#define SATYR_GDB_PARSER_H
+
+/**
+ * @file
+ * @brief State shared by the parsers of the parts of a GDB stack trace.
+ *
+ * The stack trace is parsed in a single forward pass.  The table of
+ * shared libraries, which GDB prints after the threads, is parsed when
+ * the frame parser reaches it while skipping the text following a
+ * frame header, instead of searching the whole input for it
+ * beforehand.
+ */
+
+#include <glib.h>
+#include <stdbool.h>
+
+struct sr_gdb_frame;
+struct sr_gdb_sharedlib;
+struct sr_gdb_thread;
+struct sr_location;
+
+struct gdb_parser
+{
+    /**
+     * True while the table of shared libraries should be parsed when
+     * found.  Only the first table is parsed, the following ones are
+     * skipped like any other text.
+     */
+    bool find_libs;
+
+    /**
+     * The libraries from the table found, owned by the caller.
+     */
+    struct sr_gdb_sharedlib *libs;
+};
+
+/**
+ * Skips the input up to the next line starting with '#' or the thread
+ * keyword, and returns the pointer to that line, or to the end of the
+ * input if there is none.  The rest of the current line is always
+ * skipped.  The table of shared libraries found on the way is parsed
+ * when the parser looks for it.
+ */
+const char *
+gdb_parser_skip_lines(struct gdb_parser *parser,
+                      const char *input,
+                      const char *thread_keyword,
+                      struct sr_location *location);
+
+struct sr_gdb_frame *
+gdb_parser_parse_frame(struct gdb_parser *parser,
+                       const char **input,
+                       struct sr_location *location);
+
+struct sr_gdb_thread *
+gdb_parser_parse_thread(struct gdb_parser *parser,
+                        const char **input,
+                        struct sr_location *location);
+
+#endif
@@ -18,7 +18,10 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 #include "gdb/sharedlib.h"
+#include "address_map.h"
 #include "utils.h"
+#include "location.h"
+#include "internal_arena.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
@@ -27,7 +30,7 @@
 struct sr_gdb_sharedlib *
 sr_gdb_sharedlib_new()
 {
-    struct sr_gdb_sharedlib *result = g_malloc(sizeof(*result));
+    struct sr_gdb_sharedlib *result = arena_alloc0(sizeof(*result));
     sr_gdb_sharedlib_init(result);
     return result;
 }
@@ -48,8 +51,8 @@ sr_gdb_sharedlib_free(struct sr_gdb_sharedlib *sharedlib)
     if (!sharedlib)
         return;
 
-    g_free(sharedlib->soname);
-    g_free(sharedlib);
+    arena_free(sharedlib->soname);
+    arena_free(sharedlib);
 }
 
 struct sr_gdb_sharedlib *
@@ -120,62 +123,89 @@ sr_gdb_sharedlib_find_address(struct sr_gdb_sharedlib *first,
     return NULL;
 }
 
-static char *
-find_sharedlib_section_start(const char *input)
+struct sr_address_map *
+sr_gdb_sharedlib_address_map(struct sr_gdb_sharedlib *first)
 {
-    /* searching for
-       From      To      Syms Read      Shared Object Library
-    */
-    char *result = strstr(input, "From");
-    for (; result; result = strstr(result + 1, "From"))
+    struct sr_address_map *map = sr_address_map_new();
+
+    /* The libraries without addresses have both set to UINT64_MAX, which
+     * is never found. */
+    for (struct sr_gdb_sharedlib *lib = first; lib; lib = lib->next)
     {
-        /* must be at the beginning of the line
-           or at the beginning of whole input */
-        if (result != input && *(result - 1) != '\n')
-            continue;
+        if (lib->from != UINT64_MAX)
+            sr_address_map_add(map, lib->from, lib->to, lib);
+    }
 
-        char *tmp = result + strlen("From");
-        while (isspace(*tmp))
-            ++tmp;
+    return map;
+}
 
-        if (strncmp("To", tmp, strlen("To")) != 0)
-            continue;
+/* If the line is the header of the table of shared libraries
+     From      To      Syms Read      Shared Object Library
+   returns the pointer to the next line, the first loaded library.
+   Otherwise returns NULL. */
+static const char *
+skip_sharedlib_header(const char *line)
+{
+    if (strncmp("From", line, strlen("From")) != 0)
+        return NULL;
 
-        tmp += strlen("To");
-        while (isspace(*tmp))
-            ++tmp;
+    const char *tmp = line + strlen("From");
+    while (isspace(*tmp))
+        ++tmp;
 
-        if (strncmp("Syms Read", tmp, strlen("Syms Read")) != 0)
-            continue;
+    if (strncmp("To", tmp, strlen("To")) != 0)
+        return NULL;
 
-        tmp += strlen("Syms Read");
-        while (isspace(*tmp))
-            ++tmp;
+    tmp += strlen("To");
+    while (isspace(*tmp))
+        ++tmp;
+
+    if (strncmp("Syms Read", tmp, strlen("Syms Read")) != 0)
+        return NULL;
 
-        if (strncmp("Shared Object Library\n", tmp, strlen("Shared Object Library\n")) != 0)
+    tmp += strlen("Syms Read");
+    while (isspace(*tmp))
+        ++tmp;
+
+    if (strncmp("Shared Object Library\n", tmp, strlen("Shared Object Library\n")) != 0)
+        return NULL;
+
+    return tmp + strlen("Shared Object Library\n");
+}
+
+static const char *
+find_sharedlib_section_start(const char *input)
+{
+    const char *result = strstr(input, "From");
+    for (; result; result = strstr(result + 1, "From"))
+    {
+        /* must be at the beginning of the line
+           or at the beginning of whole input */
+        if (result != input && *(result - 1) != '\n')
             continue;
 
-        /* jump to the next line - the first loaded library */
-        return tmp + strlen("Shared Object Library\n");
+        const char *first_library = skip_sharedlib_header(result);
+        if (first_library)
+            return first_library;
     }
 
     return NULL;
 }
 
-struct sr_gdb_sharedlib *
-sr_gdb_sharedlib_parse(const char *input)
+/* Parses the lines of the table of shared libraries and moves the
+   input after the last one. */
+static struct sr_gdb_sharedlib *
+parse_sharedlib_lines(const char **input)
 {
-    char *tmp = find_sharedlib_section_start(input);
-    if (!tmp)
-        return NULL;
-
     /* Parsing
        From                 To                  Syms Read        Shared Object Library
        0x0123456789abcdef   0xfedcba987654321   Yes (*)|Yes|No   /usr/lib64/libsatyr.so.2.2.2
     */
+    const char *tmp = *input;
     struct sr_gdb_sharedlib *first = NULL, *current = NULL;
-    while (1)
+    while (*tmp)
     {
+        const char *line = tmp;
         unsigned long long from = -1, to = -1;
 
         /* ugly - from/to address is sometimes missing; skip it and jump to symbols */
@@ -212,18 +242,19 @@ sr_gdb_sharedlib_parse(const char *input)
             symbols = SYMS_WRONG;
         }
         else
+        {
+            /* Not a library, leave the line to the caller. */
+            tmp = line;
             break;
+        }
 
         while (isspace(*tmp))
             ++tmp;
 
         /* Shared Object Library */
-        GString *buf = g_string_new(NULL);
+        const char *soname = tmp;
         while (*tmp && *tmp != '\n')
-        {
-            g_string_append_c(buf, *tmp);
             ++tmp;
-        }
 
         if (current)
         {
@@ -241,11 +272,40 @@ sr_gdb_sharedlib_parse(const char *input)
         current->from = from;
         current->to = to;
         current->symbols = symbols;
-        current->soname = g_string_free(buf, FALSE);
+        current->soname = arena_strndup(soname, tmp - soname);
 
         /* we are on '\n' character, jump to next line */
-        ++tmp;
+        if (*tmp)
+            ++tmp;
     }
 
+    *input = tmp;
     return first;
 }
+
+struct sr_gdb_sharedlib *
+sr_gdb_sharedlib_parse(const char *input)
+{
+    const char *tmp = find_sharedlib_section_start(input);
+    if (!tmp)
+        return NULL;
+
+    return parse_sharedlib_lines(&tmp);
+}
+
+struct sr_gdb_sharedlib *
+sr_gdb_sharedlib_parse_table(const char **input,
+                             struct sr_location *location)
+{
+    const char *local_input = skip_sharedlib_header(*input);
+    if (!local_input)
+        return NULL;
+
+    struct sr_gdb_sharedlib *result = parse_sharedlib_lines(&local_input);
+
+    for (const char *c = *input; c < local_input; ++c)
+        sr_location_eat_char(location, *c);
+
+    *input = local_input;
+    return result;
+}
@@ -21,11 +21,14 @@
 #include "gdb/thread.h"
 #include "gdb/frame.h"
 #include "gdb/sharedlib.h"
+#include "gdb_parser.h"
+#include "address_map.h"
 #include "utils.h"
 #include "location.h"
 #include "normalize.h"
 #include "generic_stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include "json.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -78,7 +81,7 @@ struct stacktrace_methods gdb_stacktrace_methods =
 struct sr_gdb_stacktrace *
 sr_gdb_stacktrace_new()
 {
-    struct sr_gdb_stacktrace *stacktrace = g_malloc(sizeof(*stacktrace));
+    struct sr_gdb_stacktrace *stacktrace = arena_alloc0(sizeof(*stacktrace));
     sr_gdb_stacktrace_init(stacktrace);
     return stacktrace;
 }
@@ -116,7 +119,7 @@ sr_gdb_stacktrace_free(struct sr_gdb_stacktrace *stacktrace)
     if (stacktrace->crash)
         sr_gdb_frame_free(stacktrace->crash);
 
-    g_free(stacktrace);
+    arena_free(stacktrace);
 }
 
 struct sr_gdb_stacktrace *
@@ -438,6 +441,12 @@ sr_gdb_stacktrace_set_crash_tid(struct sr_gdb_stacktrace *stacktrace,
     stacktrace->crash_tid = tid;
 }
 
+static bool
+stacktrace_parse_header(struct gdb_parser *parser,
+                        const char **input,
+                        struct sr_gdb_frame **frame,
+                        struct sr_location *location);
+
 struct sr_gdb_stacktrace *
 sr_gdb_stacktrace_parse(const char **input,
                         struct sr_location *location)
@@ -445,22 +454,35 @@ sr_gdb_stacktrace_parse(const char **input,
     const char *local_input = *input;
     /* im - intermediate */
     struct sr_gdb_stacktrace *imstacktrace = sr_gdb_stacktrace_new();
-    imstacktrace->libs = sr_gdb_sharedlib_parse(*input);
+
+    /* The table of shared libraries is parsed when the parsers skipping
+     * the text between the frames reach it.  Only the table at the very
+     * beginning of the input is not preceded by a line they skip.
+     */
+    struct gdb_parser parser = { .find_libs = true };
+    struct sr_location table_location;
+    sr_location_init(&table_location);
+    const char *table = local_input;
+    parser.libs = sr_gdb_sharedlib_parse_table(&table, &table_location);
+    if (table != local_input)
+        parser.find_libs = false;
 
     /* The header is mandatory, but it might contain no frame header,
      * in some broken stacktraces. In that case, stacktrace.crash value
      * is kept as NULL.
      */
-    if (!sr_gdb_stacktrace_parse_header(&local_input,
-                                        &imstacktrace->crash,
-                                        location))
+    if (!stacktrace_parse_header(&parser,
+                                 &local_input,
+                                 &imstacktrace->crash,
+                                 location))
     {
+        imstacktrace->libs = parser.libs;
         sr_gdb_stacktrace_free(imstacktrace);
         return NULL;
     }
 
     struct sr_gdb_thread *thread, *prevthread = NULL;
-    while ((thread = sr_gdb_thread_parse(&local_input, location)))
+    while ((thread = gdb_parser_parse_thread(&parser, &local_input, location)))
     {
         if (prevthread)
         {
@@ -470,6 +492,12 @@ sr_gdb_stacktrace_parse(const char **input,
         else
             imstacktrace->threads = prevthread = thread;
     }
+
+    /* The table might be in the text following the last thread parsed. */
+    if (parser.find_libs)
+        parser.libs = sr_gdb_sharedlib_parse(local_input);
+
+    imstacktrace->libs = parser.libs;
     if (!imstacktrace->threads)
     {
         sr_gdb_stacktrace_free(imstacktrace);
@@ -485,68 +513,25 @@ sr_gdb_stacktrace_parse_header(const char **input,
                                struct sr_gdb_frame **frame,
                                struct sr_location *location)
 {
-    int first_thread_line, first_thread_column;
-    const char *first_thread = sr_strstr_location(*input,
-                                                  "\nThread ",
-                                                  &first_thread_line,
-                                                  &first_thread_column);
-
-    /* Skip the newline. */
-    if (first_thread)
-    {
-        ++first_thread;
-        first_thread_line += 1;
-        first_thread_column = 0;
-    }
-
-    int first_frame_line, first_frame_column;
-    const char *first_frame = sr_strstr_location(*input,
-                                                 "\n#",
-                                                 &first_frame_line,
-                                                 &first_frame_column);
-
-    /* Skip the newline. */
-    if (first_frame)
-    {
-        ++first_frame;
-        first_frame_line += 1;
-        first_frame_column = 0;
-    }
+    struct gdb_parser parser = { .find_libs = false };
+    return stacktrace_parse_header(&parser, input, frame, location);
+}
 
-    if (first_thread)
-    {
-        if (first_frame && first_frame < first_thread)
-        {
-            /* Common case. The crash frame is present in the input
-             * before the list of threads begins.
-             */
-            *input = first_frame;
-            sr_location_add(location, first_frame_line, first_frame_column);
-        }
-        else
-        {
-            /* Uncommon case (caused by some kernel bug) where the
-             * frame is missing from the header.  The stacktrace
-             * contains just threads.  We silently skip the header and
-             * return true.
-             */
-            *input = first_thread;
-            sr_location_add(location,
-                            first_thread_line,
-                            first_thread_column);
-            *frame = NULL;
-            return true;
-        }
-    }
-    else if (first_frame)
-    {
-        /* Degenerate case when the stacktrace contains no thread, but
-         * the frame is there.
-         */
-        *input = first_frame;
-        sr_location_add(location, first_frame_line, first_frame_column);
-    }
-    else
+static bool
+stacktrace_parse_header(struct gdb_parser *parser,
+                        const char **input,
+                        struct sr_gdb_frame **frame,
+                        struct sr_location *location)
+{
+    /* Find the first line starting either a frame or a thread. */
+    struct sr_location header_location;
+    sr_location_init(&header_location);
+    const char *line = gdb_parser_skip_lines(parser,
+                                             *input,
+                                             "Thread ",
+                                             &header_location);
+
+    if (*line == '\0')
     {
         /* Degenerate case where the input is empty or completely
          * meaningless. Report a failure.
@@ -555,20 +540,42 @@ sr_gdb_stacktrace_parse_header(const char **input,
         return false;
     }
 
-    /* Parse the frame header. */
-    *frame = sr_gdb_frame_parse(input, location);
+    *input = line;
+    sr_location_add(location, header_location.line, header_location.column);
+
+    if (*line != '#')
+    {
+        /* Uncommon case (caused by some kernel bug) where the
+         * frame is missing from the header.  The stacktrace
+         * contains just threads.  We silently skip the header and
+         * return true.
+         */
+        *frame = NULL;
+        return true;
+    }
+
+    /* Common case. The crash frame is present in the input before the
+     * list of threads begins, or the stacktrace contains no thread,
+     * but the frame is there.  Parse the frame header.
+     */
+    *frame = gdb_parser_parse_frame(parser, input, location);
     return *frame;
 }
 
 void
 sr_gdb_stacktrace_set_libnames(struct sr_gdb_stacktrace *stacktrace)
 {
+    struct sr_address_map *libs_map =
+        sr_gdb_sharedlib_address_map(stacktrace->libs);
+
     struct sr_gdb_thread *thread = stacktrace->threads;
     while (thread)
     {
-        sr_gdb_thread_set_libnames(thread, stacktrace->libs);
+        sr_gdb_thread_set_libnames_map(thread, libs_map);
         thread = thread->next;
     }
+
+    sr_address_map_free(libs_map);
 }
 
 char *
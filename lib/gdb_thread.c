@@ -20,12 +20,15 @@
 #include "gdb/thread.h"
 #include "gdb/frame.h"
 #include "gdb/sharedlib.h"
+#include "gdb_parser.h"
+#include "address_map.h"
 #include "normalize.h"
 #include "location.h"
 #include "utils.h"
 #include "generic_thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
@@ -65,7 +68,7 @@ struct thread_methods gdb_thread_methods =
 struct sr_gdb_thread *
 sr_gdb_thread_new()
 {
-    struct sr_gdb_thread *thread = g_malloc(sizeof(*thread));
+    struct sr_gdb_thread *thread = arena_alloc0(sizeof(*thread));
     sr_gdb_thread_init(thread);
     return thread;
 }
@@ -93,7 +96,7 @@ sr_gdb_thread_free(struct sr_gdb_thread *thread)
         sr_gdb_frame_free(frame);
     }
 
-    g_free(thread);
+    arena_free(thread);
 }
 
 struct sr_gdb_thread *
@@ -308,6 +311,15 @@ sr_gdb_thread_append_to_str(struct sr_gdb_thread *thread,
 struct sr_gdb_thread *
 sr_gdb_thread_parse(const char **input,
                     struct sr_location *location)
+{
+    struct gdb_parser parser = { .find_libs = false };
+    return gdb_parser_parse_thread(&parser, input, location);
+}
+
+struct sr_gdb_thread *
+gdb_parser_parse_thread(struct gdb_parser *parser,
+                        const char **input,
+                        struct sr_location *location)
 {
     const char *local_input = *input;
     struct sr_gdb_thread *imthread = sr_gdb_thread_new();
@@ -408,7 +420,7 @@ sr_gdb_thread_parse(const char **input,
     struct sr_gdb_frame *frame, *prevframe = NULL;
     struct sr_location frame_location;
     sr_location_init(&frame_location);
-    while ((frame = sr_gdb_frame_parse(&local_input, &frame_location)))
+    while ((frame = gdb_parser_parse_frame(parser, &local_input, &frame_location)))
     {
         if (prevframe)
         {
@@ -523,12 +535,25 @@ sr_gdb_thread_format_funs(struct sr_gdb_thread *thread)
 
 void
 sr_gdb_thread_set_libnames(struct sr_gdb_thread *thread, struct sr_gdb_sharedlib *libs)
+{
+    struct sr_address_map *libs_map = sr_gdb_sharedlib_address_map(libs);
+    sr_gdb_thread_set_libnames_map(thread, libs_map);
+    sr_address_map_free(libs_map);
+}
+
+void
+sr_gdb_thread_set_libnames_map(struct sr_gdb_thread *thread,
+                               struct sr_address_map *libs_map)
 {
     struct sr_gdb_frame *frame = thread->frames;
     while (frame)
     {
-        struct sr_gdb_sharedlib *lib = sr_gdb_sharedlib_find_address(libs,
-                                                                     frame->address);
+        struct sr_gdb_sharedlib *lib = NULL;
+
+        /* Frames without a known address have it set to UINT64_MAX. */
+        if (frame->address != UINT64_MAX)
+            lib = sr_address_map_find(libs_map, frame->address);
+
         if (lib)
         {
             char *s1, *s2;
@@ -545,8 +570,7 @@ sr_gdb_thread_set_libnames(struct sr_gdb_thread *thread, struct sr_gdb_sharedlib
             else
                 s2 += strlen(".so");
 
-            if (frame->library_name)
-                g_free(frame->library_name);
+            arena_free(frame->library_name);
             frame->library_name = g_strndup(s1, s2 - s1);
         }
         frame = frame->next;
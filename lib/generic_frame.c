@@ -19,6 +19,7 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "report_type.h"
 #include "internal_utils.h"
@@ -75,6 +76,34 @@ sr_frame_cmp_distance(struct sr_frame *frame1, struct sr_frame *frame2)
     return DISPATCH(dtable, frame1->type, cmp_distance)(frame1, frame2);
 }
 
+enum frame_distance_key
+frame_distance_key(struct sr_frame *frame, GString *key,
+                   const char **qualifier)
+{
+    return DISPATCH(dtable, frame->type, distance_key)(frame, key, qualifier);
+}
+
+/* Strings are prefixed by their length so that the key of a frame can't be
+ * confused with the key of another frame by shifting characters between
+ * members. NULL is distinct from an empty string, same as in g_strcmp0. */
+void
+frame_distance_key_append_str(GString *key, const char *str)
+{
+    if (!str)
+    {
+        g_string_append_c(key, '-');
+        return;
+    }
+
+    g_string_append_printf(key, "%zu:%s", strlen(str), str);
+}
+
+void
+frame_distance_key_append_int(GString *key, int value)
+{
+    g_string_append_printf(key, "%d;", value);
+}
+
 void
 frame_append_bthash_text(struct sr_frame *frame, enum sr_bthash_flags flags,
                          GString *strbuf)
@@ -35,6 +35,27 @@ typedef void (*frame_append_duphash_text_fn_t)(struct sr_frame*, enum sr_duphash
                                                GString*);
 typedef void (*frame_free_fn_t)(struct sr_frame*);
 
+/* Result of the distance_key method. */
+enum frame_distance_key
+{
+    /* The frame is described by the key and the qualifier. */
+    FRAME_DISTANCE_KEY,
+    /* The frame is never equal to any other frame. */
+    FRAME_DISTANCE_KEY_UNIQUE,
+    /* The cmp_distance relation cannot be expressed by keys for this
+     * frame, compare it with cmp_distance instead. */
+    FRAME_DISTANCE_KEY_NONE
+};
+
+/* Appends a key of the frame to the string buffer so that cmp_distance
+ * considers two frames equal iff their keys are equal and their qualifiers
+ * are either equal or at least one of them is NULL. The qualifier is
+ * initialized to "" by the caller and may be pointed to a member of the
+ * frame. */
+typedef enum frame_distance_key (*frame_distance_key_fn_t)(struct sr_frame*,
+                                                           GString*,
+                                                           const char**);
+
 struct frame_methods
 {
     append_to_str_fn_t append_to_str;
@@ -42,6 +63,7 @@ struct frame_methods
     set_next_frame_fn_t set_next;
     frame_cmp_fn_t cmp;
     frame_cmp_fn_t cmp_distance;
+    frame_distance_key_fn_t distance_key;
     frame_append_bthash_text_fn_t frame_append_bthash_text;
     frame_append_duphash_text_fn_t frame_append_duphash_text;
     frame_free_fn_t frame_free;
@@ -59,4 +81,14 @@ void
 frame_append_duphash_text(struct sr_frame *frame, enum sr_duphash_flags flags,
                           GString *strbuf);
 
+enum frame_distance_key
+frame_distance_key(struct sr_frame *frame, GString *key,
+                   const char **qualifier);
+
+void
+frame_distance_key_append_str(GString *key, const char *str);
+
+void
+frame_distance_key_append_int(GString *key, int value);
+
 #endif
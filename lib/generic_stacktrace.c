@@ -20,7 +20,9 @@
 
 #include <stdlib.h>
 
+#include "internal_arena.h"
 #include "internal_utils.h"
+#include "arena.h"
 #include "location.h"
 #include "json.h"
 
@@ -132,6 +134,48 @@ sr_stacktrace_from_json_text(enum sr_report_type type, const char *input, char *
     return stacktrace;
 }
 
+struct sr_stacktrace *
+sr_arena_stacktrace_parse(struct sr_arena *arena,
+                          enum sr_report_type type,
+                          const char *input,
+                          char **error_message)
+{
+    struct sr_arena *previous = arena_enter(arena);
+    struct sr_stacktrace *stacktrace =
+        DISPATCH(dtable, type, parse)(input, error_message);
+
+    arena_enter(previous);
+    return stacktrace;
+}
+
+struct sr_stacktrace *
+sr_arena_stacktrace_from_json(struct sr_arena *arena,
+                              enum sr_report_type type,
+                              json_object *root,
+                              char **error_message)
+{
+    struct sr_arena *previous = arena_enter(arena);
+    struct sr_stacktrace *stacktrace =
+        DISPATCH(dtable, type, from_json)(root, error_message);
+
+    arena_enter(previous);
+    return stacktrace;
+}
+
+struct sr_stacktrace *
+sr_arena_stacktrace_from_json_text(struct sr_arena *arena,
+                                   enum sr_report_type type,
+                                   const char *input,
+                                   char **error_message)
+{
+    struct sr_arena *previous = arena_enter(arena);
+    struct sr_stacktrace *stacktrace =
+        sr_stacktrace_from_json_text(type, input, error_message);
+
+    arena_enter(previous);
+    return stacktrace;
+}
+
 char *
 sr_stacktrace_to_short_text(struct sr_stacktrace *stacktrace, int max_frames)
 {
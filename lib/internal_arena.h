@@ -0,0 +1,64 @@
+/*
+    internal_arena.h
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef SATYR_INTERNAL_ARENA_H
+#define SATYR_INTERNAL_ARENA_H
+
+#include <glib.h>
+#include <stddef.h>
+
+struct sr_arena;
+
+/* Makes the functions below allocate from the arena in the calling
+ * thread, or from the heap if arena is NULL. Returns the arena used
+ * before, which must be restored by another call when done.
+ *
+ * The stack traces, threads, frames and the strings they own are
+ * allocated by these functions. Memory allocated by them, or by the
+ * GLib allocator, must be released by arena_free(), which does nothing
+ * for memory of any live arena and calls g_free() for the rest.
+ */
+struct sr_arena *
+arena_enter(struct sr_arena *arena);
+
+void *
+arena_alloc0(size_t size);
+
+#define arena_new0(struct_type, n_structs) \
+    ((struct_type *)arena_alloc0(sizeof(struct_type) * (n_structs)))
+
+char *
+arena_strdup(const char *str);
+
+char *
+arena_strndup(const char *str, size_t n);
+
+/* Frees the string and returns its characters, like
+ * g_string_free(string, FALSE). */
+char *
+arena_string_free(GString *string);
+
+void
+arena_free(void *mem);
+
+/* Frees the NULL-terminated array of strings, like g_strfreev(). */
+void
+arena_strfreev(char **strv);
+
+#endif
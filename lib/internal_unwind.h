@@ -69,6 +69,22 @@ struct exe_mapping_data
     struct exe_mapping_data *next;
 };
 
+/* Results of the lookups made when resolving frames of a single Dwfl
+ * session. The threads of a process mostly share their modules and
+ * functions, so every module, address and symbol is looked up once. The
+ * cache is not thread-safe, it belongs to the session. */
+struct frame_cache
+{
+    /* Shares the functions between cores, NULL if there is no session. */
+    struct sr_unwind_session *session;
+    /* Dwfl_Module * -> struct resolved_module */
+    GHashTable *modules;
+    /* Dwarf_Addr -> struct resolved_address */
+    GHashTable *addresses;
+    /* Symbol name -> demangled function name */
+    GHashTable *functions;
+};
+
 struct core_handle
 {
     int fd;
@@ -76,22 +92,70 @@ struct core_handle
     Dwfl *dwfl;
     Dwfl_Callbacks cb;
     struct exe_mapping_data *segments;
+    char *exe_file;
+    /* NULL if the coredump is not opened within a session. */
+    struct sr_unwind_session *session;
+    struct frame_cache *frame_cache;
 };
 
 /* Gets dwfl handle and executable map data to be used for unwinding. The
  * executable map is only used by libunwind. */
 struct core_handle *
-open_coredump(const char *elf_file, const char *exe_file, char **error_msg);
+open_coredump(const char *elf_file, const char *exe_file,
+              struct sr_unwind_session *session, char **error_msg);
+
+/* Like open_coredump(), the coredump is read from the memory of the
+ * image, which must outlive the handle. The name is used in messages. */
+struct core_handle *
+open_coredump_image(const char *name, char *image, size_t image_size,
+                    const char *exe_file, struct sr_unwind_session *session,
+                    char **error_msg);
 
 void
 core_handle_free(struct core_handle *ch);
 
+struct sr_core_stream;
+
+/* Reads the coredump from the stream into a memory image for
+ * open_coredump_image(). The image contains the notes and the memory
+ * segments that are not larger than segment_limit or that the registers
+ * of the threads point into, the other segments are left out as if they
+ * were not dumped. Zero segment_limit keeps all segments. Images larger
+ * than image_limit are rejected, zero means no limit. */
+bool
+read_core_image(struct sr_core_stream *stream, uint64_t segment_limit,
+                uint64_t image_limit, char **image, size_t *image_size,
+                char **error_msg);
+
+struct frame_cache *
+frame_cache_new(struct sr_unwind_session *session);
+
+void
+frame_cache_free(struct frame_cache *cache);
+
+/* The strings of the returned frame are copies of the cached ones. */
 struct sr_core_frame *
-resolve_frame(Dwfl *dwfl, Dwarf_Addr ip, bool minus_one);
+resolve_frame(Dwfl *dwfl, struct frame_cache *cache, Dwarf_Addr ip,
+              bool minus_one);
+
+bool
+unwind_session_lookup_function(struct sr_unwind_session *session,
+                               const char *build_id, uint64_t offset,
+                               const char **function_name);
+
+const char *
+unwind_session_store_function(struct sr_unwind_session *session,
+                              const char *build_id, uint64_t offset,
+                              const char *function_name);
 
 short
 get_signal_number(Elf *e, const char *elf_file);
 
+/* Returns the signal like get_signal_number() and sets tid to the thread
+ * that received it. The tid is left untouched if there is no signal. */
+short
+get_crash_thread(Elf *e, const char *elf_file, pid_t *tid);
+
 int
 find_debuginfo_none (Dwfl_Module *mod, void **userdata, const char *modname,
                      GElf_Addr base, const char *file_name,
@@ -26,6 +26,7 @@
 #include "thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <string.h>
 #include <ctype.h>
 #include <inttypes.h>
@@ -41,6 +42,9 @@ java_append_bthash_text(struct sr_java_frame *frame, enum sr_bthash_flags flags,
 static void
 java_append_duphash_text(struct sr_java_frame *frame, enum sr_duphash_flags flags,
                          GString *strbuf);
+static enum frame_distance_key
+java_distance_key(struct sr_java_frame *frame, GString *key,
+                  const char **qualifier);
 
 DEFINE_NEXT_FUNC(java_next, struct sr_frame, struct sr_java_frame)
 DEFINE_SET_NEXT_FUNC(java_set_next, struct sr_frame, struct sr_java_frame)
@@ -52,6 +56,7 @@ struct frame_methods java_frame_methods =
     .set_next = (set_next_frame_fn_t) java_set_next,
     .cmp = (frame_cmp_fn_t) sr_java_frame_cmp,
     .cmp_distance = (frame_cmp_fn_t) sr_java_frame_cmp_distance,
+    .distance_key = (frame_distance_key_fn_t) java_distance_key,
     .frame_append_bthash_text =
         (frame_append_bthash_text_fn_t) java_append_bthash_text,
     .frame_append_duphash_text =
@@ -65,7 +70,7 @@ struct sr_java_frame *
 sr_java_frame_new()
 {
     struct sr_java_frame *frame =
-        g_malloc(sizeof(*frame));
+        arena_alloc0(sizeof(*frame));
 
     sr_java_frame_init(frame);
     return frame;
@@ -75,7 +80,7 @@ struct sr_java_frame *
 sr_java_frame_new_exception()
 {
     struct sr_java_frame *frame =
-        g_malloc(sizeof(*frame));
+        arena_alloc0(sizeof(*frame));
 
     sr_java_frame_init(frame);
     frame->is_exception = true;
@@ -95,11 +100,11 @@ sr_java_frame_free(struct sr_java_frame *frame)
     if (!frame)
         return;
 
-    g_free(frame->file_name);
-    g_free(frame->name);
-    g_free(frame->class_path);
-    g_free(frame->message);
-    g_free(frame);
+    arena_free(frame->file_name);
+    arena_free(frame->name);
+    arena_free(frame->class_path);
+    arena_free(frame->message);
+    arena_free(frame);
 }
 
 void
@@ -194,6 +199,14 @@ sr_java_frame_cmp_distance(struct sr_java_frame *frame1,
     return 0;
 }
 
+static enum frame_distance_key
+java_distance_key(struct sr_java_frame *frame, GString *key,
+                  const char **qualifier)
+{
+    frame_distance_key_append_str(key, frame->name);
+    return FRAME_DISTANCE_KEY;
+}
+
 struct sr_java_frame *
 sr_java_frame_append(struct sr_java_frame *dest,
                      struct sr_java_frame *item)
@@ -290,7 +303,7 @@ sr_java_frame_parse_exception(const char **input,
     }
 
     struct sr_java_frame *exception = sr_java_frame_new_exception();
-    exception->name = g_strndup(mark, cursor - mark);
+    exception->name = arena_strndup(mark, cursor - mark);
 
     /* : foo */
     if (*cursor == ':')
@@ -307,7 +320,7 @@ sr_java_frame_parse_exception(const char **input,
         sr_location_add(location, 0, sr_skip_char_cspan(&cursor, "\n"));
 
         if (mark != cursor)
-            exception->message = g_strndup(mark, cursor - mark);
+            exception->message = arena_strndup(mark, cursor - mark);
     }
     else
     {
@@ -468,7 +481,7 @@ const char *sr_java_frame_parse_frame_url(struct sr_java_frame *frame, const cha
 
         if (mark != cursor)
         {
-            frame->class_path = g_strndup(mark, cursor - mark);
+            frame->class_path = arena_strndup(mark, cursor - mark);
             frame->class_path = anonymize_path(frame->class_path);
         }
     }
@@ -508,7 +521,7 @@ sr_java_frame_parse(const char **input,
     struct sr_java_frame *frame = sr_java_frame_new();
 
     if (cursor != mark)
-        frame->name = g_strndup(mark, cursor - mark);
+        frame->name = arena_strndup(mark, cursor - mark);
 
     /* (SimpleTest.java:36) [file:/usr/lib/java/foo.class] */
     if (*cursor == '(')
@@ -526,7 +539,7 @@ sr_java_frame_parse(const char **input,
             else if (!sr_java_frame_parse_is_unknown_source(mark))
             {
                 /* DO NOT set file_name if input says that source isn't known */
-                frame->file_name = g_strndup(mark, cursor - mark);
+                frame->file_name = arena_strndup(mark, cursor - mark);
                 frame->file_name = anonymize_path(frame->file_name);
             }
         }
@@ -25,6 +25,7 @@
 #include "json.h"
 #include "generic_stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
@@ -65,7 +66,7 @@ struct sr_java_stacktrace *
 sr_java_stacktrace_new()
 {
     struct sr_java_stacktrace *stacktrace =
-        g_malloc(sizeof(*stacktrace));
+        arena_alloc0(sizeof(*stacktrace));
 
     sr_java_stacktrace_init(stacktrace);
     return stacktrace;
@@ -91,7 +92,7 @@ sr_java_stacktrace_free(struct sr_java_stacktrace *stacktrace)
         sr_java_thread_free(thread);
     }
 
-    g_free(stacktrace);
+    arena_free(stacktrace);
 }
 
 struct sr_java_stacktrace *
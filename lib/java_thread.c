@@ -26,6 +26,7 @@
 #include "generic_thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
@@ -66,7 +67,7 @@ struct sr_java_thread *
 sr_java_thread_new()
 {
     struct sr_java_thread *thread =
-        g_malloc(sizeof(*thread));
+        arena_alloc0(sizeof(*thread));
     sr_java_thread_init(thread);
     return thread;
 }
@@ -88,8 +89,8 @@ sr_java_thread_free(struct sr_java_thread *thread)
 
     sr_java_frame_free_full(thread->frames);
 
-    g_free(thread->name);
-    g_free(thread);
+    arena_free(thread->name);
+    arena_free(thread);
 }
 
 struct sr_java_thread *
@@ -325,7 +326,7 @@ sr_java_thread_parse(const char **input,
             return NULL;
         }
 
-        thread->name = g_strndup(mark, cursor - mark);
+        thread->name = arena_strndup(mark, cursor - mark);
 
         sr_location_eat_char(location, *(++cursor));
     }
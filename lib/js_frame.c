@@ -25,6 +25,7 @@
 #include "thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <string.h>
 #include <inttypes.h>
 #include <ctype.h>
@@ -37,6 +38,9 @@ js_append_bthash_text(struct sr_js_frame *frame, enum sr_bthash_flags flags,
 static void
 js_append_duphash_text(struct sr_js_frame *frame, enum sr_duphash_flags flags,
                        GString *strbuf);
+static enum frame_distance_key
+js_distance_key(struct sr_js_frame *frame, GString *key,
+                const char **qualifier);
 
 DEFINE_NEXT_FUNC(js_next, struct sr_frame, struct sr_js_frame)
 DEFINE_SET_NEXT_FUNC(js_set_next, struct sr_frame, struct sr_js_frame)
@@ -48,6 +52,7 @@ struct frame_methods js_frame_methods =
     .set_next = (set_next_frame_fn_t) js_set_next,
     .cmp = (frame_cmp_fn_t) sr_js_frame_cmp,
     .cmp_distance = (frame_cmp_fn_t) sr_js_frame_cmp_distance,
+    .distance_key = (frame_distance_key_fn_t) js_distance_key,
     .frame_append_bthash_text =
         (frame_append_bthash_text_fn_t) js_append_bthash_text,
     .frame_append_duphash_text =
@@ -66,7 +71,7 @@ struct sr_js_frame *
 sr_js_frame_new()
 {
     struct sr_js_frame *frame =
-        g_malloc(sizeof(*frame));
+        arena_alloc0(sizeof(*frame));
 
     sr_js_frame_init(frame);
     return frame;
@@ -85,9 +90,9 @@ sr_js_frame_free(struct sr_js_frame *frame)
     if (!frame)
         return;
 
-    g_free(frame->file_name);
-    g_free(frame->function_name);
-    g_free(frame);
+    arena_free(frame->file_name);
+    arena_free(frame->function_name);
+    arena_free(frame);
 }
 
 struct sr_js_frame *
@@ -168,6 +173,16 @@ sr_js_frame_cmp_distance(struct sr_js_frame *frame1,
     return 0;
 }
 
+static enum frame_distance_key
+js_distance_key(struct sr_js_frame *frame, GString *key,
+                const char **qualifier)
+{
+    frame_distance_key_append_int(key, frame->file_line);
+    frame_distance_key_append_str(key, frame->function_name);
+    frame_distance_key_append_str(key, frame->file_name);
+    return FRAME_DISTANCE_KEY;
+}
+
 struct sr_js_frame *
 sr_js_frame_append(struct sr_js_frame *dest,
                    struct sr_js_frame *item)
@@ -245,7 +260,7 @@ sr_js_frame_parse_v8(const char **input,
         /* Object.<anonymous> ([stdin]-wrapper:6:22)
          * ^^^^^^^^^^^^^^^^^^
          */
-        frame->function_name = g_strndup(name_beg, columns);
+        frame->function_name = arena_strndup(name_beg, columns);
 
         sr_location_add(location, 0, columns);
 
@@ -342,7 +357,7 @@ sr_js_frame_parse_v8(const char **input,
     /* bootstrap_node.js:357:29
      * ^^^^^^^^^^^^^^^^^
      */
-    frame->file_name = g_strndup(local_input, token - local_input);
+    frame->file_name = arena_strndup(local_input, token - local_input);
     frame->file_name = anonymize_path(frame->file_name);
 
     location->column += sr_skip_char_cspan(&local_input, "\n");
@@ -389,7 +404,7 @@ sr_js_frame_from_json(json_object *root, char **error_message)
 
         string = json_object_get_string(val);
 
-        result->file_name = g_strdup(string);
+        result->file_name = arena_strdup(string);
     }
 
     /* Function name. */
@@ -402,7 +417,7 @@ sr_js_frame_from_json(json_object *root, char **error_message)
 
         string = json_object_get_string(val);
 
-        result->function_name = g_strdup(string);
+        result->function_name = arena_strdup(string);
     }
 
     bool success =
@@ -24,6 +24,7 @@
 
 #include "utils.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include "json.h"
 
 #include <string.h>
@@ -234,8 +235,8 @@ sr_js_platform_from_json(json_object *root, char **error_message)
     sr_js_platform_init(platform, engine, runtime);
 
 fail:
-    g_free(engine_str);
-    g_free(runtime_str);
+    arena_free(engine_str);
+    arena_free(runtime_str);
     return platform;
 }
 
@@ -27,6 +27,7 @@
 #include "generic_stacktrace.h"
 #include "generic_thread.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -82,7 +83,7 @@ struct sr_js_stacktrace *
 sr_js_stacktrace_new()
 {
     struct sr_js_stacktrace *stacktrace =
-        g_malloc(sizeof(*stacktrace));
+        arena_alloc0(sizeof(*stacktrace));
 
     sr_js_stacktrace_init(stacktrace);
     return stacktrace;
@@ -108,8 +109,8 @@ sr_js_stacktrace_free(struct sr_js_stacktrace *stacktrace)
         sr_js_frame_free(frame);
     }
 
-    g_free(stacktrace->exception_name);
-    g_free(stacktrace);
+    arena_free(stacktrace->exception_name);
+    arena_free(stacktrace);
 }
 
 struct sr_js_stacktrace *
@@ -24,6 +24,7 @@
 #include "thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -37,6 +38,9 @@ koops_append_bthash_text(struct sr_koops_frame *frame, enum sr_bthash_flags flag
 static void
 koops_append_duphash_text(struct sr_koops_frame *frame, enum sr_duphash_flags flags,
                           GString *strbuf);
+static enum frame_distance_key
+koops_distance_key(struct sr_koops_frame *frame, GString *key,
+                   const char **qualifier);
 
 DEFINE_NEXT_FUNC(koops_next, struct sr_frame, struct sr_koops_frame)
 DEFINE_SET_NEXT_FUNC(koops_set_next, struct sr_frame, struct sr_koops_frame)
@@ -48,6 +52,7 @@ struct frame_methods koops_frame_methods =
     .set_next = (set_next_frame_fn_t) koops_set_next,
     .cmp = (frame_cmp_fn_t) sr_koops_frame_cmp,
     .cmp_distance = (frame_cmp_fn_t) sr_koops_frame_cmp_distance,
+    .distance_key = (frame_distance_key_fn_t) koops_distance_key,
     .frame_append_bthash_text =
         (frame_append_bthash_text_fn_t) koops_append_bthash_text,
     .frame_append_duphash_text =
@@ -61,7 +66,7 @@ struct sr_koops_frame *
 sr_koops_frame_new()
 {
     struct sr_koops_frame *frame =
-        g_malloc(sizeof(*frame));
+        arena_alloc0(sizeof(*frame));
 
     sr_koops_frame_init(frame);
     return frame;
@@ -80,12 +85,12 @@ sr_koops_frame_free(struct sr_koops_frame *frame)
     if (!frame)
         return;
 
-    g_free(frame->function_name);
-    g_free(frame->module_name);
-    g_free(frame->from_function_name);
-    g_free(frame->from_module_name);
-    g_free(frame->special_stack);
-    g_free(frame);
+    arena_free(frame->function_name);
+    arena_free(frame->module_name);
+    arena_free(frame->from_function_name);
+    arena_free(frame->from_module_name);
+    arena_free(frame->special_stack);
+    arena_free(frame);
 }
 
 struct sr_koops_frame *
@@ -212,6 +217,14 @@ sr_koops_frame_cmp_distance(struct sr_koops_frame *frame1,
     return 0;
 }
 
+static enum frame_distance_key
+koops_distance_key(struct sr_koops_frame *frame, GString *key,
+                   const char **qualifier)
+{
+    frame_distance_key_append_str(key, frame->function_name);
+    return FRAME_DISTANCE_KEY;
+}
+
 struct sr_koops_frame *
 sr_koops_frame_append(struct sr_koops_frame *dest,
                       struct sr_koops_frame *item)
@@ -508,7 +521,7 @@ sr_koops_parse_module_name(const char **input,
 
     if (!sr_skip_char(&local_input, ']'))
     {
-        g_free(*module_name);
+        arena_free(*module_name);
         *module_name = NULL;
         return false;
     }
@@ -553,7 +566,7 @@ sr_koops_parse_function(const char **input,
 
         if (!sr_skip_char(&local_input, '/'))
         {
-            g_free(*function_name);
+            arena_free(*function_name);
             *function_name = NULL;
             return false;
         }
@@ -574,11 +587,11 @@ sr_koops_parse_function(const char **input,
 
     if (parenthesis && !sr_skip_char(&local_input, ')'))
     {
-        g_free(*function_name);
+        arena_free(*function_name);
         *function_name = NULL;
         if (has_module)
         {
-            g_free(*module_name);
+            arena_free(*module_name);
             *module_name = NULL;
         }
 
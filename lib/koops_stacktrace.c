@@ -25,8 +25,11 @@
 #include "generic_thread.h"
 #include "generic_stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
+#include <errno.h>
 #include <string.h>
 #include <stddef.h>
+#include <unistd.h>
 
 /* http://git.kernel.org/cgit/linux/kernel/git/torvalds/linux.git/plain/kernel/panic.c?id=HEAD */
 
@@ -105,7 +108,7 @@ struct sr_koops_stacktrace *
 sr_koops_stacktrace_new()
 {
     struct sr_koops_stacktrace *stacktrace =
-        g_malloc(sizeof(*stacktrace));
+        arena_alloc0(sizeof(*stacktrace));
 
     sr_koops_stacktrace_init(stacktrace);
     return stacktrace;
@@ -131,12 +134,12 @@ sr_koops_stacktrace_free(struct sr_koops_stacktrace *stacktrace)
         sr_koops_frame_free(frame);
     }
 
-    g_strfreev(stacktrace->modules);
+    arena_strfreev(stacktrace->modules);
 
-    g_free(stacktrace->version);
-    g_free(stacktrace->raw_oops);
-    g_free(stacktrace->reason);
-    g_free(stacktrace);
+    arena_free(stacktrace->version);
+    arena_free(stacktrace->raw_oops);
+    arena_free(stacktrace->reason);
+    arena_free(stacktrace);
 }
 
 struct sr_koops_stacktrace *
@@ -320,7 +323,7 @@ parse_alt_stack_start(const char **input)
         !sr_parse_char_cspan(&local_input, "> \t\n", &stack_label) ||
         !sr_skip_char(&local_input, '>'))
     {
-        g_free(stack_label);
+        arena_free(stack_label);
         return NULL;
     }
 
@@ -328,9 +331,12 @@ parse_alt_stack_start(const char **input)
     return stack_label;
 }
 
-struct sr_koops_stacktrace *
-sr_koops_stacktrace_parse(const char **input,
-                          struct sr_location *location)
+/* Parses the kernel oops and takes the ownership of its raw text, which
+ * must be the same as the input.
+ */
+static struct sr_koops_stacktrace *
+koops_stacktrace_parse_raw(const char **input,
+                           char *raw_oops)
 {
     const char *local_input = *input;
 
@@ -340,13 +346,13 @@ sr_koops_stacktrace_parse(const char **input,
     char *alt_stack = NULL;
 
     /* Include the raw kerneloops text */
-    stacktrace->raw_oops = g_strdup(*input);
+    stacktrace->raw_oops = raw_oops;
 
     /* Looks for the "Tainted: " line in the whole input */
     parse_taint_flags(local_input, stacktrace);
 
     /* The "reason" is expected to be the first line of the input */
-    stacktrace->reason = g_strndup(*input, strcspn(*input, "\n"));
+    stacktrace->reason = arena_strndup(*input, strcspn(*input, "\n"));
 
     while (*local_input)
     {
@@ -383,7 +389,7 @@ sr_koops_stacktrace_parse(const char **input,
         /* <IRQ>, <NMI>, ... */
         if (parse_alt_stack_end(&local_input))
         {
-            g_free(alt_stack);
+            arena_free(alt_stack);
             alt_stack = NULL;
         }
 
@@ -397,7 +403,7 @@ sr_koops_stacktrace_parse(const char **input,
         if((frame = sr_koops_frame_parse(&local_input)))
         {
             if (alt_stack)
-                frame->special_stack = g_strdup(alt_stack);
+                frame->special_stack = arena_strdup(alt_stack);
 
             stacktrace->frames = sr_koops_frame_append(stacktrace->frames, frame);
             goto next_line;
@@ -409,12 +415,19 @@ next_line:
         sr_skip_char(&local_input, '\n');
     }
     if (alt_stack)
-        g_free(alt_stack);
+        arena_free(alt_stack);
 
     *input = local_input;
     return stacktrace;
 }
 
+struct sr_koops_stacktrace *
+sr_koops_stacktrace_parse(const char **input,
+                          struct sr_location *location)
+{
+    return koops_stacktrace_parse_raw(input, arena_strdup(*input));
+}
+
 static bool
 module_list_continues(const char *input)
 {
@@ -462,24 +475,14 @@ sr_koops_stacktrace_parse_modules(const char **input)
 
     int ws = sr_skip_char_span(&local_input, " \t");
 
-    int result_size = 20, result_offset = 0;
-    char **result = g_malloc_n(result_size, sizeof(char*));
+    GPtrArray *modules = g_ptr_array_new();
 
     char *module;
     while (true)
     {
         if (sr_parse_char_cspan(&local_input, " \t\n[", &module))
         {
-            // result_size is lowered by 1 because we need to terminate
-            // the list by a NULL pointer.
-            if (result_offset == result_size - 1)
-            {
-                result_size *= 2;
-                result = g_realloc_n(result, result_size, sizeof(char*));
-            }
-
-            result[result_offset] = module;
-            ++result_offset;
+            g_ptr_array_add(modules, module);
             ws = sr_skip_char_span(&local_input, " \t");
         }
         else if(*local_input == '\n')
@@ -494,7 +497,7 @@ sr_koops_stacktrace_parse_modules(const char **input)
             /* If the next line does not start with space and there wasn't
              * any space before the newline either, then the last module was
              * split into two parts and we need to read the rest */
-            if (*local_input != ' ' && ws == 0 && result_offset > 0)
+            if (*local_input != ' ' && ws == 0 && modules->len > 0)
             {
                 char *therest;
                 if (!sr_parse_char_cspan(&local_input, " \t\n[", &therest))
@@ -502,9 +505,12 @@ sr_koops_stacktrace_parse_modules(const char **input)
                     break; /* wtf? */
                 }
 
-                char *tmp = g_strdup_printf("%s%s", result[result_offset-1], therest);
-                g_free(result[result_offset-1]);
-                result[result_offset-1] = tmp;
+                char **last = (char **)&g_ptr_array_index(modules, modules->len - 1);
+                GString *joined = g_string_new(*last);
+                g_string_append(joined, therest);
+                arena_free(*last);
+                arena_free(therest);
+                *last = arena_string_free(joined);
             }
 
             ws = sr_skip_char_span(&local_input, " \t");
@@ -513,7 +519,13 @@ sr_koops_stacktrace_parse_modules(const char **input)
             break;
     }
 
-    result[result_offset] = NULL;
+    /* The array ends with the NULL pointer. */
+    char **result = arena_new0(char *, modules->len + 1);
+    for (guint i = 0; i < modules->len; i++)
+        result[i] = g_ptr_array_index(modules, i);
+
+    g_ptr_array_free(modules, TRUE);
+
     *input = local_input;
     return result;
 }
@@ -695,8 +707,9 @@ sr_koops_stacktrace_from_json(json_object *root, char **error_message)
 
         array_length = json_object_array_length(modules);
 
-        size_t allocated = 128;
-        result->modules = g_malloc_n(allocated, sizeof(char*));
+        /* The rest of the array is the NULL terminator, also when
+         * reading it fails. */
+        result->modules = arena_new0(char *, array_length + 1);
 
         for (i = 0; i < array_length; i++)
         {
@@ -709,17 +722,8 @@ sr_koops_stacktrace_from_json(json_object *root, char **error_message)
                 goto fail;
 
             module = json_object_get_string(mod_json);
-
-            /* need to keep the last element for NULL terminator */
-            if (i + 1 == allocated)
-            {
-                allocated *= 2;
-                result->modules = g_realloc(result->modules, allocated);
-            }
-            result->modules[i] = g_strdup(module);
+            result->modules[i] = arena_strdup(module);
         }
-
-        result->modules[i] = NULL;
     }
 
     /* Frames. */
@@ -877,3 +881,333 @@ sr_normalize_koops_stacktrace(struct sr_koops_stacktrace *stacktrace)
         frame = next_frame;
     }
 }
+
+/* The longest line kept, the rest of longer lines is skipped. */
+#define KOOPS_STREAM_LINE_MAX (64 * 1024)
+/* The longest oops text kept, the rest of longer oopses is skipped. */
+#define KOOPS_STREAM_OOPS_MAX (1024 * 1024)
+/* The lines of an oops without any call trace, after which another
+ * problem reported starts a new oops. */
+#define KOOPS_STREAM_HEADER_LINES 100
+
+struct sr_koops_stream
+{
+    ssize_t (*read)(void *data, void *buffer, size_t size);
+    void *data;
+    int fd;
+
+    /* The block of the log read, with room for a terminating NUL. */
+    char buffer[KOOPS_STREAM_LINE_MAX + 1];
+    size_t buffer_start;
+    size_t buffer_end;
+    bool eof;
+    /* Whether the rest of a line longer than the buffer is to be
+     * skipped. */
+    bool skip_line;
+
+    /* The text of the oops being extracted, NULL between oopses. */
+    GString *oops;
+    unsigned oops_lines;
+    bool oops_call_trace;
+};
+
+/* Problems reported by the kernel, which start an oops. They must be at
+ * the start of the message, so that e.g. "DEBUG " does not match "BUG ". */
+static const char *const koops_start_markers[] =
+{
+    "BUG:",
+    "BUG ",
+    "WARNING:",
+    "Oops:",
+    "Oops - ",
+    "general protection fault",
+    "kernel BUG at",
+    "Unable to handle kernel",
+    "Kernel panic - not syncing",
+    "INFO: ",
+    "Badness at",
+    "double fault:",
+    "do_IRQ: stack overflow",
+    "NETDEV WATCHDOG",
+};
+
+static const char *const koops_call_trace_markers[] =
+{
+    "Call Trace:",
+    "Call trace:",
+    "Backtrace:",
+    "stack backtrace:",
+};
+
+static ssize_t
+koops_stream_fd_read(void *data, void *buffer, size_t size)
+{
+    struct sr_koops_stream *stream = data;
+    ssize_t ret;
+
+    do
+        ret = read(stream->fd, buffer, size);
+    while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+
+struct sr_koops_stream *
+sr_koops_stream_new(ssize_t (*read)(void *data, void *buffer, size_t size),
+                    void *data)
+{
+    struct sr_koops_stream *stream = g_malloc0(sizeof(*stream));
+
+    stream->read = read;
+    stream->data = data;
+    stream->fd = -1;
+
+    return stream;
+}
+
+struct sr_koops_stream *
+sr_koops_stream_new_fd(int fd)
+{
+    struct sr_koops_stream *stream = sr_koops_stream_new(koops_stream_fd_read,
+                                                         NULL);
+    stream->data = stream;
+    stream->fd = fd;
+
+    return stream;
+}
+
+void
+sr_koops_stream_free(struct sr_koops_stream *stream)
+{
+    if (!stream)
+        return;
+
+    if (stream->oops)
+        g_string_free(stream->oops, TRUE);
+
+    g_free(stream);
+}
+
+/* Returns the next line of the log without the newline, terminated by
+ * NUL in the buffer, or NULL at the end of the log or on error. */
+static char *
+koops_stream_read_line(struct sr_koops_stream *stream,
+                       char **error_message)
+{
+    for (;;)
+    {
+        char *start = stream->buffer + stream->buffer_start;
+        size_t size = stream->buffer_end - stream->buffer_start;
+        char *newline = memchr(start, '\n', size);
+
+        if (newline)
+        {
+            *newline = '\0';
+            stream->buffer_start += newline - start + 1;
+
+            if (stream->skip_line)
+            {
+                stream->skip_line = false;
+                continue;
+            }
+
+            return start;
+        }
+
+        if (stream->skip_line)
+        {
+            stream->buffer_start = stream->buffer_end = 0;
+            size = 0;
+        }
+
+        /* The last line does not end with a newline, or the line does
+         * not fit into the buffer. */
+        if ((stream->eof && size > 0) || size == KOOPS_STREAM_LINE_MAX)
+        {
+            start[size] = '\0';
+            stream->buffer_start = stream->buffer_end = 0;
+            stream->skip_line = !stream->eof;
+            return start;
+        }
+
+        if (stream->eof)
+            return NULL;
+
+        memmove(stream->buffer, start, size);
+        stream->buffer_start = 0;
+        stream->buffer_end = size;
+
+        ssize_t ret = stream->read(stream->data,
+                                   stream->buffer + stream->buffer_end,
+                                   KOOPS_STREAM_LINE_MAX - stream->buffer_end);
+        if (ret < 0)
+        {
+            *error_message = g_strdup_printf("Unable to read the kernel log: %s",
+                                             strerror(errno));
+            return NULL;
+        }
+
+        if (ret == 0)
+            stream->eof = true;
+
+        stream->buffer_end += ret;
+    }
+}
+
+static bool
+koops_line_has_marker(const char *line,
+                      const char *const *markers,
+                      size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strstr(line, markers[i]))
+            return true;
+    }
+
+    return false;
+}
+
+/* Skips the printk level and the timestamp and caller id in brackets,
+ * which precede the message: "<4>[   12.345678] [  T123] BUG: ..." */
+static const char *
+koops_line_message(const char *line)
+{
+    if (line[0] == '<' && g_ascii_isdigit(line[1]) && line[2] == '>')
+        line += 3;
+
+    while (*line == '[')
+    {
+        size_t length = strspn(line + 1, " .0123456789CT");
+
+        if (line[length + 1] != ']')
+            break;
+
+        line += length + 2;
+        line += strspn(line, " ");
+    }
+
+    return line;
+}
+
+static bool
+koops_line_starts_with_marker(const char *line,
+                              const char *const *markers,
+                              size_t count)
+{
+    const char *message = koops_line_message(line);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (g_str_has_prefix(message, markers[i]))
+            return true;
+    }
+
+    return false;
+}
+
+static void
+koops_stream_start(struct sr_koops_stream *stream)
+{
+    stream->oops = g_string_sized_new(4096);
+    stream->oops_lines = 0;
+    stream->oops_call_trace = false;
+}
+
+static void
+koops_stream_append(struct sr_koops_stream *stream,
+                    const char *line)
+{
+    size_t length = strlen(line);
+
+    if (stream->oops->len + length + 1 > KOOPS_STREAM_OOPS_MAX)
+        return;
+
+    g_string_append_len(stream->oops, line, length);
+    g_string_append_c(stream->oops, '\n');
+    stream->oops_lines++;
+
+    if (!stream->oops_call_trace)
+    {
+        stream->oops_call_trace =
+            koops_line_has_marker(line, koops_call_trace_markers,
+                                  G_N_ELEMENTS(koops_call_trace_markers));
+    }
+}
+
+/* Parses the oops extracted, if any, and starts looking for the next
+ * one. */
+static struct sr_koops_stacktrace *
+koops_stream_finish(struct sr_koops_stream *stream)
+{
+    GString *oops = stream->oops;
+
+    stream->oops = NULL;
+    if (oops->len == 0)
+    {
+        g_string_free(oops, TRUE);
+        return NULL;
+    }
+
+    char *raw_oops = g_string_free(oops, FALSE);
+    const char *input = raw_oops;
+
+    return koops_stacktrace_parse_raw(&input, raw_oops);
+}
+
+struct sr_koops_stacktrace *
+sr_koops_stream_next(struct sr_koops_stream *stream,
+                     char **error_message)
+{
+    const char *line;
+
+    while ((line = koops_stream_read_line(stream, error_message)))
+    {
+        /* Remove the prefix of journalctl and syslog:
+         * "Oct 17 10:00:00 hostname kernel: " */
+        const char *kernel = strstr(line, " kernel: ");
+        if (kernel && kernel - line < 64)
+            line = kernel + strlen(" kernel: ");
+
+        bool cut_here = strstr(line, "[ cut here ]");
+        bool start = cut_here ||
+            koops_line_starts_with_marker(line, koops_start_markers,
+                                          G_N_ELEMENTS(koops_start_markers));
+
+        if (stream->oops && start &&
+            (stream->oops_call_trace ||
+             stream->oops_lines >= KOOPS_STREAM_HEADER_LINES))
+        {
+            /* Another problem reported after the call trace. */
+            struct sr_koops_stacktrace *stacktrace = koops_stream_finish(stream);
+
+            koops_stream_start(stream);
+            if (!cut_here)
+                koops_stream_append(stream, line);
+
+            return stacktrace;
+        }
+
+        if (!stream->oops)
+        {
+            if (!start)
+                continue;
+
+            koops_stream_start(stream);
+        }
+
+        if (cut_here)
+            continue;
+
+        koops_stream_append(stream, line);
+
+        if (strstr(line, "---[ end trace"))
+            return koops_stream_finish(stream);
+    }
+
+    /* The last oops ends with the log. */
+    if (stream->oops && stream->eof)
+        return koops_stream_finish(stream);
+
+    return NULL;
+}
@@ -0,0 +1,399 @@
+/*
+    lsh.c
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "lsh.h"
+#include "distance.h"
+#include "frame.h"
+#include "thread.h"
+#include "generic_frame.h"
+#include "internal_utils.h"
+#include <glib.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Maximal number of hash functions of a signature. */
+#define LSH_MAX_HASHES 128
+
+/* Recall the parameters are chosen for at the threshold distance. */
+#define LSH_RECALL 0.95
+
+/* Stored threads falling into a bucket form a linked list of entries. */
+struct lsh_entry
+{
+    int thread;
+    /* Index of the next entry of the bucket, -1 for the last one. */
+    int next;
+};
+
+struct sr_lsh_index
+{
+    float max_distance;
+    /* The signature is split into bands of rows hashes. Threads sharing
+     * all hashes of any band are candidates. */
+    int bands;
+    int rows;
+    uint64_t seeds[LSH_MAX_HASHES];
+    /* Stored threads. */
+    GPtrArray *threads;
+    /* Band key -> index of the first entry in the bucket + 1. */
+    GHashTable *buckets;
+    GArray *entries;
+    /* Source of the tokens of frames that are not equal to any other. */
+    uint64_t unique_tokens;
+};
+
+/* The finalizer of the SplitMix64 generator, a bijection scattering
+ * the bits of the value. */
+static uint64_t
+lsh_mix(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= UINT64_C(0xbf58476d1ce4e5b9);
+    value ^= value >> 27;
+    value *= UINT64_C(0x94d049bb133111eb);
+    value ^= value >> 31;
+    return value;
+}
+
+static uint64_t
+lsh_hash_string(const char *str, uint64_t seed)
+{
+    /* FNV-1a */
+    uint64_t hash = UINT64_C(0xcbf29ce484222325) ^ seed;
+
+    for (; *str; str++)
+    {
+        hash ^= (unsigned char)*str;
+        hash *= UINT64_C(0x100000001b3);
+    }
+
+    return lsh_mix(hash);
+}
+
+/* Chooses the shape of the signature so that threads at the maximal
+ * distance become candidates with the probability of at least LSH_RECALL,
+ * preferring longer bands that produce fewer false candidates. */
+static void
+lsh_choose_bands(float max_distance, int *bands, int *rows)
+{
+    double similarity = 1.0 - max_distance;
+
+    for (int r = 16; r > 1; r--)
+    {
+        int b = LSH_MAX_HASHES / r;
+        double band_match = 1.0, band_miss = 1.0;
+
+        /* Probability that all rows of a band match. */
+        for (int i = 0; i < r; i++)
+            band_match *= similarity;
+
+        /* Probability that no band matches. */
+        for (int i = 0; i < b; i++)
+            band_miss *= 1.0 - band_match;
+
+        if (1.0 - band_miss >= LSH_RECALL)
+        {
+            *bands = b;
+            *rows = r;
+            return;
+        }
+    }
+
+    *bands = LSH_MAX_HASHES;
+    *rows = 1;
+}
+
+struct sr_lsh_index *
+sr_lsh_index_new(float max_distance)
+{
+    struct sr_lsh_index *index = g_malloc0(sizeof(*index));
+
+    index->max_distance = max_distance;
+    lsh_choose_bands(max_distance, &index->bands, &index->rows);
+
+    /* Fixed seeds keep the signatures stable between runs. */
+    for (int i = 0; i < LSH_MAX_HASHES; i++)
+        index->seeds[i] = lsh_mix(UINT64_C(0x9e3779b97f4a7c15) * (i + 1));
+
+    index->threads = g_ptr_array_new();
+    index->buckets = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                           g_free, NULL);
+    index->entries = g_array_new(FALSE, FALSE, sizeof(struct lsh_entry));
+
+    return index;
+}
+
+void
+sr_lsh_index_free(struct sr_lsh_index *index)
+{
+    if (!index)
+        return;
+
+    g_ptr_array_free(index->threads, TRUE);
+    g_hash_table_destroy(index->buckets);
+    g_array_free(index->entries, TRUE);
+    g_free(index);
+}
+
+int
+sr_lsh_index_size(struct sr_lsh_index *index)
+{
+    return index->threads->len;
+}
+
+/* Computes the MinHash signature of the set of frames of the thread, as
+ * the set is understood by the Jaccard distance. The frames are hashed by
+ * their distance keys. The keys ignore the qualifiers, so frames equal by
+ * the key may still differ, which only adds candidates. Frames that are
+ * never equal to others get a token of their own. Frames that cannot be
+ * described by a key are approximated by their duplication hash text.
+ * The unique tokens are taken from the counter. */
+static void
+lsh_signature(struct sr_lsh_index *index, struct sr_thread *thread,
+              uint64_t *unique_tokens, uint64_t *signature)
+{
+    int hashes = index->bands * index->rows;
+    uint64_t type = (uint64_t)thread->type << 56;
+    GString *key = g_string_new(NULL);
+
+    for (int i = 0; i < hashes; i++)
+        signature[i] = UINT64_MAX;
+
+    for (struct sr_frame *frame = sr_thread_frames(thread);
+         frame;
+         frame = sr_frame_next(frame))
+    {
+        const char *qualifier = "";
+        uint64_t token;
+
+        g_string_truncate(key, 0);
+
+        switch (frame_distance_key(frame, key, &qualifier))
+        {
+        case FRAME_DISTANCE_KEY:
+            token = lsh_hash_string(key->str, type);
+            break;
+        case FRAME_DISTANCE_KEY_NONE:
+            frame_append_duphash_text(frame, 0, key);
+            token = lsh_hash_string(key->str, type);
+            break;
+        default:
+            token = lsh_mix((*unique_tokens)++);
+            break;
+        }
+
+        for (int i = 0; i < hashes; i++)
+        {
+            uint64_t hash = lsh_mix(token ^ index->seeds[i]);
+            if (hash < signature[i])
+                signature[i] = hash;
+        }
+    }
+
+    g_string_free(key, TRUE);
+}
+
+static gint64
+lsh_band_key(struct sr_lsh_index *index, const uint64_t *signature, int band)
+{
+    uint64_t key = lsh_mix(band + 1);
+
+    for (int i = 0; i < index->rows; i++)
+        key = lsh_mix(key ^ signature[band * index->rows + i]);
+
+    return (gint64)key;
+}
+
+int
+sr_lsh_index_add(struct sr_lsh_index *index,
+                 struct sr_thread *thread)
+{
+    uint64_t signature[LSH_MAX_HASHES];
+    int id = index->threads->len;
+
+    lsh_signature(index, thread, &index->unique_tokens, signature);
+    g_ptr_array_add(index->threads, thread);
+
+    for (int band = 0; band < index->bands; band++)
+    {
+        gint64 *key = g_new(gint64, 1);
+        struct lsh_entry entry;
+
+        *key = lsh_band_key(index, signature, band);
+        entry.thread = id;
+        entry.next = GPOINTER_TO_INT(g_hash_table_lookup(index->buckets,
+                                                         key)) - 1;
+
+        /* The entry becomes the head of the bucket. */
+        g_hash_table_insert(index->buckets, key,
+                            GINT_TO_POINTER(index->entries->len + 1));
+        g_array_append_val(index->entries, entry);
+    }
+
+    return id;
+}
+
+static int
+lsh_cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int
+lsh_cmp_uint64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+struct sr_lsh_match *
+sr_lsh_index_find(struct sr_lsh_index *index,
+                  struct sr_thread *thread,
+                  int *count)
+{
+    uint64_t signature[LSH_MAX_HASHES];
+    /* The tokens of the query must differ from the stored ones, the high
+     * bit is never set by the counter of the index. */
+    uint64_t unique_tokens = UINT64_C(1) << 63;
+    GArray *candidates = g_array_new(FALSE, FALSE, sizeof(int));
+
+    lsh_signature(index, thread, &unique_tokens, signature);
+
+    for (int band = 0; band < index->bands; band++)
+    {
+        gint64 key = lsh_band_key(index, signature, band);
+        int entry = GPOINTER_TO_INT(g_hash_table_lookup(index->buckets,
+                                                        &key)) - 1;
+
+        while (entry >= 0)
+        {
+            struct lsh_entry *e =
+                &g_array_index(index->entries, struct lsh_entry, entry);
+
+            g_array_append_val(candidates, e->thread);
+            entry = e->next;
+        }
+    }
+
+    g_array_sort(candidates, lsh_cmp_int);
+
+    struct sr_lsh_match *matches = NULL;
+    int found = 0, alloced = 0;
+
+    for (guint i = 0; i < candidates->len; i++)
+    {
+        int candidate = g_array_index(candidates, int, i);
+
+        if (i > 0 && candidate == g_array_index(candidates, int, i - 1))
+            continue;
+
+        float dist = sr_distance_bounded(SR_DISTANCE_JACCARD, thread,
+                                         g_ptr_array_index(index->threads,
+                                                           candidate),
+                                         index->max_distance);
+        if (dist > index->max_distance)
+            continue;
+
+        if (found >= alloced)
+        {
+            alloced = alloced >= 1 ? alloced * 2 : 1;
+            matches = g_renew(struct sr_lsh_match, matches, alloced);
+        }
+
+        matches[found].index = candidate;
+        matches[found].distance = dist;
+        ++found;
+    }
+
+    g_array_free(candidates, TRUE);
+
+    *count = found;
+    return matches;
+}
+
+struct sr_lsh_pair *
+sr_lsh_index_find_pairs(struct sr_lsh_index *index,
+                        int *count)
+{
+    GArray *candidates = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+    GHashTableIter iter;
+    gpointer head;
+
+    g_hash_table_iter_init(&iter, index->buckets);
+    while (g_hash_table_iter_next(&iter, NULL, &head))
+    {
+        for (int entry1 = GPOINTER_TO_INT(head) - 1; entry1 >= 0;)
+        {
+            struct lsh_entry *e1 =
+                &g_array_index(index->entries, struct lsh_entry, entry1);
+
+            for (int entry2 = e1->next; entry2 >= 0;)
+            {
+                struct lsh_entry *e2 =
+                    &g_array_index(index->entries, struct lsh_entry, entry2);
+
+                /* Entries of a bucket are ordered from the newest. */
+                uint64_t pair = (uint64_t)e2->thread << 32 | e1->thread;
+                g_array_append_val(candidates, pair);
+
+                entry2 = e2->next;
+            }
+
+            entry1 = e1->next;
+        }
+    }
+
+    g_array_sort(candidates, lsh_cmp_uint64);
+
+    struct sr_lsh_pair *pairs = NULL;
+    int found = 0, alloced = 0;
+
+    for (guint i = 0; i < candidates->len; i++)
+    {
+        uint64_t pair = g_array_index(candidates, uint64_t, i);
+
+        if (i > 0 && pair == g_array_index(candidates, uint64_t, i - 1))
+            continue;
+
+        int index1 = pair >> 32, index2 = pair & UINT32_MAX;
+        float dist = sr_distance_bounded(SR_DISTANCE_JACCARD,
+                                         g_ptr_array_index(index->threads, index1),
+                                         g_ptr_array_index(index->threads, index2),
+                                         index->max_distance);
+        if (dist > index->max_distance)
+            continue;
+
+        if (found >= alloced)
+        {
+            alloced = alloced >= 1 ? alloced * 2 : 1;
+            pairs = g_renew(struct sr_lsh_pair, pairs, alloced);
+        }
+
+        pairs[found].index1 = index1;
+        pairs[found].index2 = index2;
+        pairs[found].distance = dist;
+        ++found;
+    }
+
+    g_array_free(candidates, TRUE);
+
+    *count = found;
+    return pairs;
+}
@@ -26,6 +26,7 @@
 #include "core/thread.h"
 #include "thread.h"
 #include "utils.h"
+#include "internal_arena.h"
 #include <string.h>
 #include <assert.h>
 
@@ -262,7 +263,7 @@ sr_normalize_gdb_thread(struct sr_gdb_thread *thread)
 
         if (new_function_name)
         {
-            g_free(frame->function_name);
+            arena_free(frame->function_name);
             frame->function_name = new_function_name;
         }
 
@@ -398,7 +399,7 @@ sr_normalize_core_thread(struct sr_core_thread *thread)
 
         if (new_function_name)
         {
-            g_free(frame->function_name);
+            arena_free(frame->function_name);
             frame->function_name = new_function_name;
         }
 
@@ -567,9 +568,9 @@ sr_normalize_gdb_paired_unknown_function_names(struct sr_gdb_thread *thread1,
           strcmp(curr_frame1->library_name, curr_frame2->library_name)) &&
         next_functions_similar(curr_frame1, curr_frame2))
     {
-        g_free(curr_frame1->function_name);
+        arena_free(curr_frame1->function_name);
         curr_frame1->function_name = g_strdup_printf("__unknown_function_%d", i);
-        g_free(curr_frame2->function_name);
+        arena_free(curr_frame2->function_name);
         curr_frame2->function_name = g_strdup_printf("__unknown_function_%d", i);
         i++;
     }
@@ -595,9 +596,9 @@ sr_normalize_gdb_paired_unknown_function_names(struct sr_gdb_thread *thread1,
                     !(prev_frame1->library_name && prev_frame2->library_name &&
                       strcmp(prev_frame1->library_name, prev_frame2->library_name)))
                 {
-                    g_free(curr_frame1->function_name);
+                    arena_free(curr_frame1->function_name);
                     curr_frame1->function_name = g_strdup_printf("__unknown_function_%d", i);
-                    g_free(curr_frame2->function_name);
+                    arena_free(curr_frame2->function_name);
                     curr_frame2->function_name = g_strdup_printf("__unknown_function_%d", i);
                     i++;
                     break;
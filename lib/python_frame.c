@@ -25,6 +25,7 @@
 #include "thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <string.h>
 #include <inttypes.h>
 
@@ -36,6 +37,9 @@ python_append_bthash_text(struct sr_python_frame *frame, enum sr_bthash_flags fl
 static void
 python_append_duphash_text(struct sr_python_frame *frame, enum sr_duphash_flags flags,
                            GString *strbuf);
+static enum frame_distance_key
+python_distance_key(struct sr_python_frame *frame, GString *key,
+                    const char **qualifier);
 
 DEFINE_NEXT_FUNC(python_next, struct sr_frame, struct sr_python_frame)
 DEFINE_SET_NEXT_FUNC(python_set_next, struct sr_frame, struct sr_python_frame)
@@ -47,6 +51,7 @@ struct frame_methods python_frame_methods =
     .set_next = (set_next_frame_fn_t) python_set_next,
     .cmp = (frame_cmp_fn_t) sr_python_frame_cmp,
     .cmp_distance = (frame_cmp_fn_t) sr_python_frame_cmp_distance,
+    .distance_key = (frame_distance_key_fn_t) python_distance_key,
     .frame_append_bthash_text =
         (frame_append_bthash_text_fn_t) python_append_bthash_text,
     .frame_append_duphash_text =
@@ -60,7 +65,7 @@ struct sr_python_frame *
 sr_python_frame_new()
 {
     struct sr_python_frame *frame =
-        g_malloc(sizeof(*frame));
+        arena_alloc0(sizeof(*frame));
 
     sr_python_frame_init(frame);
     return frame;
@@ -79,10 +84,10 @@ sr_python_frame_free(struct sr_python_frame *frame)
     if (!frame)
         return;
 
-    g_free(frame->file_name);
-    g_free(frame->function_name);
-    g_free(frame->line_contents);
-    g_free(frame);
+    arena_free(frame->file_name);
+    arena_free(frame->function_name);
+    arena_free(frame->line_contents);
+    arena_free(frame);
 }
 
 struct sr_python_frame *
@@ -186,6 +191,17 @@ sr_python_frame_cmp_distance(struct sr_python_frame *frame1,
     return 0;
 }
 
+static enum frame_distance_key
+python_distance_key(struct sr_python_frame *frame, GString *key,
+                    const char **qualifier)
+{
+    frame_distance_key_append_str(key, frame->function_name);
+    frame_distance_key_append_str(key, frame->file_name);
+    frame_distance_key_append_int(key, frame->special_function);
+    frame_distance_key_append_int(key, frame->special_file);
+    return FRAME_DISTANCE_KEY;
+}
+
 struct sr_python_frame *
 sr_python_frame_append(struct sr_python_frame *dest,
                        struct sr_python_frame *item)
@@ -264,8 +280,8 @@ sr_python_frame_parse(const char **input,
     {
         frame->special_file = true;
         frame->file_name[strlen(frame->file_name)-1] = '\0';
-        char *inside = g_strdup(frame->file_name + 1);
-        g_free(frame->file_name);
+        char *inside = arena_strdup(frame->file_name + 1);
+        arena_free(frame->file_name);
         frame->file_name = inside;
     }
 
@@ -303,7 +319,7 @@ sr_python_frame_parse(const char **input,
          * function name on its line. For the sake of simplicity, we will
          * believe that we are dealing with such a frame now.
          */
-        frame->function_name = g_strdup("syntax");
+        frame->function_name = arena_strdup("syntax");
         frame->special_function = true;
     }
     else
@@ -327,8 +343,8 @@ sr_python_frame_parse(const char **input,
         {
             frame->special_function = true;
             frame->function_name[strlen(frame->function_name)-1] = '\0';
-            char *inside = g_strdup(frame->function_name + 1);
-            g_free(frame->function_name);
+            char *inside = arena_strdup(frame->function_name + 1);
+            arena_free(frame->function_name);
             frame->function_name = inside;
         }
     }
@@ -422,7 +438,7 @@ sr_python_frame_from_json(json_object *root, char **error_message)
         string = json_object_get_string(val);
 
         result->special_file = false;
-        result->file_name = g_strdup(string);
+        result->file_name = arena_strdup(string);
     }
     else if (json_object_object_get_ex(root, "special_file", &val))
     {
@@ -434,7 +450,7 @@ sr_python_frame_from_json(json_object *root, char **error_message)
         string = json_object_get_string(val);
 
         result->special_file = true;
-        result->file_name = g_strdup(string);
+        result->file_name = arena_strdup(string);
     }
 
     /* Function name / special function. */
@@ -448,7 +464,7 @@ sr_python_frame_from_json(json_object *root, char **error_message)
         string = json_object_get_string(val);
 
         result->special_function = false;
-        result->function_name = g_strdup(string);
+        result->function_name = arena_strdup(string);
     }
     else if (json_object_object_get_ex(root, "special_function", &val))
     {
@@ -460,7 +476,7 @@ sr_python_frame_from_json(json_object *root, char **error_message)
         string = json_object_get_string(val);
 
         result->special_function = true;
-        result->function_name = g_strdup(string);
+        result->function_name = arena_strdup(string);
     }
 
     bool success =
@@ -26,6 +26,7 @@
 #include "generic_stacktrace.h"
 #include "generic_thread.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -81,7 +82,7 @@ struct sr_python_stacktrace *
 sr_python_stacktrace_new()
 {
     struct sr_python_stacktrace *stacktrace =
-        g_malloc(sizeof(*stacktrace));
+        arena_alloc0(sizeof(*stacktrace));
 
     sr_python_stacktrace_init(stacktrace);
     return stacktrace;
@@ -107,8 +108,8 @@ sr_python_stacktrace_free(struct sr_python_stacktrace *stacktrace)
         sr_python_frame_free(frame);
     }
 
-    g_free(stacktrace->exception_name);
-    g_free(stacktrace);
+    arena_free(stacktrace->exception_name);
+    arena_free(stacktrace);
 }
 
 struct sr_python_stacktrace *
@@ -25,6 +25,7 @@
 #include "thread.h"
 #include "stacktrace.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <string.h>
 #include <inttypes.h>
 #include <ctype.h>
@@ -37,6 +38,9 @@ ruby_append_bthash_text(struct sr_ruby_frame *frame, enum sr_bthash_flags flags,
 static void
 ruby_append_duphash_text(struct sr_ruby_frame *frame, enum sr_duphash_flags flags,
                            GString *strbuf);
+static enum frame_distance_key
+ruby_distance_key(struct sr_ruby_frame *frame, GString *key,
+                  const char **qualifier);
 
 DEFINE_NEXT_FUNC(ruby_next, struct sr_frame, struct sr_ruby_frame)
 DEFINE_SET_NEXT_FUNC(ruby_set_next, struct sr_frame, struct sr_ruby_frame)
@@ -48,6 +52,7 @@ struct frame_methods ruby_frame_methods =
     .set_next = (set_next_frame_fn_t) ruby_set_next,
     .cmp = (frame_cmp_fn_t) sr_ruby_frame_cmp,
     .cmp_distance = (frame_cmp_fn_t) sr_ruby_frame_cmp_distance,
+    .distance_key = (frame_distance_key_fn_t) ruby_distance_key,
     .frame_append_bthash_text =
         (frame_append_bthash_text_fn_t) ruby_append_bthash_text,
     .frame_append_duphash_text =
@@ -61,7 +66,7 @@ struct sr_ruby_frame *
 sr_ruby_frame_new()
 {
     struct sr_ruby_frame *frame =
-        g_malloc(sizeof(*frame));
+        arena_alloc0(sizeof(*frame));
 
     sr_ruby_frame_init(frame);
     return frame;
@@ -80,9 +85,9 @@ sr_ruby_frame_free(struct sr_ruby_frame *frame)
     if (!frame)
         return;
 
-    g_free(frame->file_name);
-    g_free(frame->function_name);
-    g_free(frame);
+    arena_free(frame->file_name);
+    arena_free(frame->function_name);
+    arena_free(frame);
 }
 
 struct sr_ruby_frame *
@@ -173,6 +178,16 @@ sr_ruby_frame_cmp_distance(struct sr_ruby_frame *frame1,
     return 0;
 }
 
+static enum frame_distance_key
+ruby_distance_key(struct sr_ruby_frame *frame, GString *key,
+                  const char **qualifier)
+{
+    frame_distance_key_append_str(key, frame->function_name);
+    frame_distance_key_append_str(key, frame->file_name);
+    frame_distance_key_append_int(key, frame->special_function);
+    return FRAME_DISTANCE_KEY;
+}
+
 struct sr_ruby_frame *
 sr_ruby_frame_append(struct sr_ruby_frame *dest,
                      struct sr_ruby_frame *item)
@@ -336,7 +351,7 @@ sr_ruby_frame_parse(const char **input,
 
 fail:
     sr_ruby_frame_free(frame);
-    g_free(filename_lineno_in);
+    arena_free(filename_lineno_in);
     return NULL;
 }
 
@@ -414,7 +429,7 @@ sr_ruby_frame_from_json(json_object *root, char **error_message)
 
         string = json_object_get_string(val);
 
-        result->file_name = g_strdup(string);
+        result->file_name = arena_strdup(string);
     }
 
     /* Function name / special function. */
@@ -428,7 +443,7 @@ sr_ruby_frame_from_json(json_object *root, char **error_message)
         string = json_object_get_string(val);
 
         result->special_function = false;
-        result->function_name = g_strdup(string);
+        result->function_name = arena_strdup(string);
     }
     else if (json_object_object_get_ex(root, "special_function", &val))
     {
@@ -440,7 +455,7 @@ sr_ruby_frame_from_json(json_object *root, char **error_message)
         string = json_object_get_string(val);
 
         result->special_function = true;
-        result->function_name = g_strdup(string);
+        result->function_name = arena_strdup(string);
     }
 
     bool success =
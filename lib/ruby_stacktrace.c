@@ -25,6 +25,7 @@
 #include "generic_stacktrace.h"
 #include "generic_thread.h"
 #include "internal_utils.h"
+#include "internal_arena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -80,7 +81,7 @@ struct sr_ruby_stacktrace *
 sr_ruby_stacktrace_new()
 {
     struct sr_ruby_stacktrace *stacktrace =
-        g_malloc(sizeof(*stacktrace));
+        arena_alloc0(sizeof(*stacktrace));
 
     sr_ruby_stacktrace_init(stacktrace);
     return stacktrace;
@@ -106,8 +107,8 @@ sr_ruby_stacktrace_free(struct sr_ruby_stacktrace *stacktrace)
         sr_ruby_frame_free(frame);
     }
 
-    g_free(stacktrace->exception_name);
-    g_free(stacktrace);
+    arena_free(stacktrace->exception_name);
+    arena_free(stacktrace);
 }
 
 struct sr_ruby_stacktrace *
@@ -205,7 +206,7 @@ sr_ruby_stacktrace_parse(const char **input,
                                       "the beginning of the exception class");
         goto fail;
     }
-    stacktrace->exception_name = g_strdup(p);
+    stacktrace->exception_name = arena_strdup(p);
 
     /* /some/thing.rb:13:in `method': exception message (Exception::Class)\n\tfrom ...
      *                                                  ^
@@ -219,7 +220,7 @@ sr_ruby_stacktrace_parse(const char **input,
     }
 
     /* Throw away the message, it may contain sensitive data. */
-    g_free(message_and_class);
+    arena_free(message_and_class);
     message_and_class = p = NULL;
 
     /* /some/thing.rb:13:in `method': exception message (Exception::Class)\n\tfrom ...
@@ -265,7 +266,7 @@ sr_ruby_stacktrace_parse(const char **input,
 
 fail:
     sr_ruby_stacktrace_free(stacktrace);
-    g_free(message_and_class);
+    arena_free(message_and_class);
     return NULL;
 }
 
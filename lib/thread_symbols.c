@@ -0,0 +1,217 @@
+/*
+    thread_symbols.c
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "thread_symbols.h"
+#include "generic_frame.h"
+#include "internal_utils.h"
+#include "thread.h"
+#include <glib.h>
+#include <string.h>
+
+/* All frames sharing a distance key. */
+struct symbol
+{
+    /* ID used when the qualifiers do not distinguish the frames. */
+    uint32_t id;
+    bool has_id;
+    /* First non-NULL qualifier seen. */
+    const char *qualifier;
+    /* Some frame has a NULL qualifier, i.e. it is equal to all of them. */
+    bool wildcard;
+    /* At least two distinct non-NULL qualifiers were seen. */
+    bool qualified;
+    /* Qualifier -> ID, used if qualified and not wildcard. */
+    GHashTable *qualifier_ids;
+};
+
+/* Result of the first pass for a single frame. */
+struct frame_key
+{
+    /* NULL for frames that are never equal to other frames. */
+    struct symbol *symbol;
+    const char *qualifier;
+};
+
+static void
+symbol_free(struct symbol *symbol)
+{
+    if (symbol->qualifier_ids)
+        g_hash_table_destroy(symbol->qualifier_ids);
+
+    g_free(symbol);
+}
+
+static uint32_t
+next_id(uint32_t *counter)
+{
+    SR_ASSERT(*counter < UINT32_MAX);
+    return (*counter)++;
+}
+
+struct thread_symbols *
+thread_symbols_new(struct sr_thread **threads, int n)
+{
+    struct thread_symbols *symbols = g_new0(struct thread_symbols, n);
+    size_t total_frames = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        symbols[i].type = threads[i]->type;
+        symbols[i].frame_count = sr_thread_frame_count(threads[i]);
+        symbols[i].frames = g_new(struct sr_frame *, symbols[i].frame_count);
+
+        int j = 0;
+        for (struct sr_frame *frame = sr_thread_frames(threads[i]);
+             frame;
+             frame = sr_frame_next(frame))
+        {
+            symbols[i].frames[j++] = frame;
+        }
+
+        total_frames += symbols[i].frame_count;
+    }
+
+    GHashTable *table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify)symbol_free);
+    struct frame_key *keys = g_new(struct frame_key, total_frames);
+    GString *key = g_string_new(NULL);
+    uint32_t counter = 0;
+
+    /* First pass: collect the keys and the qualifiers used with them. Until
+     * all frames are seen, it is not known whether the qualifiers matter. */
+    struct frame_key *frame_key = keys;
+    for (int i = 0; i < n; i++)
+    {
+        bool exact = true;
+
+        for (int j = 0; j < symbols[i].frame_count; j++, frame_key++)
+        {
+            const char *qualifier = "";
+            g_string_truncate(key, 0);
+
+            enum frame_distance_key kind =
+                frame_distance_key(symbols[i].frames[j], key, &qualifier);
+
+            frame_key->symbol = NULL;
+            frame_key->qualifier = NULL;
+
+            if (kind == FRAME_DISTANCE_KEY_NONE)
+                exact = false;
+
+            if (!exact || kind != FRAME_DISTANCE_KEY)
+                continue;
+
+            struct symbol *symbol = g_hash_table_lookup(table, key->str);
+            if (!symbol)
+            {
+                symbol = g_new0(struct symbol, 1);
+                g_hash_table_insert(table, g_strdup(key->str), symbol);
+            }
+
+            if (!qualifier)
+                symbol->wildcard = true;
+            else if (!symbol->qualifier)
+                symbol->qualifier = qualifier;
+            else if (0 != strcmp(symbol->qualifier, qualifier))
+                symbol->qualified = true;
+
+            frame_key->symbol = symbol;
+            frame_key->qualifier = qualifier;
+        }
+
+        if (exact)
+            symbols[i].ids = g_new(uint32_t, symbols[i].frame_count);
+    }
+
+    /* Second pass: assign the IDs. */
+    frame_key = keys;
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < symbols[i].frame_count; j++, frame_key++)
+        {
+            if (!symbols[i].ids)
+                continue;
+
+            struct symbol *symbol = frame_key->symbol;
+            if (!symbol)
+            {
+                symbols[i].ids[j] = next_id(&counter);
+                continue;
+            }
+
+            if (!symbol->qualified)
+            {
+                /* All qualifiers are equal or unknown. */
+                if (!symbol->has_id)
+                {
+                    symbol->id = next_id(&counter);
+                    symbol->has_id = true;
+                }
+
+                symbols[i].ids[j] = symbol->id;
+            }
+            else if (!symbol->wildcard)
+            {
+                if (!symbol->qualifier_ids)
+                    symbol->qualifier_ids = g_hash_table_new(g_str_hash,
+                                                             g_str_equal);
+
+                gpointer id;
+                if (!g_hash_table_lookup_extended(symbol->qualifier_ids,
+                                                  frame_key->qualifier,
+                                                  NULL, &id))
+                {
+                    id = GUINT_TO_POINTER(next_id(&counter));
+                    g_hash_table_insert(symbol->qualifier_ids,
+                                        (gpointer)frame_key->qualifier, id);
+                }
+
+                symbols[i].ids[j] = GPOINTER_TO_UINT(id);
+            }
+            else
+            {
+                /* A frame with unknown qualifier equals frames with
+                 * different qualifiers, which is not an equivalence. */
+                g_free(symbols[i].ids);
+                symbols[i].ids = NULL;
+            }
+        }
+    }
+
+    g_string_free(key, TRUE);
+    g_free(keys);
+    g_hash_table_destroy(table);
+
+    return symbols;
+}
+
+void
+thread_symbols_free(struct thread_symbols *symbols, int n)
+{
+    if (!symbols)
+        return;
+
+    for (int i = 0; i < n; i++)
+    {
+        g_free(symbols[i].frames);
+        g_free(symbols[i].ids);
+    }
+
+    g_free(symbols);
+}
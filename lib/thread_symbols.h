@@ -0,0 +1,68 @@
+/*
+    thread_symbols.h
+
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#ifndef SATYR_THREAD_SYMBOLS_H
+#define SATYR_THREAD_SYMBOLS_H
+
+#include "frame.h"
+#include "report_type.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+struct sr_thread;
+
+/* A thread flattened into an array of frames for distance computation.
+ *
+ * When threads are interned together, every frame is assigned a 32-bit
+ * symbol ID so that two frames of the interned threads are equal according
+ * to sr_frame_cmp_distance() iff their IDs are equal. Frames that never
+ * compare equal (e.g. "??" in GDB) get an ID of their own.
+ */
+struct thread_symbols
+{
+    enum sr_report_type type;
+    int frame_count;
+    /* The frames of the thread, frame_count entries. */
+    struct sr_frame **frames;
+    /* Interned frame IDs, frame_count entries. NULL if the frames of the
+     * thread can't be described by IDs, frames have to be compared by
+     * sr_frame_cmp_distance() then. */
+    uint32_t *ids;
+};
+
+/* Creates symbols for an array of n threads. IDs are comparable only
+ * among threads interned by the same call. */
+struct thread_symbols *
+thread_symbols_new(struct sr_thread **threads, int n);
+
+void
+thread_symbols_free(struct thread_symbols *symbols, int n);
+
+static inline bool
+thread_symbols_frames_equal(const struct thread_symbols *symbols1, int i,
+                            const struct thread_symbols *symbols2, int j)
+{
+    if (symbols1->ids && symbols2->ids)
+        return symbols1->ids[i] == symbols2->ids[j];
+
+    return 0 == sr_frame_cmp_distance(symbols1->frames[i],
+                                      symbols2->frames[j]);
+}
+
+#endif
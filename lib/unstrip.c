@@ -18,6 +18,7 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 #include "unstrip.h"
+#include "address_map.h"
 #include "utils.h"
 #include <inttypes.h>
 #include <stdlib.h>
@@ -113,6 +114,21 @@ sr_unstrip_find_address(struct sr_unstrip_entry *entries,
     return NULL;
 }
 
+struct sr_address_map *
+sr_unstrip_address_map(struct sr_unstrip_entry *entries)
+{
+    struct sr_address_map *map = sr_address_map_new();
+
+    for (struct sr_unstrip_entry *entry = entries; entry; entry = entry->next)
+    {
+        if (entry->length > 0)
+            sr_address_map_add(map, entry->start,
+                               entry->start + entry->length - 1, entry);
+    }
+
+    return map;
+}
+
 void
 sr_unstrip_free(struct sr_unstrip_entry *entries)
 {
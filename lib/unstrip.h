@@ -51,6 +51,11 @@ struct sr_unstrip_entry *
 sr_unstrip_find_address(struct sr_unstrip_entry *entries,
                         uint64_t address);
 
+/* Creates a map of the addresses to the entries, to be searched by
+ * sr_address_map_find() instead of sr_unstrip_find_address(). */
+struct sr_address_map *
+sr_unstrip_address_map(struct sr_unstrip_entry *entries);
+
 void
 sr_unstrip_free(struct sr_unstrip_entry *entries);
 
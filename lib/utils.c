@@ -19,6 +19,7 @@
 */
 #include "utils.h"
 #include "location.h"
+#include "internal_arena.h"
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
@@ -317,6 +318,19 @@ int
 sr_parse_char_span(const char **input, const char *accept, char **result)
 {
     size_t count = strspn(*input, accept);
+    if (count == 0)
+        return 0;
+    *result = arena_strndup(*input, count);
+    *input += count;
+    return count;
+}
+
+/* Like sr_parse_char_span(), for the digits of a number converted and
+ * released right away, which never belong to an arena. */
+static int
+parse_digits(const char **input, const char *digits, char **result)
+{
+    size_t count = strspn(*input, digits);
     if (count == 0)
         return 0;
     *result = g_strndup(*input, count);
@@ -340,7 +354,7 @@ sr_parse_char_cspan(const char **input, const char *reject, char **result)
     size_t count = strcspn(*input, reject);
     if (count == 0)
         return false;
-    *result = g_strndup(*input, count);
+    *result = arena_strndup(*input, count);
     *input += count;
     return true;
 }
@@ -374,7 +388,7 @@ sr_parse_string(const char **input, const char *string, char **result)
     }
     if (*local_string != '\0')
         return false;
-    *result = g_strndup(string, local_input - *input);
+    *result = arena_strndup(string, local_input - *input);
     *input = local_input;
     return true;
 }
@@ -400,9 +414,9 @@ sr_parse_uint32(const char **input, uint32_t *result)
 {
     const char *local_input = *input;
     char *numstr;
-    int length = sr_parse_char_span(&local_input,
-                                    "0123456789",
-                                    &numstr);
+    int length = parse_digits(&local_input,
+                              "0123456789",
+                              &numstr);
 
     if (0 == length)
         return 0;
@@ -427,9 +441,9 @@ sr_parse_uint64(const char **input, uint64_t *result)
 {
     const char *local_input = *input;
     char *numstr;
-    int length = sr_parse_char_span(&local_input,
-                                    "0123456789",
-                                    &numstr);
+    int length = parse_digits(&local_input,
+                              "0123456789",
+                              &numstr);
     if (0 == length)
         return 0;
 
@@ -476,11 +490,11 @@ sr_parse_hexadecimal_uint64(const char **input, uint64_t *result)
 {
     const char *local_input = *input;
     char *numstr;
-    int count = sr_parse_char_span(&local_input,
-                                   "abcdefABCDEF0123456789",
-                                   &numstr);
+    int count = parse_digits(&local_input,
+                             "abcdefABCDEF0123456789",
+                             &numstr);
 
-    if (0 == count) /* sr_parse_char_span returned 0 */
+    if (0 == count) /* parse_digits returned 0 */
         return 0;
 
     char *endptr;
@@ -739,9 +753,9 @@ anonymize_path(char *orig_path)
         if (new_path)
         {
             // Join /home/anonymized/ and ^
-            new_path = g_strdup_printf("%s%s", ANONYMIZED_PATH, new_path);
-            g_free(orig_path);
-            return new_path;
+            g_autofree char *joined = g_strdup_printf("%s%s", ANONYMIZED_PATH, new_path);
+            arena_free(orig_path);
+            return arena_strdup(joined);
         }
     }
     return orig_path;
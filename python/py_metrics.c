@@ -439,6 +439,14 @@ sr_py_distances_part_new(PyTypeObject *object, PyObject *args, PyObject *kwds)
 
     if (PyList_Check(dist_list))
     {
+        /* Partially computed parts are pickled with the distances computed
+         * so far only. */
+        if ((size_t)PyList_Size(dist_list) > part->len)
+        {
+            PyErr_SetString(PyExc_ValueError, "too many distances for the part");
+            goto error;
+        }
+
         part->distances = g_malloc_n(sizeof(float), part->len);
         int i;
         for (i = 0; i < PyList_Size(dist_list); i++)
@@ -453,6 +461,8 @@ sr_py_distances_part_new(PyTypeObject *object, PyObject *args, PyObject *kwds)
 
             part->distances[i] = (float)d;
         }
+
+        part->done = PyList_Size(dist_list);
     }
     else if (dist_list != Py_None)
     {
@@ -505,7 +515,7 @@ sr_py_distances_part_reduce(PyObject *self, PyObject *args)
             return NULL;
 
         unsigned int i;
-        for (i = 0; i < part->len; i++)
+        for (i = 0; i < part->done; i++)
         {
             PyObject *f = PyFloat_FromDouble((double)part->distances[i]);
             if (!f)
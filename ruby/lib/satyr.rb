@@ -12,7 +12,7 @@ module Satyr
   module FFI
     extend ::FFI::Library
 
-    ffi_lib 'libsatyr.so.3', ::FFI::Library::LIBC
+    ffi_lib 'libsatyr.so.5', ::FFI::Library::LIBC
 
     enum :report_type, [ :invalid, 0,
                          :core,
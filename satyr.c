@@ -24,12 +24,17 @@
 #include "core/stacktrace.h"
 #include "utils.h"
 #include "location.h"
+#include "callgraph.h"
 #include "cluster.h"
+#include "disasm.h"
+#include "elves.h"
+#include "distance.h"
 #include "normalize.h"
 #include "report.h"
 #include "abrt.h"
 #include "thread.h"
 #include "stacktrace.h"
+#include "json_utils.h"
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -39,6 +44,7 @@
 #include <assert.h>
 #include <libgen.h>
 #include <time.h>
+#include <unistd.h>
 
 static char *g_program_name;
 
@@ -52,6 +58,11 @@ help()
     puts("   abrt-report-dir              Create report from an ABRT directory and");
     puts("                                send it to a server");
     puts("   abrt-create-core-stacktrace  Create core stacktrace from an ABRT directory");
+    puts("   distances-part               Compute a part of the distance matrix of");
+    puts("                                crash threads, resuming an interrupted run");
+    puts("   distances-merge              Merge computed parts into a distances file");
+    puts("   batch                        Parse, normalize and hash many stacktraces");
+    puts("                                or problem directories in parallel");
     puts("   debug                        Commands for debugging and development support");
 }
 
@@ -70,6 +81,9 @@ usage()
     printf("Usage: %s abrt-print-report-from-dir DIR [OPTION...]\n", g_program_name);
     printf("Usage: %s abrt-report-dir DIR URL [OPTION...]\n", g_program_name);
     printf("Usage: %s abrt-create-core-stacktrace DIR [OPTION...]\n", g_program_name);
+    printf("Usage: %s distances-part TYPE LIST NPARTS PART OUTPUT [DISTANCE]\n", g_program_name);
+    printf("Usage: %s distances-merge OUTPUT PART_FILE...\n", g_program_name);
+    printf("Usage: %s batch [-j JOBS] [-t TYPE] [PATH...]\n", g_program_name);
     printf("Usage: %s debug COMMAND [OPTION...]\n", g_program_name);
 }
 
@@ -130,6 +144,691 @@ abrt_create_core_stacktrace(int argc, char **argv)
     }
 }
 
+/* Number of distances computed between the checkpoints of a part. */
+#define DISTANCES_PART_CHECKPOINT_INTERVAL 10000
+
+static bool
+distance_type_from_string(const char *str, enum sr_distance_type *dist_type)
+{
+    static const char *names[SR_DISTANCE_NUM] =
+    {
+        [SR_DISTANCE_JARO_WINKLER] = "jaro-winkler",
+        [SR_DISTANCE_JACCARD] = "jaccard",
+        [SR_DISTANCE_LEVENSHTEIN] = "levenshtein",
+        [SR_DISTANCE_DAMERAU_LEVENSHTEIN] = "damerau-levenshtein",
+    };
+
+    for (int i = 0; i < SR_DISTANCE_NUM; i++)
+    {
+        if (names[i] && 0 == strcmp(str, names[i]))
+        {
+            *dist_type = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+distances_part(int argc, char **argv)
+{
+    if (argc < 5)
+    {
+        fprintf(stderr, "Usage: %s distances-part TYPE LIST NPARTS PART "
+                        "OUTPUT [DISTANCE]\n", g_program_name);
+        short_usage_and_exit();
+    }
+
+    enum sr_report_type type = sr_report_type_from_string(argv[0]);
+    if (type == SR_REPORT_INVALID)
+    {
+        fprintf(stderr, "Invalid report type %s\n", argv[0]);
+        exit(1);
+    }
+
+    char *end;
+    unsigned long nparts = strtoul(argv[2], &end, 10);
+    if (*end != '\0' || nparts == 0)
+    {
+        fprintf(stderr, "Wrong number of parts\n");
+        exit(1);
+    }
+
+    unsigned long part_index = strtoul(argv[3], &end, 10);
+    if (*end != '\0' || part_index >= nparts)
+    {
+        fprintf(stderr, "Wrong part number\n");
+        exit(1);
+    }
+
+    const char *output = argv[4];
+
+    enum sr_distance_type dist_type = SR_DISTANCE_LEVENSHTEIN;
+    if (argc >= 6 && !distance_type_from_string(argv[5], &dist_type))
+    {
+        fprintf(stderr, "Invalid distance type %s\n", argv[5]);
+        exit(1);
+    }
+
+    /* The list holds a stacktrace file name per line. The crash threads of
+     * the stacktraces are compared. */
+    char *error_message;
+    char *list = sr_file_to_string(argv[1], &error_message);
+    if (!list)
+    {
+        fprintf(stderr, "%s\n", error_message);
+        exit(1);
+    }
+
+    GPtrArray *stacktraces = g_ptr_array_new_with_free_func(
+        (GDestroyNotify)sr_stacktrace_free);
+    GPtrArray *threads = g_ptr_array_new();
+    char **lines = g_strsplit(list, "\n", -1);
+
+    for (char **line = lines; *line; line++)
+    {
+        if (**line == '\0')
+            continue;
+
+        char *text = sr_file_to_string(*line, &error_message);
+        if (!text)
+        {
+            fprintf(stderr, "%s\n", error_message);
+            exit(1);
+        }
+
+        struct sr_stacktrace *stacktrace = sr_stacktrace_parse(type, text,
+                                                               &error_message);
+        g_free(text);
+
+        if (!stacktrace)
+        {
+            fprintf(stderr, "%s: %s\n", *line, error_message);
+            exit(1);
+        }
+
+        struct sr_thread *thread = sr_stacktrace_find_crash_thread(stacktrace);
+        if (!thread)
+        {
+            fprintf(stderr, "%s: Cannot find crash thread\n", *line);
+            exit(1);
+        }
+
+        g_ptr_array_add(stacktraces, stacktrace);
+        g_ptr_array_add(threads, thread);
+    }
+
+    g_strfreev(lines);
+    g_free(list);
+
+    int n = threads->len;
+    if (n < 2)
+    {
+        fprintf(stderr, "At least two stacktraces are needed\n");
+        exit(1);
+    }
+
+    struct sr_distances_part *parts = sr_distances_part_create(n, n, dist_type,
+                                                               nparts);
+    struct sr_distances_part *part = parts;
+    for (unsigned long i = 0; part && i < part_index; i++)
+        part = part->next;
+
+    /* Small matrices may be split into fewer parts. */
+    if (!part)
+    {
+        sr_distances_part_free(parts, true);
+        g_ptr_array_free(threads, TRUE);
+        g_ptr_array_free(stacktraces, TRUE);
+        return;
+    }
+
+    /* Resume the computation if the output holds a checkpoint of the part. */
+    struct sr_distances_part *saved = NULL;
+    if (g_file_test(output, G_FILE_TEST_EXISTS))
+    {
+        saved = sr_distances_part_load(output, &error_message);
+        if (!saved)
+        {
+            fprintf(stderr, "%s\n", error_message);
+            exit(1);
+        }
+
+        if (saved->m != part->m || saved->n != part->n
+            || saved->m_begin != part->m_begin
+            || saved->n_begin != part->n_begin
+            || saved->len != part->len
+            || saved->dist_type != part->dist_type)
+        {
+            fprintf(stderr, "File '%s' holds a different part\n", output);
+            exit(1);
+        }
+
+        part = saved;
+    }
+
+    if (!sr_distances_part_compute_checkpointed(part,
+                                                (struct sr_thread **)threads->pdata,
+                                                output,
+                                                DISTANCES_PART_CHECKPOINT_INTERVAL,
+                                                &error_message))
+    {
+        fprintf(stderr, "%s\n", error_message);
+        exit(1);
+    }
+
+    sr_distances_part_free(saved, false);
+    sr_distances_part_free(parts, true);
+    g_ptr_array_free(threads, TRUE);
+    g_ptr_array_free(stacktraces, TRUE);
+}
+
+/* Range of the distances covered by a part file, the distances are
+ * numbered row by row in the order they are computed. */
+struct distances_range
+{
+    size_t begin;
+    size_t end;
+    const char *path;
+};
+
+static size_t
+distances_rank(size_t n, size_t i, size_t j)
+{
+    return i * (n - 1) - i * (i - 1) / 2 + (j - i - 1);
+}
+
+static gint
+distances_range_cmp(gconstpointer a, gconstpointer b)
+{
+    const struct distances_range *ra = a, *rb = b;
+
+    return (ra->begin > rb->begin) - (ra->begin < rb->begin);
+}
+
+static void
+distances_merge_fail(const char *output, const char *message)
+{
+    fprintf(stderr, "%s\n", message);
+    unlink(output);
+    exit(1);
+}
+
+static void
+distances_merge(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s distances-merge OUTPUT PART_FILE...\n",
+                g_program_name);
+        short_usage_and_exit();
+    }
+
+    const char *output = argv[0];
+    char *error_message;
+    int m = 0, n = 0;
+    enum sr_distance_type dist_type = 0;
+    GArray *ranges = g_array_sized_new(FALSE, FALSE,
+                                       sizeof(struct distances_range),
+                                       argc - 1);
+
+    /* The parts are written to the output one by one, so that only one of
+     * them is in memory at a time. */
+    for (int i = 1; i < argc; i++)
+    {
+        struct sr_distances_part *part =
+            sr_distances_part_load(argv[i], &error_message);
+        if (!part)
+            distances_merge_fail(output, error_message);
+
+        if (part->done != part->len)
+        {
+            distances_merge_fail(output, g_strdup_printf(
+                "Part '%s' has not been computed completely", argv[i]));
+        }
+
+        if (i == 1)
+        {
+            m = part->m;
+            n = part->n;
+            dist_type = part->dist_type;
+
+            if (!sr_distances_file_create(output, m, n, dist_type,
+                                          SR_DISTANCES_FLOAT32,
+                                          &error_message))
+            {
+                distances_merge_fail(output, error_message);
+            }
+        }
+
+        struct distances_range range;
+        range.begin = distances_rank(part->n, part->m_begin, part->n_begin);
+        range.end = range.begin + part->len;
+        range.path = argv[i];
+        g_array_append_val(ranges, range);
+
+        if (!sr_distances_file_write_part(output, part, &error_message))
+            distances_merge_fail(output, error_message);
+
+        sr_distances_part_free(part, false);
+    }
+
+    /* Every distance must be written by exactly one part. */
+    g_array_sort(ranges, distances_range_cmp);
+
+    size_t covered = 0;
+    for (guint i = 0; i < ranges->len; i++)
+    {
+        struct distances_range *range =
+            &g_array_index(ranges, struct distances_range, i);
+
+        if (range->begin != covered)
+        {
+            distances_merge_fail(output, g_strdup_printf(
+                "Part '%s' %s", range->path,
+                range->begin < covered ? "overlaps another part"
+                                       : "follows a missing part"));
+        }
+
+        covered = range->end;
+    }
+
+    if (covered != distances_rank(n, m, m + 1))
+    {
+        distances_merge_fail(output, "The last part of the matrix is "
+                             "missing");
+    }
+
+    if (!sr_distances_file_finish(output, &error_message))
+        distances_merge_fail(output, error_message);
+
+    g_array_free(ranges, TRUE);
+}
+
+/* Number of items per worker that may be queued or waiting for the items
+ * before them to be written. */
+#define BATCH_QUEUE_PER_WORKER 4
+
+enum batch_stage
+{
+    BATCH_STAGE_PARSE,
+    BATCH_STAGE_NORMALIZE,
+    BATCH_STAGE_HASH,
+    BATCH_STAGE_JSON,
+    BATCH_STAGE_NUM
+};
+
+static const char *batch_stage_names[BATCH_STAGE_NUM] =
+{
+    [BATCH_STAGE_PARSE] = "parse",
+    [BATCH_STAGE_NORMALIZE] = "normalize",
+    [BATCH_STAGE_HASH] = "hash",
+    [BATCH_STAGE_JSON] = "json",
+};
+
+struct batch_item
+{
+    char *path;
+    /* The JSON object written for the item, NULL until it is processed. */
+    char *output;
+    bool failed;
+    /* Time spent in every stage, in microseconds. */
+    gint64 stage_time[BATCH_STAGE_NUM];
+};
+
+struct batch
+{
+    enum sr_report_type type;
+    GMutex lock;
+    GCond cond;
+    /* Ring buffer of the items being processed, indexed by their
+     * sequence number modulo the capacity. */
+    struct batch_item *queue;
+    size_t capacity;
+    /* Sequence numbers of the next item to be added, taken by a worker
+     * and written. */
+    size_t next_added;
+    size_t next_taken;
+    size_t next_written;
+    bool input_done;
+};
+
+static void
+batch_stage_done(struct batch_item *item,
+                 enum batch_stage stage,
+                 gint64 *start)
+{
+    gint64 now = g_get_monotonic_time();
+
+    item->stage_time[stage] = now - *start;
+    *start = now;
+}
+
+/* Loads the stacktrace from a problem directory, or parses it from a file
+ * of the given type. */
+static struct sr_stacktrace *
+batch_load(enum sr_report_type type,
+           const char *path,
+           char **component,
+           char **error_message)
+{
+    if (g_file_test(path, G_FILE_TEST_IS_DIR))
+    {
+        struct sr_report *report = sr_abrt_report_from_dir(path, error_message);
+        if (!report)
+            return NULL;
+
+        struct sr_stacktrace *stacktrace = report->stacktrace;
+        report->stacktrace = NULL;
+        *component = report->component_name;
+        report->component_name = NULL;
+        sr_report_free(report);
+
+        if (!stacktrace)
+            *error_message = g_strdup("No stacktrace found");
+
+        return stacktrace;
+    }
+
+    if (type == SR_REPORT_INVALID)
+    {
+        *error_message = g_strdup("Report type of the file not given");
+        return NULL;
+    }
+
+    char *text = sr_file_to_string(path, error_message);
+    if (!text)
+        return NULL;
+
+    struct sr_stacktrace *stacktrace = sr_stacktrace_parse(type, text,
+                                                           error_message);
+    g_free(text);
+
+    return stacktrace;
+}
+
+/* Runs the stages for the item and returns its JSON object. */
+static char *
+batch_process(enum sr_report_type type,
+              struct batch_item *item)
+{
+    struct sr_stacktrace *stacktrace;
+    char *component = NULL;
+    char *error_message = NULL;
+    char *bthash = NULL, *duphash = NULL;
+    struct sr_thread *normalized = NULL;
+    gint64 time = g_get_monotonic_time();
+    GString *strbuf = g_string_new("{   \"path\": ");
+
+    sr_json_append_escaped(strbuf, item->path);
+
+    stacktrace = batch_load(type, item->path, &component, &error_message);
+    batch_stage_done(item, BATCH_STAGE_PARSE, &time);
+    if (!stacktrace)
+        goto fail;
+
+    struct sr_thread *thread = sr_stacktrace_find_crash_thread(stacktrace);
+    if (!thread)
+    {
+        error_message = g_strdup("Cannot find crash thread");
+        goto fail;
+    }
+
+    /* The bthash and the JSON are computed from the stacktrace as it was
+     * parsed, only the duphash uses a normalized copy of the thread. */
+    normalized = sr_thread_dup(thread);
+    sr_thread_normalize(normalized);
+    batch_stage_done(item, BATCH_STAGE_NORMALIZE, &time);
+
+    bthash = sr_stacktrace_get_bthash(stacktrace, SR_BTHASH_NORMAL);
+    duphash = sr_thread_get_duphash(normalized, 3, component,
+                                    SR_DUPHASH_NORMAL | SR_DUPHASH_NONORMALIZE);
+    batch_stage_done(item, BATCH_STAGE_HASH, &time);
+    if (!bthash || !duphash)
+    {
+        error_message = g_strdup("Computing hashes failed");
+        goto fail;
+    }
+
+    char *json = sr_stacktrace_to_json(stacktrace);
+
+    g_string_append(strbuf, "\n,   \"bthash\": ");
+    sr_json_append_escaped(strbuf, bthash);
+    g_string_append(strbuf, "\n,   \"duphash\": ");
+    sr_json_append_escaped(strbuf, duphash);
+    /* GDB stacktraces cannot be serialized. */
+    if (json)
+    {
+        g_string_append(strbuf, "\n,   \"stacktrace\": ");
+        g_string_append(strbuf, json);
+        g_free(json);
+    }
+    g_string_append(strbuf, "\n}\n");
+    batch_stage_done(item, BATCH_STAGE_JSON, &time);
+
+    goto done;
+
+fail:
+    g_string_append(strbuf, "\n,   \"error\": ");
+    sr_json_append_escaped(strbuf, error_message ? error_message : "Unknown error");
+    g_string_append(strbuf, "\n}\n");
+    item->failed = true;
+
+done:
+    g_free(bthash);
+    g_free(duphash);
+    g_free(error_message);
+    g_free(component);
+    if (normalized)
+        sr_thread_free(normalized);
+    if (stacktrace)
+        sr_stacktrace_free(stacktrace);
+
+    return g_string_free(strbuf, FALSE);
+}
+
+static gpointer
+batch_worker_run(gpointer data)
+{
+    struct batch *batch = data;
+
+    g_mutex_lock(&batch->lock);
+
+    while (true)
+    {
+        while (batch->next_taken == batch->next_added && !batch->input_done)
+            g_cond_wait(&batch->cond, &batch->lock);
+
+        if (batch->next_taken == batch->next_added)
+            break;
+
+        struct batch_item *item =
+            &batch->queue[batch->next_taken++ % batch->capacity];
+
+        g_mutex_unlock(&batch->lock);
+        char *output = batch_process(batch->type, item);
+        g_mutex_lock(&batch->lock);
+
+        item->output = output;
+        g_cond_broadcast(&batch->cond);
+    }
+
+    g_mutex_unlock(&batch->lock);
+
+    return NULL;
+}
+
+static gpointer
+batch_writer_run(gpointer data)
+{
+    struct batch *batch = data;
+    size_t items = 0, failed = 0;
+    gint64 stage_time[BATCH_STAGE_NUM] = { 0 };
+    gint64 start = g_get_monotonic_time();
+
+    g_mutex_lock(&batch->lock);
+
+    while (true)
+    {
+        struct batch_item *item =
+            &batch->queue[batch->next_written % batch->capacity];
+
+        /* The items are written in the order they were added. */
+        while (batch->next_written == batch->next_added
+               ? !batch->input_done
+               : !item->output)
+        {
+            g_cond_wait(&batch->cond, &batch->lock);
+        }
+
+        if (batch->next_written == batch->next_added)
+            break;
+
+        g_mutex_unlock(&batch->lock);
+
+        fputs(item->output, stdout);
+        items++;
+        if (item->failed)
+            failed++;
+        for (int i = 0; i < BATCH_STAGE_NUM; i++)
+            stage_time[i] += item->stage_time[i];
+
+        g_free(item->path);
+        g_free(item->output);
+
+        g_mutex_lock(&batch->lock);
+
+        batch->next_written++;
+        g_cond_broadcast(&batch->cond);
+    }
+
+    g_mutex_unlock(&batch->lock);
+
+    double seconds = MAX(g_get_monotonic_time() - start, 1) / 1e6;
+
+    fflush(stdout);
+    fprintf(stderr, "Processed %zu items (%zu failed) in %.3f s, %.1f items/s\n",
+            items, failed, seconds, items / seconds);
+
+    /* The time of the stages is summed over all workers. */
+    for (int i = 0; i < BATCH_STAGE_NUM; i++)
+    {
+        fprintf(stderr, "  %-10s %10.3f s %10.1f us/item\n", batch_stage_names[i],
+                stage_time[i] / 1e6,
+                items ? (double)stage_time[i] / items : 0.0);
+    }
+
+    return GSIZE_TO_POINTER(failed);
+}
+
+static void
+batch_add(struct batch *batch,
+          const char *path)
+{
+    g_mutex_lock(&batch->lock);
+
+    while (batch->next_added - batch->next_written == batch->capacity)
+        g_cond_wait(&batch->cond, &batch->lock);
+
+    struct batch_item *item =
+        &batch->queue[batch->next_added++ % batch->capacity];
+
+    memset(item, 0, sizeof(*item));
+    item->path = g_strdup(path);
+
+    g_cond_broadcast(&batch->cond);
+    g_mutex_unlock(&batch->lock);
+}
+
+static void
+batch_run(int argc, char **argv)
+{
+    enum sr_report_type type = SR_REPORT_INVALID;
+    unsigned long jobs = g_get_num_processors();
+    char *end;
+    int i;
+
+    for (i = 0; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (0 == strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            jobs = strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || jobs == 0)
+            {
+                fprintf(stderr, "Wrong number of jobs\n");
+                exit(1);
+            }
+        }
+        else if (0 == strcmp(argv[i], "-t") && i + 1 < argc)
+        {
+            type = sr_report_type_from_string(argv[++i]);
+            if (type == SR_REPORT_INVALID)
+            {
+                fprintf(stderr, "Invalid report type %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s batch [-j JOBS] [-t TYPE] [PATH...]\n",
+                    g_program_name);
+            short_usage_and_exit();
+        }
+    }
+
+    struct batch batch = { .type = type };
+
+    g_mutex_init(&batch.lock);
+    g_cond_init(&batch.cond);
+    batch.capacity = jobs * BATCH_QUEUE_PER_WORKER;
+    batch.queue = g_new0(struct batch_item, batch.capacity);
+
+    GThread **workers = g_new(GThread *, jobs);
+    for (unsigned long j = 0; j < jobs; j++)
+        workers[j] = g_thread_new("satyr-batch", batch_worker_run, &batch);
+
+    GThread *writer = g_thread_new("satyr-batch-out", batch_writer_run, &batch);
+
+    /* Without paths, read NUL-separated paths from the standard input. */
+    if (i < argc)
+    {
+        for (; i < argc; i++)
+            batch_add(&batch, argv[i]);
+    }
+    else
+    {
+        char *path = NULL;
+        size_t size = 0;
+
+        while (getdelim(&path, &size, '\0', stdin) != -1)
+        {
+            if (*path != '\0')
+                batch_add(&batch, path);
+        }
+
+        free(path);
+    }
+
+    g_mutex_lock(&batch.lock);
+    batch.input_done = true;
+    g_cond_broadcast(&batch.cond);
+    g_mutex_unlock(&batch.lock);
+
+    for (unsigned long j = 0; j < jobs; j++)
+        g_thread_join(workers[j]);
+
+    size_t failed = GPOINTER_TO_SIZE(g_thread_join(writer));
+
+    g_free(workers);
+    g_free(batch.queue);
+    g_cond_clear(&batch.cond);
+    g_mutex_clear(&batch.lock);
+
+    if (failed > 0)
+        exit(1);
+}
+
 static void
 debug_normalize(int argc, char **argv)
 {
@@ -346,6 +1045,80 @@ debug_unwind_from_hook(int argc, char **argv)
     sr_core_stacktrace_free(core_stacktrace);
 }
 
+static void
+debug_callgraph(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s debug callgraph BINARY BUILD_ID ADDRESS "
+                        "[CACHE_DIR]\n", g_program_name);
+        exit(1);
+    }
+
+    char *end;
+    uint64_t address = strtoull(argv[2], &end, 0);
+    if (*end != '\0')
+    {
+        fprintf(stderr, "Wrong address\n");
+        exit(1);
+    }
+
+    char *error_message = NULL;
+    struct sr_elf_eh_frame *eh_frame = sr_elf_get_eh_frame(argv[0],
+                                                           &error_message);
+    if (!eh_frame)
+    {
+        fprintf(stderr, "%s\n", error_message);
+        exit(1);
+    }
+
+    struct sr_disasm_state *disassembler = sr_disasm_init(argv[0],
+                                                          &error_message);
+    if (!disassembler)
+    {
+        fprintf(stderr, "%s\n", error_message);
+        exit(1);
+    }
+
+    /* With a cache directory, the call graph is reused between runs. */
+    struct sr_callgraph_index *index = sr_callgraph_index_new();
+    bool success;
+    if (argc >= 4)
+    {
+        success = sr_callgraph_index_extend_cached(index, address,
+                                                   disassembler, eh_frame,
+                                                   argv[3], argv[1],
+                                                   &error_message);
+    }
+    else
+    {
+        success = sr_callgraph_index_extend(index, address, disassembler,
+                                            eh_frame, &error_message);
+    }
+
+    if (!success)
+    {
+        fprintf(stderr, "%s\n", error_message);
+        exit(1);
+    }
+
+    for (struct sr_callgraph *node = sr_callgraph_index_nodes(index);
+         node;
+         node = node->next)
+    {
+        printf("0x%"PRIx64":", node->address);
+
+        for (uint64_t *callee = node->callees; *callee != 0; ++callee)
+            printf(" 0x%"PRIx64, *callee);
+
+        printf("\n");
+    }
+
+    sr_callgraph_index_free(index);
+    sr_disasm_free(disassembler);
+    sr_elf_eh_frame_free(eh_frame);
+}
+
 static void
 debug(int argc, char **argv)
 {
@@ -362,6 +1135,8 @@ debug(int argc, char **argv)
         debug_duphash(argc - 1, argv + 1);
     else if (0 == strcmp(argv[0], "unwind-from-hook"))
         debug_unwind_from_hook(argc - 1, argv + 1);
+    else if (0 == strcmp(argv[0], "callgraph"))
+        debug_callgraph(argc - 1, argv + 1);
     else
     {
         fprintf(stderr, "Unknown debug subcommand.\n");
@@ -390,6 +1165,12 @@ main(int argc, char **argv)
         abrt_report_dir(argc - 2, argv + 2);
     else if (0 == strcmp(argv[1], "abrt-create-core-stacktrace"))
         abrt_create_core_stacktrace(argc - 2, argv + 2);
+    else if (0 == strcmp(argv[1], "distances-part"))
+        distances_part(argc - 2, argv + 2);
+    else if (0 == strcmp(argv[1], "distances-merge"))
+        distances_merge(argc - 2, argv + 2);
+    else if (0 == strcmp(argv[1], "batch"))
+        batch_run(argc - 2, argv + 2);
     else if (0 == strcmp(argv[1], "debug"))
         debug(argc - 2, argv + 2);
     else
@@ -0,0 +1,127 @@
+#include <address_map.h>
+#include <gdb/sharedlib.h>
+
+#include <glib.h>
+
+static void
+test_address_map_find(void)
+{
+    struct sr_address_map *map;
+    int modules[4];
+
+    map = sr_address_map_new();
+
+    sr_address_map_add(map, 0x3000, 0x3fff, &modules[0]);
+    sr_address_map_add(map, 0x1000, 0x1fff, &modules[1]);
+    sr_address_map_add(map, 0x5000, UINT64_MAX, &modules[2]);
+    /* Ignored. */
+    sr_address_map_add(map, 0x2fff, 0x2000, &modules[3]);
+
+    g_assert_cmpint(sr_address_map_size(map), ==, 3);
+
+    g_assert_null(sr_address_map_find(map, 0));
+    g_assert_null(sr_address_map_find(map, 0xfff));
+    g_assert_true(sr_address_map_find(map, 0x1000) == &modules[1]);
+    g_assert_true(sr_address_map_find(map, 0x1fff) == &modules[1]);
+    g_assert_null(sr_address_map_find(map, 0x2000));
+    g_assert_null(sr_address_map_find(map, 0x2800));
+    g_assert_true(sr_address_map_find(map, 0x3abc) == &modules[0]);
+    g_assert_null(sr_address_map_find(map, 0x4000));
+    g_assert_true(sr_address_map_find(map, UINT64_MAX) == &modules[2]);
+
+    sr_address_map_free(map);
+}
+
+static void
+test_address_map_find_overlapping(void)
+{
+    struct sr_address_map *map;
+    int modules[3];
+
+    map = sr_address_map_new();
+
+    /* A long range hiding behind the later ones. */
+    sr_address_map_add(map, 0x2000, 0x2fff, &modules[0]);
+    sr_address_map_add(map, 0x1000, 0x8fff, &modules[1]);
+    sr_address_map_add(map, 0x4000, 0x4fff, &modules[2]);
+
+    g_assert_true(sr_address_map_find(map, 0x1800) == &modules[1]);
+    g_assert_true(sr_address_map_find(map, 0x2800) == &modules[0]);
+    g_assert_true(sr_address_map_find(map, 0x4800) == &modules[1]);
+    g_assert_true(sr_address_map_find(map, 0x8000) == &modules[1]);
+    g_assert_null(sr_address_map_find(map, 0x9000));
+
+    /* Adding after a search works too. */
+    sr_address_map_add(map, 0x9000, 0x9fff, &modules[2]);
+    g_assert_true(sr_address_map_find(map, 0x9000) == &modules[2]);
+
+    sr_address_map_free(map);
+}
+
+static void
+test_address_map_sharedlibs(void)
+{
+    struct sr_gdb_sharedlib *libs = NULL;
+    struct sr_address_map *map;
+    guint32 seed = 42;
+
+    /* Libraries in random order, some without addresses. */
+    for (int i = 0; i < 100; i++)
+    {
+        struct sr_gdb_sharedlib *lib = sr_gdb_sharedlib_new();
+
+        seed = seed * 1103515245 + 12345;
+        if (seed % 10 != 0)
+        {
+            lib->from = (uint64_t)(seed >> 8) << 12;
+            lib->to = lib->from + (seed % 7) * 0x1000;
+        }
+
+        libs = sr_gdb_sharedlib_append(libs, lib);
+    }
+
+    map = sr_gdb_sharedlib_address_map(libs);
+
+    /* The map agrees with the linear search. */
+    for (struct sr_gdb_sharedlib *lib = libs; lib; lib = lib->next)
+    {
+        uint64_t addresses[] = { lib->from - 1, lib->from, lib->to,
+                                 lib->to + 1, lib->from + (lib->to - lib->from) / 2 };
+
+        for (size_t i = 0; i < G_N_ELEMENTS(addresses); i++)
+        {
+            struct sr_gdb_sharedlib *expected;
+
+            expected = sr_gdb_sharedlib_find_address(libs, addresses[i]);
+            if (addresses[i] == UINT64_MAX)
+            {
+                continue;
+            }
+
+            g_assert_true(sr_address_map_find(map, addresses[i]) == expected);
+        }
+    }
+
+    sr_address_map_free(map);
+
+    while (libs)
+    {
+        struct sr_gdb_sharedlib *next = libs->next;
+
+        sr_gdb_sharedlib_free(libs);
+        libs = next;
+    }
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/address-map/find", test_address_map_find);
+    g_test_add_func("/address-map/find-overlapping", test_address_map_find_overlapping);
+    g_test_add_func("/address-map/sharedlibs", test_address_map_sharedlibs);
+
+    return g_test_run();
+}
@@ -0,0 +1,150 @@
+#include <arena.h>
+#include <stacktrace.h>
+#include <utils.h>
+
+#include <glib.h>
+
+static const struct
+{
+    enum sr_report_type type;
+    const char *filename;
+} stacktraces[] =
+{
+    { SR_REPORT_CORE, "json_files/core-01" },
+    { SR_REPORT_PYTHON, "python_stacktraces/python-01" },
+    { SR_REPORT_KERNELOOPS, "kerneloopses/rhbz-1040900-s390x-1" },
+    { SR_REPORT_JAVA, "java_stacktraces/java-01" },
+    { SR_REPORT_GDB, "gdb_stacktraces/rhbz-803600" },
+    { SR_REPORT_RUBY, "ruby_stacktraces/ruby-01" },
+    { SR_REPORT_JAVASCRIPT, "js_stacktraces/node-01" },
+};
+
+static void
+test_arena_stacktrace_parse(void)
+{
+    struct sr_arena *arena = sr_arena_new();
+
+    g_assert_cmpuint(sr_arena_size(arena), ==, 0);
+
+    for (size_t i = 0; i < G_N_ELEMENTS(stacktraces); i++)
+    {
+        g_autofree char *error_message = NULL;
+        g_autofree char *text = sr_file_to_string(stacktraces[i].filename,
+                                                  &error_message);
+
+        g_assert_nonnull(text);
+
+        struct sr_stacktrace *expected =
+            sr_stacktrace_parse(stacktraces[i].type, text, &error_message);
+        g_assert_nonnull(expected);
+
+        struct sr_stacktrace *stacktrace =
+            sr_arena_stacktrace_parse(arena, stacktraces[i].type, text,
+                                      &error_message);
+        g_assert_nonnull(stacktrace);
+
+        g_autofree char *expected_bthash = sr_stacktrace_get_bthash(expected, SR_BTHASH_NORMAL);
+        g_autofree char *bthash = sr_stacktrace_get_bthash(stacktrace, SR_BTHASH_NORMAL);
+        g_assert_cmpstr(bthash, ==, expected_bthash);
+
+        /* GDB stack traces cannot be serialized. */
+        g_autofree char *expected_json = sr_stacktrace_to_json(expected);
+        if (expected_json)
+        {
+            g_autofree char *json = sr_stacktrace_to_json(stacktrace);
+            g_assert_cmpstr(json, ==, expected_json);
+
+            /* Deserialized into the arena too. */
+            stacktrace = sr_arena_stacktrace_from_json_text(arena, stacktraces[i].type,
+                                                            expected_json,
+                                                            &error_message);
+            g_assert_nonnull(stacktrace);
+
+            g_autofree char *json2 = sr_stacktrace_to_json(stacktrace);
+            g_assert_cmpstr(json2, ==, expected_json);
+        }
+
+        sr_stacktrace_free(expected);
+    }
+
+    g_assert_cmpuint(sr_arena_size(arena), >, 0);
+
+    sr_arena_free(arena);
+}
+
+static void
+test_arena_stacktrace_parse_large(void)
+{
+    struct sr_arena *arena = sr_arena_new();
+    g_autofree char *error_message = NULL;
+    GString *text = g_string_new("Traceback (most recent call last):\n"
+                                 "  File \"/usr/bin/");
+
+    /* Strings larger than a quarter of a block get blocks of their own. */
+    for (int i = 0; i < 20 * 1024; i++)
+        g_string_append_c(text, 'a' + i % 26);
+    g_string_append(text, ".py\", line 1, in <module>\n"
+                          "    main()\n"
+                          "ValueError: bad\n");
+
+    for (int i = 0; i < 2; i++)
+    {
+        struct sr_stacktrace *expected =
+            sr_stacktrace_parse(SR_REPORT_PYTHON, text->str, &error_message);
+        g_assert_nonnull(expected);
+
+        struct sr_stacktrace *stacktrace =
+            sr_arena_stacktrace_parse(arena, SR_REPORT_PYTHON, text->str,
+                                      &error_message);
+        g_assert_nonnull(stacktrace);
+
+        g_autofree char *expected_json = sr_stacktrace_to_json(expected);
+        g_autofree char *json = sr_stacktrace_to_json(stacktrace);
+        g_assert_cmpstr(json, ==, expected_json);
+
+        sr_stacktrace_free(expected);
+    }
+
+    g_assert_cmpuint(sr_arena_size(arena), >, 2 * 20 * 1024);
+
+    g_string_free(text, TRUE);
+    sr_arena_free(arena);
+}
+
+static void
+test_arena_stacktrace_parse_failure(void)
+{
+    struct sr_arena *arena = sr_arena_new();
+    g_autofree char *error_message = NULL;
+
+    g_assert_null(sr_arena_stacktrace_parse(arena, SR_REPORT_RUBY,
+                                            "no stack trace here",
+                                            &error_message));
+    g_assert_nonnull(error_message);
+
+    /* The heap is used again once the arena is left. */
+    struct sr_stacktrace *stacktrace =
+        sr_stacktrace_parse(SR_REPORT_PYTHON,
+                            "Traceback (most recent call last):\n"
+                            "  File \"/usr/bin/a.py\", line 1, in <module>\n"
+                            "    main()\n"
+                            "ValueError: bad\n",
+                            &error_message);
+    g_assert_nonnull(stacktrace);
+
+    sr_arena_free(arena);
+    sr_stacktrace_free(stacktrace);
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/arena/stacktrace-parse", test_arena_stacktrace_parse);
+    g_test_add_func("/arena/stacktrace-parse-large", test_arena_stacktrace_parse_large);
+    g_test_add_func("/arena/stacktrace-parse-failure", test_arena_stacktrace_parse_failure);
+
+    return g_test_run();
+}
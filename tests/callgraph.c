@@ -0,0 +1,260 @@
+#include <callgraph.h>
+#include <utils.h>
+
+#include <glib.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#define BUILD_ID "0123456789abcdef0123456789abcdef01234567"
+
+static struct sr_callgraph *
+create_node(uint64_t address, int callee_count, ...)
+{
+    struct sr_callgraph *node = g_malloc(sizeof(*node));
+    va_list args;
+
+    node->address = address;
+    node->callees = g_new0(uint64_t, callee_count + 1);
+    node->next = NULL;
+
+    va_start(args, callee_count);
+    for (int i = 0; i < callee_count; i++)
+        node->callees[i] = va_arg(args, uint64_t);
+    va_end(args);
+
+    return node;
+}
+
+static struct sr_callgraph_index *
+create_index(void)
+{
+    struct sr_callgraph_index *index = sr_callgraph_index_new();
+
+    g_assert_true(sr_callgraph_index_add(index,
+        create_node(0x401000, 2, (uint64_t)0x401100, (uint64_t)0x401200)));
+    g_assert_true(sr_callgraph_index_add(index,
+        create_node(0x401100, 0)));
+    g_assert_true(sr_callgraph_index_add(index,
+        create_node(0x401200, 1, (uint64_t)0x401000)));
+
+    return index;
+}
+
+static char *
+create_cache_path(void)
+{
+    char *path;
+    int fd = g_file_open_tmp("satyr-callgraph-XXXXXX", &path, NULL);
+
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    return path;
+}
+
+static void
+assert_index_equal(struct sr_callgraph_index *index,
+                   struct sr_callgraph_index *expected)
+{
+    struct sr_callgraph *node = sr_callgraph_index_nodes(index);
+    struct sr_callgraph *expected_node = sr_callgraph_index_nodes(expected);
+
+    g_assert_cmpint(sr_callgraph_index_size(index), ==,
+                    sr_callgraph_index_size(expected));
+
+    for (; expected_node; expected_node = expected_node->next, node = node->next)
+    {
+        g_assert_nonnull(node);
+        g_assert_cmpuint(node->address, ==, expected_node->address);
+        g_assert_true(sr_callgraph_index_find(index, node->address) == node);
+
+        int i = 0;
+        do
+            g_assert_cmpuint(node->callees[i], ==, expected_node->callees[i]);
+        while (expected_node->callees[i++] != 0);
+    }
+
+    g_assert_null(node);
+}
+
+static void
+test_callgraph_cache_round_trip(void)
+{
+    struct sr_callgraph_index *expected = create_index();
+    struct sr_callgraph_index *index = sr_callgraph_index_new();
+    char *path = create_cache_path();
+    char *error_message = NULL;
+
+    g_assert_true(sr_callgraph_index_save(expected, path, BUILD_ID,
+                                          &error_message));
+    g_assert_true(sr_callgraph_index_load(index, path, BUILD_ID,
+                                          &error_message));
+    g_assert_null(error_message);
+    assert_index_equal(index, expected);
+
+    /* Nodes already in the index are kept. */
+    g_assert_true(sr_callgraph_index_load(index, path, BUILD_ID,
+                                          &error_message));
+    assert_index_equal(index, expected);
+
+    /* The cache of another build is rejected. */
+    struct sr_callgraph_index *other = sr_callgraph_index_new();
+    g_assert_false(sr_callgraph_index_load(other, path, "fedcba",
+                                           &error_message));
+    g_assert_nonnull(error_message);
+    g_assert_cmpint(sr_callgraph_index_size(other), ==, 0);
+    g_free(error_message);
+
+    unlink(path);
+    g_free(path);
+    sr_callgraph_index_free(other);
+    sr_callgraph_index_free(index);
+    sr_callgraph_index_free(expected);
+}
+
+static void
+test_callgraph_cache_corrupted(void)
+{
+    const char *contents[] =
+    {
+        /* Invalid callee. */
+        "satyr-callgraph 1 " BUILD_ID "\n"
+        "0x402000: 0x402100\n"
+        "0x402100: 0x\n",
+        /* Truncated line. */
+        "satyr-callgraph 1 " BUILD_ID "\n"
+        "0x402000: 0x402100\n"
+        "0x402100: 0x402000",
+        /* Zero callee, which would end the list. */
+        "satyr-callgraph 1 " BUILD_ID "\n"
+        "0x402000: 0x0 0x402100\n",
+    };
+    char *path = create_cache_path();
+
+    for (size_t i = 0; i < G_N_ELEMENTS(contents); i++)
+    {
+        struct sr_callgraph_index *expected = create_index();
+        struct sr_callgraph_index *index = create_index();
+        char *error_message = NULL;
+
+        g_assert_true(sr_string_to_file(path, (char *)contents[i],
+                                        &error_message));
+
+        /* Nothing from the invalid file is added. */
+        g_assert_false(sr_callgraph_index_load(index, path, BUILD_ID,
+                                               &error_message));
+        g_assert_nonnull(error_message);
+        g_free(error_message);
+
+        assert_index_equal(index, expected);
+        g_assert_null(sr_callgraph_index_find(index, 0x402000));
+
+        sr_callgraph_index_free(index);
+        sr_callgraph_index_free(expected);
+    }
+
+    unlink(path);
+    g_free(path);
+}
+
+static void
+test_callgraph_cache_extend(void)
+{
+    struct sr_callgraph_index *expected = create_index();
+    struct sr_callgraph_index *index = sr_callgraph_index_new();
+    const char *cache_dir = g_get_tmp_dir();
+    char *build_id = g_strdup_printf("satyr-test-%d", (int)getpid());
+    char *path = sr_callgraph_cache_path(cache_dir, build_id);
+    char *error_message = NULL;
+
+    g_assert_true(sr_callgraph_index_save(expected, path, build_id,
+                                          &error_message));
+
+    /* The function is found in the cache, so it is not disassembled. */
+    g_assert_true(sr_callgraph_index_extend_cached(index, 0x401200, NULL, NULL,
+                                                   cache_dir, build_id,
+                                                   &error_message));
+    assert_index_equal(index, expected);
+
+    unlink(path);
+    g_free(path);
+    g_free(build_id);
+    sr_callgraph_index_free(index);
+    sr_callgraph_index_free(expected);
+}
+
+struct save_data
+{
+    struct sr_callgraph_index *index;
+    const char *path;
+};
+
+static gpointer
+save_repeatedly(gpointer data)
+{
+    struct save_data *save_data = data;
+
+    for (int i = 0; i < 50; i++)
+    {
+        char *error_message = NULL;
+
+        if (!sr_callgraph_index_save(save_data->index, save_data->path,
+                                     BUILD_ID, &error_message))
+        {
+            g_free(error_message);
+            return GINT_TO_POINTER(FALSE);
+        }
+    }
+
+    return GINT_TO_POINTER(TRUE);
+}
+
+static void
+test_callgraph_cache_concurrent_save(void)
+{
+    struct sr_callgraph_index *expected = create_index();
+    struct sr_callgraph_index *index = sr_callgraph_index_new();
+    char *path = create_cache_path();
+    struct save_data data = { expected, path };
+    GThread *threads[4];
+    char *error_message = NULL;
+
+    /* Every writer uses its own temporary file. */
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+        threads[i] = g_thread_new("save", save_repeatedly, &data);
+
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+        g_assert_true(GPOINTER_TO_INT(g_thread_join(threads[i])));
+
+    g_assert_true(sr_callgraph_index_load(index, path, BUILD_ID,
+                                          &error_message));
+    assert_index_equal(index, expected);
+
+    /* The temporary file cannot be created. */
+    char *missing = g_strdup_printf("%s.missing/cache", path);
+    g_assert_false(sr_callgraph_index_save(expected, missing, BUILD_ID,
+                                           &error_message));
+    g_assert_nonnull(error_message);
+    g_free(error_message);
+
+    g_free(missing);
+    unlink(path);
+    g_free(path);
+    sr_callgraph_index_free(index);
+    sr_callgraph_index_free(expected);
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/callgraph/cache/round-trip", test_callgraph_cache_round_trip);
+    g_test_add_func("/callgraph/cache/corrupted", test_callgraph_cache_corrupted);
+    g_test_add_func("/callgraph/cache/extend", test_callgraph_cache_extend);
+    g_test_add_func("/callgraph/cache/concurrent-save",
+                    test_callgraph_cache_concurrent_save);
+
+    return g_test_run();
+}
@@ -2,6 +2,8 @@
 #include <distance.h>
 
 #include <glib.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 static void
 test_distances_cluster_objects_1(void)
@@ -68,6 +70,325 @@ test_distances_cluster_objects_2(void)
     sr_dendrogram_free(dendrogram);
 }
 
+static void
+test_distances_cluster_objects_linkage(void)
+{
+    struct sr_distances *distances;
+    struct sr_dendrogram *dendrogram;
+
+    distances = sr_distances_new(3, 4);
+
+    sr_distances_set_distance(distances, 0, 1, 1.0);
+    sr_distances_set_distance(distances, 0, 2, 0.5);
+    sr_distances_set_distance(distances, 0, 3, 0.0);
+    sr_distances_set_distance(distances, 1, 2, 0.1);
+    sr_distances_set_distance(distances, 1, 3, 0.3);
+    sr_distances_set_distance(distances, 2, 3, 0.7);
+
+    dendrogram = sr_distances_cluster_objects_linkage(distances,
+                                                      SR_CLUSTER_LINKAGE_SINGLE);
+
+    g_assert_cmpint(dendrogram->order[0], ==, 0);
+    g_assert_cmpint(dendrogram->order[1], ==, 3);
+    g_assert_cmpint(dendrogram->order[2], ==, 1);
+    g_assert_cmpint(dendrogram->order[3], ==, 2);
+
+    g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[0], 0.0, 1e-6);
+    g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[1], 0.3, 1e-6);
+    g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[2], 0.1, 1e-6);
+    sr_dendrogram_free(dendrogram);
+
+    dendrogram = sr_distances_cluster_objects_linkage(distances,
+                                                      SR_CLUSTER_LINKAGE_COMPLETE);
+
+    g_assert_cmpint(dendrogram->order[0], ==, 0);
+    g_assert_cmpint(dendrogram->order[1], ==, 3);
+    g_assert_cmpint(dendrogram->order[2], ==, 1);
+    g_assert_cmpint(dendrogram->order[3], ==, 2);
+
+    g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[0], 0.0, 1e-6);
+    g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[1], 1.0, 1e-6);
+    g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[2], 0.1, 1e-6);
+    sr_dendrogram_free(dendrogram);
+
+    sr_distances_free(distances);
+}
+
+static void
+test_distances_cluster_objects_ties(void)
+{
+    struct sr_distances *distances;
+    struct sr_dendrogram *dendrogram;
+    const int n = 6;
+
+    /* All objects are equally distant, the first pair in the matrix is
+     * merged first. */
+    distances = sr_distances_new(n - 1, n);
+
+    for (int i = 0; i < n - 1; i++)
+    {
+        for (int j = i + 1; j < n; j++)
+            sr_distances_set_distance(distances, i, j, 0.5);
+    }
+
+    dendrogram = sr_distances_cluster_objects(distances);
+    sr_distances_free(distances);
+
+    for (int i = 0; i < n; i++)
+        g_assert_cmpint(dendrogram->order[i], ==, i);
+
+    for (int i = 0; i < n - 1; i++)
+        g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[i], 0.5, 1e-6);
+
+    sr_dendrogram_free(dendrogram);
+}
+
+static int
+compare_floats(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Sorted merge levels of clustering that searches the whole matrix for the
+ * closest pair on every merge. */
+static float *
+reference_merge_levels(struct sr_distances *distances,
+                       enum sr_cluster_linkage linkage)
+{
+    int m = distances->m, n = distances->n;
+    struct sr_distances *d = sr_distances_dup(distances);
+    int *sizes = g_new(int, n);
+    float *levels = g_new(float, n - 1);
+
+    for (int i = 0; i < n; i++)
+        sizes[i] = 1;
+
+    for (int k = 0; k < n - 1; k++)
+    {
+        int c1 = -1, c2 = -1;
+        float min_dist = 0.0;
+
+        for (int i = 0; i < m; i++)
+        {
+            for (int j = i + 1; j < n; j++)
+            {
+                if (!sizes[i] || !sizes[j])
+                    continue;
+
+                float dist = sr_distances_get_distance(d, i, j);
+                if (c1 < 0 || min_dist > dist)
+                {
+                    c1 = i;
+                    c2 = j;
+                    min_dist = dist;
+                }
+            }
+        }
+
+        levels[k] = min_dist;
+
+        for (int i = 0; i < n; i++)
+        {
+            if (!sizes[i] || i == c1 || i == c2 || (i >= m && c2 >= m))
+                continue;
+
+            float dist1 = sr_distances_get_distance(d, i, c1);
+            float dist2 = sr_distances_get_distance(d, i, c2);
+            float dist;
+
+            if (linkage == SR_CLUSTER_LINKAGE_SINGLE)
+                dist = MIN(dist1, dist2);
+            else if (linkage == SR_CLUSTER_LINKAGE_COMPLETE)
+                dist = MAX(dist1, dist2);
+            else
+                dist = (dist1 * sizes[c1] + dist2 * sizes[c2]) /
+                       (sizes[c1] + sizes[c2]);
+
+            sr_distances_set_distance(d, i, c1, dist);
+        }
+
+        sizes[c1] += sizes[c2];
+        sizes[c2] = 0;
+    }
+
+    qsort(levels, n - 1, sizeof(*levels), compare_floats);
+
+    sr_distances_free(d);
+    g_free(sizes);
+
+    return levels;
+}
+
+static void
+test_distances_cluster_objects_reference(void)
+{
+    const enum sr_cluster_linkage linkages[] = {
+        SR_CLUSTER_LINKAGE_SINGLE,
+        SR_CLUSTER_LINKAGE_COMPLETE,
+        SR_CLUSTER_LINKAGE_AVERAGE,
+    };
+    guint32 seed = 42;
+
+    for (int t = 0; t < 60; t++)
+    {
+        int n = 2 + t, m = t % 3 ? n - 1 : 1 + t / 2;
+        struct sr_distances *distances = sr_distances_new(m, n);
+
+        for (int i = 0; i < m; i++)
+        {
+            for (int j = i + 1; j < n; j++)
+            {
+                float dist;
+
+                seed = seed * 1103515245 + 12345;
+
+                /* Few distinct distances make ties likely. Every other
+                 * matrix attracts the first half of the objects to the
+                 * object merged last, which loses the nearest clusters
+                 * of many rows on every merge. */
+                if (t % 2)
+                    dist = (seed >> 16) % 5 / 4.0;
+                else if (i < n / 2)
+                    dist = j < n / 2 ? 8.0 : 5.0 - 1e-3 * (j - n / 2);
+                else
+                    dist = i == n / 2 ? 1e-3 * (n - j) : 1.0;
+
+                sr_distances_set_distance(distances, i, j, dist);
+            }
+        }
+
+        for (size_t k = 0; k < G_N_ELEMENTS(linkages); k++)
+        {
+            struct sr_dendrogram *dendrogram =
+                sr_distances_cluster_objects_linkage(distances, linkages[k]);
+            float *expected = reference_merge_levels(distances, linkages[k]);
+
+            qsort(dendrogram->merge_levels, n - 1,
+                  sizeof(*dendrogram->merge_levels), compare_floats);
+
+            for (int i = 0; i < n - 1; i++)
+            {
+                g_assert_cmpfloat_with_epsilon(dendrogram->merge_levels[i],
+                                               expected[i], 1e-6);
+            }
+
+            g_free(expected);
+            sr_dendrogram_free(dendrogram);
+        }
+
+        sr_distances_free(distances);
+    }
+}
+
+static void
+assert_dendrograms_equal(struct sr_dendrogram *dendrogram,
+                         struct sr_dendrogram *expected)
+{
+    g_assert_cmpint(dendrogram->size, ==, expected->size);
+
+    for (int i = 0; i < expected->size; i++)
+        g_assert_cmpint(dendrogram->order[i], ==, expected->order[i]);
+
+    for (int i = 0; i < expected->size - 1; i++)
+    {
+        g_assert_cmpfloat(dendrogram->merge_levels[i], ==,
+                          expected->merge_levels[i]);
+    }
+}
+
+static void
+test_distances_cluster_objects_in_place(void)
+{
+    const enum sr_distances_encoding encodings[] = {
+        SR_DISTANCES_FLOAT32,
+        SR_DISTANCES_UINT8,
+    };
+    guint32 seed = 7;
+    char *path;
+
+    int fd = g_file_open_tmp("satyr-cluster-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    for (int t = 0; t < 4; t++)
+    {
+        int n = 40, m = t % 2 ? n - 1 : n / 2;
+        struct sr_distances *reference = sr_distances_new(m, n);
+
+        for (int i = 0; i < m; i++)
+        {
+            for (int j = i + 1; j < n; j++)
+            {
+                seed = seed * 1103515245 + 12345;
+                sr_distances_set_distance(reference, i, j,
+                                          (seed >> 16) % 256 / 255.0);
+            }
+        }
+
+        for (size_t k = 0; k < G_N_ELEMENTS(encodings); k++)
+        {
+            enum sr_cluster_linkage linkage = t / 2 ? SR_CLUSTER_LINKAGE_AVERAGE
+                                                    : SR_CLUSTER_LINKAGE_COMPLETE;
+            char *error_message = NULL;
+
+            g_assert_true(sr_distances_save(reference, path, SR_DISTANCE_JACCARD,
+                                            encodings[k], &error_message));
+
+            struct sr_distances *distances = sr_distances_load(path, NULL,
+                                                               &error_message);
+            struct sr_distances *objects = sr_distances_load(path, NULL,
+                                                             &error_message);
+            g_assert_nonnull(distances);
+            g_assert_nonnull(objects);
+            g_assert_true((distances->mapping != NULL) ==
+                          (encodings[k] == SR_DISTANCES_FLOAT32));
+
+            struct sr_dendrogram *expected =
+                sr_distances_cluster_objects_linkage(objects, linkage);
+            struct sr_dendrogram *dendrogram =
+                sr_distances_cluster_objects_in_place(distances, objects,
+                                                      linkage);
+
+            assert_dendrograms_equal(dendrogram, expected);
+            sr_dendrogram_free(dendrogram);
+            sr_distances_free(distances);
+
+            /* The file is not changed. */
+            distances = sr_distances_load(path, NULL, &error_message);
+            g_assert_nonnull(distances);
+            for (int i = 0; i < m; i++)
+            {
+                for (int j = i + 1; j < n; j++)
+                {
+                    g_assert_cmpfloat(sr_distances_get_distance(distances, i, j), ==,
+                                      sr_distances_get_distance(objects, i, j));
+                }
+            }
+
+            /* The objects are not needed unless the matrix is full. */
+            if (m + 1 != n)
+            {
+                dendrogram = sr_distances_cluster_objects_in_place(distances,
+                                                                   NULL,
+                                                                   linkage);
+                assert_dendrograms_equal(dendrogram, expected);
+                sr_dendrogram_free(dendrogram);
+            }
+
+            sr_dendrogram_free(expected);
+            sr_distances_free(distances);
+            sr_distances_free(objects);
+        }
+
+        sr_distances_free(reference);
+    }
+
+    unlink(path);
+    g_free(path);
+}
+
 static void
 test_dendrogram_cut_1(void)
 {
@@ -169,6 +490,70 @@ test_dendrogram_cut_2(void)
     sr_dendrogram_free(dendrogram);
 }
 
+static void
+test_cluster_assign(void)
+{
+    struct sr_distances *distances;
+    struct sr_dendrogram *dendrogram;
+    struct sr_cluster *clusters;
+    struct sr_cluster *cluster;
+
+    distances = sr_distances_new(5, 6);
+
+    sr_distances_set_distance(distances, 0, 1, 1.0);
+    sr_distances_set_distance(distances, 0, 2, 0.5);
+    sr_distances_set_distance(distances, 0, 3, 0.0);
+    sr_distances_set_distance(distances, 1, 2, 0.1);
+    sr_distances_set_distance(distances, 1, 3, 0.3);
+    sr_distances_set_distance(distances, 2, 3, 0.7);
+
+    /* Object 4 is close to the cluster {1, 2}, object 5 to nothing. */
+    sr_distances_set_distance(distances, 0, 4, 0.9);
+    sr_distances_set_distance(distances, 1, 4, 0.1);
+    sr_distances_set_distance(distances, 2, 4, 0.3);
+    sr_distances_set_distance(distances, 3, 4, 0.8);
+    sr_distances_set_distance(distances, 0, 5, 0.9);
+    sr_distances_set_distance(distances, 1, 5, 0.9);
+    sr_distances_set_distance(distances, 2, 5, 0.9);
+    sr_distances_set_distance(distances, 3, 5, 0.9);
+    sr_distances_set_distance(distances, 4, 5, 0.9);
+
+    dendrogram = sr_dendrogram_new(4);
+    dendrogram->order[0] = 0;
+    dendrogram->order[1] = 3;
+    dendrogram->order[2] = 1;
+    dendrogram->order[3] = 2;
+    dendrogram->merge_levels[0] = 0.0;
+    dendrogram->merge_levels[1] = 0.625;
+    dendrogram->merge_levels[2] = 0.1;
+
+    clusters = sr_dendrogram_cut(dendrogram, 0.3, 1);
+
+    cluster = sr_cluster_assign(clusters, distances, 4, 0.3,
+                                SR_CLUSTER_LINKAGE_AVERAGE);
+
+    g_assert_nonnull(cluster);
+    g_assert_cmpint(cluster->size, ==, 3);
+    g_assert_cmpint(cluster->objects[0], ==, 1);
+    g_assert_cmpint(cluster->objects[1], ==, 2);
+    g_assert_cmpint(cluster->objects[2], ==, 4);
+
+    /* Object 5 is too far from all clusters even with single linkage. */
+    cluster = sr_cluster_assign(clusters, distances, 5, 0.3,
+                                SR_CLUSTER_LINKAGE_SINGLE);
+    g_assert_null(cluster);
+
+    while (clusters)
+    {
+        cluster = clusters->next;
+        sr_cluster_free(clusters);
+        clusters = cluster;
+    }
+
+    sr_dendrogram_free(dendrogram);
+    sr_distances_free(distances);
+}
+
 int
 main(int    argc,
      char **argv)
@@ -177,8 +562,17 @@ main(int    argc,
 
     g_test_add_func("/cluster/objects-distances-1", test_distances_cluster_objects_1);
     g_test_add_func("/cluster/objects-distances-2", test_distances_cluster_objects_2);
+    g_test_add_func("/cluster/objects-distances-linkage",
+                    test_distances_cluster_objects_linkage);
+    g_test_add_func("/cluster/objects-distances-ties",
+                    test_distances_cluster_objects_ties);
+    g_test_add_func("/cluster/objects-distances-reference",
+                    test_distances_cluster_objects_reference);
+    g_test_add_func("/cluster/objects-distances-in-place",
+                    test_distances_cluster_objects_in_place);
     g_test_add_func("/dendrogram/cut-1", test_dendrogram_cut_1);
     g_test_add_func("/dendrogram/cut-2", test_dendrogram_cut_2);
+    g_test_add_func("/cluster/assign", test_cluster_assign);
 
     return g_test_run();
 }
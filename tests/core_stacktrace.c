@@ -8,10 +8,16 @@
 #include <core/unwind.h>
 #include <err.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
 #include <utils.h>
 #include <internal_unwind.h>
+#include <link.h>
 #include <stacktrace.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/procfs.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -345,6 +351,450 @@ test_core_stacktrace_from_gdb_limit(void)
     sr_core_stacktrace_free(core_stacktrace);
 }
 
+/* Skips the test if satyr is built without an unwinder, any other
+ * unwinding failure fails the test. */
+static void
+skip_without_unwinder(char *error_msg)
+{
+    g_assert_cmpstr(error_msg, ==, "satyr is built without unwind support");
+    g_test_skip(error_msg);
+    g_free(error_msg);
+}
+
+static struct sr_core_stacktrace *
+parse_coredump_timed(char const                *coredump_path,
+                     unsigned                   nthreads,
+                     struct sr_core_stacktrace *expected)
+{
+    struct sr_core_unwind_options options;
+    struct sr_core_stacktrace *stacktrace;
+    char *error_msg = NULL;
+    double elapsed;
+
+    sr_core_unwind_options_init(&options);
+    options.nthreads = nthreads;
+
+    g_test_timer_start();
+    stacktrace = sr_parse_coredump_with_options(coredump_path, dump_core_program,
+                                                &options, &error_msg);
+    elapsed = g_test_timer_elapsed();
+
+    /* The concurrent unwinding must give a result whenever the serial
+     * one did. */
+    if (NULL == stacktrace && NULL == expected)
+    {
+        skip_without_unwinder(error_msg);
+
+        return NULL;
+    }
+
+    g_assert_cmpstr(error_msg, ==, NULL);
+    g_assert_nonnull(stacktrace);
+
+    g_test_message("%u unwinding threads: %.3f s", nthreads, elapsed);
+
+    if (NULL != expected)
+    {
+        g_autofree char *json = sr_core_stacktrace_to_json(stacktrace);
+        g_autofree char *expected_json = sr_core_stacktrace_to_json(expected);
+
+        g_assert_cmpstr(json, ==, expected_json);
+    }
+
+    return stacktrace;
+}
+
+static void
+test_core_stacktrace_parse_coredump_threads(void)
+{
+    g_autoptr(GString) coredump_path = NULL;
+    g_autofree char *threads = NULL;
+    struct sr_core_stacktrace *serial;
+    struct sr_core_thread *thread;
+    /* The large core resembles the processes with hundreds of threads. */
+    int nthreads = g_test_perf() ? 400 : 16;
+    int count;
+
+    threads = g_strdup_printf("%d", nthreads);
+    coredump_path = run_and_get_stdout((char const *[]) {
+        dump_core_program,
+        "64",
+        threads,
+        NULL,
+    });
+
+    g_assert_nonnull(coredump_path);
+    g_assert_cmpuint(strlen(coredump_path->str), >, 0);
+
+    serial = parse_coredump_timed(coredump_path->str, 1, NULL);
+    if (NULL == serial)
+    {
+        unlink(coredump_path->str);
+
+        return;
+    }
+
+    count = 0;
+    for (thread = serial->threads; NULL != thread; thread = thread->next)
+    {
+        count++;
+    }
+
+    g_assert_cmpint(count, ==, nthreads + 1);
+
+    /* Concurrent unwinding gives the same threads in the same order. */
+    sr_core_stacktrace_free(parse_coredump_timed(coredump_path->str, 4, serial));
+    sr_core_stacktrace_free(parse_coredump_timed(coredump_path->str, 0, serial));
+
+    sr_core_stacktrace_free(serial);
+    unlink(coredump_path->str);
+}
+
+static void
+test_core_stacktrace_parse_coredump_budget(void)
+{
+    g_autoptr(GString) coredump_path = NULL;
+    struct sr_core_unwind_options options;
+    struct sr_core_stacktrace *stacktrace;
+    struct sr_core_thread *thread;
+    struct sr_core_frame *frame;
+    char *error_msg = NULL;
+    int threads;
+    int frames;
+
+    coredump_path = run_and_get_stdout((char const *[]) {
+        dump_core_program,
+        "64",
+        "8",
+        NULL,
+    });
+
+    g_assert_nonnull(coredump_path);
+    g_assert_cmpuint(strlen(coredump_path->str), >, 0);
+
+    sr_core_unwind_options_init(&options);
+    options.crash_thread_only = true;
+    options.max_thread_frames = 10;
+
+    stacktrace = sr_parse_coredump_with_options(coredump_path->str, dump_core_program,
+                                                &options, &error_msg);
+    if (NULL == stacktrace)
+    {
+        skip_without_unwinder(error_msg);
+        unlink(coredump_path->str);
+
+        return;
+    }
+
+    g_assert_true(stacktrace->only_crash_thread);
+    g_assert_nonnull(stacktrace->threads);
+    g_assert_null(stacktrace->threads->next);
+    g_assert_true(stacktrace->crash_thread == stacktrace->threads);
+
+    frames = 0;
+    for (frame = stacktrace->threads->frames; NULL != frame; frame = frame->next)
+    {
+        frames++;
+    }
+
+    g_assert_cmpint(frames, ==, 10);
+    sr_core_stacktrace_free(stacktrace);
+
+    /* The total budget cuts the threads short and leaves out the rest. */
+    sr_core_unwind_options_init(&options);
+    options.max_frames = 100;
+
+    stacktrace = sr_parse_coredump_with_options(coredump_path->str, dump_core_program,
+                                                &options, &error_msg);
+    g_assert_cmpstr(error_msg, ==, NULL);
+
+    threads = 0;
+    frames = 0;
+    for (thread = stacktrace->threads; NULL != thread; thread = thread->next)
+    {
+        threads++;
+
+        for (frame = thread->frames; NULL != frame; frame = frame->next)
+        {
+            frames++;
+        }
+    }
+
+    g_assert_cmpint(threads, <, 9);
+    g_assert_cmpint(frames, ==, 100);
+    sr_core_stacktrace_free(stacktrace);
+
+    unlink(coredump_path->str);
+}
+
+static void
+test_core_stacktrace_unwind_session(void)
+{
+    g_autoptr(GString) coredump_path = NULL;
+    struct sr_unwind_session *session;
+    struct sr_core_stacktrace *expected;
+    g_autofree char *expected_json = NULL;
+    char *error_msg = NULL;
+
+    coredump_path = run_and_get_stdout((char const *[]) {
+        dump_core_program,
+        "16",
+        "4",
+        NULL,
+    });
+
+    g_assert_nonnull(coredump_path);
+    g_assert_cmpuint(strlen(coredump_path->str), >, 0);
+
+    expected = sr_parse_coredump(coredump_path->str, dump_core_program, &error_msg);
+    if (NULL == expected)
+    {
+        skip_without_unwinder(error_msg);
+        unlink(coredump_path->str);
+
+        return;
+    }
+
+    expected_json = sr_core_stacktrace_to_json(expected);
+    session = sr_unwind_session_new();
+
+    /* The second time the files and functions come from the session. */
+    for (int i = 0; i < 2; i++)
+    {
+        struct sr_core_stacktrace *stacktrace;
+        g_autofree char *json = NULL;
+
+        stacktrace = sr_unwind_session_parse_coredump(session, coredump_path->str,
+                                                      dump_core_program, NULL,
+                                                      &error_msg);
+        g_assert_cmpstr(error_msg, ==, NULL);
+
+        json = sr_core_stacktrace_to_json(stacktrace);
+        g_assert_cmpstr(json, ==, expected_json);
+
+        sr_core_stacktrace_free(stacktrace);
+    }
+
+    sr_unwind_session_free(session);
+    sr_core_stacktrace_free(expected);
+    unlink(coredump_path->str);
+}
+
+/* Reads the file like a pipe that cannot seek. */
+static ssize_t
+read_unseekable(void   *data,
+                void   *buffer,
+                size_t  size)
+{
+    return read(*(int *)data, buffer, size);
+}
+
+static void
+test_core_stacktrace_parse_coredump_stream(void)
+{
+    g_autoptr(GString) coredump_path = NULL;
+    struct sr_core_unwind_options options;
+    struct sr_core_stacktrace *expected;
+    g_autofree char *expected_json = NULL;
+    char *error_msg = NULL;
+
+    coredump_path = run_and_get_stdout((char const *[]) {
+        dump_core_program,
+        "16",
+        "4",
+        NULL,
+    });
+
+    g_assert_nonnull(coredump_path);
+    g_assert_cmpuint(strlen(coredump_path->str), >, 0);
+
+    expected = sr_parse_coredump(coredump_path->str, dump_core_program, &error_msg);
+    if (NULL == expected)
+    {
+        skip_without_unwinder(error_msg);
+        unlink(coredump_path->str);
+
+        return;
+    }
+
+    expected_json = sr_core_stacktrace_to_json(expected);
+    sr_core_unwind_options_init(&options);
+
+    /* Seekable and unseekable streams, keeping the big segments or not. */
+    for (int i = 0; i < 4; i++)
+    {
+        struct sr_core_stacktrace *stacktrace;
+        struct sr_core_stream *stream;
+        g_autofree char *json = NULL;
+        int fd;
+
+        fd = open(coredump_path->str, O_RDONLY);
+        g_assert_cmpint(fd, >=, 0);
+
+        if (i % 2 == 0)
+        {
+            stream = sr_core_stream_new_fd(fd);
+        }
+        else
+        {
+            stream = sr_core_stream_new(read_unseekable, NULL, &fd);
+        }
+
+        /* Zero keeps all segments. */
+        if (i == 2)
+        {
+            options.stream_segment_limit = 0;
+        }
+
+        options.nthreads = 2;
+
+        stacktrace = sr_unwind_session_parse_coredump_stream(NULL, stream,
+                                                             dump_core_program,
+                                                             &options, &error_msg);
+
+        /* Only the elfutils unwinder reads streams. */
+        if (NULL == stacktrace && g_str_has_suffix(error_msg, "with libunwind"))
+        {
+            g_test_skip(error_msg);
+            g_free(error_msg);
+            sr_core_stream_free(stream);
+            close(fd);
+
+            break;
+        }
+
+        g_assert_cmpstr(error_msg, ==, NULL);
+
+        json = sr_core_stacktrace_to_json(stacktrace);
+        g_assert_cmpstr(json, ==, expected_json);
+
+        sr_core_stacktrace_free(stacktrace);
+        sr_core_stream_free(stream);
+        close(fd);
+    }
+
+    sr_core_stacktrace_free(expected);
+    unlink(coredump_path->str);
+}
+
+/* A coredump of a thread whose register points into a single segment
+ * that is too large to be kept in memory. */
+struct huge_coredump
+{
+    ElfW(Ehdr) ehdr;
+    ElfW(Phdr) phdrs[2];
+    ElfW(Nhdr) nhdr;
+    char name[8];
+    unsigned char prstatus[sizeof(struct elf_prstatus)];
+};
+
+struct huge_coredump_reader
+{
+    struct huge_coredump coredump;
+    size_t pos;
+};
+
+/* Reads the headers and the notes, the segment data are missing. */
+static ssize_t
+read_huge_coredump(void   *data,
+                   void   *buffer,
+                   size_t  size)
+{
+    struct huge_coredump_reader *reader = data;
+
+    size = MIN(size, sizeof(reader->coredump) - reader->pos);
+    memcpy(buffer, (char *)&reader->coredump + reader->pos, size);
+    reader->pos += size;
+
+    return size;
+}
+
+static void
+test_core_stacktrace_parse_coredump_stream_limits(void)
+{
+    struct huge_coredump_reader reader = { .pos = 0 };
+    struct huge_coredump *coredump = &reader.coredump;
+    struct sr_core_unwind_options options;
+
+    memcpy(coredump->ehdr.e_ident, ELFMAG, SELFMAG);
+    coredump->ehdr.e_ident[EI_CLASS] = __ELF_NATIVE_CLASS == 64 ? ELFCLASS64 : ELFCLASS32;
+    coredump->ehdr.e_ident[EI_DATA] = G_BYTE_ORDER == G_LITTLE_ENDIAN ? ELFDATA2LSB : ELFDATA2MSB;
+    coredump->ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    coredump->ehdr.e_type = ET_CORE;
+    coredump->ehdr.e_version = EV_CURRENT;
+    coredump->ehdr.e_phoff = offsetof(struct huge_coredump, phdrs);
+    coredump->ehdr.e_ehsize = sizeof(coredump->ehdr);
+    coredump->ehdr.e_phentsize = sizeof(ElfW(Phdr));
+    coredump->ehdr.e_phnum = G_N_ELEMENTS(coredump->phdrs);
+
+    coredump->phdrs[0].p_type = PT_NOTE;
+    coredump->phdrs[0].p_offset = offsetof(struct huge_coredump, nhdr);
+    coredump->phdrs[0].p_filesz = offsetof(struct huge_coredump, prstatus) +
+        sizeof(coredump->prstatus) - coredump->phdrs[0].p_offset;
+
+    coredump->nhdr.n_namesz = sizeof("CORE");
+    coredump->nhdr.n_descsz = sizeof(struct elf_prstatus);
+    coredump->nhdr.n_type = NT_PRSTATUS;
+    strcpy(coredump->name, "CORE");
+
+    struct elf_prstatus prstatus = { .pr_pid = 1 };
+    ((elf_greg_t *)&prstatus.pr_reg)[0] = 0x10001000;
+    memcpy(coredump->prstatus, &prstatus, sizeof(prstatus));
+
+    coredump->phdrs[1].p_type = PT_LOAD;
+    coredump->phdrs[1].p_offset = 0x10000;
+    coredump->phdrs[1].p_vaddr = 0x10000000;
+    coredump->phdrs[1].p_flags = PF_R | PF_W;
+
+    sr_core_unwind_options_init(&options);
+
+    /* Larger than the limit of the image, and than the address space. */
+    for (int i = 0; i < 2; i++)
+    {
+        struct sr_core_stream *stream;
+        struct sr_core_stacktrace *stacktrace;
+        g_autofree char *error_msg = NULL;
+        g_autofree char *expected = NULL;
+
+        if (i == 0)
+        {
+            options.stream_image_limit = 1024 * 1024 * 1024;
+            coredump->phdrs[1].p_filesz = (ElfW(Off))2 * 1024 * 1024 * 1024 - 1;
+            expected = g_strdup("The segments kept from the coredump stream "
+                                "take more than 1073741824 bytes");
+        }
+        else
+        {
+            options.stream_image_limit = 0;
+            coredump->phdrs[1].p_filesz = (ElfW(Off))-1;
+            expected = g_strdup_printf("Segment of %"PRIu64" bytes in the "
+                                       "coredump stream does not fit in memory",
+                                       (uint64_t)coredump->phdrs[1].p_filesz);
+        }
+
+        coredump->phdrs[1].p_memsz = coredump->phdrs[1].p_filesz;
+        reader.pos = 0;
+
+        stream = sr_core_stream_new(read_huge_coredump, NULL, &reader);
+        stacktrace = sr_unwind_session_parse_coredump_stream(NULL, stream, NULL,
+                                                             &options, &error_msg);
+        sr_core_stream_free(stream);
+
+        g_assert_null(stacktrace);
+        g_assert_nonnull(error_msg);
+
+        if (g_str_has_suffix(error_msg, "with libunwind") ||
+            g_str_has_suffix(error_msg, "without unwind support"))
+        {
+            g_test_skip(error_msg);
+            return;
+        }
+
+        /* Rejected before the missing data are read. */
+        g_assert_cmpstr(error_msg, ==, expected);
+    }
+}
+
 int
 main(int    argc,
      char **argv)
@@ -354,6 +804,16 @@ main(int    argc,
     g_test_add_func("/stacktrace/core/to-json", test_core_stacktrace_to_json);
     g_test_add_func("/stacktrace/core/from-json", test_core_stacktrace_from_json);
     g_test_add_func("/stacktrace/core/from-gdb-limit", test_core_stacktrace_from_gdb_limit);
+    g_test_add_func("/stacktrace/core/parse-coredump-threads",
+                    test_core_stacktrace_parse_coredump_threads);
+    g_test_add_func("/stacktrace/core/parse-coredump-budget",
+                    test_core_stacktrace_parse_coredump_budget);
+    g_test_add_func("/stacktrace/core/unwind-session",
+                    test_core_stacktrace_unwind_session);
+    g_test_add_func("/stacktrace/core/parse-coredump-stream",
+                    test_core_stacktrace_parse_coredump_stream);
+    g_test_add_func("/stacktrace/core/parse-coredump-stream-limits",
+                    test_core_stacktrace_parse_coredump_stream_limits);
 
     return g_test_run();
 }
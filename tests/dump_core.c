@@ -7,6 +7,7 @@
 #endif
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,6 +16,10 @@
 
 static char const *prefix = "/tmp/satyr.core";
 
+/* Additional threads wait here at their depth until the core is dumped. */
+static pthread_barrier_t barrier;
+static int thread_depth;
+
 #if defined(__clang__)
 __attribute__((optnone))  
 #else
@@ -94,15 +99,67 @@ dump_core(int    depth,
     return true;
 }
 
+#if defined(__clang__)
+__attribute__((optnone))
+#else
+__attribute__((optimize((0))))
+#endif
+static void
+wait_for_dump(int depth)
+{
+    if (--depth > 0)
+    {
+        wait_for_dump(depth);
+
+        return;
+    }
+
+    pthread_barrier_wait(&barrier);
+    pause();
+}
+
+static void *
+thread_main(void *arg)
+{
+    wait_for_dump(thread_depth);
+
+    return NULL;
+}
+
 int
 main (int    argc,
       char **argv)
 {
     int depth;
+    int threads = 0;
     char *name = NULL;
 
     depth = atoi(argv[1]);
 
+    /* Optionally, the process has more threads of the same depth. */
+    if (argc > 2)
+    {
+        threads = atoi(argv[2]);
+    }
+
+    if (threads > 0)
+    {
+        thread_depth = depth;
+        pthread_barrier_init(&barrier, NULL, threads + 1);
+
+        for (int i = 0; i < threads; i++)
+        {
+            pthread_t thread;
+
+            if (pthread_create(&thread, NULL, thread_main, NULL) != 0)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+
+        pthread_barrier_wait(&barrier);
+    }
+
     if (!dump_core(depth, &name))
     {
         return EXIT_FAILURE;
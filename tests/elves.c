@@ -0,0 +1,227 @@
+#include <elves.h>
+#include <utils.h>
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The test program itself is the ELF binary that is read. */
+#define BINARY "/proc/self/exe"
+
+static bool
+skip_without_elfutils(char *error_message)
+{
+    if (g_strcmp0(error_message, "satyr compiled without elfutils") != 0)
+        return false;
+
+    g_test_skip(error_message);
+    g_free(error_message);
+    return true;
+}
+
+static int
+fde_cmp(const void *a, const void *b)
+{
+    const struct sr_elf_fde *x = a, *y = b;
+
+    if (x->start_address != y->start_address)
+        return x->start_address < y->start_address ? -1 : 1;
+
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+/* The last FDE containing the offset of those that start closest to
+ * it. */
+static struct sr_elf_fde *
+find_fde_linear(struct sr_elf_eh_frame *eh_frame, uint64_t offset)
+{
+    struct sr_elf_fde *result = NULL;
+
+    for (size_t i = 0; i < eh_frame->count; i++)
+    {
+        struct sr_elf_fde *fde = &eh_frame->fdes[i];
+
+        if (offset < fde->start_address ||
+            offset >= fde->start_address + fde->length)
+            continue;
+
+        if (!result || fde->start_address >= result->start_address)
+            result = fde;
+    }
+
+    return result;
+}
+
+static void
+assert_fde_equal(struct sr_elf_fde *fde, struct sr_elf_fde *expected)
+{
+    if (!expected)
+    {
+        g_assert_null(fde);
+        return;
+    }
+
+    g_assert_nonnull(fde);
+    g_assert_cmpuint(fde->start_address, ==, expected->start_address);
+    g_assert_cmpuint(fde->length, ==, expected->length);
+}
+
+static void
+assert_eh_frame_lookups(struct sr_elf_eh_frame *eh_frame)
+{
+    g_assert_cmpuint(eh_frame->count, >, 0);
+
+    for (size_t i = 0; i < eh_frame->count; i++)
+    {
+        struct sr_elf_fde *fde = &eh_frame->fdes[i];
+        uint64_t offsets[] =
+        {
+            fde->start_address - 1,
+            fde->start_address,
+            fde->start_address + fde->length / 2,
+            fde->start_address + fde->length - 1,
+            fde->start_address + fde->length,
+        };
+
+        if (i > 0)
+        {
+            g_assert_cmpuint(eh_frame->fdes[i - 1].start_address, <=,
+                             fde->start_address);
+        }
+
+        for (size_t j = 0; j < G_N_ELEMENTS(offsets); j++)
+        {
+            assert_fde_equal(sr_elf_find_fde_for_offset(eh_frame, offsets[j]),
+                             find_fde_linear(eh_frame, offsets[j]));
+        }
+
+        struct sr_elf_fde *found = sr_elf_find_fde_for_start_address(
+            eh_frame, eh_frame->exec_base + fde->start_address);
+        g_assert_nonnull(found);
+        g_assert_cmpuint(found->start_address, ==, fde->start_address);
+
+        assert_fde_equal(sr_elf_find_fde_for_address(
+                             eh_frame, eh_frame->exec_base + fde->start_address),
+                         find_fde_linear(eh_frame, fde->start_address));
+    }
+
+    struct sr_elf_fde *last = &eh_frame->fdes[eh_frame->count - 1];
+    g_assert_null(sr_elf_find_fde_for_offset(eh_frame,
+                                             last->start_address + UINT32_MAX));
+}
+
+/* Copies the binary with .eh_frame_hdr renamed, so that the FDEs are
+ * read from .eh_frame alone. */
+static char *
+copy_without_eh_frame_hdr(void)
+{
+    static const char name[] = "\0.eh_frame_hdr";
+    g_autofree char *contents = NULL;
+    gsize length;
+    char *path;
+    bool renamed = false;
+
+    g_assert_true(g_file_get_contents(BINARY, &contents, &length, NULL));
+
+    for (gsize i = 0; i + sizeof(name) <= length; i++)
+    {
+        if (memcmp(contents + i, name, sizeof(name)) == 0)
+        {
+            contents[i + sizeof(name) - 2] = 'x';
+            renamed = true;
+        }
+    }
+
+    g_assert_true(renamed);
+
+    int fd = g_file_open_tmp("satyr-elves-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    g_assert_true(g_file_set_contents(path, contents, length, NULL));
+
+    return path;
+}
+
+static void
+test_elves_eh_frame(void)
+{
+    char *error_message = NULL;
+    struct sr_elf_eh_frame *eh_frame = sr_elf_get_eh_frame(BINARY,
+                                                           &error_message);
+
+    if (!eh_frame && skip_without_elfutils(error_message))
+        return;
+
+    g_assert_null(error_message);
+    g_assert_nonnull(eh_frame);
+    assert_eh_frame_lookups(eh_frame);
+
+    /* The FDEs of the whole .eh_frame match its binary search table. */
+    char *path = copy_without_eh_frame_hdr();
+    struct sr_elf_eh_frame *scanned = sr_elf_get_eh_frame(path, &error_message);
+
+    g_assert_null(error_message);
+    g_assert_nonnull(scanned);
+    assert_eh_frame_lookups(scanned);
+
+    g_assert_cmpuint(scanned->exec_base, ==, eh_frame->exec_base);
+    g_assert_cmpuint(scanned->count, ==, eh_frame->count);
+
+    /* Entries starting at the same offset may come in any order. */
+    qsort(eh_frame->fdes, eh_frame->count, sizeof(struct sr_elf_fde), fde_cmp);
+    qsort(scanned->fdes, scanned->count, sizeof(struct sr_elf_fde), fde_cmp);
+    for (size_t i = 0; i < eh_frame->count; i++)
+        assert_fde_equal(&scanned->fdes[i], &eh_frame->fdes[i]);
+
+    unlink(path);
+    g_free(path);
+    sr_elf_eh_frame_free(scanned);
+    sr_elf_eh_frame_free(eh_frame);
+}
+
+static void
+test_elves_plt(void)
+{
+    char *error_message = NULL;
+    struct sr_elf_plt *plt = sr_elf_get_procedure_linkage_table(BINARY,
+                                                               &error_message);
+
+    if (!plt && skip_without_elfutils(error_message))
+        return;
+
+    g_assert_null(error_message);
+    g_assert_nonnull(plt);
+    g_assert_cmpuint(plt->count, >, 0);
+
+    for (size_t i = 0; i < plt->count; i++)
+    {
+        struct sr_elf_plt_entry *entry = &plt->entries[i];
+
+        if (i > 0)
+            g_assert_cmpuint(plt->entries[i - 1].address, <, entry->address);
+
+        g_assert_true(sr_elf_plt_find_for_address(plt, entry->address) == entry);
+        g_assert_null(sr_elf_plt_find_for_address(plt, entry->address + 1));
+
+        g_assert_nonnull(entry->symbol_name);
+        g_assert_true(entry->symbol_name >= plt->names);
+    }
+
+    g_assert_null(sr_elf_plt_find_for_address(plt, plt->entries[0].address - 1));
+
+    sr_elf_procedure_linkage_table_free(plt);
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/elves/eh-frame", test_elves_eh_frame);
+    g_test_add_func("/elves/plt", test_elves_plt);
+
+    return g_test_run();
+}
@@ -0,0 +1,127 @@
+/* Measures the throughput of the GDB stack trace parser.
+ *
+ * Usage: gdb_parse_bench [-a] [-r ROUNDS] FILE...
+ *
+ * Every file is parsed ROUNDS times (100 by default), into an arena
+ * with -a.  The throughput of every file and of all of them
+ * together is printed in MB/s.
+ */
+#include <arena.h>
+#include <gdb/stacktrace.h>
+#include <location.h>
+#include <utils.h>
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool
+parse_rounds(const char *text,
+             bool use_arena,
+             int rounds)
+{
+    for (int i = 0; i < rounds; i++)
+    {
+        struct sr_location location;
+        struct sr_gdb_stacktrace *stacktrace;
+        const char *input = text;
+
+        if (use_arena)
+        {
+            struct sr_arena *arena = sr_arena_new();
+            char *error_message = NULL;
+
+            if (!sr_arena_stacktrace_parse(arena, SR_REPORT_GDB, text,
+                                           &error_message))
+            {
+                fprintf(stderr, "%s\n", error_message);
+                g_free(error_message);
+                sr_arena_free(arena);
+                return false;
+            }
+
+            sr_arena_free(arena);
+            continue;
+        }
+
+        sr_location_init(&location);
+        stacktrace = sr_gdb_stacktrace_parse(&input, &location);
+
+        if (!stacktrace)
+        {
+            fprintf(stderr, "%d:%d: %s\n", location.line, location.column,
+                    location.message);
+            return false;
+        }
+
+        sr_gdb_stacktrace_free(stacktrace);
+    }
+
+    return true;
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    bool arena = false;
+    int rounds = 100;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (0 == strcmp(argv[i], "-a"))
+            arena = true;
+        else if (0 == strcmp(argv[i], "-r") && i + 1 < argc)
+            rounds = atoi(argv[++i]);
+        else
+            break;
+    }
+
+    if (i == argc || rounds <= 0)
+    {
+        fprintf(stderr, "Usage: %s [-a] [-r ROUNDS] FILE...\n", argv[0]);
+        return 2;
+    }
+
+    gint64 total_time = 0;
+    size_t total_size = 0;
+    int result = 0;
+
+    for (; i < argc; i++)
+    {
+        g_autofree char *error_message = NULL;
+        g_autofree char *text = sr_file_to_string(argv[i], &error_message);
+
+        if (!text)
+        {
+            fprintf(stderr, "%s\n", error_message);
+            result = 1;
+            continue;
+        }
+
+        gint64 start = g_get_monotonic_time();
+        if (!parse_rounds(text, arena, rounds))
+        {
+            fprintf(stderr, "%s: parsing failed\n", argv[i]);
+            result = 1;
+            continue;
+        }
+        gint64 time = MAX(g_get_monotonic_time() - start, 1);
+        size_t size = strlen(text) * rounds;
+
+        printf("%-50s %10zu B %8.1f MB/s\n", argv[i], strlen(text),
+               (double)size / time);
+
+        total_time += time;
+        total_size += size;
+    }
+
+    if (total_time > 0)
+        printf("%-50s %10zu B %8.1f MB/s\n", "total", total_size / rounds,
+               (double)total_size / total_time);
+
+    return result;
+}
@@ -1,7 +1,9 @@
 #include <gdb/sharedlib.h>
+#include <location.h>
 #include <utils.h>
 
 #include <glib.h>
+#include <string.h>
 
 static void
 test_gdb_sharedlib_parse(void)
@@ -48,6 +50,48 @@ test_gdb_sharedlib_count(void)
     }
 }
 
+static void
+test_gdb_sharedlib_parse_table(void)
+{
+    const char *input =
+        "From                To                  Syms Read   Shared Object Library\n"
+        "0x0000003848c05640  0x0000003848c10e48  Yes         /lib64/libpthread.so.0\n"
+        "                                        No          /usr/lib64/libfoo.so\n"
+        "0x0000003848a00b00  0x0000003848a1d4d0  Yes (*)     /lib64/ld-linux-x86-64.so.2\n"
+        "(*): Shared library is missing debugging information.\n";
+    const char *local_input = input;
+    struct sr_location location;
+    struct sr_gdb_sharedlib *libraries;
+
+    sr_location_init(&location);
+
+    /* Not at the beginning of the table. */
+    local_input = input + 1;
+    g_assert_null(sr_gdb_sharedlib_parse_table(&local_input, &location));
+    g_assert_true(local_input == input + 1);
+    g_assert_cmpint(location.line, ==, 1);
+
+    local_input = input;
+    libraries = sr_gdb_sharedlib_parse_table(&local_input, &location);
+    g_assert_cmpint(sr_gdb_sharedlib_count(libraries), ==, 3);
+    g_assert_cmpstr(libraries->next->soname, ==, "/usr/lib64/libfoo.so");
+    g_assert_true(libraries->next->from == UINT64_MAX);
+    g_assert_true(libraries->next->symbols == SYMS_WRONG);
+    g_assert_true(libraries->next->next->symbols == SYMS_NOT_FOUND);
+
+    /* The input is moved to the line following the table. */
+    g_assert_true(local_input == strstr(input, "(*):"));
+    g_assert_cmpint(location.line, ==, 5);
+    g_assert_cmpint(location.column, ==, 0);
+
+    while (libraries)
+    {
+        struct sr_gdb_sharedlib *library = libraries;
+        libraries = library->next;
+        sr_gdb_sharedlib_free(library);
+    }
+}
+
 static void
 test_gdb_sharedlib_append(void)
 {
@@ -107,6 +151,7 @@ main(int    argc,
 
     g_test_add_func("/gdb_sharedlib/parse", test_gdb_sharedlib_parse);
     g_test_add_func("/gdb_sharedlib/count", test_gdb_sharedlib_count);
+    g_test_add_func("/gdb_sharedlib/parse-table", test_gdb_sharedlib_parse_table);
     g_test_add_func("/gdb_sharedlib/append", test_gdb_sharedlib_append);
     g_test_add_func("/gdb_sharedlib/find-address", test_gdb_sharedlib_find_address);
 
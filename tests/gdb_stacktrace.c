@@ -1,9 +1,12 @@
+#include "arena.h"
 #include "stacktrace.h"
 #include "thread.h"
 #include "gdb/frame.h"
 #include "gdb/thread.h"
 #include "gdb/stacktrace.h"
+#include "gdb/sharedlib.h"
 #include "location.h"
+#include "normalize.h"
 #include "utils.h"
 #include <stdio.h>
 #include <glib.h>
@@ -230,6 +233,111 @@ test_gdb_stacktrace_parse_ppc64(void)
     sr_gdb_stacktrace_free(stacktrace);
 }
 
+static void
+test_gdb_stacktrace_parse_sharedlibs(void)
+{
+    const char *paths[] = {
+        "gdb_stacktraces/rhbz-621492",
+        "gdb_stacktraces/rhbz-803600",
+        "gdb_stacktraces/rhbz-955617",
+        "gdb_stacktraces/rhbz-1239318",
+        "gdb_stacktraces/no-thread-header",
+    };
+
+    for (int i = 0; i < sizeof (paths) / sizeof (*paths); i++)
+    {
+        char *error_message;
+        g_autofree char *full_input = sr_file_to_string(paths[i], &error_message);
+        g_assert_nonnull(full_input);
+
+        /* The table parsed on the way matches the one found in the
+         * whole input. */
+        struct sr_gdb_sharedlib *expected = sr_gdb_sharedlib_parse(full_input);
+
+        struct sr_location location;
+        sr_location_init(&location);
+        const char *input = full_input;
+        struct sr_gdb_stacktrace *stacktrace = sr_gdb_stacktrace_parse(&input, &location);
+        g_assert_nonnull(stacktrace);
+
+        g_assert_cmpint(sr_gdb_sharedlib_count(stacktrace->libs), ==, sr_gdb_sharedlib_count(expected));
+        for (struct sr_gdb_sharedlib *lib = stacktrace->libs, *expected_lib = expected;
+             lib;
+             lib = lib->next, expected_lib = expected_lib->next)
+        {
+            g_assert_true(lib->from == expected_lib->from);
+            g_assert_true(lib->to == expected_lib->to);
+            g_assert_cmpint(lib->symbols, ==, expected_lib->symbols);
+            g_assert_cmpstr(lib->soname, ==, expected_lib->soname);
+        }
+
+        while (expected)
+        {
+            struct sr_gdb_sharedlib *next = expected->next;
+            sr_gdb_sharedlib_free(expected);
+            expected = next;
+        }
+        sr_gdb_stacktrace_free(stacktrace);
+    }
+}
+
+static void
+test_gdb_stacktrace_parse_arena(void)
+{
+    const char *paths[] = {
+        "gdb_stacktraces/rhbz-621492",
+        "gdb_stacktraces/rhbz-803600",
+        "gdb_stacktraces/rhbz-1032472",
+        "gdb_stacktraces/rhbz-1119072",
+        "gdb_stacktraces/rhbz-1239318",
+        "gdb_stacktraces/no-thread-header",
+    };
+
+    for (int i = 0; i < sizeof (paths) / sizeof (*paths); i++)
+    {
+        char *error_message;
+        g_autofree char *full_input = sr_file_to_string(paths[i], &error_message);
+        g_assert_nonnull(full_input);
+
+        /* Parse the stacktrace both ways. */
+        struct sr_location location;
+        sr_location_init(&location);
+        const char *input = full_input;
+        struct sr_gdb_stacktrace *expected = sr_gdb_stacktrace_parse(&input, &location);
+        g_assert_nonnull(expected);
+
+        struct sr_arena *arena = sr_arena_new();
+        struct sr_gdb_stacktrace *stacktrace = (struct sr_gdb_stacktrace *)
+            sr_arena_stacktrace_parse(arena, SR_REPORT_GDB, full_input, &error_message);
+        g_assert_nonnull(stacktrace);
+        g_assert_cmpuint(sr_arena_size(arena), >, 0);
+
+        g_autofree char *expected_text = sr_gdb_stacktrace_to_text(expected, true);
+        g_autofree char *text = sr_gdb_stacktrace_to_text(stacktrace, true);
+        g_assert_cmpstr(text, ==, expected_text);
+
+        /* Renaming and removing frames works on the arena strings. */
+        sr_gdb_stacktrace_set_libnames(expected);
+        sr_gdb_stacktrace_set_libnames(stacktrace);
+        sr_normalize_gdb_stacktrace(expected);
+        sr_normalize_gdb_stacktrace(stacktrace);
+
+        g_autofree char *expected_normalized = sr_gdb_stacktrace_to_text(expected, true);
+        g_autofree char *normalized = sr_gdb_stacktrace_to_text(stacktrace, true);
+        g_assert_cmpstr(normalized, ==, expected_normalized);
+
+        /* A duplicated frame outlives the stacktrace. */
+        struct sr_gdb_frame *frame = sr_gdb_frame_dup(stacktrace->threads->frames, false);
+
+        /* Releasing the stacktrace leaves the arena memory alone. */
+        sr_gdb_stacktrace_free(expected);
+        sr_stacktrace_free((struct sr_stacktrace *)stacktrace);
+        sr_arena_free(arena);
+        g_assert_nonnull(frame->function_name);
+        sr_gdb_frame_free(frame);
+    }
+}
+
 
 int
 main(int    argc,
@@ -244,6 +352,8 @@ main(int    argc,
     g_test_add_func("/stacktrace/gdb/get-crash-frame", test_gdb_stacktrace_get_crash_frame);
     g_test_add_func("/stacktrace/gdb/parse-no-thread-header", test_gdb_stacktrace_parse_no_thread_header);
     g_test_add_func("/stacktrace/gdb/parse-ppc64", test_gdb_stacktrace_parse_ppc64);
+    g_test_add_func("/stacktrace/gdb/parse-sharedlibs", test_gdb_stacktrace_parse_sharedlibs);
+    g_test_add_func("/stacktrace/gdb/parse-arena", test_gdb_stacktrace_parse_arena);
 
     return g_test_run();
 }
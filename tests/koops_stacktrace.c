@@ -5,6 +5,8 @@
 #include "thread.h"
 #include "stacktrace.h"
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include <glib.h>
 
 static void
@@ -777,6 +779,147 @@ test_koops_stacktrace_get_reason(void)
 }
 
 
+struct koops_log
+{
+    const char *text;
+    size_t length;
+    size_t offset;
+};
+
+/* Returns the log in small pieces to split the lines between reads. */
+static ssize_t
+koops_log_read(void *data, void *buffer, size_t size)
+{
+    struct koops_log *log = data;
+
+    size = MIN(MIN(size, 7), log->length - log->offset);
+    memcpy(buffer, log->text + log->offset, size);
+    log->offset += size;
+
+    return size;
+}
+
+static void
+test_koops_stream_next(void)
+{
+    const char *paths[] =
+    {
+        "kerneloopses/github-102",
+        "kerneloopses/rhbz-1518943",
+        "kerneloopses/rhbz-865695-2",
+        "kerneloopses/rhbz-827868",
+    };
+    char *texts[G_N_ELEMENTS(paths)];
+    GString *log = g_string_new("[    0.000000] Linux version 4.14.0\n");
+
+    for (size_t i = 0; i < G_N_ELEMENTS(paths); i++)
+    {
+        char *error_message = NULL;
+
+        texts[i] = sr_file_to_string(paths[i], &error_message);
+        g_assert_nonnull(texts[i]);
+    }
+
+    /* The oops ends at the start of the next one. */
+    g_string_append(log, "------------[ cut here ]------------\n");
+    g_string_append(log, texts[0]);
+    g_string_append(log, texts[1]);
+
+    /* Lines of the journal have a prefix and the oops ends with its end
+     * marker. */
+    for (const char *line = texts[2]; *line; line = strchr(line, '\n') + 1)
+    {
+        g_string_append(log, "Oct 17 10:00:00 localhost kernel: ");
+        g_string_append_len(log, line, strchr(line, '\n') - line + 1);
+    }
+
+    /* The end of a line longer than the buffer is skipped. */
+    g_string_append(log, "e1000e: eth0 NIC Link is Up\n");
+    for (int i = 0; i < 100000; i++)
+        g_string_append_c(log, 'x');
+    g_string_append(log, "BUG: \nsystemd[1]: Started Session 1.\n");
+
+    /* The last oops ends with the log. */
+    g_string_append_len(log, texts[3], strlen(texts[3]) - 1);
+
+    struct koops_log data = { log->str, log->len, 0 };
+    struct sr_koops_stream *stream = sr_koops_stream_new(koops_log_read, &data);
+
+    for (size_t i = 0; i < G_N_ELEMENTS(paths); i++)
+    {
+        char *error_message = NULL;
+        struct sr_koops_stacktrace *stacktrace =
+            sr_koops_stream_next(stream, &error_message);
+        const char *input = texts[i];
+        struct sr_location location;
+
+        g_assert_nonnull(stacktrace);
+        g_assert_null(error_message);
+        g_assert_cmpstr(stacktrace->raw_oops, ==, texts[i]);
+
+        sr_location_init(&location);
+        struct sr_koops_stacktrace *expected =
+            sr_koops_stacktrace_parse(&input, &location);
+
+        g_assert_cmpstr(stacktrace->reason, ==, expected->reason);
+        g_assert_cmpint(sr_thread_frame_count((struct sr_thread *)stacktrace), ==,
+                        sr_thread_frame_count((struct sr_thread *)expected));
+        g_assert_cmpint(sr_thread_frame_count((struct sr_thread *)stacktrace), >, 0);
+        g_assert_cmpint(sr_koops_frame_cmp(stacktrace->frames, expected->frames), ==, 0);
+
+        sr_koops_stacktrace_free(expected);
+        sr_koops_stacktrace_free(stacktrace);
+        g_free(texts[i]);
+    }
+
+    char *error_message = NULL;
+    g_assert_null(sr_koops_stream_next(stream, &error_message));
+    g_assert_null(error_message);
+
+    sr_koops_stream_free(stream);
+    g_string_free(log, TRUE);
+}
+
+static void
+test_koops_stream_fd(void)
+{
+    const char *log =
+        "[   10.000000] usb 1-1: new high-speed USB device number 2\n"
+        /* Markers in the middle of a message do not start an oops. */
+        "[   15.000000] ath9k: DEBUG INFO: calibration done, WARNING: none\n"
+        "[   20.000000] WARNING: CPU: 0 PID: 1 at fs/inode.c:10 iput+0x10/0x20\n"
+        "[   20.000000] Call Trace:\n"
+        "[   20.000000]  [<ffffffff8100f0f0>] dump_stack+0x19/0x1b\n"
+        "[   20.000000]  [<ffffffff8100f1f0>] iput+0x10/0x20\n"
+        "[   20.000000] ---[ end trace 0123456789abcdef ]---\n"
+        "[   30.000000] usb 1-1: USB disconnect, device number 2\n"
+        "<4>[   40.000000] [  T123] xhci_hcd: DEBUG BUG on port 2 ignored\n";
+    int fds[2];
+
+    g_assert_cmpint(pipe(fds), ==, 0);
+    g_assert_cmpint(write(fds[1], log, strlen(log)), ==, strlen(log));
+    close(fds[1]);
+
+    struct sr_koops_stream *stream = sr_koops_stream_new_fd(fds[0]);
+    char *error_message = NULL;
+    struct sr_koops_stacktrace *stacktrace =
+        sr_koops_stream_next(stream, &error_message);
+
+    g_assert_nonnull(stacktrace);
+    g_assert_cmpstr(stacktrace->reason, ==,
+                    "[   20.000000] WARNING: CPU: 0 PID: 1 at fs/inode.c:10 iput+0x10/0x20");
+    g_assert_cmpint(sr_thread_frame_count((struct sr_thread *)stacktrace), ==, 2);
+    g_assert_cmpstr(stacktrace->frames->next->function_name, ==, "iput");
+    sr_koops_stacktrace_free(stacktrace);
+
+    g_assert_null(sr_koops_stream_next(stream, &error_message));
+    g_assert_null(error_message);
+
+    sr_koops_stream_free(stream);
+    close(fds[0]);
+}
+
+
 int
 main(int    argc,
      char **argv)
@@ -788,6 +931,8 @@ main(int    argc,
     g_test_add_func("/stacktrace/koops/to-json", test_koops_stacktrace_to_json);
     g_test_add_func("/thread/get-duphash", test_thread_get_duphash);
     g_test_add_func("/stacktrace/koops/get-reason", test_koops_stacktrace_get_reason);
+    g_test_add_func("/stacktrace/koops/stream-next", test_koops_stream_next);
+    g_test_add_func("/stacktrace/koops/stream-fd", test_koops_stream_fd);
 
     return g_test_run();
 }
@@ -0,0 +1,175 @@
+#include <distance.h>
+#include <gdb/frame.h>
+#include <gdb/thread.h>
+#include <lsh.h>
+#include <thread.h>
+
+#include <glib.h>
+
+static struct sr_gdb_thread *
+create_thread(int frame_count,
+              int first_function)
+{
+    struct sr_gdb_thread *thread;
+
+    thread = sr_gdb_thread_new();
+
+    for (int i = 0; i < frame_count; i++)
+    {
+        struct sr_gdb_frame *frame;
+
+        frame = sr_gdb_frame_new();
+        frame->function_name = g_strdup_printf("func_%d", first_function + i);
+
+        if (NULL == thread->frames)
+        {
+            thread->frames = frame;
+        }
+        else
+        {
+            sr_gdb_frame_append(thread->frames, frame);
+        }
+    }
+
+    return thread;
+}
+
+static void
+test_lsh_index_find(void)
+{
+    struct sr_lsh_index *index;
+    struct sr_gdb_thread *threads[3];
+    struct sr_gdb_thread *query;
+    struct sr_lsh_match *matches;
+    int count;
+
+    /* Threads sharing 0, 9 and 20 of their 20 frames with the query. */
+    threads[0] = create_thread(20, 100);
+    threads[1] = create_thread(20, 11);
+    threads[2] = create_thread(20, 0);
+    query = create_thread(20, 0);
+
+    index = sr_lsh_index_new(0.5);
+    g_assert_cmpint(sr_lsh_index_size(index), ==, 0);
+
+    for (int i = 0; i < 3; i++)
+    {
+        g_assert_cmpint(sr_lsh_index_add(index, (struct sr_thread *)threads[i]), ==, i);
+    }
+
+    g_assert_cmpint(sr_lsh_index_size(index), ==, 3);
+
+    matches = sr_lsh_index_find(index, (struct sr_thread *)query, &count);
+
+    g_assert_cmpint(count, ==, 1);
+    g_assert_cmpint(matches[0].index, ==, 2);
+    g_assert_cmpfloat(matches[0].distance, ==, 0.0);
+    g_free(matches);
+
+    /* The query can be added afterwards. */
+    g_assert_cmpint(sr_lsh_index_add(index, (struct sr_thread *)query), ==, 3);
+
+    matches = sr_lsh_index_find(index, (struct sr_thread *)query, &count);
+
+    g_assert_cmpint(count, ==, 2);
+    g_assert_cmpint(matches[0].index, ==, 2);
+    g_assert_cmpint(matches[1].index, ==, 3);
+    g_free(matches);
+
+    sr_lsh_index_free(index);
+
+    for (int i = 0; i < 3; i++)
+    {
+        sr_gdb_thread_free(threads[i]);
+    }
+
+    sr_gdb_thread_free(query);
+}
+
+static void
+test_lsh_index_find_pairs(void)
+{
+    const int n = 200;
+    const float max_distance = 0.4;
+    struct sr_lsh_index *index;
+    struct sr_gdb_thread **threads;
+    struct sr_lsh_pair *pairs;
+    int count;
+    int expected;
+    guint32 seed = 42;
+
+    threads = g_new(struct sr_gdb_thread *, n);
+    index = sr_lsh_index_new(max_distance);
+
+    /* Threads made of overlapping windows of functions, neighbours in the
+     * array are similar. */
+    for (int i = 0; i < n; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        threads[i] = create_thread(10 + (seed >> 16) % 20, i * 2);
+        sr_lsh_index_add(index, (struct sr_thread *)threads[i]);
+    }
+
+    pairs = sr_lsh_index_find_pairs(index, &count);
+
+    /* All returned pairs are verified and ordered. */
+    for (int k = 0; k < count; k++)
+    {
+        float distance;
+
+        g_assert_cmpint(pairs[k].index1, <, pairs[k].index2);
+        if (k > 0)
+        {
+            g_assert_true(pairs[k - 1].index1 < pairs[k].index1 ||
+                          (pairs[k - 1].index1 == pairs[k].index1 &&
+                           pairs[k - 1].index2 < pairs[k].index2));
+        }
+
+        distance = sr_distance(SR_DISTANCE_JACCARD,
+                               (struct sr_thread *)threads[pairs[k].index1],
+                               (struct sr_thread *)threads[pairs[k].index2]);
+        g_assert_cmpfloat(pairs[k].distance, ==, distance);
+        g_assert_cmpfloat(distance, <=, max_distance);
+    }
+
+    /* Almost all of the similar pairs are found. */
+    expected = 0;
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = i + 1; j < n; j++)
+        {
+            if (sr_distance(SR_DISTANCE_JACCARD,
+                            (struct sr_thread *)threads[i],
+                            (struct sr_thread *)threads[j]) <= max_distance)
+            {
+                ++expected;
+            }
+        }
+    }
+
+    g_assert_cmpint(expected, >, 0);
+    g_assert_cmpint(count, <=, expected);
+    g_assert_cmpint(count, >=, expected * 9 / 10);
+
+    g_free(pairs);
+    sr_lsh_index_free(index);
+
+    for (int i = 0; i < n; i++)
+    {
+        sr_gdb_thread_free(threads[i]);
+    }
+
+    g_free(threads);
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/lsh/index-find", test_lsh_index_find);
+    g_test_add_func("/lsh/index-find-pairs", test_lsh_index_find_pairs);
+
+    return g_test_run();
+}
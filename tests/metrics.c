@@ -4,7 +4,10 @@
 #include <glib.h>
 #include <math.h>
 #include <normalize.h>
+#include <thread.h>
+#include <unistd.h>
 #include <stdbool.h>
+#include <string.h>
 #include <utils.h>
 
 typedef struct
@@ -270,6 +273,538 @@ test_distances_threads_compare(void)
     }
 }
 
+static void
+set_library_names(struct sr_gdb_thread *thread,
+                  ...)
+{
+    va_list argp;
+
+    va_start(argp, thread);
+    for (struct sr_gdb_frame *frame = thread->frames; frame; frame = frame->next)
+    {
+        frame->library_name = g_strdup(va_arg(argp, char *));
+    }
+    va_end(argp);
+}
+
+static void
+test_distances_threads_compare_library_names(void)
+{
+    struct sr_gdb_thread *threads[4];
+    struct sr_distances *distances;
+
+    /* Library names are compared only if both are known, so the frames are
+     * not an equivalence when interned. */
+    threads[0] = create_thread(2, "foo", "bar");
+    set_library_names(threads[0], "liba", "libc");
+    threads[1] = create_thread(2, "foo", "bar");
+    set_library_names(threads[1], NULL, "libc");
+    threads[2] = create_thread(2, "foo", "bar");
+    set_library_names(threads[2], "libb", "libc");
+    threads[3] = create_thread(3, "baz", "foo", "bar");
+    set_library_names(threads[3], NULL, "libb", NULL);
+
+    for (int type = 0; type < SR_DISTANCE_NUM; type++)
+    {
+        distances = sr_threads_compare((struct sr_thread **)threads, 3, 4, type);
+
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = i + 1; j < 4; j++)
+            {
+                float expected;
+
+                expected = sr_distance(type,
+                                       (struct sr_thread *)threads[i],
+                                       (struct sr_thread *)threads[j]);
+
+                g_assert_cmpfloat(sr_distances_get_distance(distances, i, j),
+                                  ==, expected);
+            }
+        }
+
+        sr_distances_free(distances);
+    }
+
+    distances = sr_threads_compare((struct sr_thread **)threads, 3, 4,
+                                   SR_DISTANCE_LEVENSHTEIN);
+
+    g_assert_cmpfloat(sr_distances_get_distance(distances, 0, 1), ==, 0.0);
+    g_assert_cmpfloat(sr_distances_get_distance(distances, 1, 2), ==, 0.0);
+    g_assert_cmpfloat_with_epsilon(sr_distances_get_distance(distances, 0, 2),
+                                   0.5, FLT_EPSILON);
+
+    sr_distances_free(distances);
+
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+    {
+        sr_gdb_thread_free(threads[i]);
+    }
+}
+
+static struct sr_gdb_thread **
+create_random_threads(int count,
+                      int max_frame_count,
+                      int symbol_count)
+{
+    struct sr_gdb_thread **threads;
+    guint32 seed = 42;
+
+    threads = g_new(struct sr_gdb_thread *, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        int frame_count;
+        char **function_names;
+
+        seed = seed * 1103515245 + 12345;
+        frame_count = 1 + (seed >> 16) % max_frame_count;
+        function_names = g_new0(char *, frame_count + 1);
+
+        for (int j = 0; j < frame_count; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            function_names[j] = g_strdup_printf("func_%u", (seed >> 16) % symbol_count);
+        }
+
+        threads[i] = create_threadv(frame_count, function_names);
+        g_strfreev(function_names);
+    }
+
+    return threads;
+}
+
+static void
+free_threads(struct sr_gdb_thread **threads,
+             int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        sr_gdb_thread_free(threads[i]);
+    }
+
+    g_free(threads);
+}
+
+static void
+test_distances_threads_compare_parallel(void)
+{
+    const int m = 40;
+    const int n = 60;
+    struct sr_gdb_thread **threads;
+
+    threads = create_random_threads(n, 20, 30);
+
+    for (int type = 0; type < SR_DISTANCE_NUM; type++)
+    {
+        struct sr_distances *reference;
+
+        reference = sr_threads_compare((struct sr_thread **)threads, m, n, type);
+
+        for (unsigned nthreads = 0; nthreads <= 8; nthreads++)
+        {
+            struct sr_distances *distances;
+
+            distances = sr_threads_compare_parallel((struct sr_thread **)threads,
+                                                    m, n, type, nthreads);
+
+            g_assert_cmpint(distances->m, ==, reference->m);
+            g_assert_cmpint(distances->n, ==, reference->n);
+
+            for (int i = 0; i < m; i++)
+            {
+                for (int j = i + 1; j < n; j++)
+                {
+                    float lhs;
+                    float rhs;
+
+                    lhs = sr_distances_get_distance(distances, i, j);
+                    rhs = sr_distances_get_distance(reference, i, j);
+
+                    g_assert_true(0 == memcmp(&lhs, &rhs, sizeof (lhs)));
+                }
+            }
+
+            sr_distances_free(distances);
+        }
+
+        sr_distances_free(reference);
+    }
+
+    free_threads(threads, n);
+}
+
+static void
+test_distances_threads_compare_duplicates(void)
+{
+    const int n = 50;
+    const int ms[] = { 1, 10, n - 1 };
+    struct sr_gdb_thread **threads;
+
+    /* Few short threads over a small alphabet, most of them are
+     * duplicates. */
+    threads = create_random_threads(n, 3, 3);
+
+    for (int type = 0; type < SR_DISTANCE_NUM; type++)
+    {
+        for (size_t k = 0; k < G_N_ELEMENTS(ms); k++)
+        {
+            for (unsigned nthreads = 1; nthreads <= 4; nthreads *= 4)
+            {
+                struct sr_distances *distances;
+
+                distances = sr_threads_compare_parallel((struct sr_thread **)threads,
+                                                        ms[k], n, type, nthreads);
+
+                for (int i = 0; i < ms[k]; i++)
+                {
+                    for (int j = i + 1; j < n; j++)
+                    {
+                        float lhs;
+                        float rhs;
+
+                        lhs = sr_distances_get_distance(distances, i, j);
+                        rhs = sr_distance(type, (struct sr_thread *)threads[i],
+                                          (struct sr_thread *)threads[j]);
+
+                        g_assert_true(0 == memcmp(&lhs, &rhs, sizeof (lhs)));
+                    }
+                }
+
+                sr_distances_free(distances);
+            }
+        }
+    }
+
+    free_threads(threads, n);
+}
+
+static void
+test_distances_threads_compare_extend(void)
+{
+    const int old_n = 25;
+    const int n = 40;
+    const int ms[] = { 5, old_n - 1 };
+    struct sr_gdb_thread **threads;
+
+    threads = create_random_threads(n, 10, 15);
+
+    for (size_t k = 0; k < G_N_ELEMENTS(ms); k++)
+    {
+        struct sr_distances *old_distances;
+        struct sr_distances *distances;
+        struct sr_distances *reference;
+
+        old_distances = sr_threads_compare((struct sr_thread **)threads,
+                                           ms[k], old_n,
+                                           SR_DISTANCE_LEVENSHTEIN);
+        distances = sr_threads_compare_extend(old_distances,
+                                              (struct sr_thread **)threads,
+                                              n, SR_DISTANCE_LEVENSHTEIN);
+        reference = sr_threads_compare((struct sr_thread **)threads,
+                                       ms[k] + 1 == old_n ? n - 1 : ms[k], n,
+                                       SR_DISTANCE_LEVENSHTEIN);
+
+        g_assert_cmpint(distances->m, ==, reference->m);
+        g_assert_cmpint(distances->n, ==, reference->n);
+
+        for (int i = 0; i < reference->m; i++)
+        {
+            for (int j = i + 1; j < n; j++)
+            {
+                g_assert_cmpfloat(sr_distances_get_distance(distances, i, j), ==,
+                                  sr_distances_get_distance(reference, i, j));
+            }
+        }
+
+        sr_distances_free(old_distances);
+        sr_distances_free(distances);
+        sr_distances_free(reference);
+    }
+
+    free_threads(threads, n);
+}
+
+static void
+test_distances_bounded(void)
+{
+    const int n = 30;
+    const float bounds[] = { 0.0, 0.2, 0.5, 0.8 };
+    struct sr_gdb_thread **threads;
+
+    threads = create_random_threads(n, 40, 20);
+
+    for (int type = 0; type < SR_DISTANCE_NUM; type++)
+    {
+        for (size_t k = 0; k < G_N_ELEMENTS(bounds); k++)
+        {
+            struct sr_distances *reference;
+            struct sr_distances *distances;
+
+            reference = sr_threads_compare((struct sr_thread **)threads, n - 1, n, type);
+            distances = sr_threads_compare_bounded((struct sr_thread **)threads, n - 1, n,
+                                                   type, bounds[k]);
+
+            for (int i = 0; i < n - 1; i++)
+            {
+                for (int j = i + 1; j < n; j++)
+                {
+                    float exact;
+                    float bounded;
+
+                    exact = sr_distances_get_distance(reference, i, j);
+                    bounded = sr_distance_bounded(type,
+                                                  (struct sr_thread *)threads[i],
+                                                  (struct sr_thread *)threads[j],
+                                                  bounds[k]);
+
+                    g_assert_cmpfloat(sr_distances_get_distance(distances, i, j), ==, bounded);
+
+                    /* Jaro-Winkler distance is never bounded. */
+                    if (exact <= bounds[k] || type == SR_DISTANCE_JARO_WINKLER)
+                    {
+                        g_assert_cmpfloat(bounded, ==, exact);
+                    }
+                    else
+                    {
+                        g_assert_cmpfloat(bounded, >, bounds[k]);
+                        g_assert_cmpfloat(bounded, <=, exact);
+                    }
+                }
+            }
+
+            sr_distances_free(reference);
+            sr_distances_free(distances);
+        }
+    }
+
+    free_threads(threads, n);
+}
+
+static void
+test_distances_file(void)
+{
+    const int n = 30;
+    const enum sr_distances_encoding encodings[] = {
+        SR_DISTANCES_FLOAT32,
+        SR_DISTANCES_FLOAT16,
+        SR_DISTANCES_UINT8,
+    };
+    const float tolerances[] = { 0.0, 1e-3, 0.5 / 255 };
+    struct sr_gdb_thread **threads;
+    struct sr_distances *reference;
+    char *path;
+    int fd;
+
+    threads = create_random_threads(n, 10, 15);
+    reference = sr_threads_compare((struct sr_thread **)threads, n - 1, n,
+                                   SR_DISTANCE_JACCARD);
+
+    fd = g_file_open_tmp("satyr-distances-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    for (size_t k = 0; k < G_N_ELEMENTS(encodings); k++)
+    {
+        struct sr_distances_part *parts;
+        struct sr_distances *distances;
+        enum sr_distance_type dist_type;
+        char *error_message = NULL;
+
+        /* Whole matrix at once. */
+        g_assert_true(sr_distances_save(reference, path, SR_DISTANCE_JACCARD,
+                                        encodings[k], &error_message));
+
+        distances = sr_distances_load(path, &dist_type, &error_message);
+        g_assert_nonnull(distances);
+        g_assert_cmpint(dist_type, ==, SR_DISTANCE_JACCARD);
+        g_assert_cmpint(distances->m, ==, n - 1);
+        g_assert_cmpint(distances->n, ==, n);
+
+        for (int i = 0; i < n - 1; i++)
+        {
+            for (int j = i + 1; j < n; j++)
+            {
+                g_assert_cmpfloat_with_epsilon(sr_distances_get_distance(distances, i, j),
+                                               sr_distances_get_distance(reference, i, j),
+                                               tolerances[k] + FLT_EPSILON);
+            }
+        }
+
+        sr_distances_free(distances);
+
+        /* By parts in reverse order. */
+        g_assert_true(sr_distances_file_create(path, n - 1, n,
+                                               SR_DISTANCE_JACCARD,
+                                               encodings[k], &error_message));
+
+        parts = sr_distances_part_create(n - 1, n, SR_DISTANCE_JACCARD, 4);
+        for (struct sr_distances_part *part = parts; part; part = part->next)
+        {
+            sr_distances_part_compute(part, (struct sr_thread **)threads);
+        }
+
+        for (int p = 3; p >= 0; p--)
+        {
+            struct sr_distances_part *part = parts;
+
+            for (int q = 0; q < p; q++)
+            {
+                part = part->next;
+            }
+
+            /* Parts computed from other threads are rejected. */
+            if (p == 0)
+            {
+                part->checksum++;
+                g_assert_false(sr_distances_file_write_part(path, part,
+                                                            &error_message));
+                g_assert_nonnull(error_message);
+                g_free(error_message);
+                error_message = NULL;
+                part->checksum--;
+            }
+
+            g_assert_true(sr_distances_file_write_part(path, part,
+                                                       &error_message));
+        }
+
+        sr_distances_part_free(parts, true);
+
+        /* Incomplete files are rejected. */
+        g_assert_null(sr_distances_load(path, NULL, &error_message));
+        g_assert_nonnull(error_message);
+        g_free(error_message);
+        error_message = NULL;
+
+        g_assert_true(sr_distances_file_finish(path, &error_message));
+
+        distances = sr_distances_load(path, NULL, &error_message);
+        g_assert_nonnull(distances);
+
+        for (int i = 0; i < n - 1; i++)
+        {
+            for (int j = i + 1; j < n; j++)
+            {
+                g_assert_cmpfloat_with_epsilon(sr_distances_get_distance(distances, i, j),
+                                               sr_distances_get_distance(reference, i, j),
+                                               tolerances[k] + FLT_EPSILON);
+            }
+        }
+
+        sr_distances_free(distances);
+    }
+
+    unlink(path);
+    g_free(path);
+    sr_distances_free(reference);
+    free_threads(threads, n);
+}
+
+static int
+levenshtein_reference(struct sr_gdb_thread *thread1,
+                      struct sr_gdb_thread *thread2)
+{
+    int m = sr_thread_frame_count((struct sr_thread *)thread1);
+    int n = sr_thread_frame_count((struct sr_thread *)thread2);
+    int *row = g_new(int, n + 1);
+    struct sr_gdb_frame *frame1;
+    int result;
+
+    for (int j = 0; j <= n; j++)
+    {
+        row[j] = j;
+    }
+
+    frame1 = thread1->frames;
+    for (int i = 1; i <= m; i++, frame1 = frame1->next)
+    {
+        struct sr_gdb_frame *frame2 = thread2->frames;
+        int diagonal = row[0];
+
+        row[0] = i;
+
+        for (int j = 1; j <= n; j++, frame2 = frame2->next)
+        {
+            int cost = g_strcmp0(frame1->function_name,
+                                 frame2->function_name) == 0 ? 0 : 1;
+            int value = MIN(diagonal + cost, MIN(row[j], row[j - 1]) + 1);
+
+            diagonal = row[j];
+            row[j] = value;
+        }
+    }
+
+    result = row[n];
+    g_free(row);
+
+    return result;
+}
+
+static void
+test_distances_levenshtein_long_threads(void)
+{
+    const int n = 12;
+    struct sr_gdb_thread **threads;
+
+    /* Cover both the single word and the multi-word bit-parallel paths. */
+    threads = create_random_threads(n, 200, 20);
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            int frame_count1 = sr_thread_frame_count((struct sr_thread *)threads[i]);
+            int frame_count2 = sr_thread_frame_count((struct sr_thread *)threads[j]);
+            float expected;
+            float distance;
+
+            expected = (float)levenshtein_reference(threads[i], threads[j]) /
+                       MAX(frame_count1, frame_count2);
+            distance = sr_distance(SR_DISTANCE_LEVENSHTEIN,
+                                   (struct sr_thread *)threads[i],
+                                   (struct sr_thread *)threads[j]);
+
+            g_assert_cmpfloat(distance, ==, expected);
+        }
+    }
+
+    free_threads(threads, n);
+}
+
+static void
+test_distances_threads_compare_parallel_perf(void)
+{
+    const int n = 2000;
+    struct sr_gdb_thread **threads;
+    double serial = 0.0;
+
+    threads = create_random_threads(n, 40, 200);
+
+    for (unsigned nthreads = 1; nthreads <= 16; nthreads *= 2)
+    {
+        struct sr_distances *distances;
+        double elapsed;
+
+        g_test_timer_start();
+        distances = sr_threads_compare_parallel((struct sr_thread **)threads,
+                                                n, n, SR_DISTANCE_LEVENSHTEIN,
+                                                nthreads);
+        elapsed = g_test_timer_elapsed();
+
+        if (nthreads == 1)
+            serial = elapsed;
+
+        g_test_minimized_result(elapsed,
+                                "%u threads: %.3f s, speedup %.2f",
+                                nthreads, elapsed, serial / elapsed);
+
+        sr_distances_free(distances);
+    }
+
+    free_threads(threads, n);
+}
+
 static void
 test_distances_part_divide(void)
 {
@@ -399,6 +934,115 @@ test_distances_part_conquer(void)
     }
 }
 
+static void
+test_distances_part_checkpoint(void)
+{
+    const int n = 30;
+    struct sr_gdb_thread **threads;
+    struct sr_gdb_thread **other_threads;
+    struct sr_distances *reference;
+    struct sr_distances_part *parts;
+    struct sr_distances_part *part;
+    struct sr_distances *distances;
+    char *error_message = NULL;
+    char *path;
+    int fd;
+
+    threads = create_random_threads(n, 10, 15);
+    other_threads = create_random_threads(n, 16, 20);
+    reference = sr_threads_compare((struct sr_thread **)threads, n - 1, n,
+                                   SR_DISTANCE_JACCARD);
+
+    fd = g_file_open_tmp("satyr-distances-part-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    parts = sr_distances_part_create(n - 1, n, SR_DISTANCE_JACCARD, 3);
+
+    for (part = parts; part; part = part->next)
+    {
+        struct sr_distances_part *loaded;
+        size_t half;
+
+        g_assert_true(sr_distances_part_compute_checkpointed(part,
+                                                             (struct sr_thread **)threads,
+                                                             path, 7,
+                                                             &error_message));
+
+        loaded = sr_distances_part_load(path, &error_message);
+        g_assert_nonnull(loaded);
+        g_assert_cmpint(loaded->m_begin, ==, part->m_begin);
+        g_assert_cmpint(loaded->n_begin, ==, part->n_begin);
+        g_assert_cmpuint(loaded->len, ==, part->len);
+        g_assert_cmpuint(loaded->done, ==, part->len);
+        g_assert_cmpuint(loaded->checksum, ==, part->checksum);
+
+        /* Interrupt the computation in the middle and resume it. */
+        half = loaded->len / 2;
+        for (size_t k = half; k < loaded->len; k++)
+        {
+            loaded->distances[k] = -1.0;
+        }
+
+        loaded->done = half;
+        g_assert_true(sr_distances_part_save(loaded, path, &error_message));
+        sr_distances_part_free(loaded, false);
+
+        loaded = sr_distances_part_load(path, &error_message);
+        g_assert_nonnull(loaded);
+        g_assert_cmpuint(loaded->done, ==, half);
+
+        /* Different threads are rejected. */
+        if (half > 0)
+        {
+            g_assert_false(sr_distances_part_compute_checkpointed(loaded,
+                                                                  (struct sr_thread **)other_threads,
+                                                                  path, 7,
+                                                                  &error_message));
+            g_assert_nonnull(error_message);
+            g_free(error_message);
+            error_message = NULL;
+        }
+
+        sr_distances_part_compute(loaded, (struct sr_thread **)threads);
+        g_assert_cmpuint(loaded->done, ==, loaded->len);
+
+        for (size_t k = 0; k < loaded->len; k++)
+        {
+            g_assert_cmpfloat(loaded->distances[k], ==, part->distances[k]);
+        }
+
+        sr_distances_part_free(loaded, false);
+    }
+
+    distances = sr_distances_part_merge(parts);
+    g_assert_nonnull(distances);
+
+    for (int i = 0; i < n - 1; i++)
+    {
+        for (int j = i + 1; j < n; j++)
+        {
+            g_assert_cmpfloat(sr_distances_get_distance(distances, i, j), ==,
+                              sr_distances_get_distance(reference, i, j));
+        }
+    }
+
+    /* Files of other kinds are rejected. */
+    g_assert_true(sr_distances_save(reference, path, SR_DISTANCE_JACCARD,
+                                    SR_DISTANCES_FLOAT32, &error_message));
+    g_assert_null(sr_distances_part_load(path, &error_message));
+    g_assert_nonnull(error_message);
+    g_free(error_message);
+
+    unlink(path);
+    g_free(path);
+    sr_distances_free(distances);
+    sr_distances_part_free(parts, true);
+    sr_distances_free(reference);
+    free_threads(threads, n);
+    free_threads(other_threads, n);
+}
+
 int
 main(int    argc,
      char **argv)
@@ -511,9 +1155,29 @@ main(int    argc,
 
     g_test_add_func("/distances/basic-properties", test_distances_basic_properties);
     g_test_add_func("/distances/threads-compare", test_distances_threads_compare);
+    g_test_add_func("/distances/threads-compare/library-names",
+                    test_distances_threads_compare_library_names);
+
+    g_test_add_func("/distances/threads-compare/duplicates",
+                    test_distances_threads_compare_duplicates);
+    g_test_add_func("/distances/threads-compare/extend",
+                    test_distances_threads_compare_extend);
+    g_test_add_func("/distances/levenshtein/long-threads",
+                    test_distances_levenshtein_long_threads);
+
+    g_test_add_func("/distances/threads-compare/parallel",
+                    test_distances_threads_compare_parallel);
+    if (g_test_perf())
+    {
+        g_test_add_func("/distances/threads-compare/parallel/perf",
+                        test_distances_threads_compare_parallel_perf);
+    }
 
     g_test_add_func("/distances/part/divide", test_distances_part_divide);
+    g_test_add_func("/distances/bounded", test_distances_bounded);
+    g_test_add_func("/distances/file", test_distances_file);
     g_test_add_func("/distances/part/conquer", test_distances_part_conquer);
+    g_test_add_func("/distances/part/checkpoint", test_distances_part_checkpoint);
 
     exit_code = g_test_run();
 